@@ -9,6 +9,7 @@
 #include "Debug/Debug.h"
 #include "Physics/Physics.h"
 #include "Rendering/Graphics.h"
+#include "ResourceManagement/FileSystem.h"
 #include "ResourceManagement/Resources.h"
 
 #include "LayerManager.h"
@@ -23,13 +24,19 @@ bool App::Initialize(UniquePtr<Game>&& game)
 {
 	_isRunning = false;
 
-	LayerManager::Initialize();
-
 	if (!gDebug.Initialize())
 	{
 		return false;
 	}
 
+	if (!gFileSystem.Initialize())
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot initialize file system"));
+		return false;
+	}
+
+	LayerManager::Initialize();
+
 	if (!gWindow.Open(DT_TEXT("DT Engine"), 1600, 900))
 	{
 		gDebug.Print(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot open window"));
@@ -60,7 +67,11 @@ bool App::Initialize(UniquePtr<Game>&& game)
 		return false;
 	}
 
-	gDebug.InitializeDraws();
+	if (!gDebug.InitializeDraws())
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot initialize debug draws"));
+		return false;
+	}
 
 	gTime.Initialize();
 
@@ -91,6 +102,8 @@ void App::Loop()
 	{
 		MessageSystem::GatherMessages();
 
+		gResources.Update();
+
 		gDebug.Update(deltaTime);
 
 		gPhysics.Update(deltaTime);
@@ -126,8 +139,10 @@ void App::Shutdown()
 
 	gPhysics.Shutdown();
 
+	gDebug.ShutdownDraws();
 	gGraphics.Shutdown();
 	gResources.Shutdown();
+	gFileSystem.Shutdown();
 
 	gWindow.Hide();
 	gWindow.Close();
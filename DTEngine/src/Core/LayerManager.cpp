@@ -2,6 +2,8 @@
 
 #include <fstream>
 
+#include "ResourceManagement/FileSystem.h"
+
 String LayerManager::_layers[MAX_LAYERS];
 LayerID LayerManager::ALL = 0;
 
@@ -16,9 +18,10 @@ void LayerManager::Initialize()
 		ALL |= (1 << i);
 	}
 
-	std::ifstream file(LAYER_MANAGER_FILENAME);
-	if (file.is_open())
+	std::string text;
+	if (gFileSystem.ReadTextFile(LAYER_MANAGER_FILENAME, text))
 	{
+		std::istringstream file(text);
 		std::string lineStr;
 		int i = 0;
 		while (std::getline(file, lineStr) && i < MAX_LAYERS)
@@ -28,7 +31,6 @@ void LayerManager::Initialize()
 			++i;
 		}
 	}
-	file.close();
 }
 
 void LayerManager::Save()
@@ -2,10 +2,6 @@
 
 #include "Rendering/Graphics.h"
 #include "Rendering/MeshBase.h"
-#include "Rendering/Material.h"
-#include "ResourceManagement/Resources.h"
-#include "Rendering/Meshes/CubeMesh.h"
-#include "Rendering/Meshes/SphereMesh.h"
 
 const String CHANNEL_ENGINE = DT_TEXT("Engine");
 const String CHANNEL_GRAPHICS = DT_TEXT("Graphics");
@@ -17,71 +13,144 @@ const String CHANNEL_GENERAL = DT_TEXT("General");
 
 Debug gDebug;
 
-DebugDrawGeometry::DebugDrawGeometry(SharedPtr<MeshBase> mesh, Vector3 position, Quaternion rotation, Vector3 scale, Vector4 color, float lifetime) : _mesh(mesh), _lifetime(lifetime)
-{
-	_worldMatrix = Matrix::FromScale(scale) * rotation.ToMatrix() * Matrix::FromTranslation(position);
-
-	_material = std::make_unique<Material>();
-	_material->SetRenderStateParams(RenderStateParams(CullMode::None, FillMode::Wireframe, ZWrite::Off, BlendMode::SrcAlpha, BlendMode::InvSrcAlpha, CompareFunction::Always));
-	_material->Initialize();
-	_material->SetColor(color);
-}
-
-DebugDrawGeometry::DebugDrawGeometry(DebugDrawGeometry&& other) : _mesh(std::move(other._mesh)), _lifetime(other._lifetime), _worldMatrix(other._worldMatrix), _material(std::move(other._material))
-{}
+// Segments of each of the three circles drawn for a sphere
+static const unsigned int SPHERE_CIRCLE_SEGMENTS = 24;
 
-DebugDrawGeometry::~DebugDrawGeometry()
+// Adds 12 edges of a box, bits of corner index select max or min along each axis (as in BoundingBox::GetCorner)
+static void AddBoxLines(DebugRenderer& renderer, const Vector3 (&corners)[BoundingBox::CORNERS_COUNT], const Vector4& color, DebugDepthMode depthMode)
 {
-	if (_material)
+	for (unsigned char i = 0; i < BoundingBox::CORNERS_COUNT; ++i)
 	{
-		_material->Shutdown();
+		for (unsigned char axisBit = 1; axisBit < BoundingBox::CORNERS_COUNT; axisBit <<= 1)
+		{
+			if ((i & axisBit) == 0)
+			{
+				renderer.AddLine(corners[i], corners[i | axisBit], color, depthMode);
+			}
+		}
 	}
-	_material = nullptr;
 }
 
-void DebugDrawGeometry::Render(Graphics& graphics) const
+void Debug::UpdateDraws(float deltaTime)
 {
-	graphics.SetObject(nullptr);
-	graphics.SetMaterial(_material.get());
+	_drawsRenderer.Clear();
 
-	static const String MODEL_TO_WORLD_MATRIX_NAME = DT_TEXT("Model2WorldMatrix");
-	_material->SetMatrix(MODEL_TO_WORLD_MATRIX_NAME, _worldMatrix);
+	unsigned int shapesCount = (unsigned int)_timedShapes.size();
+	for (unsigned int i = 0; i < shapesCount;)
+	{
+		DebugShape& shape = _timedShapes[i];
+		shape.Lifetime -= deltaTime;
+		if (shape.Lifetime <= 0.0f)
+		{
+			--shapesCount;
+			if (i != shapesCount)
+			{
+				shape = std::move(_timedShapes[shapesCount]);
+			}
+			_timedShapes.pop_back();
+			continue;
+		}
 
-	_material->UpdatePerDrawCallBuffers(graphics);
-	graphics.DrawIndexed(_mesh->GetVertexBuffer(), _mesh->GetIndexBuffer(), _mesh->GetIndicesCount(), _mesh->GetVertexTypeSize(), 0);
+		AddShapeVertices(shape);
+		++i;
+	}
 }
 
-DebugDrawGeometry& DebugDrawGeometry::operator=(const DebugDrawGeometry& other)
+void Debug::AddShapeVertices(const DebugShape& shape)
 {
-	_mesh = other._mesh;
+	switch (shape.Type)
+	{
+		case DebugShapeType::Line:
+			_drawsRenderer.AddLine(shape.Position, shape.Size, shape.Color, shape.DepthMode);
+			break;
 
-	_material = std::make_unique<Material>();
-	_material->SetColor(other._material->GetColor());
-	_material->SetRenderStateParams(RenderStateParams(CullMode::None, FillMode::Wireframe, ZWrite::Off, BlendMode::SrcAlpha, BlendMode::InvSrcAlpha, CompareFunction::Always));
-	_material->Initialize();
+		case DebugShapeType::Cube:
+		{
+			const BoundingBox box(shape.Size * -0.5f, shape.Size * 0.5f);
+			Vector3 corners[BoundingBox::CORNERS_COUNT];
+			for (unsigned char i = 0; i < BoundingBox::CORNERS_COUNT; ++i)
+			{
+				corners[i] = box.GetCorner(i) * shape.Rotation + shape.Position;
+			}
+			AddBoxLines(_drawsRenderer, corners, shape.Color, shape.DepthMode);
+			break;
+		}
 
-	_worldMatrix = other._worldMatrix;
-	_lifetime = other._lifetime;
+		case DebugShapeType::Sphere:
+		{
+			// Circles around X, Y and Z axes
+			const float radius = shape.Size.X;
+			const float angleStep = Math::TWO_PI / SPHERE_CIRCLE_SEGMENTS;
+			Vector3 previous[3] = {shape.Position + Vector3(0.0f, radius, 0.0f), shape.Position + Vector3(radius, 0.0f, 0.0f), shape.Position + Vector3(0.0f, radius, 0.0f)};
+			for (unsigned int i = 1; i <= SPHERE_CIRCLE_SEGMENTS; ++i)
+			{
+				const float cosine = Math::Cos(i * angleStep) * radius;
+				const float sine = Math::Sin(i * angleStep) * radius;
+				const Vector3 current[3] = {shape.Position + Vector3(0.0f, cosine, sine), shape.Position + Vector3(cosine, 0.0f, sine), shape.Position + Vector3(sine, cosine, 0.0f)};
+				for (unsigned char j = 0; j < 3; ++j)
+				{
+					_drawsRenderer.AddLine(previous[j], current[j], shape.Color, shape.DepthMode);
+					previous[j] = current[j];
+				}
+			}
+			break;
+		}
 
-	return *this;
+		case DebugShapeType::Mesh:
+		{
+			if (!shape.Mesh)
+			{
+				break;
+			}
+
+			const Matrix modelToWorld = Matrix::FromScale(shape.Size) * shape.Rotation.ToMatrix() * Matrix::FromTranslation(shape.Position);
+			const MeshBase& mesh = *shape.Mesh;
+
+			// Meshes which released their CPU data are drawn as their bounds
+			if (mesh.GetVertices() == nullptr || mesh.GetIndices() == nullptr)
+			{
+				Vector3 corners[BoundingBox::CORNERS_COUNT];
+				for (unsigned char i = 0; i < BoundingBox::CORNERS_COUNT; ++i)
+				{
+					const Vector4 corner = Vector4(mesh.GetBoundingBox().GetCorner(i), 1.0f) * modelToWorld;
+					corners[i] = Vector3(corner.X, corner.Y, corner.Z);
+				}
+				AddBoxLines(_drawsRenderer, corners, shape.Color, shape.DepthMode);
+				break;
+			}
+
+			const MeshBase::VertexType* vertices = mesh.GetVertices();
+			const unsigned int* indices = mesh.GetIndices();
+			Vector3 triangle[3];
+			for (unsigned int i = 0; i < mesh.GetIndicesCount(); ++i)
+			{
+				const Vector4 position = Vector4(vertices[indices[i]].Position, 1.0f) * modelToWorld;
+				triangle[i % 3] = Vector3(position.X, position.Y, position.Z);
+				if (i % 3 == 2)
+				{
+					_drawsRenderer.AddTriangle(triangle[0], triangle[1], triangle[2], shape.Color, shape.DepthMode);
+				}
+			}
+			break;
+		}
+	}
 }
 
-void Debug::UpdateDraws(float deltaTime)
+void Debug::AddShape(const DebugShape& shape)
 {
-	const int drawsCount = (int)_draws.size();
-	for (int i = drawsCount - 1; i >= 0; --i)
+	AddShapeVertices(shape);
+
+	if (shape.Lifetime > 0.0f)
 	{
-		_draws[i]._lifetime -= deltaTime;
-		if (_draws[i]._lifetime <= 0.0f)
-		{
-			_draws.erase(_draws.begin() + i);
-		}
+		_timedShapes.push_back(shape);
 	}
 }
 
 bool Debug::Initialize()
 {
 #if DT_DEBUG
+	_mainThreadID = std::this_thread::get_id();
+
 	RegisterChannel(CHANNEL_ENGINE);
 	RegisterChannel(CHANNEL_GRAPHICS);
 	RegisterChannel(CHANNEL_AUDIO);
@@ -97,14 +166,21 @@ bool Debug::Initialize()
 bool Debug::InitializeDraws()
 {
 #if DT_DEBUG
-	_cube = gResources.Get<CubeMesh>();
-	_sphere = gResources.Get<SphereMesh>();
-#endif
+	return _drawsRenderer.Initialize(gGraphics);
+#else
 	return true;
+#endif
+}
+
+void Debug::ShutdownDraws()
+{
+	_timedShapes.clear();
+	_drawsRenderer.Shutdown();
 }
 
 void Debug::Shutdown()
 {
+	_pendingLogs.clear();
 	_channels.clear();
 	_logsPerChannel.clear();
 }
@@ -112,31 +188,60 @@ void Debug::Shutdown()
 void Debug::Update(float deltaTime)
 {
 #if DT_DEBUG
+	FlushPendingLogs();
 	UpdateDraws(deltaTime);
 #endif
 }
 
+void Debug::FlushPendingLogs()
+{
+	DynamicArray<Pair<Channel, Log>> pendingLogs;
+	{
+		std::lock_guard<std::mutex> lock(_logMutex);
+		pendingLogs.swap(_pendingLogs);
+	}
+
+	// Lock is not held, so handlers may log themselves
+	for (const auto& pendingLog : pendingLogs)
+	{
+		OnLogged.Execute(pendingLog.first, pendingLog.second);
+	}
+}
+
 void Debug::Print(LogVerbosity verbosity, const String& channel, const String& message)
 {
 #if DT_DEBUG
-	DT_ASSERT(_channels.find(channel) != _channels.end(), DT_TEXT("Channel does not exist!"));
-
 	Log l(verbosity, message);
-	const Channel& channelRef = _channels[channel];
+	Channel channelCopy;
+	{
+		std::lock_guard<std::mutex> lock(_logMutex);
 
-	_logsPerChannel[channelRef].push_back(l);
-	OnLogged.Execute(channelRef, l);
+		DT_ASSERT(_channels.find(channel) != _channels.end(), DT_TEXT("Channel does not exist!"));
 
-	if (channelRef.Visible)
-	{
-		String s = channel;
-		s += DT_TEXT(": ");
-		s += EnumInfo<LogVerbosity>::ToString(verbosity);
-		s += DT_TEXT(" - ");
-		s += message;
-		s += DT_TEXT("\n");
-		OutputDebugString(s.c_str());
+		const Channel& channelRef = _channels[channel];
+		_logsPerChannel[channelRef].push_back(l);
+
+		if (channelRef.Visible)
+		{
+			String s = channel;
+			s += DT_TEXT(": ");
+			s += EnumInfo<LogVerbosity>::ToString(verbosity);
+			s += DT_TEXT(" - ");
+			s += message;
+			s += DT_TEXT("\n");
+			OutputDebugString(s.c_str());
+		}
+
+		// Handlers are not thread safe, loading threads leave the log for main thread
+		if (std::this_thread::get_id() != _mainThreadID)
+		{
+			_pendingLogs.emplace_back(channelRef, l);
+			return;
+		}
+		channelCopy = channelRef;
 	}
+
+	OnLogged.Execute(channelCopy, l);
 #endif
 }
 
@@ -167,38 +272,48 @@ void Debug::SetChannelVisibility(const String& name, bool visibility)
 #if DT_DEBUG
 	DT_ASSERT(_channels.find(name) != _channels.end(), DT_TEXT("Channel does not exist!"));
 
-	Channel& channel = _channels[name];
-	channel.Visible = visibility;
+	Channel channel;
+	{
+		// Printing threads read visibility
+		std::lock_guard<std::mutex> lock(_logMutex);
+		_channels[name].Visible = visibility;
+		channel = _channels[name];
+	}
 	OnChannelVisibilityChanged.Execute(channel);
 #endif
 }
 
-void Debug::DrawMesh(const Vector3& position, SharedPtr<MeshBase> mesh, const Vector3& size, const Quaternion& rotation, const Vector4& color, float lifetime)
+void Debug::DrawMesh(const Vector3& position, SharedPtr<MeshBase> mesh, const Vector3& size, const Quaternion& rotation, const Vector4& color, float lifetime, DebugDepthMode depthMode)
+{
+#if DT_DEBUG
+	AddShape({DebugShapeType::Mesh, depthMode, position, size, rotation, color, mesh, lifetime});
+#endif
+}
+
+void Debug::DrawCube(const Vector3& center, const Vector3& size, const Quaternion& rotation, const Vector4& color, float lifetime, DebugDepthMode depthMode)
 {
 #if DT_DEBUG
-	_draws.push_back(std::move(DebugDrawGeometry(mesh, position, rotation, size, color, lifetime)));
+	AddShape({DebugShapeType::Cube, depthMode, center, size, rotation, color, nullptr, lifetime});
 #endif
 }
 
-void Debug::DrawCube(const Vector3& center, const Vector3& size, const Quaternion& rotation, const Vector4& color, float lifetime)
+void Debug::DrawSphere(const Vector3& center, float radius, const Vector4& color, float lifetime, DebugDepthMode depthMode)
 {
 #if DT_DEBUG
-	_draws.push_back(std::move(DebugDrawGeometry(_cube, center, rotation, size, color, lifetime)));
+	AddShape({DebugShapeType::Sphere, depthMode, center, Vector3(radius, radius, radius), Quaternion::IDENTITY, color, nullptr, lifetime});
 #endif
 }
 
-void Debug::DrawSphere(const Vector3& center, float radius, const Vector4& color, float lifetime)
+void Debug::DrawLine(const Vector3& start, const Vector3& end, const Vector4& color, float lifetime, DebugDepthMode depthMode)
 {
 #if DT_DEBUG
-	_draws.push_back(std::move(DebugDrawGeometry(_sphere, center, Quaternion::IDENTITY, Vector3(radius * 2.0f, radius * 2.0f, radius * 2.0f), color, lifetime)));
+	AddShape({DebugShapeType::Line, depthMode, start, end, Quaternion::IDENTITY, color, nullptr, lifetime});
 #endif
 }
 
-void Debug::DrawLine(const Vector3& start, const Vector3& end, const Vector4& color, float thickness, float lifetime)
+void Debug::RenderDraws(Graphics& graphics, const Matrix& viewMatrix, const Matrix& projectionMatrix)
 {
 #if DT_DEBUG
-	Vector3 direction = end - start;
-	Vector3 scale(thickness, thickness, direction.Length());
-	_draws.push_back(std::move(DebugDrawGeometry(_cube, start + direction * 0.5f, direction.ToRotator().ToQuaternion(), scale, color, lifetime)));
+	_drawsRenderer.Render(graphics, viewMatrix, projectionMatrix);
 #endif
 }
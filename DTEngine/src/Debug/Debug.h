@@ -1,13 +1,16 @@
 #pragma once
 
+#include <mutex>
+#include <thread>
+
 #include "Core/Event.h"
 #include "Core/Platform.h"
 #include "Utility/EnumInfo.h"
 #include "Utility/Math.h"
+#include "Rendering/DebugRenderer.h"
 
 class Graphics;
 class MeshBase;
-class Material;
 
 enum class LogVerbosity
 {
@@ -63,25 +66,27 @@ public:
 	{}
 };
 
-struct DebugDrawGeometry final
+enum class DebugShapeType : unsigned char
 {
-	friend class Debug;
-
-private:
-	SharedPtr<MeshBase> _mesh;
-	UniquePtr<Material> _material;
-	Matrix _worldMatrix;
-
-	float _lifetime;
-
-public:
-	DebugDrawGeometry(SharedPtr<MeshBase> mesh, Vector3 position, Quaternion rotation = Quaternion::IDENTITY, Vector3 scale = Vector3(1.0f, 1.0f, 1.0f), Vector4 color = Vector4(1, 1, 1, 1), float lifetime = 0.0f);
-	DebugDrawGeometry(DebugDrawGeometry&& other);
-	~DebugDrawGeometry();
-
-	void Render(Graphics& graphics) const;
+	Line,
+	Cube,
+	Sphere,
+	Mesh
+};
 
-	DebugDrawGeometry& operator=(const DebugDrawGeometry& other);
+// Debug draw that lives longer than a frame, its vertices are generated again every frame until lifetime runs out
+struct DebugShape final
+{
+	DebugShapeType Type;
+	DebugDepthMode DepthMode;
+	// Start of lines, center of other shapes
+	Vector3 Position;
+	// End of lines, size of cubes and meshes, radius of spheres in X
+	Vector3 Size;
+	Quaternion Rotation;
+	Vector4 Color;
+	SharedPtr<MeshBase> Mesh;
+	float Lifetime;
 };
 
 class Debug final
@@ -89,22 +94,34 @@ class Debug final
 private:
 	Dictionary<String, Channel> _channels;
 	Dictionary<Channel, DynamicArray<Log>, ChannelHasher> _logsPerChannel;
+	// Assets log from loading threads
+	std::mutex _logMutex;
+	// OnLogged handlers run only on the thread which initialized debug, logs from other threads wait for Update
+	std::thread::id _mainThreadID;
+	DynamicArray<Pair<Channel, Log>> _pendingLogs;
 
-	DynamicArray<DebugDrawGeometry> _draws;
-
-	SharedPtr<MeshBase> _cube;
-	SharedPtr<MeshBase> _sphere;
+	// Shapes with lifetime, expired ones are swapped with the last one and popped, so order is not kept
+	DynamicArray<DebugShape> _timedShapes;
+	DebugRenderer _drawsRenderer;
 
 public:
+	// Always executed on main thread
 	Event<void(const Channel&, const Log&)> OnLogged;
 	Event<void(const Channel&)> OnChannelVisibilityChanged;
 
 private:
 	void UpdateDraws(float deltaTime);
+	// Executes OnLogged for logs printed by other threads since the last call
+	void FlushPendingLogs();
+	// Appends vertices of the shape to current frame of debug draws
+	void AddShapeVertices(const DebugShape& shape);
+	void AddShape(const DebugShape& shape);
 
 public:
 	bool Initialize();
 	bool InitializeDraws();
+	// Debug draws renderer owns GPU resources, so it has to be shut down before graphics
+	void ShutdownDraws();
 	void Shutdown();
 
 	void Update(float deltaTime);
@@ -115,15 +132,14 @@ public:
 	void RegisterChannel(const String& name);
 	void SetChannelVisibility(const String& name, bool visibility);
 
-	void DrawMesh(const Vector3& position, SharedPtr<MeshBase> mesh, const Vector3& size = Vector3::ONE, const Quaternion& rotation = Quaternion::IDENTITY, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f);
-	void DrawCube(const Vector3& center, const Vector3& size, const Quaternion& rotation = Quaternion::IDENTITY, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f);
-	void DrawSphere(const Vector3& center, float radius, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f);
-	void DrawLine(const Vector3& start, const Vector3& end, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float thickness = 1.0f, float lifetime = -1.0f);
+	// Lifetime of zero or less draws the shape only in current frame
+	void DrawMesh(const Vector3& position, SharedPtr<MeshBase> mesh, const Vector3& size = Vector3::ONE, const Quaternion& rotation = Quaternion::IDENTITY, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f, DebugDepthMode depthMode = DebugDepthMode::AlwaysVisible);
+	void DrawCube(const Vector3& center, const Vector3& size, const Quaternion& rotation = Quaternion::IDENTITY, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f, DebugDepthMode depthMode = DebugDepthMode::AlwaysVisible);
+	void DrawSphere(const Vector3& center, float radius, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f, DebugDepthMode depthMode = DebugDepthMode::AlwaysVisible);
+	void DrawLine(const Vector3& start, const Vector3& end, const Vector4& color = Vector4(1.0f, 1.0f, 1.0f, 1.0f), float lifetime = -1.0f, DebugDepthMode depthMode = DebugDepthMode::AlwaysVisible);
 
-	inline const DynamicArray<DebugDrawGeometry>& GetDraws() const
-	{
-		return _draws;
-	}
+	// Draws all debug draws of current frame, may be called once per camera
+	void RenderDraws(Graphics& graphics, const Matrix& viewMatrix, const Matrix& projectionMatrix);
 };
 
 extern const String CHANNEL_ENGINE;
@@ -0,0 +1,543 @@
+#include "SelfTest.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+
+#include "Debug/Debug.h"
+#include "Rendering/BlockCompressor.h"
+#include "Rendering/ImageDecoder.h"
+#include "Rendering/MeshOptimizer.h"
+#include "Rendering/OBJImporter.h"
+#include "Rendering/Meshes/StaticMesh.h"
+#include "Rendering/OcclusionBuffer.h"
+#include "Rendering/ShaderCache.h"
+#include "ResourceManagement/FileSystem.h"
+#include "Utility/Inflate.h"
+
+// Reference decoding of BC1 color block, four color mode only as the compressor never writes the other one
+static void DecodeBC1Block(const unsigned char* input, unsigned char* block)
+{
+	int palette[4][3];
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		const unsigned int color = input[i * 2] | (input[i * 2 + 1] << 8);
+		const int r = color >> 11;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		palette[i][0] = (r << 3) | (r >> 2);
+		palette[i][1] = (g << 2) | (g >> 4);
+		palette[i][2] = (b << 3) | (b >> 2);
+	}
+	for (unsigned int c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	const unsigned int indices = input[4] | (input[5] << 8) | (input[6] << 16) | ((unsigned int)input[7] << 24);
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		const unsigned int index = (indices >> (2 * i)) & 3;
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			block[i * 4 + c] = (unsigned char)palette[index][c];
+		}
+	}
+}
+
+// Reference decoding of BC4 block into one channel of the block
+static void DecodeBC4Block(const unsigned char* input, unsigned int channel, unsigned char* block)
+{
+	int palette[8];
+	palette[0] = input[0];
+	palette[1] = input[1];
+	if (palette[0] > palette[1])
+	{
+		for (int j = 1; j < 7; ++j)
+		{
+			palette[j + 1] = ((7 - j) * palette[0] + j * palette[1] + 3) / 7;
+		}
+	}
+	else
+	{
+		for (int j = 1; j < 5; ++j)
+		{
+			palette[j + 1] = ((5 - j) * palette[0] + j * palette[1] + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	unsigned long long indices = 0;
+	for (int i = 0; i < 6; ++i)
+	{
+		indices |= (unsigned long long)input[2 + i] << (8 * i);
+	}
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		block[i * 4 + channel] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+	}
+}
+
+// Largest difference of given channels between two blocks
+static int GetBlockError(const unsigned char* first, const unsigned char* second, unsigned int firstChannel, unsigned int channelsCount)
+{
+	int error = 0;
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		for (unsigned int c = firstChannel; c < firstChannel + channelsCount; ++c)
+		{
+			error = Math::Max(error, Math::Abs((int)first[i * 4 + c] - (int)second[i * 4 + c]));
+		}
+	}
+	return error;
+}
+
+bool SelfTest::Check(bool condition, const Char* description)
+{
+	if (!condition)
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Self test failed: %s"), description);
+	}
+
+	return condition;
+}
+
+bool SelfTest::TestOcclusionBuffer()
+{
+	// Camera 10 units in front of a 10x10 quad at Z = 0, looking at its center
+	const Matrix viewProjection = Matrix::LookTo(Vector3(0.0f, 0.0f, -10.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 1.0f, 0.0f)) * Matrix::Perspective(60.0f, 2.0f, 0.1f, 100.0f);
+	const Vector3 positions[] = {Vector3(-5.0f, -5.0f, 0.0f), Vector3(5.0f, -5.0f, 0.0f), Vector3(5.0f, 5.0f, 0.0f), Vector3(-5.0f, 5.0f, 0.0f)};
+	const unsigned int indices[] = {0, 1, 2, 0, 2, 3};
+
+	OcclusionBuffer buffer;
+	buffer.AddOccluder(positions, sizeof(Vector3), 4, indices, 6, viewProjection);
+	buffer.Rasterize();
+
+	bool passed = true;
+	passed &= Check(!buffer.IsVisible(Vector3(-1.0f, -1.0f, 5.0f), Vector3(1.0f, 1.0f, 6.0f), viewProjection), DT_TEXT("bounds behind occluder have to be hidden"));
+	passed &= Check(buffer.IsVisible(Vector3(-1.0f, -1.0f, -3.0f), Vector3(1.0f, 1.0f, -2.0f), viewProjection), DT_TEXT("bounds in front of occluder have to be visible"));
+	passed &= Check(buffer.IsVisible(Vector3(-1.0f, -1.0f, -1.0f), Vector3(1.0f, 1.0f, 1.0f), viewProjection), DT_TEXT("bounds intersecting occluder have to be visible"));
+	passed &= Check(buffer.IsVisible(Vector3(-20.0f, -1.0f, 5.0f), Vector3(20.0f, 1.0f, 6.0f), viewProjection), DT_TEXT("bounds sticking out of occluder have to be visible"));
+
+	buffer.Clear();
+	passed &= Check(buffer.IsVisible(Vector3(-1.0f, -1.0f, 5.0f), Vector3(1.0f, 1.0f, 6.0f), viewProjection), DT_TEXT("cleared occlusion buffer can't hide anything"));
+
+	return passed;
+}
+
+bool SelfTest::TestMeshOptimizer()
+{
+	// Grid of quads with triangles in shuffled order, the worst case for post-transform cache
+	const unsigned int GRID_SIZE = 32;
+	const unsigned int GRID_VERTICES = GRID_SIZE + 1;
+
+	DynamicArray<MeshBase::VertexType> vertices(GRID_VERTICES * GRID_VERTICES);
+	for (unsigned int i = 0; i < (unsigned int)vertices.size(); ++i)
+	{
+		vertices[i].Position = Vector3((float)(i % GRID_VERTICES), 0.0f, (float)(i / GRID_VERTICES));
+		vertices[i].Normal = Vector3(0.0f, 1.0f, 0.0f);
+		vertices[i].UV = Vector2(0.0f, 0.0f);
+	}
+
+	DynamicArray<unsigned int> triangles;
+	for (unsigned int y = 0; y < GRID_SIZE; ++y)
+	{
+		for (unsigned int x = 0; x < GRID_SIZE; ++x)
+		{
+			const unsigned int corner = y * GRID_VERTICES + x;
+			triangles.insert(triangles.end(), {corner, corner + GRID_VERTICES, corner + 1});
+			triangles.insert(triangles.end(), {corner + 1, corner + GRID_VERTICES, corner + GRID_VERTICES + 1});
+		}
+	}
+
+	// Fixed seed linear congruential generator, so the check is the same on every run
+	unsigned int seed = 12345;
+	const unsigned int trianglesCount = (unsigned int)triangles.size() / 3;
+	for (unsigned int i = trianglesCount - 1; i > 0; --i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		const unsigned int j = (seed >> 8) % (i + 1);
+		for (unsigned int k = 0; k < 3; ++k)
+		{
+			std::swap(triangles[i * 3 + k], triangles[j * 3 + k]);
+		}
+	}
+
+	// Triangles as grid coordinates of their corners, rotated to start at the smallest one so winding is kept
+	const auto gatherTriangles = [](const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices)
+	{
+		DynamicArray<std::tuple<int, int, int>> result;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			int corners[3];
+			for (unsigned int k = 0; k < 3; ++k)
+			{
+				const Vector3& position = vertices[indices[i + k]].Position;
+				corners[k] = (int)position.Z * 1000 + (int)position.X;
+			}
+			const unsigned int first = corners[0] < corners[1] ? (corners[0] < corners[2] ? 0 : 2) : (corners[1] < corners[2] ? 1 : 2);
+			result.push_back(std::make_tuple(corners[first], corners[(first + 1) % 3], corners[(first + 2) % 3]));
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+	const DynamicArray<std::tuple<int, int, int>> sourceTriangles = gatherTriangles(vertices, triangles);
+
+	float acmrBefore = 0.0f;
+	float acmrAfter = 0.0f;
+	MeshOptimizer::Optimize(vertices.data(), (unsigned int)vertices.size(), triangles.data(), (unsigned int)triangles.size(), acmrBefore, acmrAfter);
+
+	bool passed = true;
+	passed &= Check(acmrBefore > 2.0f, DT_TEXT("shuffled grid has to miss the vertex cache on most vertices"));
+	passed &= Check(acmrAfter < 0.8f, DT_TEXT("optimized grid has to reach ACMR below 0.8"));
+	passed &= Check(Math::Abs(acmrAfter - MeshOptimizer::CalculateACMR(triangles.data(), (unsigned int)triangles.size(), (unsigned int)vertices.size())) < Math::EPSILON, DT_TEXT("reported ACMR has to match optimized indices"));
+	passed &= Check(gatherTriangles(vertices, triangles) == sourceTriangles, DT_TEXT("optimization has to keep the same triangles with the same winding"));
+
+	return passed;
+}
+
+bool SelfTest::TestShaderCache()
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	const fs::path directory = fs::temp_directory_path(error) / "DTEngineSelfTest";
+	fs::remove_all(directory, error);
+	fs::create_directories(directory, error);
+
+	const String sourcePath = (directory / "TestPS.hlsl").native();
+	const String includePath = (directory / "Common.hlsl").native();
+	const auto writeFile = [](const String& path, const char* text)
+	{
+		std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc) << text;
+	};
+	writeFile(sourcePath, "#include \"Common.hlsl\"\nfloat4 main() : SV_TARGET { return Tint; }\n");
+	writeFile(includePath, "float4 Tint;\n");
+
+	// Stub compiler uses the source as bytecode and reports a single variable, so no D3D is needed
+	unsigned int compilationsCount = 0;
+	const ShaderCache::CompilerFunction compiler = [&compilationsCount](const ShaderCompileRequest& request, CompiledShader& compiledShader)
+	{
+		++compilationsCount;
+
+		ShaderConstantBufferReflection buffer;
+		buffer.Name = DT_TEXT("PerMaterial");
+		buffer.Index = 1;
+		buffer.Size = 16;
+		buffer.Variables.push_back({DT_TEXT("Tint"), 0, 16, ShaderVariableType::Vector4});
+		compiledShader.ConstantBuffers.push_back(buffer);
+
+		return gFileSystem.ReadFile(request.SourcePath, compiledShader.Bytecode);
+	};
+
+	ShaderCache cache((directory / "Cache" / "").native());
+
+	ShaderCompileRequest request;
+	request.SourcePath = sourcePath;
+	request.EntryPoint = "main";
+	request.Target = "ps_5_0";
+	request.Flags = 0;
+
+	bool passed = true;
+	CompiledShader compiled;
+	CompiledShader cached;
+	passed &= Check(cache.Get(request, compiler, compiled) && compilationsCount == 1 && cache.GetMissesCount() == 1, DT_TEXT("first request has to be compiled"));
+	passed &= Check(cache.Get(request, compiler, cached) && compilationsCount == 1 && cache.GetHitsCount() == 1, DT_TEXT("repeated request has to be a cache hit"));
+	passed &= Check(cached.Bytecode == compiled.Bytecode && cached.ConstantBuffers.size() == 1 && cached.ConstantBuffers[0].Variables.size() == 1 && cached.ConstantBuffers[0].Variables[0].Name == DT_TEXT("Tint"),
+					DT_TEXT("cached bytecode and reflection have to match compiled ones"));
+
+	writeFile(includePath, "float4 Tint;\nfloat4 Unused;\n");
+	passed &= Check(cache.Get(request, compiler, cached) && compilationsCount == 2, DT_TEXT("changed include has to be a cache miss"));
+
+	// Entry of the original sources has been replaced by the one above, so it can't be hit anymore
+	writeFile(includePath, "float4 Tint;\n");
+	passed &= Check(cache.Get(request, compiler, cached) && compilationsCount == 3, DT_TEXT("superseded entry has to be removed"));
+
+	ShaderCompileRequest variantRequest = request;
+	variantRequest.Define = "SKINNED";
+	passed &= Check(cache.Get(variantRequest, compiler, cached) && compilationsCount == 4, DT_TEXT("different define has to be a cache miss"));
+	passed &= Check(cache.Get(request, compiler, cached) && compilationsCount == 4, DT_TEXT("variants have to keep separate entries"));
+
+	unsigned int entriesCount = 0;
+	for (fs::directory_iterator it(directory / "Cache", error), end; !error && it != end; it.increment(error))
+	{
+		++entriesCount;
+	}
+	passed &= Check(entriesCount == 2, DT_TEXT("cache has to keep a single entry per request"));
+
+	fs::remove_all(directory, error);
+
+	return passed;
+}
+
+bool SelfTest::TestOBJImporter()
+{
+	DynamicArray<MeshBase::VertexType> vertices;
+	DynamicArray<unsigned int> indices;
+	DynamicArray<StaticMesh::SubMesh> subMeshes;
+
+	// Padding puts the face in another chunk than the elements it references, when the file is parsed on more threads
+	std::string text = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nvn 0 0 -1\n";
+	text.append(OBJImporter::MIN_CHUNK_SIZE * 2, '#');
+	text += "\nf -3/-1/-1 -2/-1/-1 -1/-1/-1\n";
+
+	bool passed = Check(OBJImporter::Import(text.data(), text.size(), vertices, indices, subMeshes) && indices.size() == 3 && vertices.size() == 3 && vertices[2].Position.Y == 1.0f,
+						DT_TEXT("relative indices have to reference elements of previous chunks"));
+
+	const std::string overflowingText = "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4294967299\n";
+	passed &= Check(!OBJImporter::Import(overflowingText.data(), overflowingText.size(), vertices, indices, subMeshes), DT_TEXT("index which doesn't fit in int has to be rejected"));
+
+	return passed;
+}
+
+bool SelfTest::TestCookedMesh()
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	const fs::path directory = fs::temp_directory_path(error) / "DTEngineSelfTest";
+	fs::remove_all(directory, error);
+	fs::create_directories(directory, error);
+
+	// Two quads with their own materials, cooking has to keep them apart
+	const String sourcePath = (directory / "Quads.obj").native();
+	const String cookedPath = (directory / "Quads.dtmesh").native();
+	std::ofstream(sourcePath, std::ios::out | std::ios::binary | std::ios::trunc) <<
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\n"
+		"usemtl Left\nf 1 2 3\nf 1 3 4\n"
+		"usemtl Right\nf 2 5 6\nf 2 6 3\n";
+
+	bool passed = Check(StaticMesh::Cook(sourcePath, cookedPath), DT_TEXT("mesh has to be cooked"));
+
+	StaticMesh mesh;
+	passed &= Check(mesh.Load(cookedPath) && mesh.GetVerticesCount() == 6 && mesh.GetIndicesCount() == 12, DT_TEXT("cooked mesh has to be loaded with all of its geometry"));
+
+	const DynamicArray<StaticMesh::SubMesh>& subMeshes = mesh.GetSubMeshes();
+	passed &= Check(subMeshes.size() == 2 && subMeshes[0].IndexStart == 0 && subMeshes[0].IndicesCount == 6 && subMeshes[1].IndexStart == 6 && subMeshes[1].IndicesCount == 6,
+					DT_TEXT("cooked mesh has to keep submeshes of the source"));
+
+	// LODs count which would overflow the layout check, it follows magic, version and three other counts in the header
+	DynamicArray<unsigned char> cookedData;
+	gFileSystem.ReadFile(cookedPath, cookedData);
+	const size_t lodsCountOffset = 5 * sizeof(unsigned int);
+	if (cookedData.size() >= lodsCountOffset + sizeof(unsigned int))
+	{
+		const unsigned int corruptedLODsCount = 0xFFFFFFFF;
+		memcpy(cookedData.data() + lodsCountOffset, &corruptedLODsCount, sizeof(corruptedLODsCount));
+		std::ofstream(cookedPath, std::ios::out | std::ios::binary | std::ios::trunc).write((const char*)cookedData.data(), cookedData.size());
+	}
+
+	StaticMesh corruptedMesh;
+	passed &= Check(!corruptedMesh.Load(cookedPath), DT_TEXT("cooked mesh with too many LODs has to be rejected"));
+
+	fs::remove_all(directory, error);
+
+	return passed;
+}
+
+bool SelfTest::TestBlockCompression()
+{
+	// Red and blue are exact in 5:6:5, gradient spans most of the range in every compressed channel but blue
+	unsigned char twoColors[64];
+	unsigned char gradient[64];
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		const bool isRed = ((i + i / 4) & 1) == 0;
+		twoColors[i * 4 + 0] = isRed ? 255 : 0;
+		twoColors[i * 4 + 1] = 0;
+		twoColors[i * 4 + 2] = isRed ? 0 : 255;
+		twoColors[i * 4 + 3] = 255;
+
+		gradient[i * 4 + 0] = (unsigned char)(i * 16);
+		gradient[i * 4 + 1] = (unsigned char)(255 - i * 16);
+		gradient[i * 4 + 2] = 128;
+		gradient[i * 4 + 3] = (unsigned char)(i * 17);
+	}
+
+	// Four colors along the gradient are a third of its range apart, eight values of BC4 are a seventh apart
+	const int maxColorError = 240 / 6 + 8;
+	const int maxSingleChannelError = 255 / 14 + 1;
+
+	unsigned char compressed[16];
+	unsigned char decoded[64] = {0};
+	bool passed = true;
+
+	BlockCompressor::CompressBC1Block(twoColors, compressed);
+	DecodeBC1Block(compressed, decoded);
+	passed &= Check(GetBlockError(twoColors, decoded, 0, 3) == 0, DT_TEXT("BC1 has to keep colors which are exact in 5:6:5"));
+
+	BlockCompressor::CompressBC1Block(gradient, compressed);
+	DecodeBC1Block(compressed, decoded);
+	passed &= Check(GetBlockError(gradient, decoded, 0, 3) <= maxColorError, DT_TEXT("BC1 gradient has to stay within error of its palette"));
+
+	BlockCompressor::CompressBC4Block(gradient, 3, compressed);
+	DecodeBC4Block(compressed, 3, decoded);
+	passed &= Check(GetBlockError(gradient, decoded, 3, 1) <= maxSingleChannelError, DT_TEXT("BC4 gradient has to stay within error of its palette"));
+
+	BlockCompressor::CompressBC4Block(gradient, 2, compressed);
+	DecodeBC4Block(compressed, 2, decoded);
+	passed &= Check(GetBlockError(gradient, decoded, 2, 1) == 0, DT_TEXT("BC4 has to keep constant channel exactly"));
+
+	BlockCompressor::CompressBC3Block(gradient, compressed);
+	DecodeBC4Block(compressed, 3, decoded);
+	DecodeBC1Block(compressed + 8, decoded);
+	passed &= Check(GetBlockError(gradient, decoded, 0, 3) <= maxColorError && GetBlockError(gradient, decoded, 3, 1) <= maxSingleChannelError,
+					DT_TEXT("BC3 has to encode color as BC1 and alpha as BC4"));
+
+	BlockCompressor::CompressBC5Block(gradient, compressed);
+	DecodeBC4Block(compressed, 0, decoded);
+	DecodeBC4Block(compressed + 8, 1, decoded);
+	passed &= Check(GetBlockError(gradient, decoded, 0, 2) <= maxSingleChannelError, DT_TEXT("BC5 has to encode red and green as BC4"));
+
+	return passed;
+}
+
+bool SelfTest::TestInflate()
+{
+	// Streams written by zlib, one for each block type
+	static const unsigned char STORED_STREAM[] =
+	{
+		0x78, 0x01, 0x01, 0x0C, 0x00, 0xF3, 0xFF, 0x53, 0x74, 0x6F, 0x72, 0x65, 0x64, 0x20, 0x62, 0x6C, 0x6F, 0x63, 0x6B, 0x1E,
+		0x00, 0x04, 0x9D
+	};
+	static const unsigned char FIXED_STREAM[] =
+	{
+		0x78, 0xDA, 0x73, 0x09, 0x71, 0xCD, 0x4B, 0xCF, 0xCC, 0x4B, 0x55, 0x28, 0x4E, 0xCD, 0x49, 0x53, 0x28, 0x49, 0x2D, 0x2E,
+		0x51, 0x70, 0x19, 0x0C, 0x42, 0x00, 0x10, 0x68, 0x35, 0xC1
+	};
+	static const unsigned char DYNAMIC_STREAM[] =
+	{
+		0x78, 0xDA, 0x3D, 0x8F, 0xDB, 0x11, 0x44, 0x31, 0x08, 0x42, 0x5B, 0xB1, 0x35, 0x1E, 0xFD, 0xD7, 0xB0, 0xA0, 0xB9, 0xEB,
+		0x87, 0x63, 0x04, 0x8E, 0x13, 0x18, 0x24, 0x41, 0x40, 0x23, 0x01, 0x18, 0xB8, 0x2D, 0x95, 0xBD, 0x22, 0x55, 0x03, 0x75,
+		0x4A, 0xAD, 0x99, 0x09, 0x0F, 0x39, 0xB3, 0x2B, 0x89, 0xAE, 0xC9, 0xA2, 0x7C, 0xC9, 0xF9, 0x42, 0x01, 0x14, 0x01, 0x61,
+		0x78, 0xCC, 0xFA, 0xA2, 0xF6, 0xD4, 0xDE, 0x29, 0x8D, 0xE7, 0x6D, 0xF3, 0x46, 0x03, 0x50, 0x43, 0x41, 0x43, 0xF6, 0x2C,
+		0xFF, 0x00, 0xC7, 0xC0, 0xE3, 0x7D, 0xC5, 0xB1, 0xB3, 0x4F, 0x8C, 0x7E, 0x7A, 0x09, 0xFD, 0x01, 0xF8, 0x4F, 0x6E, 0xE9,
+		0x1B, 0x3B, 0xAC, 0x39, 0x9E, 0xA4, 0xB5, 0xEC, 0x5E, 0x12, 0x9F, 0xBD, 0x5F, 0x3C, 0xE3, 0xBE, 0x7F, 0xA1, 0xBB, 0x6D,
+		0x1F
+	};
+
+	const std::string storedText = "Stored block";
+	std::string fixedText;
+	for (unsigned int i = 0; i < 8; ++i)
+	{
+		fixedText += "DTEngine self test ";
+	}
+
+	// Dynamic stream holds 300 letters picked with this LCG, skewed alphabet makes zlib build its own codes
+	static const char ALPHABET[] = "aaaaaaaabbbbccd ";
+	std::string dynamicText;
+	unsigned int state = 1;
+	for (unsigned int i = 0; i < 300; ++i)
+	{
+		state = state * 1103515245u + 12345u;
+		dynamicText += ALPHABET[(state >> 16) & 15];
+	}
+
+	bool passed = true;
+	std::string output(storedText.size(), '\0');
+	passed &= Check(Inflate::DecompressZlib(STORED_STREAM, sizeof(STORED_STREAM), (unsigned char*)&output[0], output.size()) && output == storedText,
+					DT_TEXT("stored block has to be copied"));
+
+	output.assign(fixedText.size(), '\0');
+	passed &= Check(Inflate::DecompressZlib(FIXED_STREAM, sizeof(FIXED_STREAM), (unsigned char*)&output[0], output.size()) && output == fixedText,
+					DT_TEXT("block with fixed codes has to be decoded"));
+	passed &= Check(!Inflate::DecompressZlib(FIXED_STREAM, sizeof(FIXED_STREAM) - 10, (unsigned char*)&output[0], output.size()), DT_TEXT("truncated stream has to be rejected"));
+	passed &= Check(!Inflate::DecompressZlib(FIXED_STREAM, sizeof(FIXED_STREAM), (unsigned char*)&output[0], output.size() - 1), DT_TEXT("stream longer than destination has to be rejected"));
+
+	output.assign(dynamicText.size(), '\0');
+	passed &= Check(Inflate::DecompressZlib(DYNAMIC_STREAM, sizeof(DYNAMIC_STREAM), (unsigned char*)&output[0], output.size()) && output == dynamicText,
+					DT_TEXT("block with dynamic codes has to be decoded"));
+
+	return passed;
+}
+
+bool SelfTest::TestImageDecoder()
+{
+	// 3x2 RGBA image, first row uses Sub filter and second one Paeth filter
+	static const unsigned char PNG_IMAGE[] =
+	{
+		0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x03,
+		0x00, 0x00, 0x00, 0x02, 0x08, 0x06, 0x00, 0x00, 0x00, 0x9D, 0x74, 0x66, 0x1A, 0x00, 0x00, 0x00, 0x22, 0x49, 0x44, 0x41,
+		0x54, 0x78, 0xDA, 0x63, 0xFC, 0xCF, 0xC0, 0xF0, 0x9F, 0xF1, 0x3F, 0x43, 0x23, 0x03, 0xE3, 0xFF, 0x06, 0x16, 0x6E, 0x11,
+		0x39, 0x4D, 0x23, 0x5B, 0x0D, 0x0D, 0x8D, 0x94, 0xFC, 0x0A, 0x00, 0x6E, 0x5F, 0x07, 0x9D, 0xBA, 0x54, 0x6D, 0xD3, 0x00,
+		0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+	};
+	static const unsigned char PNG_PIXELS[] =
+	{
+		255, 0, 0, 255, 0, 255, 0, 128, 0, 0, 255, 0,
+		10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120
+	};
+
+	// 2x2 true color image with alpha, rows stored bottom to top in BGRA order
+	static const unsigned char TGA_IMAGE[] =
+	{
+		0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 32, 8,
+		30, 20, 10, 40, 70, 60, 50, 80,
+		3, 2, 1, 4, 7, 6, 5, 8
+	};
+	static const unsigned char TGA_PIXELS[] =
+	{
+		1, 2, 3, 4, 5, 6, 7, 8,
+		10, 20, 30, 40, 50, 60, 70, 80
+	};
+
+	// Same image RLE compressed without alpha, top to bottom, all four pixels in one repeated packet
+	static const unsigned char RLE_TGA_IMAGE[] =
+	{
+		0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 24, 0x20,
+		0x83, 30, 20, 10
+	};
+	static const unsigned char RLE_TGA_PIXELS[] =
+	{
+		10, 20, 30, 255, 10, 20, 30, 255,
+		10, 20, 30, 255, 10, 20, 30, 255
+	};
+
+	const auto isImage = [](const Image& image, unsigned int width, unsigned int height, const unsigned char* pixels)
+	{
+		return image.Width == width && image.Height == height && image.Pixels.size() == (size_t)width * height * 4 && memcmp(image.Pixels.data(), pixels, image.Pixels.size()) == 0;
+	};
+
+	bool passed = true;
+	Image image;
+	passed &= Check(ImageDecoder::Decode(PNG_IMAGE, sizeof(PNG_IMAGE), image) && isImage(image, 3, 2, PNG_PIXELS), DT_TEXT("filtered PNG has to be decoded"));
+	passed &= Check(ImageDecoder::Decode(TGA_IMAGE, sizeof(TGA_IMAGE), image) && isImage(image, 2, 2, TGA_PIXELS), DT_TEXT("bottom up TGA has to be decoded top to bottom"));
+	passed &= Check(ImageDecoder::Decode(RLE_TGA_IMAGE, sizeof(RLE_TGA_IMAGE), image) && isImage(image, 2, 2, RLE_TGA_PIXELS), DT_TEXT("RLE compressed TGA has to be decoded"));
+	passed &= Check(!ImageDecoder::Decode(PNG_IMAGE, sizeof(PNG_IMAGE) - 30, image), DT_TEXT("truncated PNG has to be rejected"));
+
+	return passed;
+}
+
+bool SelfTest::Run()
+{
+	struct NamedTest
+	{
+		const Char* Name;
+		bool (*Test)();
+	};
+
+	const NamedTest tests[] =
+	{
+		{DT_TEXT("OcclusionBuffer"), &SelfTest::TestOcclusionBuffer},
+		{DT_TEXT("MeshOptimizer"), &SelfTest::TestMeshOptimizer},
+		{DT_TEXT("ShaderCache"), &SelfTest::TestShaderCache},
+		{DT_TEXT("OBJImporter"), &SelfTest::TestOBJImporter},
+		{DT_TEXT("CookedMesh"), &SelfTest::TestCookedMesh},
+		{DT_TEXT("BlockCompression"), &SelfTest::TestBlockCompression},
+		{DT_TEXT("Inflate"), &SelfTest::TestInflate},
+		{DT_TEXT("ImageDecoder"), &SelfTest::TestImageDecoder}
+	};
+
+	unsigned int failedCount = 0;
+	for (const NamedTest& test : tests)
+	{
+		const bool passed = test.Test();
+		gDebug.Printf(passed ? LogVerbosity::Log : LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Self test %s: %s"), test.Name, passed ? DT_TEXT("passed") : DT_TEXT("FAILED"));
+		failedCount += passed ? 0 : 1;
+	}
+
+	return failedCount == 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Core/Platform.h"
+
+// Deterministic CPU checks of engine systems which don't need GPU nor window, run with "DTEngine.exe -selftest"
+class SelfTest final
+{
+private:
+	// Logs description as an error if condition is false
+	static bool Check(bool condition, const Char* description);
+
+	static bool TestOcclusionBuffer();
+	static bool TestMeshOptimizer();
+	static bool TestShaderCache();
+	static bool TestOBJImporter();
+	static bool TestCookedMesh();
+	static bool TestBlockCompression();
+	static bool TestInflate();
+	static bool TestImageDecoder();
+
+public:
+	// Runs all checks, returns true only if every one of them has passed
+	static bool Run();
+};
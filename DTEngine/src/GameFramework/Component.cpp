@@ -27,6 +27,9 @@ void Component::OnShutdown()
 void Component::OnOwnerEnableChanged(bool enabled)
 {}
 
+void Component::OnOwnerMobilityChanged(bool isStatic)
+{}
+
 void Component::Load(Archive& archive)
 {}
 
@@ -54,6 +54,8 @@ public:
 	virtual void OnShutdown();
 
 	virtual void OnOwnerEnableChanged(bool enabled);
+	// Called on Entity::SetStatic when owner's STATIC flag changes
+	virtual void OnOwnerMobilityChanged(bool isStatic);
 
 	virtual void Load(Archive& archive);
 	virtual void Save(Archive& archive);
@@ -6,16 +6,18 @@
 
 #include "MeshRenderer.h"
 #include "Rendering/Material.h"
+#include "Rendering/ObjectConstantsArena.h"
+#include "Rendering/OcclusionBuffer.h"
 
 #include "Utility/Math.h"
 
 WeakPtr<Camera> Camera::_main;
 DynamicArray<SharedPtr<Camera>> Camera::_allCameras;
 
-Camera::Camera(SharedPtr<Entity> owner) : Component(owner), _fov(60.0f), _near(0.01f), _far(1000.0f), _order(0), _cullingMask(LayerManager::ALL)
+Camera::Camera(SharedPtr<Entity> owner) : Component(owner), _fov(60.0f), _near(0.01f), _far(1000.0f), _order(0), _cullingMask(LayerManager::ALL), _isOcclusionCullingEnabled(false)
 {}
 
-Camera::Camera(const Camera& other) : Component(other), _fov(other._fov), _near(other._near), _far(other._far), _cullingMask(other._cullingMask)
+Camera::Camera(const Camera& other) : Component(other), _fov(other._fov), _near(other._near), _far(other._far), _cullingMask(other._cullingMask), _isOcclusionCullingEnabled(other._isOcclusionCullingEnabled)
 {}
 
 Camera::~Camera()
@@ -30,18 +32,106 @@ void Camera::Resize()
 	gDebug.Printf(LogVerbosity::Log, CHANNEL_CAMERA, DT_TEXT("Resizing camera for object: %s"), GetOwner()->GetName().c_str());
 }
 
-void Camera::DetermineVisibleRenderers(const DynamicArray<SharedPtr<MeshRenderer>>& allRenderers, DynamicArray<SharedPtr<MeshRenderer>>& visibleRenderers)
+void Camera::DetermineVisibility()
 {
-	for (auto renderer : allRenderers)
+	DynamicArray<Camera*> cameras;
+	for (const auto& camera : _allCameras)
+	{
+		if (camera)
+		{
+			camera->_visibleRenderers.clear();
+			cameras.push_back(camera.get());
+		}
+	}
+
+	// Renderers visible by at least one camera of a batch, with masks of cameras which see them
+	DynamicArray<Plane> frustums;
+	DynamicArray<MeshRenderer*> renderers;
+	DynamicArray<unsigned int> camerasMasks;
+
+	const unsigned int camerasCount = (unsigned int)cameras.size();
+	for (unsigned int firstCamera = 0; firstCamera < camerasCount; firstCamera += LooseOctree::MAX_QUERY_VOLUMES)
+	{
+		const unsigned int batchCamerasCount = Math::Min(LooseOctree::MAX_QUERY_VOLUMES, camerasCount - firstCamera);
+
+		frustums.clear();
+		for (unsigned int i = 0; i < batchCamerasCount; ++i)
+		{
+			const Camera* camera = cameras[firstCamera + i];
+			frustums.insert(frustums.end(), camera->_frustum, camera->_frustum + 6);
+		}
+
+		renderers.clear();
+		camerasMasks.clear();
+		MeshRenderer::QueryRenderers(frustums.data(), 6, batchCamerasCount, renderers, camerasMasks);
+
+		// Enabled state and layer are checked once per renderer for all cameras of the batch
+		const unsigned int renderersCount = (unsigned int)renderers.size();
+		for (unsigned int i = 0; i < renderersCount; ++i)
+		{
+			MeshRenderer* renderer = renderers[i];
+			if (!IsVisible(renderer))
+			{
+				continue;
+			}
+
+			const LayerID layer = renderer->GetOwner()->GetLayer();
+			for (unsigned int j = 0; j < batchCamerasCount; ++j)
+			{
+				Camera* camera = cameras[firstCamera + j];
+				if ((camerasMasks[i] & (1u << j)) != 0 && (camera->_cullingMask & layer) != 0)
+				{
+					camera->_visibleRenderers.push_back(renderer);
+				}
+			}
+		}
+	}
+}
+
+void Camera::CullOccludedRenderers(DynamicArray<MeshRenderer*>& renderers)
+{
+	if (!_occlusionBuffer)
+	{
+		_occlusionBuffer = std::make_unique<OcclusionBuffer>();
+	}
+
+	OcclusionBuffer& occlusionBuffer = *_occlusionBuffer;
+	occlusionBuffer.Clear();
+
+	const Matrix viewProjection = _viewMatrix * _projectionMatrix;
+
+	bool anyOccluder = false;
+	for (auto renderer : renderers)
 	{
-		if ((_cullingMask & renderer->GetOwner()->GetLayer()) != 0 && IsVisible(renderer))
+		if (!renderer->IsOccluder())
 		{
-			visibleRenderers.push_back(renderer);
+			continue;
 		}
+
+		const SharedPtr<MeshBase> mesh = renderer->GetMesh();
+		const Matrix modelViewProjection = renderer->GetOwner()->GetTransform().GetModelMatrix() * viewProjection;
+
+		occlusionBuffer.AddOccluder(mesh->GetPositions(), mesh->GetPositionsStride(), mesh->GetPositionsCount(), mesh->GetIndices(), mesh->GetIndicesCount(), modelViewProjection);
+		anyOccluder = true;
 	}
+
+	if (!anyOccluder)
+	{
+		return;
+	}
+
+	occlusionBuffer.Rasterize();
+
+	// Occluders are tested as well, one can be hidden behind another
+	auto occluded = [&occlusionBuffer, &viewProjection](const MeshRenderer* renderer)
+	{
+		const BoundingBox& bounds = renderer->GetWorldBoundingBox();
+		return !occlusionBuffer.IsVisible(bounds.GetMin(), bounds.GetMax(), viewProjection);
+	};
+	renderers.erase(std::remove_if(renderers.begin(), renderers.end(), occluded), renderers.end());
 }
 
-void Camera::DivideRenderersByRenderQueue(const DynamicArray<SharedPtr<MeshRenderer>>& allRenderers, DynamicArray<SharedPtr<MeshRenderer>>& opaqueRenderers, DynamicArray<SharedPtr<MeshRenderer>>& transparentRenderers)
+void Camera::DivideRenderersByRenderQueue(const DynamicArray<MeshRenderer*>& allRenderers, DynamicArray<MeshRenderer*>& opaqueRenderers, DynamicArray<MeshRenderer*>& transparentRenderers)
 {
 	for (auto renderer : allRenderers)
 	{
@@ -92,16 +182,10 @@ void Camera::ConstructFrustum()
 						vp[3][3] - vp[2][3]);
 }
 
-bool Camera::IsVisible(SharedPtr<MeshRenderer> renderer)
+bool Camera::IsVisible(const MeshRenderer* renderer)
 {
-	if (!renderer->IsEnabled() || !renderer->GetOwner()->IsEnabledInHierarchy())
-	{
-		return false;
-	}
-
-	// Check if bounding box of given renderer is inside frustum
-	// Pass also a model-to-world matrix
-	return IsInsideFrustum(renderer->GetBoundingBox(), renderer->GetOwner()->GetTransform().GetModelMatrix());
+	// Frustum test is already done by renderers trees
+	return renderer->IsEnabled() && renderer->GetOwner()->IsEnabledInHierarchy();
 }
 
 void Camera::RegisterCamera(SharedPtr<Camera> camera)
@@ -168,6 +252,8 @@ void Camera::OnShutdown()
 
 	SharedPtr<Camera> cam = SharedFromThis();
 	UnregisterCamera(SharedFromThis());
+	_visibleRenderers.clear();
+	_occlusionBuffer = nullptr;
 }
 
 void Camera::OnOwnerTransformUpdated(const Transform& transform)
@@ -177,17 +263,31 @@ void Camera::OnOwnerTransformUpdated(const Transform& transform)
 	ConstructFrustum();
 }
 
-void Camera::Render(Graphics& graphics, const DynamicArray<SharedPtr<MeshRenderer>>& renderers)
+void Camera::Render(Graphics& graphics)
 {
-	static DynamicArray<SharedPtr<MeshRenderer>> opaqueRenderers;
-	static DynamicArray<SharedPtr<MeshRenderer>> transparentRenderers;
-	static DynamicArray<SharedPtr<MeshRenderer>> visibleRenderers;
-	opaqueRenderers.clear();
-	transparentRenderers.clear();
-	visibleRenderers.clear();
+	static DynamicArray<MeshRenderer*> opaqueRenderers;
+	static DynamicArray<MeshRenderer*> transparentRenderers;
 
-	DetermineVisibleRenderers(renderers, visibleRenderers);
-	DivideRenderersByRenderQueue(visibleRenderers, opaqueRenderers, transparentRenderers);
+	graphics.SetViewProjection(_viewMatrix, _projectionMatrix);
+
+	// Cameras created after DetermineVisibility have nothing to render until the next frame
+	if (_isOcclusionCullingEnabled)
+	{
+		CullOccludedRenderers(_visibleRenderers);
+	}
+	SelectLODs(_visibleRenderers);
+	DivideRenderersByRenderQueue(_visibleRenderers, opaqueRenderers, transparentRenderers);
+
+	// Upload constants of all visible objects at once, draws will only bind their slots
+	const unsigned int opaqueCount = (unsigned int)opaqueRenderers.size();
+	const unsigned int transparentCount = (unsigned int)transparentRenderers.size();
+	ObjectConstants* objectConstants = graphics.BeginObjectConstants(opaqueCount + transparentCount);
+	WriteObjectConstants(opaqueRenderers, objectConstants, 0);
+	WriteObjectConstants(transparentRenderers, objectConstants, opaqueCount);
+	if (objectConstants)
+	{
+		graphics.EndObjectConstants();
+	}
 
 	for (auto& meshRenderer : opaqueRenderers)
 	{
@@ -198,22 +298,51 @@ void Camera::Render(Graphics& graphics, const DynamicArray<SharedPtr<MeshRendere
 	{
 		meshRenderer->GetOwner()->Render(graphics);
 	}
+
+	// Renderers may be destroyed before the next visibility pass
+	_visibleRenderers.clear();
+	opaqueRenderers.clear();
+	transparentRenderers.clear();
 }
 
-void Camera::RenderDebug(Graphics& graphics)
+void Camera::SelectLODs(const DynamicArray<MeshRenderer*>& renderers) const
 {
-#if DT_DEBUG
+	const Vector3 position = _owner->GetTransform().GetPosition();
+	// Cotangent of half of vertical FOV
+	const float projectionScale = _projectionMatrix.M22;
 
-	// Set render state to debug wireframe
-	graphics.SetRenderState(Graphics::CommonRenderStates::WireframeRenderState);
-	graphics.SetObject(nullptr);
+	for (auto& meshRenderer : renderers)
+	{
+		meshRenderer->SelectLOD(position, projectionScale);
+	}
+}
 
-	// Draw all debug draws
-	const DynamicArray<DebugDrawGeometry>& debugDraws = gDebug.GetDraws();
-	for (auto& draw : debugDraws)
+void Camera::WriteObjectConstants(const DynamicArray<MeshRenderer*>& renderers, ObjectConstants* objectConstants, unsigned int firstSlot)
+{
+	const unsigned int renderersCount = (unsigned int)renderers.size();
+	for (unsigned int i = 0; i < renderersCount; ++i)
 	{
-		draw.Render(graphics);
+		if (!objectConstants)
+		{
+			// Arena is not available, renderer will upload its constants when drawn
+			renderers[i]->SetObjectConstantsSlot(ObjectConstantsArena::INVALID_SLOT);
+			continue;
+		}
+
+		const unsigned int slot = firstSlot + i;
+		const MeshBase& mesh = *renderers[i]->GetMesh();
+		objectConstants[slot].Model2WorldMatrix = renderers[i]->GetOwner()->GetTransform().GetModelMatrix();
+		objectConstants[slot].PositionDequantizeScale = mesh.GetPositionDequantizeScale();
+		objectConstants[slot].PositionDequantizeOffset = mesh.GetPositionDequantizeOffset();
+		renderers[i]->SetObjectConstantsSlot(slot);
 	}
+}
+
+void Camera::RenderDebug(Graphics& graphics)
+{
+#if DT_DEBUG
+
+	gDebug.RenderDraws(graphics, _viewMatrix, _projectionMatrix);
 
 #endif
 }
@@ -240,33 +369,13 @@ bool Camera::IsInsideFrustum(const Vector3& worldPoint) const
 
 bool Camera::IsInsideFrustum(const BoundingBox& boundingBox) const
 {
-	return IsInsideFrustum(boundingBox, Matrix::IDENTITY);
+	return TestBoxAgainstPlanes(_frustum, 6, boundingBox.GetMin(), boundingBox.GetMax()) != ContainmentType::Disjoint;
 }
 
 bool Camera::IsInsideFrustum(const BoundingBox& boundingBox, const Matrix& modelToWorld) const
 {
-	const DynamicArray<Vector3>& corners = boundingBox.GetCorners();
-	for (unsigned char i = 0; i < 6; ++i)
-	{
-		bool liesBehind = true;
-		for (auto& corner : corners)
-		{
-			// Calculate world position of a corner
-			Vector4 worldCorner = Vector4(corner, 1) * modelToWorld;
-			if (_frustum[i].Dot(worldCorner) > 0.0f)
-			{
-				liesBehind = false;
-				break;
-			}
-		}
-
-		if (liesBehind)
-		{
-			return false;
-		}
-	}
-
-	return true;
+	const BoundingBox worldBoundingBox = boundingBox.GetTransformed(modelToWorld);
+	return TestBoxAgainstPlanes(_frustum, 6, worldBoundingBox.GetMin(), worldBoundingBox.GetMax()) != ContainmentType::Disjoint;
 }
 
 Vector3 Camera::ConvertWorldToViewPoint(const Vector3& worldPoint) const
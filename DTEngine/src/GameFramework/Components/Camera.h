@@ -6,7 +6,9 @@
 #include "Utility/GeometryUtils.h"
 
 class MeshRenderer;
+class OcclusionBuffer;
 class UIRenderer;
+struct ObjectConstants;
 
 class Camera final : public Component
 {
@@ -28,6 +30,14 @@ private:
 	LayerID _cullingMask;
 	short _order;
 
+	// Filled by DetermineVisibility and cleared by Render, so no renderer is kept past the frame it was culled in
+	DynamicArray<MeshRenderer*> _visibleRenderers;
+
+	// Renderers hidden behind occluders (see MeshRenderer::SetOccluder) are skipped after frustum culling
+	bool _isOcclusionCullingEnabled;
+	// Created on first use, so cameras without occlusion culling don't hold a depth buffer
+	UniquePtr<OcclusionBuffer> _occlusionBuffer;
+
 public:
 	Camera(SharedPtr<Entity> owner);
 	Camera(const Camera& other);
@@ -37,11 +47,17 @@ public:
 
 private:
 	void Resize();
-	void DetermineVisibleRenderers(const DynamicArray<SharedPtr<MeshRenderer>>& allRenderers, DynamicArray<SharedPtr<MeshRenderer>>& visibleRenderers);
-	void DivideRenderersByRenderQueue(const DynamicArray<SharedPtr<MeshRenderer>>& allRenderers, DynamicArray<SharedPtr<MeshRenderer>>& opaqueRenderers, DynamicArray<SharedPtr<MeshRenderer>>& transparentRenderers);
+	void CullOccludedRenderers(DynamicArray<MeshRenderer*>& renderers);
+	void DivideRenderersByRenderQueue(const DynamicArray<MeshRenderer*>& allRenderers, DynamicArray<MeshRenderer*>& opaqueRenderers, DynamicArray<MeshRenderer*>& transparentRenderers);
 	void ConstructFrustum();
+	// LOD state is kept per renderer, so with several cameras the last one rendering a renderer decides its hysteresis
+	void SelectLODs(const DynamicArray<MeshRenderer*>& renderers) const;
+
+	// Writes model matrices of renderers to consecutive arena slots starting at firstSlot and assigns those slots to renderers
+	// Every renderer touches only its own slot, so this can be split between threads
+	static void WriteObjectConstants(const DynamicArray<MeshRenderer*>& renderers, ObjectConstants* objectConstants, unsigned int firstSlot);
 
-	bool IsVisible(SharedPtr<MeshRenderer> renderer);
+	static bool IsVisible(const MeshRenderer* renderer);
 
 	static void RegisterCamera(SharedPtr<Camera> camera);
 	static void UnregisterCamera(SharedPtr<Camera> camera);
@@ -55,18 +71,23 @@ public:
 
 	virtual void OnOwnerTransformUpdated(const Transform& transform) override;
 
-	void Render(Graphics& graphics, const DynamicArray<SharedPtr<MeshRenderer>>& renderers);
+	// Culls renderers for all cameras in a single pass, must be called once per frame before cameras are rendered
+	// Cameras are culled together in batches of LooseOctree::MAX_QUERY_VOLUMES
+	// Per renderer work (enabled state, layer, bounds) is done once no matter how many cameras are there
+	static void DetermineVisibility();
+
+	void Render(Graphics& graphics);
 	void RenderDebug(Graphics& graphics);
 	void RenderSky(Graphics& graphics);
 	void RenderUI(Graphics& graphics, const DynamicArray<SharedPtr<UIRenderer>>& uiRenderers) = delete;
 
 	// Returns true if a worldPoint is inside a frustum
 	bool IsInsideFrustum(const Vector3& worldPoint) const;
-	// Returns true if one of boundingBox corners is inside frustum
-	// NOTE: this function variant assumes that boundingBox has corners in world space already
+	// Returns true if boundingBox is at least partially inside frustum
+	// NOTE: this function variant assumes that boundingBox is in world space already
 	bool IsInsideFrustum(const BoundingBox& boundingBox) const;
-	// Returns true if one of boundingBox corners transformed by modelToWorld matrix is inside frustum
-	// NOTE: this function variant assumes that boundingBox has corners in model/object space
+	// Returns true if boundingBox transformed by modelToWorld matrix is at least partially inside frustum
+	// NOTE: this function variant assumes that boundingBox is in model/object space
 	bool IsInsideFrustum(const BoundingBox& boundingBox, const Matrix& modelToWorld) const;
 
 	// Converts from world coordinates to view (camera) space coordinates
@@ -104,6 +125,16 @@ public:
 		_cullingMask = cullingMask;
 	}
 
+	inline bool IsOcclusionCullingEnabled() const
+	{
+		return _isOcclusionCullingEnabled;
+	}
+
+	inline void SetOcclusionCullingEnabled(bool enabled)
+	{
+		_isOcclusionCullingEnabled = enabled;
+	}
+
 public:
 	inline static SharedPtr<Camera> GetMainCamera()
 	{
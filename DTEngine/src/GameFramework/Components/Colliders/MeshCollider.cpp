@@ -4,6 +4,15 @@
 
 using namespace physx;
 
+MeshCollider::MeshCollider(SharedPtr<MeshBase> mesh) : Collider(), _mesh(mesh)
+{
+	// Shape is cooked from positions only when physical body gets initialized
+	if (_mesh)
+	{
+		_mesh->RequireCPUData(MeshDataRetention::Positions);
+	}
+}
+
 void MeshCollider::Initialize(PhysicalBody* physicalBody)
 {
 	Collider::Initialize(physicalBody);
@@ -34,17 +43,9 @@ void MeshCollider::MatchToMeshBoundingBox(const BoundingBox& boundingBox)
 		return;
 	}
 
+	// Mesh's bounds are already known, so no CPU side vertices are needed
 	Vector3 targetScale = boundingBox.GetHalfExtents();
-	const DynamicArray<MeshBase::VertexType>& vertices = _mesh->GetVertices();
-	Vector3 meshSize = Vector3::ZERO;
-	for (int i = 0; i < vertices.size(); ++i)
-	{
-		for (int j = i; j < vertices.size(); ++i)
-		{
-			Vector3 diff = vertices[j].Position - vertices[i].Position;
-			meshSize = Vector3::Max(meshSize, diff);
-		}
-	}
+	const Vector3 meshSize = _mesh->GetBoundingBox().GetMax() - _mesh->GetBoundingBox().GetMin();
 
 	if (meshSize.X != 0.0f)
 	{
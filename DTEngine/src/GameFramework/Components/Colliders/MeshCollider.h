@@ -9,8 +9,7 @@ private:
 	SharedPtr<MeshBase> _mesh;
 
 public:
-	inline MeshCollider(SharedPtr<MeshBase> mesh) : Collider(), _mesh(mesh)
-	{}
+	MeshCollider(SharedPtr<MeshBase> mesh);
 	inline MeshCollider(const MeshCollider& other) : Collider(other), _mesh(other._mesh)
 	{}
 
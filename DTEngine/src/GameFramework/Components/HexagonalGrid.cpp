@@ -310,6 +310,8 @@ SharedPtr<HexagonalGrid> HexagonalGridUtility::CreateGrid(unsigned int width, un
 			position.Y = 0.0f;
 			position.Z = xDirection.Z * coordinates.X + yDirection.Z * coordinates.Y;
 			hexagonEntity->SetPosition(position);
+			// Grid never moves, so hexagons can be statically batched
+			hexagonEntity->SetStatic(true);
 
 			// Add hexagon to map
 			gridComponent->_hexagonalMap.insert({coordinates, hexagon});
@@ -4,16 +4,22 @@
 #include "GameFramework/Entity.h"
 #include "Rendering/MeshBase.h"
 #include "Rendering/Material.h"
+#include "Rendering/ObjectConstantsArena.h"
 #include "ResourceManagement/Resources.h"
 
 DynamicArray<SharedPtr<MeshRenderer>> MeshRenderer::_allRenderers;
 
-MeshRenderer::MeshRenderer(SharedPtr<Entity> owner) : Component(owner), _mesh(nullptr), _material(nullptr)
+// Renderers outside of these bounds are still handled, but tested one by one
+static const float RENDERERS_TREE_HALF_SIZE = 4096.0f;
+LooseOctree MeshRenderer::_staticRenderersTree(Vector3::ZERO, RENDERERS_TREE_HALF_SIZE);
+LooseOctree MeshRenderer::_dynamicRenderersTree(Vector3::ZERO, RENDERERS_TREE_HALF_SIZE);
+
+MeshRenderer::MeshRenderer(SharedPtr<Entity> owner) : Component(owner), _mesh(nullptr), _material(nullptr), _objectConstantsSlot(ObjectConstantsArena::INVALID_SLOT), _treeHandle(LooseOctree::INVALID_HANDLE), _isInStaticTree(false), _currentLOD(0), _isOccluder(false)
 {
 	_material = gResources.Get<Material>();
 }
 
-MeshRenderer::MeshRenderer(const MeshRenderer& other) : Component(other), _mesh(other._mesh), _material(other._material)
+MeshRenderer::MeshRenderer(const MeshRenderer& other) : Component(other), _mesh(other._mesh), _material(other._material), _objectConstantsSlot(ObjectConstantsArena::INVALID_SLOT), _worldBoundingBox(other._worldBoundingBox), _treeHandle(LooseOctree::INVALID_HANDLE), _isInStaticTree(false), _currentLOD(0), _isOccluder(other._isOccluder)
 {}
 
 MeshRenderer::~MeshRenderer()
@@ -27,6 +33,12 @@ void MeshRenderer::RegisterMeshRenderer(SharedPtr<MeshRenderer> meshRenderer)
 		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Renderer of object %s already registered!"), meshRenderer->GetOwner()->GetName().c_str());
 		return;
 	}
+
+	// One handler serves all renderers, so it is bound only while there are any
+	if (_allRenderers.empty())
+	{
+		gResources.OnAssetReloaded.Bind(&MeshRenderer::OnAssetReloaded);
+	}
 	_allRenderers.push_back(meshRenderer);
 }
 
@@ -36,9 +48,68 @@ void MeshRenderer::UnregisterMeshRenderer(SharedPtr<MeshRenderer> meshRenderer)
 	if (found != _allRenderers.end())
 	{
 		_allRenderers.erase(found);
+
+		if (_allRenderers.empty())
+		{
+			gResources.OnAssetReloaded.Unbind(&MeshRenderer::OnAssetReloaded);
+		}
+	}
+}
+
+void MeshRenderer::OnAssetReloaded(const Asset& asset)
+{
+	// Reloaded mesh is the same object with new content, renderers only refresh what they derived from it
+	for (const SharedPtr<MeshRenderer>& renderer : _allRenderers)
+	{
+		if (renderer->_mesh.get() == &asset)
+		{
+			renderer->_currentLOD = 0;
+			renderer->UpdateWorldBoundingBox();
+		}
 	}
 }
 
+void MeshRenderer::UpdateWorldBoundingBox()
+{
+	// Renderer without a mesh has no bounds, so it can't be rendered anyway
+	if (!_mesh)
+	{
+		RemoveFromTree();
+		return;
+	}
+
+	_worldBoundingBox = _mesh->GetBoundingBox().GetTransformed(_owner->GetTransform().GetModelMatrix());
+
+	const bool isStatic = _owner->IsStatic();
+	if (_treeHandle != LooseOctree::INVALID_HANDLE && isStatic != _isInStaticTree)
+	{
+		RemoveFromTree();
+	}
+
+	LooseOctree& tree = isStatic ? _staticRenderersTree : _dynamicRenderersTree;
+	if (_treeHandle == LooseOctree::INVALID_HANDLE)
+	{
+		_treeHandle = tree.Insert(this, _worldBoundingBox.GetMin(), _worldBoundingBox.GetMax());
+		_isInStaticTree = isStatic;
+	}
+	else
+	{
+		tree.Update(_treeHandle, _worldBoundingBox.GetMin(), _worldBoundingBox.GetMax());
+	}
+}
+
+void MeshRenderer::RemoveFromTree()
+{
+	if (_treeHandle == LooseOctree::INVALID_HANDLE)
+	{
+		return;
+	}
+
+	LooseOctree& tree = _isInStaticTree ? _staticRenderersTree : _dynamicRenderersTree;
+	tree.Remove(_treeHandle);
+	_treeHandle = LooseOctree::INVALID_HANDLE;
+}
+
 SharedPtr<Component> MeshRenderer::Copy(SharedPtr<Entity> newOwner) const
 {
 	IMPLEMENT_COPY(MeshRenderer);
@@ -49,13 +120,40 @@ void MeshRenderer::OnInitialize()
 	Component::OnInitialize();
 
 	RegisterMeshRenderer(SharedFromThis());
+	UpdateWorldBoundingBox();
 }
 
 void MeshRenderer::OnShutdown()
 {
 	Component::OnShutdown();
 
+	RemoveFromTree();
 	UnregisterMeshRenderer(SharedFromThis());
+
+	// Renderer may still be referenced after its entity is gone, its assets are released right away so resources can evict them
+	_mesh = nullptr;
+	_material = nullptr;
+}
+
+void MeshRenderer::OnOwnerMobilityChanged(bool isStatic)
+{
+	Component::OnOwnerMobilityChanged(isStatic);
+
+	// Moves renderer between static and dynamic tree
+	if (_treeHandle != LooseOctree::INVALID_HANDLE)
+	{
+		UpdateWorldBoundingBox();
+	}
+}
+
+void MeshRenderer::OnOwnerTransformUpdated(const Transform& transform)
+{
+	Component::OnOwnerTransformUpdated(transform);
+
+	if (_treeHandle != LooseOctree::INVALID_HANDLE)
+	{
+		UpdateWorldBoundingBox();
+	}
 }
 
 void MeshRenderer::OnRender(Graphics& graphics)
@@ -70,15 +168,61 @@ void MeshRenderer::OnRender(Graphics& graphics)
 	{
 		gDebug.Print(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Trying to render mesh renderer without material set. Aborting"));
 #if DT_DEBUG
-		graphics.SetMaterial(gResources.GetDefaultMaterial());
-		graphics.DrawIndexed(_mesh->GetVertexBuffer(), _mesh->GetIndexBuffer(), _mesh->GetIndicesCount(), _mesh->GetVertexTypeSize(), 0);
+		graphics.SetMaterial(gResources.GetDefaultMaterial(), _mesh.get());
+		graphics.DrawMesh(*_mesh);
 #endif
 		return;
 	}
 
 	graphics.SetRenderState(_material->GetRenderState());
-	graphics.SetMaterial(_material.get());
-	graphics.DrawIndexed(_mesh->GetVertexBuffer(), _mesh->GetIndexBuffer(), _mesh->GetIndicesCount(), _mesh->GetVertexTypeSize(), 0);
+	graphics.SetObjectConstantsSlot(_objectConstantsSlot);
+	graphics.SetMaterial(_material.get(), _mesh.get());
+	graphics.DrawMesh(*_mesh, _currentLOD);
+}
+
+void MeshRenderer::SelectLOD(const Vector3& cameraPosition, float projectionScale)
+{
+	if (!_mesh || _mesh->GetLODsCount() == 1)
+	{
+		return;
+	}
+
+	// Bounding sphere of world bounds projected on screen, relative to screen height
+	const Vector3 center = (_worldBoundingBox.GetMin() + _worldBoundingBox.GetMax()) * 0.5f;
+	const float radius = (_worldBoundingBox.GetMax() - center).Length();
+	const float distance = (center - cameraPosition).Length();
+
+	// Camera inside of the bounding sphere always sees the most detailed mesh
+	const float screenSize = distance > radius ? radius * projectionScale / distance : 1.0f;
+	_currentLOD = _mesh->SelectLOD(screenSize, _currentLOD);
+}
+
+void MeshRenderer::SetMesh(SharedPtr<MeshBase> mesh)
+{
+	_mesh = mesh;
+	_currentLOD = 0;
+	UpdateWorldBoundingBox();
+
+	if (_isOccluder && _mesh)
+	{
+		_mesh->RequireCPUData(MeshDataRetention::Positions);
+	}
+}
+
+void MeshRenderer::SetOccluder(bool isOccluder)
+{
+	_isOccluder = isOccluder;
+
+	if (_isOccluder && _mesh)
+	{
+		_mesh->RequireCPUData(MeshDataRetention::Positions);
+	}
+}
+
+void MeshRenderer::QueryRenderers(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks)
+{
+	_staticRenderersTree.Query(planes, planesPerVolume, volumesCount, renderers, volumesMasks);
+	_dynamicRenderersTree.Query(planes, planesPerVolume, volumesCount, renderers, volumesMasks);
 }
 
 RenderQueue MeshRenderer::GetQueue() const
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GameFramework/Component.h"
+#include "Rendering/LooseOctree.h"
 #include "Rendering/Material.h"
 #include "Rendering/MeshBase.h"
 
@@ -11,10 +12,28 @@ class MeshRenderer final : public Component
 private:
 	static DynamicArray<SharedPtr<MeshRenderer>> _allRenderers;
 
+	// Renderers of static entities never move, so they are kept apart from the dynamic ones
+	static LooseOctree _staticRenderersTree;
+	static LooseOctree _dynamicRenderersTree;
+
 private:
 	SharedPtr<MeshBase> _mesh;
 	SharedPtr<Material> _material;
 
+	// Slot in object constants arena assigned by camera for the current pass
+	unsigned int _objectConstantsSlot;
+
+	// World space bounds, recalculated only when owner's transform or mesh changes
+	BoundingBox _worldBoundingBox;
+	unsigned int _treeHandle;
+	bool _isInStaticTree;
+
+	// LOD selected by the last camera rendering this renderer, kept between frames for hysteresis
+	unsigned int _currentLOD;
+
+	// Occluders are rasterized to occlusion buffer of cameras with occlusion culling enabled, should be big and simple meshes
+	bool _isOccluder;
+
 public:
 	MeshRenderer(SharedPtr<Entity> owner);
 	MeshRenderer(const MeshRenderer& other);
@@ -25,6 +44,12 @@ public:
 private:
 	static void RegisterMeshRenderer(SharedPtr<MeshRenderer> meshRenderer);
 	static void UnregisterMeshRenderer(SharedPtr<MeshRenderer> meshRenderer);
+	// Bounds and LOD of renderers using reloaded mesh are recalculated, renderers using other assets are left alone
+	static void OnAssetReloaded(const Asset& asset);
+
+	// Recalculates world bounds, then inserts renderer to proper tree, moves it between trees or updates its bounds
+	void UpdateWorldBoundingBox();
+	void RemoveFromTree();
 
 protected:
 	virtual SharedPtr<Component> Copy(SharedPtr<Entity> newOwner) const override;
@@ -32,20 +57,35 @@ protected:
 public:
 	virtual void OnInitialize() override;
 	virtual void OnShutdown() override;
+	virtual void OnOwnerMobilityChanged(bool isStatic) override;
+	virtual void OnOwnerTransformUpdated(const Transform& transform) override;
 	virtual void OnRender(Graphics& graphics) override;
 
 	RenderQueue GetQueue() const;
 
-	inline void SetMesh(SharedPtr<MeshBase> mesh)
-	{
-		_mesh = mesh;
-	}
+	// Picks mesh LOD from projected size of world bounds, projectionScale is cotangent of half of camera's vertical FOV
+	void SelectLOD(const Vector3& cameraPosition, float projectionScale);
+
+	void SetMesh(SharedPtr<MeshBase> mesh);
 
 	inline void SetMaterial(SharedPtr<Material> material)
 	{
 		_material = material;
 	}
 
+	// Occluders rasterize mesh's CPU side positions, so those are required from the mesh
+	void SetOccluder(bool isOccluder);
+
+	inline bool IsOccluder() const
+	{
+		return _isOccluder && _mesh && _mesh->GetPositionsCount() > 0;
+	}
+
+	inline void SetObjectConstantsSlot(unsigned int slot)
+	{
+		_objectConstantsSlot = slot;
+	}
+
 	inline SharedPtr<Material> GetMaterial() const
 	{
 		return _material;
@@ -62,8 +102,22 @@ public:
 		return _mesh->GetBoundingBox();
 	}
 
+	inline unsigned int GetCurrentLOD() const
+	{
+		return _currentLOD;
+	}
+
+	inline const BoundingBox& GetWorldBoundingBox() const
+	{
+		return _worldBoundingBox;
+	}
+
 	inline static const DynamicArray<SharedPtr<MeshRenderer>>& GetAllMeshRenderers()
 	{
 		return _allRenderers;
 	}
+
+	// Appends renderers whose world bounds are inside at least one of given volumes and masks of volumes containing them
+	// See LooseOctree::Query, enabled state and layers are not checked
+	static void QueryRenderers(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks);
 };
\ No newline at end of file
@@ -100,11 +100,7 @@ void Entity::Update(float deltaTime)
 
 	Flags.RaiseFlag(EntityFlag::DURING_UPDATE);
 
-	if (_transform._shouldCalculateMatrix)
-	{
-		_transform.CalculateModelMatrix(_parent ? &(_parent->_transform) : nullptr);
-		OnTransformUpdated();
-	}
+	UpdateTransform();
 
 	for (const auto& component : _components)
 	{
@@ -126,6 +122,20 @@ void Entity::Render(Graphics& graphics)
 	}
 }
 
+void Entity::UpdateTransform()
+{
+	if (_parent)
+	{
+		_parent->UpdateTransform();
+	}
+
+	if (_transform._shouldCalculateMatrix)
+	{
+		_transform.CalculateModelMatrix(_parent ? &(_parent->_transform) : nullptr);
+		OnTransformUpdated();
+	}
+}
+
 void Entity::OnTransformUpdated()
 {
 	for (const auto& component : _components)
@@ -152,6 +162,29 @@ void Entity::SetEnabled(bool enabled)
 	}
 }
 
+void Entity::SetStatic(bool isStatic)
+{
+	if (IsStatic() == isStatic)
+	{
+		return;
+	}
+
+	if (isStatic)
+	{
+		Flags.RaiseFlag(EntityFlag::STATIC);
+	}
+	else
+	{
+		Flags.ClearFlag(EntityFlag::STATIC);
+	}
+
+	// Notify all components that mobility has changed
+	for (const auto& component : _components)
+	{
+		component->OnOwnerMobilityChanged(isStatic);
+	}
+}
+
 bool Entity::IsEnabledInHierarchy() const
 {
 	if (!IsEnabled())
@@ -85,8 +85,12 @@ public:
 
 	void Render(Graphics& graphics);
 
+	// Recalculates model matrix (and parent's first) if transform has changed since last update
+	void UpdateTransform();
 	void OnTransformUpdated();
 	void SetEnabled(bool enabled);
+	// Raises or clears STATIC flag and notifies components, so they can move between static and dynamic structures
+	void SetStatic(bool isStatic);
 
 	bool IsEnabledInHierarchy() const;
 
@@ -98,6 +102,10 @@ public:
 	{
 		return _enabled;
 	}
+	inline bool IsStatic() const
+	{
+		return Flags.IsFlagSet(EntityFlag::STATIC);
+	}
 
 	inline LayerID GetLayer() const
 	{
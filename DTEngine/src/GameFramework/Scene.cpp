@@ -1,7 +1,10 @@
 #include "Scene.h"
 
+#include <algorithm>
+
 #include "Core/Archive.h"
 #include "Debug/Debug.h"
+#include "ResourceManagement/Resources.h"
 #include "Components/Camera.h"
 
 #include "Components/CameraControl.h"
@@ -30,6 +33,10 @@ void Scene::Load()
 	//		_entities.push_back(entity);
 	//		entity->Load(archive)
 
+	// Assets loaded from files are requested before anything else, so loading threads read them while entities are being set up
+	// Default material and procedural meshes are created on main thread when the first renderer asks for them
+	const AssetLoadHandle<Shader> defaultShaderLoad = gResources.LoadAsync<Shader>(Material::DEFAULT_SHADER_ID, Material::DEFAULT_SHADER_PATH);
+
 	for (const auto& e : _entities)
 	{
 		e->Initialize();
@@ -74,6 +81,14 @@ void Scene::Load()
 		physicalBody->AddCollider(std::move(cc));
 	}
 
+	// Everything requested above has to be initialized before batching merges renderers by material
+	gResources.Wait(defaultShaderLoad);
+
+	BuildStaticBatches();
+
+	// Colliders, occluders and static batching have taken what they need from meshes by now
+	gResources.ReleaseMeshesCPUData();
+
 	//TODO: Put this something like FileSystem::Close(archive);
 }
 
@@ -115,6 +130,12 @@ void Scene::Update(float deltaTime)
 	}
 	_newEntities.clear();
 
+	// Scene holds the last references of destroyed entities, their components release meshes and materials with them
+	_entities.erase(std::remove_if(_entities.begin(), _entities.end(), [](const SharedPtr<Entity>& entity)
+	{
+		return entity->Flags.IsFlagSet(EntityFlag::PENDING_DESTROY);
+	}), _entities.end());
+
 	for (auto go : _entities)
 	{
 		if (go->IsEnabledInHierarchy())
@@ -132,12 +153,14 @@ void Scene::Render(Graphics& graphics)
 		return;
 	}
 
+	Camera::DetermineVisibility();
+
 	const DynamicArray<SharedPtr<Camera>>& cameras = Camera::GetAllCameras();
 	for (auto camera : cameras)
 	{
 		if (camera)
 		{
-			camera->Render(graphics, MeshRenderer::GetAllMeshRenderers());
+			camera->Render(graphics);
 		}
 	}
 
@@ -157,6 +180,11 @@ void Scene::Render(Graphics& graphics)
 	}
 }
 
+unsigned int Scene::BuildStaticBatches(float cellSize)
+{
+	return StaticBatchingUtility::Build(*this, cellSize);
+}
+
 SharedPtr<Entity> Scene::SpawnEntity(const String& name)
 {
 	SharedPtr<Entity> entity = SharedPtr<Entity>(new Entity(name));
@@ -182,3 +210,11 @@ SharedPtr<Entity> Scene::SpawnEntity(SharedPtr<Entity> original, const String& n
 
 	return entity;
 }
+
+void Scene::DestroyEntity(SharedPtr<Entity> entity)
+{
+	if (!entity->Flags.IsFlagSet(EntityFlag::PENDING_DESTROY))
+	{
+		entity->Shutdown();
+	}
+}
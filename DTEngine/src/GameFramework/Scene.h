@@ -3,6 +3,7 @@
 #include "Core/Platform.h"
 #include "Entity.h"
 #include "Rendering/Graphics.h"
+#include "StaticBatching.h"
 
 class Camera;
 
@@ -25,7 +26,12 @@ public:
 	void Update(float deltaTime);
 	void Render(Graphics& graphics);
 
+	// Merges renderers of static entities into batches, called on load before meshes release their CPU data
+	unsigned int BuildStaticBatches(float cellSize = StaticBatchingUtility::DEFAULT_CELL_SIZE);
+
 	SharedPtr<Entity> SpawnEntity(const String& name);
 	SharedPtr<Entity> SpawnEntity(SharedPtr<Entity> original);
 	SharedPtr<Entity> SpawnEntity(SharedPtr<Entity> original, const String& name);
+	// Shuts the entity down right away, scene drops it in the next update so assets it used can be evicted
+	void DestroyEntity(SharedPtr<Entity> entity);
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "StaticBatching.h"
+
+#include <tuple>
+
+#include "Debug/Debug.h"
+#include "Entity.h"
+#include "Scene.h"
+#include "Components/MeshRenderer.h"
+#include "Rendering/Material.h"
+#include "Rendering/Meshes/BatchedMesh.h"
+
+const float StaticBatchingUtility::DEFAULT_CELL_SIZE = 64.0f;
+
+struct StaticBatchKey
+{
+	const Material* BatchMaterial;
+	unsigned int Layer;
+	int CellX;
+	int CellY;
+	int CellZ;
+
+	inline bool operator<(const StaticBatchKey& other) const
+	{
+		return std::tie(BatchMaterial, Layer, CellX, CellY, CellZ) < std::tie(other.BatchMaterial, other.Layer, other.CellX, other.CellY, other.CellZ);
+	}
+};
+
+struct StaticBatch
+{
+	SharedPtr<Material> BatchMaterial;
+	DynamicArray<SharedPtr<MeshRenderer>> Renderers;
+};
+
+static bool CanBeBatched(const SharedPtr<MeshRenderer>& renderer)
+{
+	const SharedPtr<Entity> owner = renderer->GetOwner();
+	if (!owner->IsStatic() || !renderer->IsEnabled() || !owner->IsEnabledInHierarchy())
+	{
+		return false;
+	}
+
+	// Transparent renderers have to stay separate to be sorted
+	const SharedPtr<MeshBase> mesh = renderer->GetMesh();
+	if (!mesh || !renderer->GetMaterial() || renderer->GetQueue() != RenderQueue::Opaque)
+	{
+		return false;
+	}
+
+	// Batching doesn't require full data of meshes, so unless something else does, trimming frees it
+	DT_ASSERT(mesh->GetRetainedCPUData() == MeshDataRetention::Full, DT_TEXT("Static batching has to be built before meshes release their CPU data"));
+
+	// Meshes which failed to load have no data to merge
+	return mesh->GetVertices() != nullptr;
+}
+
+static void AppendToBatch(const MeshRenderer& renderer, DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices)
+{
+	const SharedPtr<MeshBase> mesh = renderer.GetMesh();
+	const Matrix& modelToWorld = renderer.GetOwner()->GetTransform().GetModelMatrix();
+	const Matrix normalToWorld = modelToWorld.GetInversed().GetTransposed();
+
+	const unsigned int baseVertex = (unsigned int)vertices.size();
+	const MeshBase::VertexType* meshVertices = mesh->GetVertices();
+	for (unsigned int i = 0; i < mesh->GetVerticesCount(); ++i)
+	{
+		const MeshBase::VertexType& vertex = meshVertices[i];
+		MeshBase::VertexType worldVertex;
+		worldVertex.Position = Vector3(Vector4(vertex.Position, 1.0f) * modelToWorld);
+		worldVertex.Normal = (vertex.Normal * normalToWorld).GetNormalizedSafe();
+		worldVertex.UV = vertex.UV;
+		vertices.push_back(worldVertex);
+	}
+
+	const unsigned int* meshIndices = mesh->GetIndices();
+	for (unsigned int i = 0; i < mesh->GetIndicesCount(); ++i)
+	{
+		indices.push_back(baseVertex + meshIndices[i]);
+	}
+}
+
+unsigned int StaticBatchingUtility::Build(Scene& scene, float cellSize)
+{
+	DT_ASSERT(cellSize > 0.0f, DT_TEXT("Static batching cell size must be greater than 0"));
+
+	// Group renderers by material, layer and cell containing center of their world bounds
+	Map<StaticBatchKey, StaticBatch> batches;
+	for (const auto& renderer : MeshRenderer::GetAllMeshRenderers())
+	{
+		if (!CanBeBatched(renderer))
+		{
+			continue;
+		}
+
+		// Batching usually runs right after spawning, before the first update has calculated model matrices and world bounds
+		renderer->GetOwner()->UpdateTransform();
+
+		const Vector3 center = renderer->GetWorldBoundingBox().GetCenter();
+
+		StaticBatchKey key;
+		key.BatchMaterial = renderer->GetMaterial().get();
+		key.Layer = renderer->GetOwner()->GetLayer();
+		key.CellX = (int)floorf(center.X / cellSize);
+		key.CellY = (int)floorf(center.Y / cellSize);
+		key.CellZ = (int)floorf(center.Z / cellSize);
+
+		StaticBatch& batch = batches[key];
+		batch.BatchMaterial = renderer->GetMaterial();
+		batch.Renderers.push_back(renderer);
+	}
+
+	unsigned int batchesCount = 0;
+	unsigned int batchedRenderersCount = 0;
+	for (auto& pair : batches)
+	{
+		StaticBatch& batch = pair.second;
+
+		// Merging single renderer wouldn't save any draw call
+		if (batch.Renderers.size() < 2)
+		{
+			continue;
+		}
+
+		DynamicArray<MeshBase::VertexType> vertices;
+		DynamicArray<unsigned int> indices;
+		for (const auto& renderer : batch.Renderers)
+		{
+			AppendToBatch(*renderer, vertices, indices);
+		}
+
+		SharedPtr<BatchedMesh> mesh = SharedPtr<BatchedMesh>(new BatchedMesh(std::move(vertices), std::move(indices)));
+		if (!mesh->Initialize())
+		{
+			gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot initialize static batch mesh"));
+			continue;
+		}
+
+		SharedPtr<Entity> batchEntity = scene.SpawnEntity(DT_TEXT("StaticBatch"));
+		batchEntity->SetLayer(pair.first.Layer, false);
+		batchEntity->SetStatic(true);
+
+		SharedPtr<MeshRenderer> batchRenderer = batchEntity->AddComponent<MeshRenderer>();
+		batchRenderer->SetMaterial(batch.BatchMaterial);
+		batchRenderer->SetMesh(mesh);
+
+		for (const auto& renderer : batch.Renderers)
+		{
+			renderer->GetOwner()->RemoveComponent(renderer);
+		}
+
+		++batchesCount;
+		batchedRenderersCount += (unsigned int)batch.Renderers.size();
+	}
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Static batching merged %u renderers into %u batches"), batchedRenderersCount, batchesCount);
+
+	return batchesCount;
+}
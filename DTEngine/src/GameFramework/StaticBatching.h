@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Core/Platform.h"
+
+class Scene;
+
+class StaticBatchingUtility final
+{
+public:
+	static const float DEFAULT_CELL_SIZE;
+
+public:
+	// Merges opaque renderers of STATIC entities sharing material and layer into combined meshes, one per spatial cell of given size
+	// Every batch is spawned on the scene as a static entity with its own renderer (and bounds), original renderers are removed
+	// Merged geometry is read from CPU data of meshes, so it has to run before Resources::ReleaseMeshesCPUData
+	// Returns number of created batches
+	static unsigned int Build(Scene& scene, float cellSize = DEFAULT_CELL_SIZE);
+};
@@ -269,16 +269,20 @@ bool Physics::CreateMeshShape(SharedPtr<MeshBase> mesh, physx::PxShape** shape)
 {
 	DT_ASSERT(mesh && shape, DT_TEXT("Cannot create mesh shape either for null mesh or null shape"));
 	
-	const DynamicArray<MeshBase::VertexType>& vertices = mesh->GetVertices();
-	const DynamicArray<unsigned int>& indices = mesh->GetIndices();
+	const unsigned int* indices = mesh->GetIndices();
+	if (mesh->GetPositionsCount() == 0 || indices == nullptr)
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_PHYSICS, DT_TEXT("Mesh (%s) has no CPU data to cook, it has to be required before it is released"), mesh->GetPath().c_str());
+		return false;
+	}
 
 	PxTriangleMeshDesc triangleDesc;
-	triangleDesc.points.count = (PxU32)vertices.size();
-	triangleDesc.points.stride = sizeof(MeshBase::VertexType);
-	triangleDesc.points.data = vertices.data();
-	triangleDesc.triangles.count = (PxU32)indices.size() / 3;
+	triangleDesc.points.count = (PxU32)mesh->GetPositionsCount();
+	triangleDesc.points.stride = mesh->GetPositionsStride();
+	triangleDesc.points.data = mesh->GetPositions();
+	triangleDesc.triangles.count = (PxU32)mesh->GetIndicesCount() / 3;
 	triangleDesc.triangles.stride = sizeof(unsigned int) * 3;
-	triangleDesc.triangles.data = indices.data();
+	triangleDesc.triangles.data = indices;
 
 #if DT_DEBUG
 
@@ -0,0 +1,359 @@
+#include "BlockCompressor.h"
+
+#include <climits>
+#include <cstring>
+#include <thread>
+
+#include "Utility/Math.h"
+
+static const unsigned int BLOCK_PIXELS_COUNT = 16;
+static const unsigned int POWER_ITERATIONS_COUNT = 8;
+static const unsigned int LEAST_SQUARES_ITERATIONS_COUNT = 2;
+
+// Color is given in [0, 255]
+static unsigned short PackColor565(const float* color)
+{
+	const int r = Math::Clamp((int)(color[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+	const int g = Math::Clamp((int)(color[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+	const int b = Math::Clamp((int)(color[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+// Same expansion to 8 bits as GPUs do
+static void UnpackColor565(unsigned short color, int* rgb)
+{
+	const int r = color >> 11;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the nearest of four palette colors for every pixel, returns sum of squared errors
+static int FindColorIndices(const unsigned char* block, unsigned short color0, unsigned short color1, unsigned int& indices)
+{
+	int palette[4][3];
+	UnpackColor565(color0, palette[0]);
+	UnpackColor565(color1, palette[1]);
+	for (int c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	indices = 0;
+	int error = 0;
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		const unsigned char* pixel = block + i * 4;
+		int bestDistance = INT_MAX;
+		unsigned int bestIndex = 0;
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			const int r = pixel[0] - palette[j][0];
+			const int g = pixel[1] - palette[j][1];
+			const int b = pixel[2] - palette[j][2];
+			const int distance = r * r + g * g + b * b;
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestIndex = j;
+			}
+		}
+
+		indices |= bestIndex << (2 * i);
+		error += bestDistance;
+	}
+
+	return error;
+}
+
+// Solves for endpoints minimizing squared error of the block with given indices, returns false if all pixels use the same palette entry
+static bool RefineEndpoints(const unsigned char* block, unsigned int indices, float* endpoint0, float* endpoint1)
+{
+	// Weights of endpoint 0 in each palette entry
+	static const float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float ax[3] = {0.0f, 0.0f, 0.0f};
+	float bx[3] = {0.0f, 0.0f, 0.0f};
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		const float a = WEIGHTS[(indices >> (2 * i)) & 3];
+		const float b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < 3; ++c)
+		{
+			ax[c] += a * block[i * 4 + c];
+			bx[c] += b * block[i * 4 + c];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+	if (Math::Abs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	const float inverseDeterminant = 1.0f / determinant;
+	for (int c = 0; c < 3; ++c)
+	{
+		endpoint0[c] = Math::Clamp((ax[c] * bb - bx[c] * ab) * inverseDeterminant, 0.0f, 255.0f);
+		endpoint1[c] = Math::Clamp((bx[c] * aa - ax[c] * ab) * inverseDeterminant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+void BlockCompressor::CompressBC1Block(const unsigned char* block, unsigned char* output)
+{
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			mean[c] += block[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		mean[c] /= BLOCK_PIXELS_COUNT;
+	}
+
+	// Symmetric, stored as rr, rg, rb, gg, gb, bb
+	float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		const float r = block[i * 4 + 0] - mean[0];
+		const float g = block[i * 4 + 1] - mean[1];
+		const float b = block[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Principal axis by power iteration, starting from the column of the channel with the biggest variance (it is never orthogonal to the axis)
+	static const int COVARIANCE_COLUMNS[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+	const int column = covariance[0] >= covariance[3] && covariance[0] >= covariance[5] ? 0 : (covariance[3] >= covariance[5] ? 1 : 2);
+	float axis[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		axis[c] = covariance[COVARIANCE_COLUMNS[column][c]];
+	}
+	for (unsigned int iteration = 0; iteration < POWER_ITERATIONS_COUNT; ++iteration)
+	{
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		const float length = Math::Sqrt(x * x + y * y + z * z);
+		if (length < 1e-6f)
+		{
+			// Single color block
+			axis[0] = axis[1] = axis[2] = 0.0f;
+			break;
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	// Endpoints are the extremes of pixels projected on the axis
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		const float projection = (block[i * 4 + 0] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] + (block[i * 4 + 2] - mean[2]) * axis[2];
+		minProjection = Math::Min(minProjection, projection);
+		maxProjection = Math::Max(maxProjection, projection);
+	}
+
+	float endpoint0[3];
+	float endpoint1[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		endpoint0[c] = mean[c] + axis[c] * maxProjection;
+		endpoint1[c] = mean[c] + axis[c] * minProjection;
+	}
+
+	unsigned short color0 = PackColor565(endpoint0);
+	unsigned short color1 = PackColor565(endpoint1);
+	unsigned int indices;
+	int error = FindColorIndices(block, color0, color1, indices);
+
+	// Extremes are pulled towards the rest of pixels, refined endpoints are kept only if they are better after quantization
+	for (unsigned int iteration = 0; iteration < LEAST_SQUARES_ITERATIONS_COUNT && error > 0; ++iteration)
+	{
+		if (!RefineEndpoints(block, indices, endpoint0, endpoint1))
+		{
+			break;
+		}
+
+		const unsigned short refinedColor0 = PackColor565(endpoint0);
+		const unsigned short refinedColor1 = PackColor565(endpoint1);
+		if (refinedColor0 == color0 && refinedColor1 == color1)
+		{
+			break;
+		}
+
+		unsigned int refinedIndices;
+		const int refinedError = FindColorIndices(block, refinedColor0, refinedColor1, refinedIndices);
+		if (refinedError >= error)
+		{
+			break;
+		}
+
+		color0 = refinedColor0;
+		color1 = refinedColor1;
+		indices = refinedIndices;
+		error = refinedError;
+	}
+
+	// Four color mode needs color0 > color1, swapping endpoints maps indices 0 <-> 1 and 2 <-> 3
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+		indices ^= 0x55555555;
+	}
+	else if (color0 == color1)
+	{
+		indices = 0;
+	}
+
+	output[0] = (unsigned char)(color0 & 0xFF);
+	output[1] = (unsigned char)(color0 >> 8);
+	output[2] = (unsigned char)(color1 & 0xFF);
+	output[3] = (unsigned char)(color1 >> 8);
+	for (int i = 0; i < 4; ++i)
+	{
+		output[4 + i] = (unsigned char)(indices >> (8 * i));
+	}
+}
+
+void BlockCompressor::CompressBC4Block(const unsigned char* block, unsigned int channel, unsigned char* output)
+{
+	int minValue = 255;
+	int maxValue = 0;
+	for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+	{
+		minValue = Math::Min(minValue, (int)block[i * 4 + channel]);
+		maxValue = Math::Max(maxValue, (int)block[i * 4 + channel]);
+	}
+
+	// First endpoint bigger than second selects mode with six interpolated values between them
+	output[0] = (unsigned char)maxValue;
+	output[1] = (unsigned char)minValue;
+
+	unsigned long long indices = 0;
+	if (maxValue > minValue)
+	{
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int j = 1; j < 7; ++j)
+		{
+			palette[j + 1] = ((7 - j) * maxValue + j * minValue + 3) / 7;
+		}
+
+		for (unsigned int i = 0; i < BLOCK_PIXELS_COUNT; ++i)
+		{
+			const int value = block[i * 4 + channel];
+			int bestDistance = INT_MAX;
+			unsigned long long bestIndex = 0;
+			for (unsigned int j = 0; j < 8; ++j)
+			{
+				const int distance = Math::Abs(value - palette[j]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = j;
+				}
+			}
+			indices |= bestIndex << (3 * i);
+		}
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		output[2 + i] = (unsigned char)(indices >> (8 * i));
+	}
+}
+
+void BlockCompressor::CompressBC3Block(const unsigned char* block, unsigned char* output)
+{
+	CompressBC4Block(block, 3, output);
+	CompressBC1Block(block, output + 8);
+}
+
+void BlockCompressor::CompressBC5Block(const unsigned char* block, unsigned char* output)
+{
+	CompressBC4Block(block, 0, output);
+	CompressBC4Block(block, 1, output + 8);
+}
+
+static void CompressBlockRows(const unsigned char* pixels, unsigned int width, unsigned int height, TextureFormat format, unsigned char* blocks, unsigned int firstRow, unsigned int endRow)
+{
+	const unsigned int blockSize = GetTextureFormatBlockSize(format);
+	const unsigned int blocksPerRow = (width + 3) / 4;
+
+	unsigned char block[BLOCK_PIXELS_COUNT * 4];
+	for (unsigned int blockY = firstRow; blockY < endRow; ++blockY)
+	{
+		for (unsigned int blockX = 0; blockX < blocksPerRow; ++blockX)
+		{
+			for (unsigned int y = 0; y < 4; ++y)
+			{
+				const unsigned int sourceY = Math::Min(blockY * 4 + y, height - 1);
+				for (unsigned int x = 0; x < 4; ++x)
+				{
+					const unsigned int sourceX = Math::Min(blockX * 4 + x, width - 1);
+					memcpy(block + (y * 4 + x) * 4, pixels + ((size_t)sourceY * width + sourceX) * 4, 4);
+				}
+			}
+
+			unsigned char* output = blocks + ((size_t)blockY * blocksPerRow + blockX) * blockSize;
+			switch (format)
+			{
+			case TextureFormat::BC1:
+				BlockCompressor::CompressBC1Block(block, output);
+				break;
+			case TextureFormat::BC3:
+				BlockCompressor::CompressBC3Block(block, output);
+				break;
+			case TextureFormat::BC5:
+				BlockCompressor::CompressBC5Block(block, output);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void BlockCompressor::Compress(const unsigned char* pixels, unsigned int width, unsigned int height, TextureFormat format, unsigned char* blocks)
+{
+	DT_ASSERT(IsBlockCompressed(format), DT_TEXT("Only block compressed formats can be compressed"));
+
+	// Every thread gets a continuous range of block rows, blocks are independent so no synchronization is needed
+	const unsigned int rowsCount = (height + 3) / 4;
+	const size_t blocksCount = (size_t)rowsCount * ((width + 3) / 4);
+	const unsigned int hardwareThreadsCount = Math::Max(std::thread::hardware_concurrency(), 1u);
+	const unsigned int threadsCount = (unsigned int)Math::Clamp<size_t>(blocksCount / MIN_BLOCKS_PER_THREAD, 1, Math::Min(Math::Min(hardwareThreadsCount, MAX_THREADS_COUNT), rowsCount));
+
+	DynamicArray<std::thread> threads;
+	for (unsigned int i = 1; i < threadsCount; ++i)
+	{
+		threads.push_back(std::thread(&CompressBlockRows, pixels, width, height, format, blocks, rowsCount * i / threadsCount, rowsCount * (i + 1) / threadsCount));
+	}
+	CompressBlockRows(pixels, width, height, format, blocks, 0, rowsCount / threadsCount);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "TextureFormat.h"
+
+// Encodes RGBA8 images to BC1, BC3 and BC5 blocks
+// Colors use endpoints along the principal axis of the block refined by least squares, single channels use their min and max
+// Big images are split to rows of blocks compressed on more threads
+class BlockCompressor final
+{
+public:
+	// Smaller images are compressed on calling thread only
+	static const unsigned int MIN_BLOCKS_PER_THREAD = 1024;
+	static const unsigned int MAX_THREADS_COUNT = 8;
+
+	// Blocks at right and bottom edges of images with sizes not divisible by 4 repeat edge pixels
+	static void Compress(const unsigned char* pixels, unsigned int width, unsigned int height, TextureFormat format, unsigned char* blocks);
+
+	// Blocks are 16 RGBA8 pixels, row by row
+	static void CompressBC1Block(const unsigned char* block, unsigned char* output);
+	static void CompressBC3Block(const unsigned char* block, unsigned char* output);
+	static void CompressBC5Block(const unsigned char* block, unsigned char* output);
+	// Encodes one channel of the block (0 - 3) as BC4, used by alpha of BC3 and both channels of BC5
+	static void CompressBC4Block(const unsigned char* block, unsigned int channel, unsigned char* output);
+};
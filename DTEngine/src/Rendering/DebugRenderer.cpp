@@ -0,0 +1,246 @@
+#include "DebugRenderer.h"
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+
+#include "Debug/Debug.h"
+#include "Rendering/Graphics.h"
+#include "Rendering/Shader.h"
+
+static const String DEBUG_SHADER_PATH = DT_TEXT("Resources/Shaders/Debug");
+
+struct DebugPerFrameConstants
+{
+	Matrix World2ViewMatrix;
+	Matrix View2ProjectionMatrix;
+};
+
+DebugRenderer::DebugRenderer() : _isUploaded(false), _vertexBuffer(nullptr), _vertexBufferCapacity(0), _perFrameBuffer(nullptr), _vertexShader(nullptr), _pixelShader(nullptr), _inputLayout(nullptr)
+{
+	ZeroMemory(_uploadedFirstVertices, sizeof(_uploadedFirstVertices));
+}
+
+bool DebugRenderer::CreateShaders(Graphics& graphics)
+{
+	ShaderCompileRequest request;
+	request.EntryPoint = "main";
+	request.Flags = D3D10_SHADER_ENABLE_STRICTNESS;
+
+	CompiledShader compiledVertexShader;
+	request.SourcePath = DEBUG_SHADER_PATH + DT_TEXT("VS.hlsl");
+	request.Target = "vs_5_0";
+	if (!Shader::CompileCached(request, compiledVertexShader))
+	{
+		return false;
+	}
+
+	CompiledShader compiledPixelShader;
+	request.SourcePath = DEBUG_SHADER_PATH + DT_TEXT("PS.hlsl");
+	request.Target = "ps_5_0";
+	if (!Shader::CompileCached(request, compiledPixelShader))
+	{
+		return false;
+	}
+
+	if (!graphics.CreateVertexShader(compiledVertexShader.Bytecode.data(), compiledVertexShader.Bytecode.size(), &_vertexShader) ||
+		!graphics.CreatePixelShader(compiledPixelShader.Bytecode.data(), compiledPixelShader.Bytecode.size(), &_pixelShader))
+	{
+		return false;
+	}
+
+	D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[2];
+	inputLayoutDesc[0] = {0};
+	inputLayoutDesc[1] = {0};
+
+	inputLayoutDesc[0].SemanticName = "POSITION";
+	inputLayoutDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	inputLayoutDesc[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	inputLayoutDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+	inputLayoutDesc[1].SemanticName = "COLOR";
+	inputLayoutDesc[1].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	inputLayoutDesc[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	inputLayoutDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+	return graphics.CreateInputLayout(inputLayoutDesc, sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC), compiledVertexShader.Bytecode.data(), compiledVertexShader.Bytecode.size(), &_inputLayout);
+}
+
+bool DebugRenderer::CreateVertexBuffer(Graphics& graphics, unsigned int capacity)
+{
+	RELEASE_COM(_vertexBuffer);
+	_vertexBufferCapacity = 0;
+
+	D3D11_BUFFER_DESC bufferDesc = {0};
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = capacity * sizeof(DebugVertex);
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	if (!graphics.CreateBuffer(bufferDesc, &_vertexBuffer))
+	{
+		return false;
+	}
+
+	_vertexBufferCapacity = capacity;
+	return true;
+}
+
+bool DebugRenderer::Upload(Graphics& graphics)
+{
+	const unsigned int verticesCount = GetVerticesCount();
+	if (verticesCount > _vertexBufferCapacity)
+	{
+		unsigned int capacity = Math::Max(_vertexBufferCapacity, INITIAL_VERTEX_BUFFER_CAPACITY);
+		while (capacity < verticesCount)
+		{
+			capacity *= 2;
+		}
+
+		if (!CreateVertexBuffer(graphics, capacity))
+		{
+			gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot create debug vertex buffer for %u vertices"), capacity);
+			return false;
+		}
+	}
+
+	if (verticesCount > 0)
+	{
+		DebugVertex* data = (DebugVertex*)graphics.Map(_vertexBuffer);
+		if (!data)
+		{
+			return false;
+		}
+
+		unsigned int firstVertex = 0;
+		for (unsigned int i = 0; i < STREAMS_COUNT; ++i)
+		{
+			_uploadedFirstVertices[i] = firstVertex;
+			if (!_streams[i].empty())
+			{
+				memcpy(data + firstVertex, _streams[i].data(), _streams[i].size() * sizeof(DebugVertex));
+				firstVertex += (unsigned int)_streams[i].size();
+			}
+		}
+
+		graphics.Unmap(_vertexBuffer);
+	}
+
+	_isUploaded = true;
+	return true;
+}
+
+bool DebugRenderer::Initialize(Graphics& graphics)
+{
+	if (!CreateShaders(graphics))
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot create debug shaders"));
+		return false;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {0};
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(DebugPerFrameConstants);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (!graphics.CreateBuffer(bufferDesc, &_perFrameBuffer) || !CreateVertexBuffer(graphics, INITIAL_VERTEX_BUFFER_CAPACITY))
+	{
+		return false;
+	}
+
+	// Debug draws don't write depth, so they never hide each other or the scene drawn after them
+	for (unsigned char i = 0; i < (unsigned char)DebugPrimitiveType::Count; ++i)
+	{
+		const FillMode fillMode = (DebugPrimitiveType)i == DebugPrimitiveType::Triangles ? FillMode::Wireframe : FillMode::Solid;
+		for (unsigned char j = 0; j < (unsigned char)DebugDepthMode::Count; ++j)
+		{
+			const CompareFunction zTestFunction = (DebugDepthMode)j == DebugDepthMode::DepthTested ? CompareFunction::LessOrEqual : CompareFunction::Always;
+
+			SharedPtr<RenderState>& renderState = _renderStates[GetStreamIndex((DebugPrimitiveType)i, (DebugDepthMode)j)];
+			renderState = graphics.GetRenderState(RenderStateParams(CullMode::None, fillMode, ZWrite::Off, BlendMode::SrcAlpha, BlendMode::InvSrcAlpha, zTestFunction));
+			if (!renderState)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void DebugRenderer::Shutdown()
+{
+	Clear();
+
+	for (SharedPtr<RenderState>& renderState : _renderStates)
+	{
+		renderState = nullptr;
+	}
+
+	RELEASE_COM(_vertexBuffer);
+	_vertexBufferCapacity = 0;
+	RELEASE_COM(_perFrameBuffer);
+	RELEASE_COM(_inputLayout);
+	RELEASE_COM(_vertexShader);
+	RELEASE_COM(_pixelShader);
+}
+
+void DebugRenderer::Clear()
+{
+	// Streams keep their capacity, so steady debug drawing doesn't allocate every frame
+	for (DynamicArray<DebugVertex>& stream : _streams)
+	{
+		stream.clear();
+	}
+	_isUploaded = false;
+}
+
+void DebugRenderer::Render(Graphics& graphics, const Matrix& viewMatrix, const Matrix& projectionMatrix)
+{
+	if (!_vertexShader || GetVerticesCount() == 0)
+	{
+		return;
+	}
+
+	if (!_isUploaded && !Upload(graphics))
+	{
+		return;
+	}
+
+	DebugPerFrameConstants* constants = (DebugPerFrameConstants*)graphics.Map(_perFrameBuffer);
+	if (!constants)
+	{
+		return;
+	}
+	constants->World2ViewMatrix = viewMatrix;
+	constants->View2ProjectionMatrix = projectionMatrix;
+	graphics.Unmap(_perFrameBuffer);
+
+	graphics.SetShaders(_inputLayout, _vertexShader, _pixelShader);
+	graphics.SetVSConstantBuffers(0, 1, &_perFrameBuffer);
+
+	for (unsigned char i = 0; i < (unsigned char)DebugPrimitiveType::Count; ++i)
+	{
+		const D3D11_PRIMITIVE_TOPOLOGY topology = (DebugPrimitiveType)i == DebugPrimitiveType::Lines ? D3D11_PRIMITIVE_TOPOLOGY_LINELIST : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		for (unsigned char j = 0; j < (unsigned char)DebugDepthMode::Count; ++j)
+		{
+			const unsigned int streamIndex = GetStreamIndex((DebugPrimitiveType)i, (DebugDepthMode)j);
+			if (_streams[streamIndex].empty())
+			{
+				continue;
+			}
+
+			graphics.SetRenderState(_renderStates[streamIndex]);
+			graphics.Draw(_vertexBuffer, sizeof(DebugVertex), _uploadedFirstVertices[streamIndex], (unsigned int)_streams[streamIndex].size(), topology);
+		}
+	}
+}
+
+unsigned int DebugRenderer::GetVerticesCount() const
+{
+	unsigned int verticesCount = 0;
+	for (const DynamicArray<DebugVertex>& stream : _streams)
+	{
+		verticesCount += (unsigned int)stream.size();
+	}
+	return verticesCount;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Utility/Math.h"
+
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+
+class Graphics;
+struct RenderState;
+
+struct DebugVertex
+{
+	Vector3 Position;
+	Vector4 Color;
+};
+
+enum class DebugPrimitiveType : unsigned char
+{
+	Lines,
+	// Drawn in wireframe, used for meshes so their edges don't have to be deduplicated
+	Triangles,
+
+	Count
+};
+
+enum class DebugDepthMode : unsigned char
+{
+	// Drawn on top of everything
+	AlwaysVisible,
+	// Hidden behind scene geometry
+	DepthTested,
+
+	Count
+};
+
+// Batches debug primitives into CPU vertex streams, one stream per primitive type and depth mode
+// Streams are uploaded to a single dynamic vertex buffer once per frame, each camera then issues one draw per non empty stream
+class DebugRenderer final
+{
+public:
+	static const unsigned int STREAMS_COUNT = (unsigned int)DebugPrimitiveType::Count * (unsigned int)DebugDepthMode::Count;
+	// Vertex buffer grows to fit the streams, so this only avoids reallocations during first frames
+	static const unsigned int INITIAL_VERTEX_BUFFER_CAPACITY = 8192;
+
+private:
+	DynamicArray<DebugVertex> _streams[STREAMS_COUNT];
+	// Range of each stream in vertex buffer, valid after upload
+	unsigned int _uploadedFirstVertices[STREAMS_COUNT];
+	bool _isUploaded;
+
+	ID3D11Buffer* _vertexBuffer;
+	unsigned int _vertexBufferCapacity;
+	ID3D11Buffer* _perFrameBuffer;
+
+	ID3D11VertexShader* _vertexShader;
+	ID3D11PixelShader* _pixelShader;
+	ID3D11InputLayout* _inputLayout;
+
+	SharedPtr<RenderState> _renderStates[STREAMS_COUNT];
+
+public:
+	DebugRenderer();
+
+private:
+	static inline unsigned int GetStreamIndex(DebugPrimitiveType primitiveType, DebugDepthMode depthMode)
+	{
+		return (unsigned int)primitiveType * (unsigned int)DebugDepthMode::Count + (unsigned int)depthMode;
+	}
+
+	bool CreateShaders(Graphics& graphics);
+	bool CreateVertexBuffer(Graphics& graphics, unsigned int capacity);
+	bool Upload(Graphics& graphics);
+
+public:
+	bool Initialize(Graphics& graphics);
+	void Shutdown();
+
+	// Starts new frame of primitives, previous ones are dropped
+	void Clear();
+
+	inline void AddLine(const Vector3& start, const Vector3& end, const Vector4& color, DebugDepthMode depthMode)
+	{
+		DynamicArray<DebugVertex>& stream = _streams[GetStreamIndex(DebugPrimitiveType::Lines, depthMode)];
+		stream.push_back({start, color});
+		stream.push_back({end, color});
+		_isUploaded = false;
+	}
+
+	inline void AddTriangle(const Vector3& a, const Vector3& b, const Vector3& c, const Vector4& color, DebugDepthMode depthMode)
+	{
+		DynamicArray<DebugVertex>& stream = _streams[GetStreamIndex(DebugPrimitiveType::Triangles, depthMode)];
+		stream.push_back({a, color});
+		stream.push_back({b, color});
+		stream.push_back({c, color});
+		_isUploaded = false;
+	}
+
+	// Uploads streams if they changed since last call, so rendering more cameras in a frame costs only the draws
+	void Render(Graphics& graphics, const Matrix& viewMatrix, const Matrix& projectionMatrix);
+
+	unsigned int GetVerticesCount() const;
+};
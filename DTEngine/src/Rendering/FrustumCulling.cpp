@@ -0,0 +1,108 @@
+#include "FrustumCulling.h"
+
+#include <xmmintrin.h>
+
+void BoundsArray::Add(const Vector3& min, const Vector3& max)
+{
+	CenterX.push_back(0.0f);
+	CenterY.push_back(0.0f);
+	CenterZ.push_back(0.0f);
+	ExtentX.push_back(0.0f);
+	ExtentY.push_back(0.0f);
+	ExtentZ.push_back(0.0f);
+
+	Set(GetCount() - 1, min, max);
+}
+
+void BoundsArray::Add(const BoundsArray& other, unsigned int index)
+{
+	CenterX.push_back(other.CenterX[index]);
+	CenterY.push_back(other.CenterY[index]);
+	CenterZ.push_back(other.CenterZ[index]);
+	ExtentX.push_back(other.ExtentX[index]);
+	ExtentY.push_back(other.ExtentY[index]);
+	ExtentZ.push_back(other.ExtentZ[index]);
+}
+
+void BoundsArray::Set(unsigned int index, const Vector3& min, const Vector3& max)
+{
+	CenterX[index] = (min.X + max.X) * 0.5f;
+	CenterY[index] = (min.Y + max.Y) * 0.5f;
+	CenterZ[index] = (min.Z + max.Z) * 0.5f;
+	ExtentX[index] = (max.X - min.X) * 0.5f;
+	ExtentY[index] = (max.Y - min.Y) * 0.5f;
+	ExtentZ[index] = (max.Z - min.Z) * 0.5f;
+}
+
+void BoundsArray::RemoveSwap(unsigned int index)
+{
+	const unsigned int last = GetCount() - 1;
+
+	CenterX[index] = CenterX[last];
+	CenterY[index] = CenterY[last];
+	CenterZ[index] = CenterZ[last];
+	ExtentX[index] = ExtentX[last];
+	ExtentY[index] = ExtentY[last];
+	ExtentZ[index] = ExtentZ[last];
+
+	CenterX.pop_back();
+	CenterY.pop_back();
+	CenterZ.pop_back();
+	ExtentX.pop_back();
+	ExtentY.pop_back();
+	ExtentZ.pop_back();
+}
+
+void BoundsArray::Clear()
+{
+	CenterX.clear();
+	CenterY.clear();
+	CenterZ.clear();
+	ExtentX.clear();
+	ExtentY.clear();
+	ExtentZ.clear();
+}
+
+void CullBounds(const Plane* planes, unsigned int planesCount, const BoundsArray& bounds, DynamicArray<unsigned int>& visibilityMask)
+{
+	const unsigned int count = bounds.GetCount();
+	visibilityMask.assign((count + 31) / 32, 0);
+
+	// Bounds are outside if center's distance to any plane is smaller than -(box projected on plane normal)
+	const unsigned int simdCount = count & ~3u;
+	for (unsigned int i = 0; i < simdCount; i += 4)
+	{
+		const __m128 centerX = _mm_loadu_ps(&bounds.CenterX[i]);
+		const __m128 centerY = _mm_loadu_ps(&bounds.CenterY[i]);
+		const __m128 centerZ = _mm_loadu_ps(&bounds.CenterZ[i]);
+		const __m128 extentX = _mm_loadu_ps(&bounds.ExtentX[i]);
+		const __m128 extentY = _mm_loadu_ps(&bounds.ExtentY[i]);
+		const __m128 extentZ = _mm_loadu_ps(&bounds.ExtentZ[i]);
+
+		__m128 inside = _mm_cmpeq_ps(centerX, centerX);
+		for (unsigned int p = 0; p < planesCount; ++p)
+		{
+			const Vector4& plane = planes[p].GetPlaneVector();
+
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.X), centerX), _mm_mul_ps(_mm_set1_ps(plane.Y), centerY)),
+											   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.Z), centerZ), _mm_set1_ps(plane.W)));
+			const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Math::Abs(plane.X)), extentX), _mm_mul_ps(_mm_set1_ps(Math::Abs(plane.Y)), extentY)),
+											 _mm_mul_ps(_mm_set1_ps(Math::Abs(plane.Z)), extentZ));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		// i is a multiple of 4, so four bits never cross a word boundary
+		visibilityMask[i >> 5] |= (unsigned int)_mm_movemask_ps(inside) << (i & 31);
+	}
+
+	for (unsigned int i = simdCount; i < count; ++i)
+	{
+		const Vector3 center(bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i]);
+		const Vector3 extents(bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i]);
+		if (TestBoxAgainstPlanes(planes, planesCount, center - extents, center + extents) != ContainmentType::Disjoint)
+		{
+			visibilityMask[i >> 5] |= 1u << (i & 31);
+		}
+	}
+}
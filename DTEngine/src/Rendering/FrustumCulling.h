@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Utility/GeometryUtils.h"
+#include "Utility/Math.h"
+
+// World space bounds of many objects (centers and half extents) stored as structure of arrays,
+// so they can be tested against planes four at a time
+struct BoundsArray final
+{
+public:
+	DynamicArray<float> CenterX;
+	DynamicArray<float> CenterY;
+	DynamicArray<float> CenterZ;
+	DynamicArray<float> ExtentX;
+	DynamicArray<float> ExtentY;
+	DynamicArray<float> ExtentZ;
+
+public:
+	void Add(const Vector3& min, const Vector3& max);
+	// Copies bounds at given index of another array
+	void Add(const BoundsArray& other, unsigned int index);
+	void Set(unsigned int index, const Vector3& min, const Vector3& max);
+	// Moves last bounds into given index (matches swap-removal of elements that own the bounds)
+	void RemoveSwap(unsigned int index);
+	void Clear();
+
+	inline unsigned int GetCount() const
+	{
+		return (unsigned int)CenterX.size();
+	}
+};
+
+// Tests all bounds against convex volume bounded by planes (normals pointing inside)
+// Writes one bit per bounds into visibilityMask (bit set if bounds are not fully behind any of the planes)
+// Bounds are processed in groups of four with SSE, so there are no per object transforms nor allocations
+void CullBounds(const Plane* planes, unsigned int planesCount, const BoundsArray& bounds, DynamicArray<unsigned int>& visibilityMask);
+
+inline bool IsBitSet(const DynamicArray<unsigned int>& visibilityMask, unsigned int index)
+{
+	return (visibilityMask[index >> 5] & (1u << (index & 31))) != 0;
+}
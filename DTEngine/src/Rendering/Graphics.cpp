@@ -27,8 +27,12 @@ void Graphics::CommonRenderStates::Shutdown()
 	DefaultRenderState.Shutdown();
 }
 
-Graphics::Graphics() : _swapChain(nullptr), _device(nullptr), _deviceContext(nullptr), _renderTargetView(nullptr), _depthStencilBuffer(nullptr), _depthStencilView(nullptr)
-{}
+Graphics::Graphics() : _swapChain(nullptr), _device(nullptr), _deviceContext(nullptr), _renderTargetView(nullptr), _depthStencilBuffer(nullptr), _depthStencilView(nullptr), _deviceContext1(nullptr), _sceneTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST), _lastUsedShader(nullptr), _lastUsedVertexFormat(VertexFormat::Full), _lastUsedRenderStateID(0), _defaultSamplerState(nullptr), _currentObjectSlot(ObjectConstantsArena::INVALID_SLOT)
+{
+	ZeroMemory(_boundVSConstantBuffers, sizeof(_boundVSConstantBuffers));
+	ZeroMemory(_boundVSConstantBuffersOffsets, sizeof(_boundVSConstantBuffersOffsets));
+	ZeroMemory(_boundPSShaderResources, sizeof(_boundPSShaderResources));
+}
 
 bool Graphics::GetRefreshRate(unsigned int windowHeight, unsigned int& numerator, unsigned int& denominator)
 {
@@ -233,12 +237,49 @@ bool Graphics::Initialize(bool vsync)
 		return false;
 	}
 
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MaxAnisotropy = 8;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	result = _device->CreateSamplerState(&samplerDesc, &_defaultSamplerState);
+	HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot create default sampler state")));
+
+	// Object constants arena needs constant buffer offsets, without them objects upload their constants per draw
+	static const unsigned int OBJECT_CONSTANTS_ARENA_INITIAL_CAPACITY = 1024;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {0};
+	result = _device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (SUCCEEDED(result) && options.ConstantBufferOffsetting)
+	{
+		_deviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&_deviceContext1);
+	}
+
+	if (_deviceContext1)
+	{
+		if (!_objectConstantsArena.Initialize(*this, OBJECT_CONSTANTS_ARENA_INITIAL_CAPACITY))
+		{
+			gDebug.Print(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Cannot create object constants arena, falling back to per draw uploads"));
+		}
+	}
+	else
+	{
+		gDebug.Print(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Constant buffer offsets are not supported, falling back to per draw uploads"));
+	}
+
 	return true;
 }
 
 void Graphics::Shutdown()
 {
+	_objectConstantsArena.Shutdown();
+	_renderStates.clear();
+	RELEASE_COM(_defaultSamplerState);
 	ReleaseWindowDependentResources();
+	RELEASE_COM(_deviceContext1);
 	RELEASE_COM(_deviceContext);
 	RELEASE_COM(_device);
 }
@@ -250,9 +291,26 @@ void Graphics::BeginScene(D3D11_PRIMITIVE_TOPOLOGY topology)
 
 	_deviceContext->ClearDepthStencilView(_depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
+	_sceneTopology = topology;
 	_deviceContext->IASetPrimitiveTopology(topology);
 
-	_lastUsedMaterial = nullptr;
+	_lastUsedShader = nullptr;
+	_lastUsedRenderStateID = 0;
+	ZeroMemory(_boundVSConstantBuffers, sizeof(_boundVSConstantBuffers));
+	ZeroMemory(_boundVSConstantBuffersOffsets, sizeof(_boundVSConstantBuffersOffsets));
+	ZeroMemory(_boundPSShaderResources, sizeof(_boundPSShaderResources));
+
+	for (auto it = _renderStates.begin(); it != _renderStates.end();)
+	{
+		if (it->second.expired())
+		{
+			it = _renderStates.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
 }
 
 void Graphics::EndScene()
@@ -321,33 +379,59 @@ bool Graphics::CreateBuffer(const D3D11_BUFFER_DESC& bufferDesc, const D3D11_SUB
 	return true;
 }
 
-bool Graphics::CreateVertexShader(ID3D10Blob* shaderBuffer, ID3D11VertexShader** vertexShader) const
+bool Graphics::CreateVertexShader(const void* bytecode, size_t bytecodeSize, ID3D11VertexShader** vertexShader) const
+{
+	if (!bytecode || bytecodeSize == 0 || !vertexShader || !_device)
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex shader. Either bytecode, vertexShader or device is nullptr"));
+		return false;
+	}
+
+	HRESULT result = _device->CreateVertexShader(bytecode, bytecodeSize, nullptr, vertexShader);
+	HR(result);
+	return true;
+}
+
+bool Graphics::CreatePixelShader(const void* bytecode, size_t bytecodeSize, ID3D11PixelShader** pixelShader) const
+{
+	if (!bytecode || bytecodeSize == 0 || !pixelShader || !_device)
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create pixel shader. Either bytecode, pixelShader or device is nullptr"));
+		return false;
+	}
+
+	HRESULT result = _device->CreatePixelShader(bytecode, bytecodeSize, nullptr, pixelShader);
+	HR(result);
+	return true;
+}
+
+bool Graphics::CreateTexture2D(const D3D11_TEXTURE2D_DESC& textureDesc, const D3D11_SUBRESOURCE_DATA* textureData, ID3D11Texture2D** texture) const
 {
-	if (!shaderBuffer || !vertexShader || !_device)
+	if (!texture || !_device)
 	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex shader. Either shaderBuffer, vertexShader or device is nullptr"));
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create texture. Either texture or device is nullptr"));
 		return false;
 	}
 
-	HRESULT result = _device->CreateVertexShader(shaderBuffer->GetBufferPointer(), shaderBuffer->GetBufferSize(), nullptr, vertexShader);
+	HRESULT result = _device->CreateTexture2D(&textureDesc, textureData, texture);
 	HR(result);
 	return true;
 }
 
-bool Graphics::CreatePixelShader(ID3D10Blob* shaderBuffer, ID3D11PixelShader** pixelShader) const
+bool Graphics::CreateShaderResourceView(ID3D11Resource* resource, ID3D11ShaderResourceView** view) const
 {
-	if (!shaderBuffer || !pixelShader || !_device)
+	if (!resource || !view || !_device)
 	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex shader. Either shaderBuffer, pixelShader or device is nullptr"));
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create shader resource view. Either resource, view or device is nullptr"));
 		return false;
 	}
 
-	HRESULT result = _device->CreatePixelShader(shaderBuffer->GetBufferPointer(), shaderBuffer->GetBufferSize(), nullptr, pixelShader);
+	HRESULT result = _device->CreateShaderResourceView(resource, nullptr, view);
 	HR(result);
 	return true;
 }
 
-bool Graphics::CreateInputLayout(D3D11_INPUT_ELEMENT_DESC const* inputLayoutDesc, unsigned char inputLayoutDescSize, void* shaderBufferPointer, size_t shaderBufferSize, ID3D11InputLayout** inputLayout) const
+bool Graphics::CreateInputLayout(D3D11_INPUT_ELEMENT_DESC const* inputLayoutDesc, unsigned char inputLayoutDescSize, const void* shaderBufferPointer, size_t shaderBufferSize, ID3D11InputLayout** inputLayout) const
 {
 	if (!inputLayoutDesc || !inputLayout || !_device || !shaderBufferPointer || inputLayoutDescSize == 0 || shaderBufferSize == 0)
 	{
@@ -378,82 +462,225 @@ void Graphics::Unmap(ID3D11Resource* resource) const
 	_deviceContext->Unmap(resource, 0);
 }
 
-void Graphics::SetVSConstantBuffers(unsigned int bufferSlot, unsigned int bufferCount, ID3D11Buffer** buffers) const
+void Graphics::SetVSConstantBuffers(unsigned int bufferSlot, unsigned int bufferCount, ID3D11Buffer** buffers)
+{
+	DT_ASSERT(bufferSlot + bufferCount <= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, DT_TEXT("Constant buffer slot out of range"));
+
+	bool alreadyBound = true;
+	for (unsigned int i = 0; i < bufferCount; ++i)
+	{
+		if (_boundVSConstantBuffers[bufferSlot + i] != buffers[i] || _boundVSConstantBuffersOffsets[bufferSlot + i] != 0)
+		{
+			_boundVSConstantBuffers[bufferSlot + i] = buffers[i];
+			_boundVSConstantBuffersOffsets[bufferSlot + i] = 0;
+			alreadyBound = false;
+		}
+	}
+
+	if (!alreadyBound)
+	{
+		_deviceContext->VSSetConstantBuffers(bufferSlot, bufferCount, buffers);
+	}
+}
+
+void Graphics::SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView* view)
+{
+	DT_ASSERT(slot < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, DT_TEXT("Shader resource slot out of range"));
+
+	if (_boundPSShaderResources[slot] == view)
+	{
+		return;
+	}
+
+	_boundPSShaderResources[slot] = view;
+	_deviceContext->PSSetShaderResources(slot, 1, &view);
+}
+
+void Graphics::SetVSConstantBufferRange(unsigned int bufferSlot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantsCount)
+{
+	DT_ASSERT(_deviceContext1, DT_TEXT("Binding constant buffer ranges requires D3D11.1"));
+	DT_ASSERT(bufferSlot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, DT_TEXT("Constant buffer slot out of range"));
+
+	if (_boundVSConstantBuffers[bufferSlot] == buffer && _boundVSConstantBuffersOffsets[bufferSlot] == firstConstant)
+	{
+		return;
+	}
+
+	_boundVSConstantBuffers[bufferSlot] = buffer;
+	_boundVSConstantBuffersOffsets[bufferSlot] = firstConstant;
+	_deviceContext1->VSSetConstantBuffers1(bufferSlot, 1, &buffer, &firstConstant, &constantsCount);
+}
+
+ObjectConstants* Graphics::BeginObjectConstants(unsigned int objectsCount)
+{
+	if (!_deviceContext1)
+	{
+		return nullptr;
+	}
+
+	return _objectConstantsArena.Begin(*this, objectsCount);
+}
+
+void Graphics::EndObjectConstants()
+{
+	_objectConstantsArena.End(*this);
+}
+
+void Graphics::SetObjectConstantsSlot(unsigned int slot)
+{
+	_currentObjectSlot = slot;
+}
+
+void Graphics::SetViewProjection(const Matrix& viewMatrix, const Matrix& projectionMatrix)
 {
-	_deviceContext->VSSetConstantBuffers(bufferSlot, bufferCount, buffers);
+	static const String WORLD_TO_VIEW_MATRIX_NAME = DT_TEXT("World2ViewMatrix");
+	static const String VIEW_TO_PROJECTION_MATRIX_NAME = DT_TEXT("View2ProjectionMatrix");
+
+	Material::SetGlobalMatrix(WORLD_TO_VIEW_MATRIX_NAME, viewMatrix);
+	Material::SetGlobalMatrix(VIEW_TO_PROJECTION_MATRIX_NAME, projectionMatrix);
 }
 
 void Graphics::SetObject(Entity* entity)
 {
-	_currentlyRenderedEntity = entity;
+	// No object draws untransformed, previous object's matrix or arena slot must not leak into the next draw
+	SetObject(entity ? entity->GetTransform().GetModelMatrix() : Matrix::IDENTITY);
 }
 
-void Graphics::SetMaterial(Material* material)
+void Graphics::SetObject(const Matrix& modelToWorldMatrix)
 {
-	if (_lastUsedMaterial != material)
+	_currentObjectMatrix = modelToWorldMatrix;
+	_currentObjectSlot = ObjectConstantsArena::INVALID_SLOT;
+}
+
+void Graphics::SetMaterial(Material* material, const MeshBase* mesh)
+{
+	if (!material || !material->GetShader())
+	{
+		return;
+	}
+
+	const VertexFormat vertexFormat = mesh ? mesh->GetVertexFormat() : VertexFormat::Full;
+
+	Shader* shader = material->GetShader().get();
+	if (_lastUsedShader != shader)
 	{
-		_lastUsedMaterial = material;
-		if (_lastUsedMaterial)
+		_lastUsedShader = shader;
+		_lastUsedVertexFormat = vertexFormat;
+		_deviceContext->IASetInputLayout(shader->GetInputLayout(vertexFormat));
+		_deviceContext->VSSetShader(shader->GetVertexShader(vertexFormat), nullptr, 0);
+		_deviceContext->PSSetShader(shader->GetPixelShader(), nullptr, 0);
+
+		// All materials sample the same way, so samplers change only with shader
+		for (unsigned int slot : shader->GetSamplerSlots())
 		{
-			_lastUsedMaterial->UpdatePerFrameBuffers(*this);
-			SharedPtr<Shader> shader = material->GetShader();
-			_deviceContext->IASetInputLayout(shader->GetInputLayout());
-			_deviceContext->VSSetShader(shader->GetVertexShader(), nullptr, 0);
-			_deviceContext->PSSetShader(shader->GetPixelShader(), nullptr, 0);
+			_deviceContext->PSSetSamplers(slot, 1, &_defaultSamplerState);
 		}
 	}
+	else if (_lastUsedVertexFormat != vertexFormat)
+	{
+		_lastUsedVertexFormat = vertexFormat;
+		_deviceContext->IASetInputLayout(shader->GetInputLayout(vertexFormat));
+		_deviceContext->VSSetShader(shader->GetVertexShader(vertexFormat), nullptr, 0);
+	}
+
+	// Each of those uploads data only if it has changed and binds buffers only if they are not bound already
+	shader->UpdatePerFrameBuffers(*this);
+	material->UpdatePerMaterialBuffers(*this);
 
-	if (_lastUsedMaterial && _currentlyRenderedEntity)
+	if (_objectConstantsArena.IsValidSlot(_currentObjectSlot) && shader->UsesObjectConstantsLayout())
+	{
+		// Object constants were already written to the arena, just point the shader at the object's slot
+		SetVSConstantBufferRange(shader->GetObjectConstantsBufferIndex(), _objectConstantsArena.GetBuffer(), _currentObjectSlot * ObjectConstantsArena::SLOT_CONSTANTS_COUNT, ObjectConstantsArena::SLOT_CONSTANTS_COUNT);
+	}
+	else
 	{
 		static const String MODEL_TO_WORLD_MATRIX_NAME = DT_TEXT("Model2WorldMatrix");
-		_lastUsedMaterial->SetMatrix(MODEL_TO_WORLD_MATRIX_NAME, _currentlyRenderedEntity->GetTransform().GetModelMatrix());
-		_lastUsedMaterial->UpdatePerDrawCallBuffers(*this);
+		static const String POSITION_DEQUANTIZE_SCALE_NAME = DT_TEXT("PositionDequantizeScale");
+		static const String POSITION_DEQUANTIZE_OFFSET_NAME = DT_TEXT("PositionDequantizeOffset");
+		_objectParameters.SetMatrix(MODEL_TO_WORLD_MATRIX_NAME, _currentObjectMatrix);
+		if (vertexFormat == VertexFormat::Quantized)
+		{
+			_objectParameters.SetVector(POSITION_DEQUANTIZE_SCALE_NAME, mesh->GetPositionDequantizeScale());
+			_objectParameters.SetVector(POSITION_DEQUANTIZE_OFFSET_NAME, mesh->GetPositionDequantizeOffset());
+		}
+		shader->UpdatePerObjectBuffers(*this, _objectParameters);
 	}
 }
 
-void Graphics::DrawIndexed(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, unsigned int indicesCount, unsigned int stride, unsigned int offset) const
+void Graphics::DrawIndexed(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, unsigned int indicesCount, unsigned int stride, unsigned int offset, IndexFormat indexFormat) const
 {
 	_deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	_deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	_deviceContext->IASetIndexBuffer(indexBuffer, indexFormat == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 
 	_deviceContext->DrawIndexed(indicesCount, 0, 0);
 }
 
-bool Graphics::CreateRenderState(UniquePtr<RenderState>& renderState) const
+void Graphics::DrawMesh(const MeshBase& mesh, unsigned int lod) const
 {
-	if (renderState)
+	DrawIndexed(mesh.GetVertexBuffer(lod), mesh.GetIndexBuffer(lod), mesh.GetIndicesCount(lod), mesh.GetVertexStride(), 0, mesh.GetIndexFormat(lod));
+}
+
+void Graphics::SetShaders(ID3D11InputLayout* inputLayout, ID3D11VertexShader* vertexShader, ID3D11PixelShader* pixelShader)
+{
+	_lastUsedShader = nullptr;
+	_deviceContext->IASetInputLayout(inputLayout);
+	_deviceContext->VSSetShader(vertexShader, nullptr, 0);
+	_deviceContext->PSSetShader(pixelShader, nullptr, 0);
+}
+
+void Graphics::Draw(ID3D11Buffer* vertexBuffer, unsigned int stride, unsigned int firstVertex, unsigned int verticesCount, D3D11_PRIMITIVE_TOPOLOGY topology) const
+{
+	const unsigned int offset = 0;
+	_deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+
+	if (topology != _sceneTopology)
 	{
-		gDebug.Print(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Creating render state in place of existing render state. Possible memory leak!"));
+		_deviceContext->IASetPrimitiveTopology(topology);
 	}
 
-	renderState.reset(new RenderState());
+	_deviceContext->Draw(verticesCount, firstVertex);
 
-	return renderState->Initialize(_device);
+	if (topology != _sceneTopology)
+	{
+		_deviceContext->IASetPrimitiveTopology(_sceneTopology);
+	}
 }
 
-bool Graphics::CreateRenderState(UniquePtr<RenderState>& renderState, const RenderStateParams& renderStateParams) const
+SharedPtr<RenderState> Graphics::GetRenderState(const RenderStateParams& renderStateParams)
 {
+	WeakPtr<RenderState>& cachedRenderState = _renderStates[renderStateParams];
+	SharedPtr<RenderState> renderState = cachedRenderState.lock();
 	if (renderState)
 	{
-		gDebug.Print(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Creating render state in place of existing render state. Possible memory leak!"));
+		return renderState;
 	}
 
 	renderState.reset(new RenderState(renderStateParams));
+	if (!renderState->Initialize(_device))
+	{
+		return SharedPtr<RenderState>(nullptr);
+	}
 
-	return renderState->Initialize(_device);
+	cachedRenderState = renderState;
+	return renderState;
 }
 
 void Graphics::SetRenderState(const RenderState& renderState)
 {
+	if (_lastUsedRenderStateID == renderState._id)
+	{
+		return;
+	}
+
+	_lastUsedRenderStateID = renderState._id;
 	_deviceContext->OMSetDepthStencilState(renderState._depthStencilState, 1);
 	_deviceContext->RSSetState(renderState._rasterizerState);
 }
 
-void Graphics::SetRenderState(const UniquePtr<RenderState>& renderState)
+void Graphics::SetRenderState(const SharedPtr<RenderState>& renderState)
 {
 	if (renderState)
 	{
-		_deviceContext->OMSetDepthStencilState(renderState->_depthStencilState, 1);
-		_deviceContext->RSSetState(renderState->_rasterizerState);
+		SetRenderState(*renderState);
 	}
 }
\ No newline at end of file
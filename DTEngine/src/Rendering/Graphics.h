@@ -5,15 +5,19 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxguid.lib")
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 
 #include "Core/Platform.h"
 #include "Utility/Math.h"
 #include "RenderState.h"
+#include "MaterialParametersCollection.h"
+#include "ObjectConstantsArena.h"
+#include "VertexFormat.h"
 
 class Window;
 class MeshBase;
 class Material;
+class Shader;
 class MeshRenderer;
 class Entity;
 
@@ -37,12 +41,34 @@ private:
 	IDXGISwapChain* _swapChain;
 	ID3D11Device* _device;
 	ID3D11DeviceContext* _deviceContext;
+	// Available only with D3D11.1 runtime, required for binding constant buffer ranges
+	ID3D11DeviceContext1* _deviceContext1;
 	ID3D11RenderTargetView* _renderTargetView;
 	ID3D11Texture2D* _depthStencilBuffer;
 	ID3D11DepthStencilView* _depthStencilView;
 
-	Material* _lastUsedMaterial;
-	Entity* _currentlyRenderedEntity;
+	D3D11_PRIMITIVE_TOPOLOGY _sceneTopology;
+	Shader* _lastUsedShader;
+	VertexFormat _lastUsedVertexFormat;
+	// ID rather than pointer, freed state's address may be reused by a different one
+	unsigned int _lastUsedRenderStateID;
+	// States are owned by their users (materials), cache only hands out existing ones while they are alive
+	// Expired entries are erased in BeginScene
+	Dictionary<RenderStateParams, WeakPtr<RenderState>, RenderStateParamsHasher> _renderStates;
+	ID3D11Buffer* _boundVSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	unsigned int _boundVSConstantBuffersOffsets[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ID3D11ShaderResourceView* _boundPSShaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	// Trilinear anisotropic wrapping sampler, bound to every sampler slot of material shaders
+	ID3D11SamplerState* _defaultSamplerState;
+
+	// Parameters of currently rendered object (i.e. model to world matrix), consumed by per object constant buffers
+	// Used only if currently rendered object has no slot in object constants arena
+	MaterialParametersCollection _objectParameters;
+	Matrix _currentObjectMatrix;
+	unsigned int _currentObjectSlot;
+
+	ObjectConstantsArena _objectConstantsArena;
+
 	bool _vsync;
 
 	bool _isResizing;
@@ -69,22 +95,49 @@ public:
 
 	bool CreateBuffer(const D3D11_BUFFER_DESC& bufferDesc, ID3D11Buffer** bufferPtr) const;
 	bool CreateBuffer(const D3D11_BUFFER_DESC& bufferDesc, const D3D11_SUBRESOURCE_DATA& bufferData, ID3D11Buffer** bufferPtr) const;
-	bool CreateVertexShader(ID3D10Blob* shaderBuffer, ID3D11VertexShader** vertexShader) const;
-	bool CreatePixelShader(ID3D10Blob* shaderBuffer, ID3D11PixelShader** pixelShader) const;
-	bool CreateInputLayout(D3D11_INPUT_ELEMENT_DESC const* inputLayoutDesc, unsigned char inputLayoutDescSize, void* shaderBufferPointer, size_t shaderBufferSize, ID3D11InputLayout** inputLayout) const;
+	bool CreateVertexShader(const void* bytecode, size_t bytecodeSize, ID3D11VertexShader** vertexShader) const;
+	bool CreatePixelShader(const void* bytecode, size_t bytecodeSize, ID3D11PixelShader** pixelShader) const;
+	bool CreateTexture2D(const D3D11_TEXTURE2D_DESC& textureDesc, const D3D11_SUBRESOURCE_DATA* textureData, ID3D11Texture2D** texture) const;
+	// View of the whole resource in its own format
+	bool CreateShaderResourceView(ID3D11Resource* resource, ID3D11ShaderResourceView** view) const;
+	bool CreateInputLayout(D3D11_INPUT_ELEMENT_DESC const* inputLayoutDesc, unsigned char inputLayoutDescSize, const void* shaderBufferPointer, size_t shaderBufferSize, ID3D11InputLayout** inputLayout) const;
 
 	void* Map(ID3D11Resource* resource, D3D11_MAP mapFlag = D3D11_MAP_WRITE_DISCARD) const;
 	void Unmap(ID3D11Resource* resource) const;
-	void SetVSConstantBuffers(unsigned int bufferSlot, unsigned int bufferCount, ID3D11Buffer** buffers) const;
-
+	// Binds given constant buffers, skipping the call if exactly those buffers are already bound
+	void SetVSConstantBuffers(unsigned int bufferSlot, unsigned int bufferCount, ID3D11Buffer** buffers);
+	// Binds texture to pixel shader, skipping the call if it is already bound to that slot
+	void SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView* view);
+	// Binds a range of a constant buffer (offset and size given in 16 byte constants)
+	void SetVSConstantBufferRange(unsigned int bufferSlot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantsCount);
+
+	// Maps object constants arena for given number of objects, returns nullptr if arena cannot be used
+	// Every object writes only its own slot, so slots can be filled in any order (or in parallel)
+	ObjectConstants* BeginObjectConstants(unsigned int objectsCount);
+	void EndObjectConstants();
+	// Sets slot in object constants arena used by next draw (ObjectConstantsArena::INVALID_SLOT to upload constants per draw)
+	void SetObjectConstantsSlot(unsigned int slot);
+
+	// Sets view and projection matrices used by per frame constant buffers (call once per camera pass)
+	void SetViewProjection(const Matrix& viewMatrix, const Matrix& projectionMatrix);
+	// nullptr resets object to identity matrix without arena slot
 	void SetObject(Entity* entity);
-	void SetMaterial(Material* material);
-	void DrawIndexed(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, unsigned int indicesCount, unsigned int stride, unsigned int offset) const;
-
-	bool CreateRenderState(UniquePtr<RenderState>& renderState) const;
-	bool CreateRenderState(UniquePtr<RenderState>& renderState, const RenderStateParams& renderStateParams) const;
+	void SetObject(const Matrix& modelToWorldMatrix);
+	// Mesh selects shader variant for its vertex format and provides its dequantization constants, nullptr means full vertex format
+	void SetMaterial(Material* material, const MeshBase* mesh = nullptr);
+	void DrawIndexed(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, unsigned int indicesCount, unsigned int stride, unsigned int offset, IndexFormat indexFormat = IndexFormat::UInt32) const;
+	void DrawMesh(const MeshBase& mesh, unsigned int lod = 0) const;
+
+	// Binds shaders that are not part of any material (i.e. debug drawing), next material binds its own shader again
+	void SetShaders(ID3D11InputLayout* inputLayout, ID3D11VertexShader* vertexShader, ID3D11PixelShader* pixelShader);
+	// Non indexed draw with its own topology, scene topology is restored afterwards
+	void Draw(ID3D11Buffer* vertexBuffer, unsigned int stride, unsigned int firstVertex, unsigned int verticesCount, D3D11_PRIMITIVE_TOPOLOGY topology) const;
+
+	// Returns shared state for given params, GPU objects are created only if no alive state has the same params
+	SharedPtr<RenderState> GetRenderState(const RenderStateParams& renderStateParams);
+	// Skips binding if the same state is already bound
 	void SetRenderState(const RenderState& renderState);
-	void SetRenderState(const UniquePtr<RenderState>& renderState);
+	void SetRenderState(const SharedPtr<RenderState>& renderState);
 };
 
 extern Graphics gGraphics;
@@ -0,0 +1,453 @@
+#include "ImageDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Utility/Inflate.h"
+#include "Utility/Math.h"
+
+static const unsigned char PNG_SIGNATURE[] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+// PNG color types
+static const unsigned int PNG_GRAYSCALE = 0;
+static const unsigned int PNG_RGB = 2;
+static const unsigned int PNG_PALETTE = 3;
+static const unsigned int PNG_GRAYSCALE_ALPHA = 4;
+static const unsigned int PNG_RGBA = 6;
+
+static inline unsigned short ReadLittleEndian16(const unsigned char* data)
+{
+	return (unsigned short)(data[0] | (data[1] << 8));
+}
+
+static inline unsigned int ReadBigEndian32(const unsigned char* data)
+{
+	return ((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) | ((unsigned int)data[2] << 8) | data[3];
+}
+
+bool ImageDecoder::Decode(const unsigned char* data, size_t size, Image& image)
+{
+	if (size >= sizeof(PNG_SIGNATURE) && memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+	{
+		return DecodePNG(data, size, image);
+	}
+
+	return DecodeTGA(data, size, image);
+}
+
+// Converts one TGA pixel (or color map entry) stored in BGR(A) order, 15 and 16 bit pixels are 5 bits per channel
+static inline void ReadTGAColor(const unsigned char* data, unsigned int bytesPerPixel, bool isGrayscale, bool hasAlpha, unsigned char* color)
+{
+	if (isGrayscale)
+	{
+		color[0] = color[1] = color[2] = data[0];
+		color[3] = bytesPerPixel == 2 && hasAlpha ? data[1] : 255;
+		return;
+	}
+
+	switch (bytesPerPixel)
+	{
+		case 2:
+			{
+				const unsigned short value = ReadLittleEndian16(data);
+				color[0] = (unsigned char)(((value >> 10) & 0x1F) * 255 / 31);
+				color[1] = (unsigned char)(((value >> 5) & 0x1F) * 255 / 31);
+				color[2] = (unsigned char)((value & 0x1F) * 255 / 31);
+				color[3] = hasAlpha && (value & 0x8000) == 0 ? 0 : 255;
+			}
+			break;
+		default:
+			color[0] = data[2];
+			color[1] = data[1];
+			color[2] = data[0];
+			color[3] = bytesPerPixel == 4 && hasAlpha ? data[3] : 255;
+			break;
+	}
+}
+
+bool ImageDecoder::DecodeTGA(const unsigned char* data, size_t size, Image& image)
+{
+	static const size_t HEADER_SIZE = 18;
+	if (size < HEADER_SIZE)
+	{
+		return false;
+	}
+
+	const unsigned int idLength = data[0];
+	const unsigned int colorMapType = data[1];
+	const unsigned int imageType = data[2];
+	const unsigned int colorMapStart = ReadLittleEndian16(data + 3);
+	const unsigned int colorMapLength = ReadLittleEndian16(data + 5);
+	const unsigned int colorMapBits = data[7];
+	const unsigned int width = ReadLittleEndian16(data + 12);
+	const unsigned int height = ReadLittleEndian16(data + 14);
+	const unsigned int pixelBits = data[16];
+	const unsigned int descriptor = data[17];
+
+	// Types 1 - 3 are color mapped, true color and grayscale images, 9 - 11 are their RLE compressed versions
+	const bool isCompressed = imageType >= 9;
+	const unsigned int baseType = isCompressed ? imageType - 8 : imageType;
+	const bool isColorMapped = baseType == 1;
+	const bool isGrayscale = baseType == 3;
+	if (baseType < 1 || baseType > 3 || width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION || (isColorMapped && colorMapType != 1))
+	{
+		return false;
+	}
+
+	const unsigned int bytesPerPixel = (pixelBits + 7) / 8;
+	const bool isValidDepth = isColorMapped ? pixelBits == 8 || pixelBits == 16 : isGrayscale ? pixelBits == 8 || pixelBits == 16 : pixelBits >= 15 && pixelBits <= 32 && bytesPerPixel != 1;
+	if (!isValidDepth)
+	{
+		return false;
+	}
+
+	// Alpha is used only if descriptor declares alpha bits, many writers store garbage there otherwise
+	const bool hasAlpha = (descriptor & 0x0F) != 0;
+
+	const unsigned char* position = data + HEADER_SIZE + idLength;
+	const unsigned char* const end = data + size;
+
+	DynamicArray<unsigned char> colorMap;
+	if (colorMapType == 1)
+	{
+		const unsigned int entryBytes = (colorMapBits + 7) / 8;
+		if (entryBytes < 2 || entryBytes > 4 || (size_t)(end - position) < (size_t)colorMapLength * entryBytes)
+		{
+			return false;
+		}
+
+		colorMap.resize((size_t)(colorMapStart + colorMapLength) * 4);
+		for (unsigned int i = 0; i < colorMapLength; ++i)
+		{
+			ReadTGAColor(position + i * entryBytes, entryBytes, false, hasAlpha || entryBytes == 4, colorMap.data() + (colorMapStart + i) * 4);
+		}
+		position += colorMapLength * entryBytes;
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	const size_t pixelsCount = (size_t)width * height;
+	size_t pixelIndex = 0;
+	while (pixelIndex < pixelsCount)
+	{
+		// Uncompressed image is one long raw packet
+		size_t packetLength = pixelsCount - pixelIndex;
+		bool isRepeated = false;
+		if (isCompressed)
+		{
+			if (position >= end)
+			{
+				return false;
+			}
+			isRepeated = (*position & 0x80) != 0;
+			packetLength = Math::Min((size_t)(*position & 0x7F) + 1, pixelsCount - pixelIndex);
+			++position;
+		}
+
+		const size_t packetBytes = isRepeated ? bytesPerPixel : packetLength * bytesPerPixel;
+		if ((size_t)(end - position) < packetBytes)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < packetLength; ++i, ++pixelIndex)
+		{
+			const unsigned char* pixel = isRepeated ? position : position + i * bytesPerPixel;
+			unsigned char* color = image.Pixels.data() + pixelIndex * 4;
+			if (isColorMapped)
+			{
+				const unsigned int index = bytesPerPixel == 2 ? ReadLittleEndian16(pixel) : pixel[0];
+				if ((size_t)index * 4 >= colorMap.size())
+				{
+					return false;
+				}
+				memcpy(color, colorMap.data() + index * 4, 4);
+			}
+			else
+			{
+				ReadTGAColor(pixel, bytesPerPixel, isGrayscale, hasAlpha, color);
+			}
+		}
+		position += packetBytes;
+	}
+
+	// Rows are stored bottom to top unless descriptor says otherwise, columns may be stored right to left
+	const size_t rowSize = (size_t)width * 4;
+	if ((descriptor & 0x20) == 0)
+	{
+		DynamicArray<unsigned char> row(rowSize);
+		for (unsigned int y = 0; y < height / 2; ++y)
+		{
+			unsigned char* top = image.Pixels.data() + y * rowSize;
+			unsigned char* bottom = image.Pixels.data() + (height - 1 - y) * rowSize;
+			memcpy(row.data(), top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, row.data(), rowSize);
+		}
+	}
+	if ((descriptor & 0x10) != 0)
+	{
+		unsigned int* pixels = (unsigned int*)image.Pixels.data();
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			unsigned int* row = pixels + (size_t)y * width;
+			for (unsigned int x = 0; x < width / 2; ++x)
+			{
+				std::swap(row[x], row[width - 1 - x]);
+			}
+		}
+	}
+
+	return true;
+}
+
+static inline unsigned char PaethPredictor(int left, int up, int upLeft)
+{
+	const int estimate = left + up - upLeft;
+	const int leftDistance = abs(estimate - left);
+	const int upDistance = abs(estimate - up);
+	const int upLeftDistance = abs(estimate - upLeft);
+	if (leftDistance <= upDistance && leftDistance <= upLeftDistance)
+	{
+		return (unsigned char)left;
+	}
+	return (unsigned char)(upDistance <= upLeftDistance ? up : upLeft);
+}
+
+// Reverses PNG filters in place, each row starts with its filter type which is left as is
+static bool UnfilterPNG(unsigned char* data, unsigned int rowsCount, size_t rowSize, unsigned int filterStride)
+{
+	const unsigned char* previousRow = nullptr;
+	for (unsigned int y = 0; y < rowsCount; ++y)
+	{
+		const unsigned char filter = data[0];
+		unsigned char* row = data + 1;
+
+		for (size_t x = 0; x < rowSize; ++x)
+		{
+			const int left = x >= filterStride ? row[x - filterStride] : 0;
+			const int up = previousRow ? previousRow[x] : 0;
+			const int upLeft = previousRow && x >= filterStride ? previousRow[x - filterStride] : 0;
+
+			switch (filter)
+			{
+				case 0:
+					break;
+				case 1:
+					row[x] = (unsigned char)(row[x] + left);
+					break;
+				case 2:
+					row[x] = (unsigned char)(row[x] + up);
+					break;
+				case 3:
+					row[x] = (unsigned char)(row[x] + ((left + up) >> 1));
+					break;
+				case 4:
+					row[x] = (unsigned char)(row[x] + PaethPredictor(left, up, upLeft));
+					break;
+				default:
+					return false;
+			}
+		}
+
+		previousRow = row;
+		data += rowSize + 1;
+	}
+
+	return true;
+}
+
+bool ImageDecoder::DecodePNG(const unsigned char* data, size_t size, Image& image)
+{
+	const unsigned char* position = data + sizeof(PNG_SIGNATURE);
+	const unsigned char* const end = data + size;
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int bitDepth = 0;
+	unsigned int colorType = 0;
+	unsigned char palette[256 * 4];
+	unsigned int paletteSize = 0;
+	// Color which is transparent in images without alpha, in full sample precision
+	bool hasTransparentColor = false;
+	unsigned int transparentColor[3] = {0, 0, 0};
+	DynamicArray<unsigned char> compressedData;
+
+	memset(palette, 255, sizeof(palette));
+
+	// Chunk CRCs are not verified, corrupted data is caught by the decompressor or by the image size
+	bool hasEnded = false;
+	while (!hasEnded)
+	{
+		if (end - position < 12)
+		{
+			return false;
+		}
+
+		const unsigned int length = ReadBigEndian32(position);
+		const unsigned char* type = position + 4;
+		const unsigned char* chunk = position + 8;
+		if ((size_t)(end - chunk) < (size_t)length + 4)
+		{
+			return false;
+		}
+		position = chunk + length + 4;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+			{
+				return false;
+			}
+			width = ReadBigEndian32(chunk);
+			height = ReadBigEndian32(chunk + 4);
+			bitDepth = chunk[8];
+			colorType = chunk[9];
+
+			// Only deflate and adaptive filtering are defined, interlaced images are not supported
+			if (chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0)
+			{
+				return false;
+			}
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = Math::Min(length / 3, 256u);
+			for (unsigned int i = 0; i < paletteSize; ++i)
+			{
+				memcpy(palette + i * 4, chunk + i * 3, 3);
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == PNG_PALETTE)
+			{
+				for (unsigned int i = 0; i < length && i < 256; ++i)
+				{
+					palette[i * 4 + 3] = chunk[i];
+				}
+			}
+			else if (colorType == PNG_GRAYSCALE && length >= 2)
+			{
+				hasTransparentColor = true;
+				transparentColor[0] = transparentColor[1] = transparentColor[2] = (chunk[0] << 8) | chunk[1];
+			}
+			else if (colorType == PNG_RGB && length >= 6)
+			{
+				hasTransparentColor = true;
+				for (unsigned int i = 0; i < 3; ++i)
+				{
+					transparentColor[i] = (chunk[i * 2] << 8) | chunk[i * 2 + 1];
+				}
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressedData.insert(compressedData.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			hasEnded = true;
+		}
+	}
+
+	unsigned int channelsCount = 0;
+	switch (colorType)
+	{
+		case PNG_GRAYSCALE:
+			channelsCount = 1;
+			break;
+		case PNG_RGB:
+			channelsCount = 3;
+			break;
+		case PNG_PALETTE:
+			channelsCount = 1;
+			break;
+		case PNG_GRAYSCALE_ALPHA:
+			channelsCount = 2;
+			break;
+		case PNG_RGBA:
+			channelsCount = 4;
+			break;
+		default:
+			return false;
+	}
+
+	const bool isValidDepth = bitDepth == 8 || (bitDepth == 16 && colorType != PNG_PALETTE) || (bitDepth < 8 && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4) && (colorType == PNG_GRAYSCALE || colorType == PNG_PALETTE));
+	if (!isValidDepth || width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION || (colorType == PNG_PALETTE && paletteSize == 0))
+	{
+		return false;
+	}
+
+	const unsigned int pixelBits = channelsCount * bitDepth;
+	const size_t rowSize = ((size_t)width * pixelBits + 7) / 8;
+	DynamicArray<unsigned char> filteredData((rowSize + 1) * height);
+	if (!Inflate::DecompressZlib(compressedData.data(), compressedData.size(), filteredData.data(), filteredData.size()))
+	{
+		return false;
+	}
+
+	// Filters work on whole bytes, neighbouring pixel is at least one byte away
+	if (!UnfilterPNG(filteredData.data(), height, rowSize, Math::Max(pixelBits / 8, 1u)))
+	{
+		return false;
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	const unsigned int maxSample = (1u << bitDepth) - 1;
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const unsigned char* row = filteredData.data() + y * (rowSize + 1) + 1;
+		unsigned char* color = image.Pixels.data() + (size_t)y * width * 4;
+
+		for (unsigned int x = 0; x < width; ++x, color += 4)
+		{
+			// Samples in full precision, 16 bit samples are big endian and samples smaller than a byte are packed from the highest bits
+			unsigned int samples[4] = {0, 0, 0, maxSample};
+			for (unsigned int channel = 0; channel < channelsCount; ++channel)
+			{
+				const size_t bitOffset = ((size_t)x * channelsCount + channel) * bitDepth;
+				if (bitDepth == 16)
+				{
+					samples[channel] = (row[bitOffset / 8] << 8) | row[bitOffset / 8 + 1];
+				}
+				else
+				{
+					samples[channel] = (row[bitOffset / 8] >> (8 - bitDepth - bitOffset % 8)) & maxSample;
+				}
+			}
+
+			switch (colorType)
+			{
+				case PNG_PALETTE:
+					memcpy(color, palette + samples[0] * 4, 4);
+					continue;
+				case PNG_GRAYSCALE:
+					samples[3] = hasTransparentColor && samples[0] == transparentColor[0] ? 0 : maxSample;
+					samples[1] = samples[2] = samples[0];
+					break;
+				case PNG_GRAYSCALE_ALPHA:
+					samples[3] = samples[1];
+					samples[1] = samples[2] = samples[0];
+					break;
+				case PNG_RGB:
+					samples[3] = hasTransparentColor && samples[0] == transparentColor[0] && samples[1] == transparentColor[1] && samples[2] == transparentColor[2] ? 0 : maxSample;
+					break;
+				default:
+					break;
+			}
+
+			for (unsigned int channel = 0; channel < 4; ++channel)
+			{
+				color[channel] = bitDepth == 16 ? (unsigned char)(samples[channel] >> 8) : (unsigned char)(samples[channel] * 255 / maxSample);
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Core/Platform.h"
+
+// Decoded image, always RGBA with 8 bits per channel and rows stored top to bottom
+struct Image
+{
+	unsigned int Width;
+	unsigned int Height;
+	DynamicArray<unsigned char> Pixels;
+
+	inline Image() : Width(0), Height(0)
+	{}
+};
+
+// Decodes images from memory, formats without alpha get opaque alpha
+// TGA: true color, grayscale and color mapped images, uncompressed or RLE compressed
+// PNG: all color types and bit depths, except interlaced images
+class ImageDecoder final
+{
+public:
+	// Same as the biggest texture D3D11 supports
+	static const unsigned int MAX_DIMENSION = 16384;
+
+	// Format is recognized from the data, PNG has a signature and anything else is read as TGA
+	static bool Decode(const unsigned char* data, size_t size, Image& image);
+
+	static bool DecodeTGA(const unsigned char* data, size_t size, Image& image);
+	static bool DecodePNG(const unsigned char* data, size_t size, Image& image);
+};
@@ -0,0 +1,332 @@
+#include "LooseOctree.h"
+
+LooseOctree::LooseOctree(const Vector3& center, float halfSize) : _elementsCount(0)
+{
+	CreateNode(center, halfSize, 0, INVALID_NODE);
+}
+
+int LooseOctree::CreateNode(const Vector3& center, float halfSize, unsigned char depth, int parent)
+{
+	Node node;
+	node.Center = center;
+	node.HalfSize = halfSize;
+	node.Depth = depth;
+	node.Parent = parent;
+	node.SubtreeElementsCount = 0;
+	for (unsigned char i = 0; i < 8; ++i)
+	{
+		node.Children[i] = INVALID_NODE;
+	}
+
+	if (_freeNodes.size() > 0)
+	{
+		const int nodeIndex = _freeNodes.back();
+		_freeNodes.pop_back();
+		_nodes[nodeIndex] = std::move(node);
+		return nodeIndex;
+	}
+
+	_nodes.push_back(std::move(node));
+	return (int)_nodes.size() - 1;
+}
+
+void LooseOctree::ReleaseNode(int nodeIndex)
+{
+	Node& node = _nodes[nodeIndex];
+	DT_ASSERT(node.SubtreeElementsCount == 0, DT_TEXT("Only empty octree nodes can be released"));
+
+	for (unsigned char i = 0; i < 8; ++i)
+	{
+		if (node.Children[i] != INVALID_NODE)
+		{
+			ReleaseNode(node.Children[i]);
+			node.Children[i] = INVALID_NODE;
+		}
+	}
+
+	if (node.Parent != INVALID_NODE)
+	{
+		int* siblings = _nodes[node.Parent].Children;
+		for (unsigned char i = 0; i < 8; ++i)
+		{
+			if (siblings[i] == nodeIndex)
+			{
+				siblings[i] = INVALID_NODE;
+				break;
+			}
+		}
+		node.Parent = INVALID_NODE;
+	}
+
+	_freeNodes.push_back(nodeIndex);
+}
+
+int LooseOctree::FindNode(const Vector3& min, const Vector3& max)
+{
+	const Vector3 center = (min + max) * 0.5f;
+	const Vector3 halfExtents = max - center;
+	const float extent = Math::Max(halfExtents.X, Math::Max(halfExtents.Y, halfExtents.Z));
+
+	// Element has to have its center inside root's cell and be not bigger than the cell, otherwise loose bounds won't contain it
+	const Node& root = _nodes[0];
+	const Vector3 offset = center - root.Center;
+	if (extent > root.HalfSize || Math::Abs(offset.X) > root.HalfSize || Math::Abs(offset.Y) > root.HalfSize || Math::Abs(offset.Z) > root.HalfSize)
+	{
+		return INVALID_NODE;
+	}
+
+	// Descend as long as element fits into child's cell
+	int nodeIndex = 0;
+	while (_nodes[nodeIndex].Depth < MAX_DEPTH)
+	{
+		const float childHalfSize = _nodes[nodeIndex].HalfSize * 0.5f;
+		if (extent > childHalfSize)
+		{
+			break;
+		}
+
+		const Vector3 nodeCenter = _nodes[nodeIndex].Center;
+		const unsigned char childIndex = (center.X >= nodeCenter.X ? 1 : 0) | (center.Y >= nodeCenter.Y ? 2 : 0) | (center.Z >= nodeCenter.Z ? 4 : 0);
+
+		int child = _nodes[nodeIndex].Children[childIndex];
+		if (child == INVALID_NODE)
+		{
+			const Vector3 childCenter(nodeCenter.X + ((childIndex & 1) ? childHalfSize : -childHalfSize),
+									  nodeCenter.Y + ((childIndex & 2) ? childHalfSize : -childHalfSize),
+									  nodeCenter.Z + ((childIndex & 4) ? childHalfSize : -childHalfSize));
+
+			// Creating node may reallocate nodes array, so do not keep references to nodes across this call
+			child = CreateNode(childCenter, childHalfSize, _nodes[nodeIndex].Depth + 1, nodeIndex);
+			_nodes[nodeIndex].Children[childIndex] = child;
+		}
+
+		nodeIndex = child;
+	}
+
+	return nodeIndex;
+}
+
+void LooseOctree::AddToNode(unsigned int handle, int nodeIndex, const Vector3& min, const Vector3& max)
+{
+	ElementsList& elements = nodeIndex == INVALID_NODE ? _outsideElements : _nodes[nodeIndex].Elements;
+
+	Element& element = _elements[handle];
+	element.Node = nodeIndex;
+	element.IndexInNode = (unsigned int)elements.Handles.size();
+
+	elements.Handles.push_back(handle);
+	elements.Bounds.Add(min, max);
+
+	for (int node = nodeIndex; node != INVALID_NODE; node = _nodes[node].Parent)
+	{
+		++_nodes[node].SubtreeElementsCount;
+	}
+}
+
+void LooseOctree::RemoveFromNode(unsigned int handle)
+{
+	const Element& element = _elements[handle];
+	ElementsList& elements = element.Node == INVALID_NODE ? _outsideElements : _nodes[element.Node].Elements;
+
+	// Swap with last element so removal doesn't need to shift the arrays
+	const unsigned int lastHandle = elements.Handles.back();
+	elements.Handles[element.IndexInNode] = lastHandle;
+	elements.Bounds.RemoveSwap(element.IndexInNode);
+	_elements[lastHandle].IndexInNode = element.IndexInNode;
+	elements.Handles.pop_back();
+
+	int emptyNode = INVALID_NODE;
+	for (int node = element.Node; node != INVALID_NODE; node = _nodes[node].Parent)
+	{
+		if (--_nodes[node].SubtreeElementsCount == 0 && node != 0)
+		{
+			emptyNode = node;
+		}
+	}
+
+	if (emptyNode != INVALID_NODE)
+	{
+		ReleaseNode(emptyNode);
+	}
+}
+
+unsigned int LooseOctree::Insert(MeshRenderer* renderer, const Vector3& min, const Vector3& max)
+{
+	unsigned int handle;
+	if (_freeElements.size() > 0)
+	{
+		handle = _freeElements.back();
+		_freeElements.pop_back();
+	}
+	else
+	{
+		handle = (unsigned int)_elements.size();
+		_elements.push_back(Element());
+	}
+
+	_elements[handle].Renderer = renderer;
+
+	AddToNode(handle, FindNode(min, max), min, max);
+	++_elementsCount;
+
+	return handle;
+}
+
+void LooseOctree::Update(unsigned int handle, const Vector3& min, const Vector3& max)
+{
+	DT_ASSERT(handle < _elements.size() && _elements[handle].Renderer, DT_TEXT("Invalid octree handle"));
+
+	const Element& element = _elements[handle];
+	const int nodeIndex = FindNode(min, max);
+	if (nodeIndex == element.Node)
+	{
+		ElementsList& elements = nodeIndex == INVALID_NODE ? _outsideElements : _nodes[nodeIndex].Elements;
+		elements.Bounds.Set(element.IndexInNode, min, max);
+		return;
+	}
+
+	// Removal may prune the node just found (i.e. a new child of the element's node), so it is looked up again
+	RemoveFromNode(handle);
+	AddToNode(handle, FindNode(min, max), min, max);
+}
+
+void LooseOctree::Remove(unsigned int handle)
+{
+	DT_ASSERT(handle < _elements.size() && _elements[handle].Renderer, DT_TEXT("Invalid octree handle"));
+
+	RemoveFromNode(handle);
+	_elements[handle].Renderer = nullptr;
+	_freeElements.push_back(handle);
+	--_elementsCount;
+}
+
+void LooseOctree::QueryElements(const ElementsList& elements, unsigned int testedVolumes, unsigned int insideVolumes, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const
+{
+	const unsigned int count = (unsigned int)elements.Handles.size();
+
+	if (testedVolumes == 0)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			renderers.push_back(_elements[elements.Handles[i]].Renderer);
+			volumesMasks.push_back(insideVolumes);
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		_pendingElements.Handles.push_back(elements.Handles[i]);
+		_pendingElements.TestedVolumes.push_back(testedVolumes);
+		_pendingElements.InsideVolumes.push_back(insideVolumes);
+		_pendingElements.Bounds.Add(elements.Bounds, i);
+	}
+}
+
+void LooseOctree::CullPendingElements(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const
+{
+	const unsigned int count = (unsigned int)_pendingElements.Handles.size();
+
+	unsigned int testedVolumes = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		testedVolumes |= _pendingElements.TestedVolumes[i];
+	}
+
+	// Elements are culled against every volume any of them needs, testing some of them needlessly is cheaper than losing batches of four
+	for (unsigned int volume = 0; volume < volumesCount; ++volume)
+	{
+		const unsigned int volumeBit = 1u << volume;
+		if ((testedVolumes & volumeBit) == 0)
+		{
+			continue;
+		}
+
+		CullBounds(planes + volume * planesPerVolume, planesPerVolume, _pendingElements.Bounds, _visibilityMask);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if ((_pendingElements.TestedVolumes[i] & volumeBit) != 0 && IsBitSet(_visibilityMask, i))
+			{
+				_pendingElements.InsideVolumes[i] |= volumeBit;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (_pendingElements.InsideVolumes[i] != 0)
+		{
+			renderers.push_back(_elements[_pendingElements.Handles[i]].Renderer);
+			volumesMasks.push_back(_pendingElements.InsideVolumes[i]);
+		}
+	}
+
+	_pendingElements.Handles.clear();
+	_pendingElements.TestedVolumes.clear();
+	_pendingElements.InsideVolumes.clear();
+	_pendingElements.Bounds.Clear();
+}
+
+void LooseOctree::QueryNode(int nodeIndex, const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, unsigned int testedVolumes, unsigned int insideVolumes, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const
+{
+	const Node& node = _nodes[nodeIndex];
+	if (node.SubtreeElementsCount == 0)
+	{
+		return;
+	}
+
+	const float looseHalfSize = 2.0f * node.HalfSize;
+	const Vector3 looseExtents(looseHalfSize, looseHalfSize, looseHalfSize);
+	const Vector3 looseMin = node.Center - looseExtents;
+	const Vector3 looseMax = node.Center + looseExtents;
+
+	for (unsigned int volume = 0; volume < volumesCount; ++volume)
+	{
+		const unsigned int volumeBit = 1u << volume;
+		if ((testedVolumes & volumeBit) == 0)
+		{
+			continue;
+		}
+
+		const ContainmentType containment = TestBoxAgainstPlanes(planes + volume * planesPerVolume, planesPerVolume, looseMin, looseMax);
+		if (containment != ContainmentType::Intersects)
+		{
+			testedVolumes &= ~volumeBit;
+		}
+		if (containment == ContainmentType::Contains)
+		{
+			insideVolumes |= volumeBit;
+		}
+	}
+
+	if ((testedVolumes | insideVolumes) == 0)
+	{
+		return;
+	}
+
+	QueryElements(node.Elements, testedVolumes, insideVolumes, renderers, volumesMasks);
+
+	for (unsigned char i = 0; i < 8; ++i)
+	{
+		if (node.Children[i] != INVALID_NODE)
+		{
+			QueryNode(node.Children[i], planes, planesPerVolume, volumesCount, testedVolumes, insideVolumes, renderers, volumesMasks);
+		}
+	}
+}
+
+void LooseOctree::Query(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const
+{
+	DT_ASSERT(volumesCount <= MAX_QUERY_VOLUMES, DT_TEXT("Too many volumes in a single octree query"));
+
+	if (volumesCount == 0)
+	{
+		return;
+	}
+
+	const unsigned int allVolumes = volumesCount == MAX_QUERY_VOLUMES ? ~0u : (1u << volumesCount) - 1;
+
+	QueryNode(0, planes, planesPerVolume, volumesCount, allVolumes, 0, renderers, volumesMasks);
+	QueryElements(_outsideElements, allVolumes, 0, renderers, volumesMasks);
+	CullPendingElements(planes, planesPerVolume, volumesCount, renderers, volumesMasks);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Rendering/FrustumCulling.h"
+#include "Utility/GeometryUtils.h"
+#include "Utility/Math.h"
+
+class MeshRenderer;
+
+// Loose octree over world space bounds of mesh renderers
+// Loose bounds of a node are twice as big as its cell, so every element is stored in exactly one node
+// chosen by its center and size (no splitting, no duplicates)
+// Elements are referenced by handles, moving an element relocates it only if it doesn't fit its node anymore
+class LooseOctree final
+{
+public:
+	static const unsigned int INVALID_HANDLE = (unsigned int)-1;
+	// Volumes are tracked as bits of unsigned int during queries
+	static const unsigned int MAX_QUERY_VOLUMES = 32;
+
+private:
+	static const int INVALID_NODE = -1;
+	static const unsigned char MAX_DEPTH = 8;
+
+	// Handles of elements with their bounds kept in the same order, so bounds can be culled in batches
+	struct ElementsList
+	{
+		DynamicArray<unsigned int> Handles;
+		BoundsArray Bounds;
+	};
+
+	struct Node
+	{
+		Vector3 Center;
+		float HalfSize;
+		unsigned char Depth;
+		int Parent;
+		int Children[8];
+		ElementsList Elements;
+		// Number of elements stored in this node and all its descendants, empty subtrees are skipped during queries
+		unsigned int SubtreeElementsCount;
+	};
+
+	struct Element
+	{
+		MeshRenderer* Renderer;
+		int Node;
+		// Index in node's elements (or in _outsideElements if element doesn't fit into the root)
+		unsigned int IndexInNode;
+	};
+
+	// Elements of nodes intersecting query volumes, gathered during traversal and culled together at its end
+	// Nodes usually hold just a few elements, culling them one node at a time would rarely fill SIMD groups of four
+	struct PendingElements
+	{
+		DynamicArray<unsigned int> Handles;
+		// Volumes element still has to be tested against and volumes already known to contain it
+		DynamicArray<unsigned int> TestedVolumes;
+		DynamicArray<unsigned int> InsideVolumes;
+		BoundsArray Bounds;
+	};
+
+	DynamicArray<Node> _nodes;
+	// Nodes of pruned subtrees, reused by CreateNode
+	DynamicArray<int> _freeNodes;
+	DynamicArray<Element> _elements;
+	DynamicArray<unsigned int> _freeElements;
+	// Elements which do not fit into loose bounds of the root, those are culled on every query
+	ElementsList _outsideElements;
+	unsigned int _elementsCount;
+	// Reused between queries, so culling doesn't allocate once those have grown enough
+	mutable PendingElements _pendingElements;
+	mutable DynamicArray<unsigned int> _visibilityMask;
+
+public:
+	LooseOctree(const Vector3& center, float halfSize);
+
+private:
+	int CreateNode(const Vector3& center, float halfSize, unsigned char depth, int parent);
+	int FindNode(const Vector3& min, const Vector3& max);
+	// Detaches node from its parent and frees it together with all its descendants, the subtree has to be empty
+	void ReleaseNode(int nodeIndex);
+
+	void AddToNode(unsigned int handle, int nodeIndex, const Vector3& min, const Vector3& max);
+	// Prunes the largest subtree left empty by the removal (the root is always kept)
+	void RemoveFromNode(unsigned int handle);
+
+	// Elements have to be tested against volumes from testedVolumes mask, volumes from insideVolumes mask contain all the elements already
+	// Elements which need no tests are appended right away, the rest is deferred to CullPendingElements
+	void QueryElements(const ElementsList& elements, unsigned int testedVolumes, unsigned int insideVolumes, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const;
+	void CullPendingElements(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const;
+	void QueryNode(int nodeIndex, const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, unsigned int testedVolumes, unsigned int insideVolumes, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const;
+
+public:
+	// Returns handle which must be used to update or remove the element
+	unsigned int Insert(MeshRenderer* renderer, const Vector3& min, const Vector3& max);
+	void Update(unsigned int handle, const Vector3& min, const Vector3& max);
+	void Remove(unsigned int handle);
+
+	// Culls elements against several convex volumes (i.e. camera frustums) in a single traversal
+	// Planes of volumes are stored one volume after another, planesPerVolume planes each
+	// Appends every renderer that is inside at least one volume once, together with a mask of volumes it's inside
+	// Subtrees outside of all volumes are rejected as a whole, volumes containing whole subtree do not test its elements
+	void Query(const Plane* planes, unsigned int planesPerVolume, unsigned int volumesCount, DynamicArray<MeshRenderer*>& renderers, DynamicArray<unsigned int>& volumesMasks) const;
+
+	inline unsigned int GetElementsCount() const
+	{
+		return _elementsCount;
+	}
+};
@@ -3,36 +3,304 @@
 #include <fstream>
 
 #include "GameFramework/Entity.h"
-#include "GameFramework/Components/Camera.h"
 #include "Graphics.h"
+#include "ResourceManagement/FileSystem.h"
 #include "ResourceManagement/Resources.h"
 #include "Utility/JSON.h"
+#include "Utility/String.h"
 
-static const String DEFAULT_SHADER_PATH = DT_TEXT("Resources/Shaders/Color");
+const String Material::DEFAULT_SHADER_PATH = DT_TEXT("Resources/Shaders/Color");
+const AssetID Material::DEFAULT_SHADER_ID = GetAssetID(DT_TEXT("Resources/Shaders/Color"));
 
-Material::Material() : _shader(nullptr), _color(1.0f, 1.0f, 1.0f, 1.0f), _queue(OPAQUE_UPPER_LIMIT), _renderState(nullptr)
+static const String COOKED_MATERIAL_EXTENSION = DT_TEXT("dtcmat");
+static const unsigned int COOKED_MATERIAL_MAGIC = 0x544D5444; // "DTMT"
+// Has to be bumped whenever cooked material layout changes
+static const unsigned int COOKED_MATERIAL_VERSION = 1;
+
+// Layout of .dtcmat files:
+// header, baked parameters, textures, baked buffers, parameters data and strings (as Char, shader path first)
+struct CookedMaterialHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	AssetID ShaderID;
+	// Layout of shader per material constant buffers the parameters are laid out for
+	unsigned long long LayoutHash;
+	Vector4 Color;
+	unsigned short Queue;
+	// Render state params, each of them fits into 8 bits
+	unsigned char Cull;
+	unsigned char Fill;
+	unsigned char DepthWrite;
+	unsigned char DepthTest;
+	unsigned char SrcBlend;
+	unsigned char DestBlend;
+	unsigned int ShaderPathLength;
+	unsigned int ParametersCount;
+	unsigned int TexturesCount;
+	unsigned int BuffersCount;
+	unsigned int DataSize;
+	unsigned int StringsLength;
+};
+
+// Texture parameter, name and path point into strings
+struct CookedMaterialTexture
+{
+	AssetID ID;
+	unsigned int NameOffset;
+	unsigned int NameLength;
+	unsigned int PathOffset;
+	unsigned int PathLength;
+};
+
+// Pointers into mapped cooked material
+struct CookedMaterialView
+{
+	const CookedMaterialHeader* Header;
+	const Material::BakedParameter* Parameters;
+	const CookedMaterialTexture* Textures;
+	const Material::BakedBuffer* Buffers;
+	const unsigned char* Data;
+	const Char* Strings;
+};
+
+// Validates layout of cooked material and points the view into its data
+static bool ReadCookedMaterial(const unsigned char* data, size_t size, CookedMaterialView& view)
+{
+	if (size < sizeof(CookedMaterialHeader))
+	{
+		return false;
+	}
+
+	view.Header = (const CookedMaterialHeader*)data;
+	const CookedMaterialHeader& header = *view.Header;
+	if (header.Magic != COOKED_MATERIAL_MAGIC || header.Version != COOKED_MATERIAL_VERSION)
+	{
+		return false;
+	}
+
+	size_t offset = sizeof(CookedMaterialHeader);
+	view.Parameters = (const Material::BakedParameter*)(data + offset);
+	offset += (size_t)header.ParametersCount * sizeof(Material::BakedParameter);
+	view.Textures = (const CookedMaterialTexture*)(data + offset);
+	offset += (size_t)header.TexturesCount * sizeof(CookedMaterialTexture);
+	view.Buffers = (const Material::BakedBuffer*)(data + offset);
+	offset += (size_t)header.BuffersCount * sizeof(Material::BakedBuffer);
+	view.Data = data + offset;
+	offset += header.DataSize;
+	view.Strings = (const Char*)(data + offset);
+	offset += (size_t)header.StringsLength * sizeof(Char);
+	if (offset > size || header.ShaderPathLength > header.StringsLength)
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < header.BuffersCount; ++i)
+	{
+		const Material::BakedBuffer& buffer = view.Buffers[i];
+		if (buffer.Offset > header.DataSize || buffer.Size > header.DataSize - buffer.Offset)
+		{
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < header.ParametersCount; ++i)
+	{
+		const Material::BakedParameter& parameter = view.Parameters[i];
+		if (parameter.BufferIndex >= header.BuffersCount)
+		{
+			return false;
+		}
+
+		const Material::BakedBuffer& buffer = view.Buffers[parameter.BufferIndex];
+		if (parameter.VariableIndex >= buffer.VariablesCount || parameter.Offset > buffer.Size || parameter.Size > buffer.Size - parameter.Offset)
+		{
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < header.TexturesCount; ++i)
+	{
+		const CookedMaterialTexture& texture = view.Textures[i];
+		if (texture.NameOffset > header.StringsLength || texture.NameLength > header.StringsLength - texture.NameOffset ||
+			texture.PathOffset > header.StringsLength || texture.PathLength > header.StringsLength - texture.PathOffset)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool SaveCookedMaterial(const String& path, const CookedMaterialHeader& header, const DynamicArray<Material::BakedParameter>& parameters,
+							   const DynamicArray<CookedMaterialTexture>& textures, const DynamicArray<Material::BakedBuffer>& buffers,
+							   const DynamicArray<unsigned char>& data, const DynamicArray<Char>& strings)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)parameters.data(), parameters.size() * sizeof(Material::BakedParameter));
+	file.write((const char*)textures.data(), textures.size() * sizeof(CookedMaterialTexture));
+	file.write((const char*)buffers.data(), buffers.size() * sizeof(Material::BakedBuffer));
+	file.write((const char*)data.data(), data.size());
+	file.write((const char*)strings.data(), strings.size() * sizeof(Char));
+
+	return !file.fail();
+}
+
+Material::Material() : EnableSharedFromThis<Material>(), _shader(nullptr), _color(1.0f, 1.0f, 1.0f, 1.0f), _queue(OPAQUE_UPPER_LIMIT), _renderState(nullptr),
+	_parametersCollection(new MaterialParametersCollection()), _shaderVersion(0)
 {}
 
-Material::Material(const Material& other) : _shader(other._shader), _color(other._color), _queue(other._queue), _parametersCollection(other._parametersCollection), _renderState(nullptr), _renderStateParams(other._renderStateParams)
+Material::Material(const Material& other) : EnableSharedFromThis<Material>(), _parent(other._parent), _shader(other._shader), _color(other._color), _queue(other._queue),
+	_parametersCollection(other._parametersCollection ? new MaterialParametersCollection(*other._parametersCollection) : nullptr), _overrides(other._overrides), _bakedParameters(other._bakedParameters),
+	_renderState(nullptr), _renderStateParams(other._renderStateParams), _shaderVersion(0)
 {}
 
+Material::Material(const SharedPtr<Material>& parent) : EnableSharedFromThis<Material>(), _parent(parent), _shader(nullptr), _color(parent->_color), _queue(parent->_queue), _renderState(nullptr), _renderStateParams(parent->_renderStateParams), _shaderVersion(0)
+{
+	if (parent->_parent)
+	{
+		_overrides.SetParent(&parent->_overrides);
+	}
+}
+
 Material::~Material()
 {}
 
-bool Material::Load(const String& path)
+bool Material::CreateConstantBuffers()
 {
-	Asset::Load(path);
+	ReleaseConstantBuffers();
 
-	std::ifstream materialFile(path);
-	if (!materialFile.is_open())
+	if (!_shader)
+	{
+		return true;
+	}
+
+	_shaderVersion = _shader->GetVersion();
+	if (!_shader->CreatePerMaterialStorages(gGraphics, _constantBuffers))
 	{
 		return false;
 	}
 
-	JSON materialData = JSON::parse(materialFile);
-	materialFile.close();
+	// Instances with a shader of their own still fall back to parameters cooked into their root
+	const SharedPtr<const BakedParameters>& bakedParameters = GetRoot()._bakedParameters;
+	if (bakedParameters)
+	{
+		const DynamicArray<SharedPtr<const BakedConstantBuffer>>& bakedBuffers = GetBakedConstantBuffers(*bakedParameters);
+		for (size_t i = 0; i < bakedBuffers.size(); ++i)
+		{
+			_constantBuffers[i].SetBaked(bakedBuffers[i]);
+		}
+	}
 
-	String shaderPath = materialData["Shader"];
+	return true;
+}
+
+void Material::ReleaseConstantBuffers()
+{
+	for (auto& constantBuffer : _constantBuffers)
+	{
+		constantBuffer.Shutdown();
+	}
+	_constantBuffers.clear();
+}
+
+const Material& Material::GetRoot() const
+{
+	const Material* root = this;
+	while (root->_parent)
+	{
+		root = root->_parent.get();
+	}
+
+	return *root;
+}
+
+const DynamicArray<SharedPtr<const BakedConstantBuffer>>& Material::GetBakedConstantBuffers(const BakedParameters& baked) const
+{
+	const unsigned long long layoutHash = _shader->GetPerMaterialLayoutHash();
+	if (baked.HasConstantBuffers && baked.ConstantBuffersLayoutHash == layoutHash)
+	{
+		return baked.ConstantBuffers;
+	}
+
+	const DynamicArray<UniquePtr<ShaderConstantBuffer>>& shaderBuffers = _shader->GetPerMaterialBuffers();
+
+	bool isSameLayout = baked.LayoutHash == layoutHash && baked.BuffersCount == shaderBuffers.size();
+	for (size_t i = 0; isSameLayout && i < shaderBuffers.size(); ++i)
+	{
+		isSameLayout = baked.Buffers[i].Size == shaderBuffers[i]->Size && baked.Buffers[i].VariablesCount == shaderBuffers[i]->Variables.size();
+	}
+
+	DynamicArray<SharedPtr<BakedConstantBuffer>> buffers;
+	for (const auto& shaderBuffer : shaderBuffers)
+	{
+		SharedPtr<BakedConstantBuffer> buffer(new BakedConstantBuffer());
+		buffer->Data.assign(shaderBuffer->Size, 0);
+		buffer->Variables.assign(shaderBuffer->Variables.size(), false);
+		buffers.push_back(buffer);
+	}
+
+	if (isSameLayout)
+	{
+		// Cooked data is the constant buffers content already
+		for (size_t i = 0; i < buffers.size(); ++i)
+		{
+			memcpy(buffers[i]->Data.data(), baked.Data + baked.Buffers[i].Offset, baked.Buffers[i].Size);
+		}
+		for (unsigned int i = 0; i < baked.ParametersCount; ++i)
+		{
+			const BakedParameter& parameter = baked.Parameters[i];
+			buffers[parameter.BufferIndex]->Variables[parameter.VariableIndex] = true;
+		}
+	}
+	else
+	{
+		gDebug.Printf(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Material (%s) has been cooked for another layout of its shader, it should be cooked again"), _path.c_str());
+
+		for (size_t i = 0; i < buffers.size(); ++i)
+		{
+			const ShaderConstantBuffer& shaderBuffer = *shaderBuffers[i];
+			for (size_t j = 0; j < shaderBuffer.Variables.size(); ++j)
+			{
+				const ShaderVariable& variable = *shaderBuffer.Variables[j];
+				for (unsigned int k = 0; k < baked.ParametersCount; ++k)
+				{
+					const BakedParameter& parameter = baked.Parameters[k];
+					if (parameter.NameHash == variable.NameHash && parameter.Size == variable.Size)
+					{
+						memcpy(buffers[i]->Data.data() + variable.Offset, baked.Data + baked.Buffers[parameter.BufferIndex].Offset + parameter.Offset, parameter.Size);
+						buffers[i]->Variables[j] = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	baked.ConstantBuffers.assign(buffers.begin(), buffers.end());
+	baked.ConstantBuffersLayoutHash = layoutHash;
+	baked.HasConstantBuffers = true;
+
+	return baked.ConstantBuffers;
+}
+
+bool Material::ReadJSON(const String& path, String& shaderPath, DynamicArray<Pair<String, String>>& texturePaths)
+{
+	std::string materialText;
+	if (!gFileSystem.ReadTextFile(path, materialText))
+	{
+		return false;
+	}
+
+	JSON materialData = JSON::parse(materialText);
+
+	shaderPath = materialData["Shader"];
 	_queue = materialData["Queue"];
 	CullMode cullMode = EnumInfo<CullMode>::FromString(materialData["Cull"]);
 	FillMode fillMode = EnumInfo<FillMode>::FromString(materialData["Fill"]);
@@ -43,18 +311,94 @@ bool Material::Load(const String& path)
 	_color = materialData["Color"];
 
 	JSON parametersData = materialData["Parameters"];
-	if (!_parametersCollection.LoadFromJSON(parametersData))
+	if (!_parametersCollection->LoadFromJSON(parametersData, texturePaths))
 	{
 		return false;
 	}
 
-	_shader = gResources.Get<Shader>(shaderPath);
-
 	_renderStateParams = RenderStateParams(cullMode, fillMode, zWrite, srcBlendMode, destBlendMode, zTest);
 
 	return true;
 }
 
+bool Material::LoadFromJSON(const String& path)
+{
+	String shaderPath;
+	DynamicArray<Pair<String, String>> texturePaths;
+	if (!ReadJSON(path, shaderPath, texturePaths))
+	{
+		return false;
+	}
+
+	// Material may be loaded on a loading thread, so it cannot wait for shader and textures initialization here
+	_shaderLoad = gResources.LoadAsync<Shader>(shaderPath);
+	for (const auto& texturePath : texturePaths)
+	{
+		_textureLoads.push_back(Pair<String, AssetLoadHandle<Texture>>(texturePath.first, gResources.LoadAsync<Texture>(texturePath.second)));
+	}
+
+	return true;
+}
+
+bool Material::LoadCooked(const String& path)
+{
+	FileView file;
+	if (!gFileSystem.MapFile(path, file))
+	{
+		return false;
+	}
+
+	CookedMaterialView view;
+	if (!ReadCookedMaterial(file.GetData(), file.GetSize(), view))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cooked material (%s) is corrupted or has been cooked by another version"), path.c_str());
+		return false;
+	}
+
+	const CookedMaterialHeader& header = *view.Header;
+	_queue = header.Queue;
+	_color = header.Color;
+	_renderStateParams = RenderStateParams((CullMode)header.Cull, (FillMode)header.Fill, (ZWrite)header.DepthWrite, (BlendMode)header.SrcBlend, (BlendMode)header.DestBlend, (CompareFunction)header.DepthTest);
+
+	// IDs are cooked as well, so none of the paths is hashed
+	_shaderLoad = gResources.LoadAsync<Shader>(header.ShaderID, String(view.Strings, header.ShaderPathLength));
+	for (unsigned int i = 0; i < header.TexturesCount; ++i)
+	{
+		const CookedMaterialTexture& texture = view.Textures[i];
+		const String name(view.Strings + texture.NameOffset, texture.NameLength);
+		const String texturePath(view.Strings + texture.PathOffset, texture.PathLength);
+		_textureLoads.push_back(Pair<String, AssetLoadHandle<Texture>>(name, gResources.LoadAsync<Texture>(texture.ID, texturePath)));
+	}
+
+	// Parameters point into the file instead of copying it, so the view moves into them
+	SharedPtr<BakedParameters> bakedParameters(new BakedParameters());
+	bakedParameters->LayoutHash = header.LayoutHash;
+	bakedParameters->Buffers = view.Buffers;
+	bakedParameters->BuffersCount = header.BuffersCount;
+	bakedParameters->Parameters = view.Parameters;
+	bakedParameters->ParametersCount = header.ParametersCount;
+	bakedParameters->Data = view.Data;
+	bakedParameters->DataSize = header.DataSize;
+	bakedParameters->ConstantBuffersLayoutHash = 0;
+	bakedParameters->HasConstantBuffers = false;
+	bakedParameters->File.Swap(file);
+	_bakedParameters = bakedParameters;
+
+	return true;
+}
+
+bool Material::Load(const String& path)
+{
+	Asset::Load(path);
+
+	if (GetExtension(path) == COOKED_MATERIAL_EXTENSION)
+	{
+		return LoadCooked(path);
+	}
+
+	return LoadFromJSON(path);
+}
+
 bool Material::Save(const String& path)
 {
 	std::ofstream materialFile(path);
@@ -89,27 +433,73 @@ bool Material::Save(const String& path)
 	return true;
 }
 
+bool Material::IsReadyToInitialize() const
+{
+	for (const auto& textureLoad : _textureLoads)
+	{
+		if (!textureLoad.second.IsLoaded())
+		{
+			return false;
+		}
+	}
+
+	return !_shaderLoad.IsValid() || _shaderLoad.IsLoaded();
+}
+
 bool Material::Initialize()
 {
+	// Copies of instances use everything their parent has initialized already, except for a shader set on them
+	if (_parent)
+	{
+		return !_shader || CreateConstantBuffers();
+	}
+
 	_queue = OPAQUE_UPPER_LIMIT;
 
 	Graphics& graphics = gGraphics;
 
-	if (!graphics.CreateRenderState(_renderState, _renderStateParams))
+	_renderState = graphics.GetRenderState(_renderStateParams);
+	if (!_renderState)
 	{
 		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create render state"));
 		return false;
 	}
 
+	if (_shaderLoad.IsValid())
+	{
+		_shader = gResources.Wait(_shaderLoad);
+		_shaderLoad = AssetLoadHandle<Shader>();
+	}
+
 	if (!_shader)
 	{
-		_shader = gResources.Get<Shader>(DEFAULT_SHADER_PATH);
+		_shader = gResources.Get<Shader>(DEFAULT_SHADER_ID, DEFAULT_SHADER_PATH);
 	}
 
+	// Missing textures are replaced by the white one, so the material still renders
+	for (const auto& textureLoad : _textureLoads)
+	{
+		SharedPtr<Texture> texture = gResources.Wait(textureLoad.second);
+		if (!texture)
+		{
+			gDebug.Printf(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Material (%s) cannot load texture %s"), _path.c_str(), textureLoad.first.c_str());
+			texture = gResources.Get<Texture>();
+		}
+		_parametersCollection->SetTexture(textureLoad.first, texture);
+	}
+	_textureLoads.clear();
+
+	// Cooked materials have their color baked already
 	String colorName = DT_TEXT("Color");
-	if (_parametersCollection.GetVector4(colorName) == nullptr)
+	if (!_bakedParameters && _parametersCollection->GetVector4(colorName) == nullptr)
 	{
-		_parametersCollection.SetColor(colorName, _color);
+		_parametersCollection->SetColor(colorName, _color);
+	}
+
+	if (!CreateConstantBuffers())
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create material constant buffers"));
+		return false;
 	}
 
 	return true;
@@ -117,36 +507,236 @@ bool Material::Initialize()
 
 void Material::Shutdown()
 {
-	if (_renderState)
+	ReleaseConstantBuffers();
+
+	_renderState = nullptr;
+	_shaderLoad = AssetLoadHandle<Shader>();
+	_textureLoads.clear();
+}
+
+size_t Material::GetMemorySize() const
+{
+	size_t size = 0;
+	for (const ConstantBufferStorage& constantBuffer : _constantBuffers)
+	{
+		size += constantBuffer.GetMemorySize();
+	}
+	size += _overrides.GetMemorySize();
+
+	// Shader and textures are assets of their own, so they are counted separately
+	if (_bakedParameters)
+	{
+		size += _bakedParameters->File.GetSize();
+		for (const auto& constantBuffer : _bakedParameters->ConstantBuffers)
+		{
+			size += constantBuffer->Data.capacity() + constantBuffer->Variables.capacity() / 8;
+		}
+	}
+
+	return size;
+}
+
+void Material::GetDependencies(DynamicArray<const Asset*>& dependencies) const
+{
+	if (_shader)
+	{
+		dependencies.push_back(_shader.get());
+	}
+}
+
+bool Material::TakeReloaded(Asset& reloaded)
+{
+	// Resources reload assets as instances of the same type
+	Material& material = static_cast<Material&>(reloaded);
+	if (!material.Initialize())
+	{
+		return false;
+	}
+
+	std::swap(_renderState, material._renderState);
+	std::swap(_shader, material._shader);
+	std::swap(_color, material._color);
+	std::swap(_queue, material._queue);
+	std::swap(_renderStateParams, material._renderStateParams);
+	std::swap(_parametersCollection, material._parametersCollection);
+	std::swap(_bakedParameters, material._bakedParameters);
+	std::swap(_constantBuffers, material._constantBuffers);
+	std::swap(_shaderVersion, material._shaderVersion);
+
+	return true;
+}
+
+void Material::OnDependencyReloaded(const Asset& dependency)
+{
+	if (&dependency == _shader.get() && _renderState && !CreateConstantBuffers())
 	{
-		_renderState->Shutdown();
-		_renderState = nullptr;
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to recreate material constant buffers"));
 	}
 }
 
-void Material::UpdatePerFrameBuffers(Graphics& graphics)
+void Material::UpdatePerMaterialBuffers(Graphics& graphics)
 {
-	static const String WORLD_TO_VIEW_MATRIX_NAME = DT_TEXT("World2ViewMatrix");
-	static const String VIEW_TO_PROJECTION_MATRIX_NAME = DT_TEXT("View2ProjectionMatrix");
+	// Instances upload their parameters into buffers of the material their shader comes from
+	// Buffers track which parameters they hold, so they are re-uploaded only when another instance gets bound
+	Material* buffersOwner = this;
+	while (!buffersOwner->_shader && buffersOwner->_parent)
+	{
+		buffersOwner = buffersOwner->_parent.get();
+	}
 
-	SetMatrix(WORLD_TO_VIEW_MATRIX_NAME, Camera::GetMainCamera()->GetViewMatrix());
-	SetMatrix(VIEW_TO_PROJECTION_MATRIX_NAME, Camera::GetMainCamera()->GetProjectionMatrix());
+	const SharedPtr<Shader>& shader = buffersOwner->_shader;
+	if (shader)
+	{
+		// Copies and instances are not tracked by resources, so they catch up with reloaded shader here
+		if (buffersOwner->_shaderVersion != shader->GetVersion())
+		{
+			buffersOwner->CreateConstantBuffers();
+		}
+		// Parameters of the root are shared by all its instances, only instances have overrides
+		const MaterialParametersCollection& parametersCollection = *GetRoot()._parametersCollection;
+		const MaterialParameterOverrides* overrides = _parent ? &_overrides : nullptr;
+		shader->UpdatePerMaterialBuffers(graphics, buffersOwner->_constantBuffers, parametersCollection, overrides);
+		shader->BindTextures(graphics, parametersCollection, overrides);
+	}
+}
 
-	if (_shader)
+void Material::SetShader(SharedPtr<Shader> shader)
+{
+	_shader = shader;
+
+	// Constant buffers layout depends on shader, so recreate them if material is already initialized (instances always are)
+	if (_renderState || _parent)
 	{
-		_shader->UpdatePerFrameBuffers(graphics, _parametersCollection);
+		CreateConstantBuffers();
 	}
 }
 
-void Material::UpdatePerDrawCallBuffers(Graphics& graphics)
+void Material::SetRenderStateParams(const RenderStateParams& params)
 {
-	if (_shader)
+	_renderStateParams = params;
+
+	// Instances switch from the state of their parent to their own only if they really differ
+	const SharedPtr<RenderState>& renderState = GetRenderState();
+	if (renderState && renderState->GetParams() != params)
+	{
+		_renderState = gGraphics.GetRenderState(params);
+	}
+}
+
+SharedPtr<Material> Material::CreateInstance()
+{
+	SharedPtr<Material> parent = weak_from_this().lock();
+	if (!parent)
 	{
-		_shader->UpdatePerDrawCallBuffers(graphics, _parametersCollection);
+		// Instances have to keep their parent alive, materials not owned by shared pointers are copied instead
+		return gResources.GetCopy<Material>(*this);
 	}
+
+	return SharedPtr<Material>(new Material(parent), [](Material* material)
+	{
+		material->Shutdown();
+		delete material;
+	});
 }
 
-SharedPtr<Material> Material::CreateInstance() const
+bool Material::Cook(const String& sourcePath, const String& cookedPath)
 {
-	return gResources.GetCopy<Material>(*this);
+	Material material;
+	String shaderPath;
+	DynamicArray<Pair<String, String>> texturePaths;
+	if (!material.ReadJSON(sourcePath, shaderPath, texturePaths))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot cook material (%s), it cannot be read"), sourcePath.c_str());
+		return false;
+	}
+
+	// Only reflection is needed, so the shader is loaded but never initialized
+	Shader shader;
+	if (!shader.Load(shaderPath))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot cook material (%s), its shader (%s) cannot be compiled"), sourcePath.c_str(), shaderPath.c_str());
+		shader.Shutdown();
+		return false;
+	}
+
+	MaterialParametersCollection& parameters = *material._parametersCollection;
+	const String colorName = DT_TEXT("Color");
+	if (parameters.GetVector4(colorName) == nullptr)
+	{
+		parameters.SetColor(colorName, material._color);
+	}
+
+	// Parameters the material doesn't set are left out, so they still fall back to globals at runtime
+	DynamicArray<BakedBuffer> bakedBuffers;
+	DynamicArray<BakedParameter> bakedParameters;
+	DynamicArray<unsigned char> bakedData;
+	const unsigned long long layoutHash = shader.GetPerMaterialLayoutHash();
+	const DynamicArray<UniquePtr<ShaderConstantBuffer>>& shaderBuffers = shader.GetPerMaterialBuffers();
+	for (size_t i = 0; i < shaderBuffers.size(); ++i)
+	{
+		const ShaderConstantBuffer& shaderBuffer = *shaderBuffers[i];
+		const BakedBuffer buffer = {(unsigned int)bakedData.size(), shaderBuffer.Size, (unsigned int)shaderBuffer.Variables.size()};
+		bakedBuffers.push_back(buffer);
+		bakedData.resize(bakedData.size() + shaderBuffer.Size, 0);
+
+		for (size_t j = 0; j < shaderBuffer.Variables.size(); ++j)
+		{
+			ShaderVariable& variable = *shaderBuffer.Variables[j];
+			void const* value = variable.Get(parameters);
+			if (value == nullptr)
+			{
+				continue;
+			}
+
+			memcpy(bakedData.data() + buffer.Offset + variable.Offset, value, variable.Size);
+			const BakedParameter parameter = {variable.NameHash, variable.Offset, variable.Size, (unsigned short)i, (unsigned short)j, 0};
+			bakedParameters.push_back(parameter);
+		}
+	}
+	shader.Shutdown();
+
+	DynamicArray<Char> strings(shaderPath.begin(), shaderPath.end());
+	DynamicArray<CookedMaterialTexture> textures;
+	for (const auto& texturePath : texturePaths)
+	{
+		CookedMaterialTexture texture;
+		texture.ID = GetAssetID(texturePath.second);
+		texture.NameOffset = (unsigned int)strings.size();
+		texture.NameLength = (unsigned int)texturePath.first.size();
+		strings.insert(strings.end(), texturePath.first.begin(), texturePath.first.end());
+		texture.PathOffset = (unsigned int)strings.size();
+		texture.PathLength = (unsigned int)texturePath.second.size();
+		strings.insert(strings.end(), texturePath.second.begin(), texturePath.second.end());
+		textures.push_back(texture);
+	}
+
+	const RenderStateParams& renderStateParams = material._renderStateParams;
+	CookedMaterialHeader header;
+	header.Magic = COOKED_MATERIAL_MAGIC;
+	header.Version = COOKED_MATERIAL_VERSION;
+	header.ShaderID = GetAssetID(shaderPath);
+	header.LayoutHash = layoutHash;
+	header.Color = material._color;
+	header.Queue = material._queue;
+	header.Cull = (unsigned char)renderStateParams.GetCullMode();
+	header.Fill = (unsigned char)renderStateParams.GetFillMode();
+	header.DepthWrite = (unsigned char)renderStateParams.GetZWrite();
+	header.DepthTest = (unsigned char)renderStateParams.GetZTestFunction();
+	header.SrcBlend = (unsigned char)renderStateParams.GetSrcBlendMode();
+	header.DestBlend = (unsigned char)renderStateParams.GetDestBlendMode();
+	header.ShaderPathLength = (unsigned int)shaderPath.size();
+	header.ParametersCount = (unsigned int)bakedParameters.size();
+	header.TexturesCount = (unsigned int)textures.size();
+	header.BuffersCount = (unsigned int)bakedBuffers.size();
+	header.DataSize = (unsigned int)bakedData.size();
+	header.StringsLength = (unsigned int)strings.size();
+
+	if (!SaveCookedMaterial(cookedPath, header, bakedParameters, textures, bakedBuffers, bakedData, strings))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot write cooked material (%s)"), cookedPath.c_str());
+		return false;
+	}
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Cooked material (%s) with %u baked parameters and %u textures to %s"), sourcePath.c_str(), header.ParametersCount, header.TexturesCount, cookedPath.c_str());
+	return true;
 }
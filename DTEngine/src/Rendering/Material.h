@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Shader.h"
+#include "Texture.h"
 #include "RenderState.h"
 #include "MaterialParametersCollection.h"
+#include "ResourceManagement/AssetLoader.h"
+#include "ResourceManagement/FileSystem.h"
 
 enum class RenderQueue
 {
@@ -14,37 +17,127 @@ enum class RenderQueue
 	Overlay
 };
 
-class Material final : public Asset
+class Material final : public Asset, public EnableSharedFromThis<Material>
 {
 private:
 	static const unsigned short OPAQUE_UPPER_LIMIT = 1000;
 	static const unsigned short TRANSPARENT_UPPER_LIMIT = 2000;
 
+public:
+	// Shader of materials which don't specify one, default material included
+	static const String DEFAULT_SHADER_PATH;
+	static const AssetID DEFAULT_SHADER_ID;
+
+	// Parameter resolved when the material is cooked, its value is stored in data of its buffer
+	struct BakedParameter
+	{
+		// Parameters are matched by hashes of their names when shader layout has changed since the material was cooked
+		unsigned long long NameHash;
+		// Offset within its constant buffer
+		unsigned int Offset;
+		unsigned int Size;
+		unsigned short BufferIndex;
+		unsigned short VariableIndex;
+		unsigned int Reserved;
+	};
+
+	struct BakedBuffer
+	{
+		// Offset within BakedParameters::Data
+		unsigned int Offset;
+		unsigned int Size;
+		unsigned int VariablesCount;
+	};
+
+	// Per material constant buffers of the shader filled in when the material is cooked, immutable once loaded so copies share them
+	struct BakedParameters
+	{
+		unsigned long long LayoutHash;
+		// Point into the cooked file, which stays mapped as long as the parameters live
+		FileView File;
+		const BakedBuffer* Buffers;
+		unsigned int BuffersCount;
+		const BakedParameter* Parameters;
+		unsigned int ParametersCount;
+		const unsigned char* Data;
+		unsigned int DataSize;
+
+		// Laid out for the shader on first use (on main thread, where materials are initialized), copies reuse them
+		mutable unsigned long long ConstantBuffersLayoutHash;
+		mutable bool HasConstantBuffers;
+		mutable DynamicArray<SharedPtr<const BakedConstantBuffer>> ConstantBuffers;
+	};
+
 private:
-	UniquePtr<RenderState> _renderState;
+	// Instances take shader, render state and parameters they don't override from their parent
+	SharedPtr<Material> _parent;
+	// Shared with all materials using the same render state params
+	SharedPtr<RenderState> _renderState;
 	SharedPtr<Shader> _shader;
+	// Shader requested by Load, taken in Initialize
+	AssetLoadHandle<Shader> _shaderLoad;
+	// Textures requested by Load (with names of their parameters), set as parameters in Initialize
+	DynamicArray<Pair<String, AssetLoadHandle<Texture>>> _textureLoads;
 	Vector4 _color;
 
 	unsigned short _queue;
 	RenderStateParams _renderStateParams;
 
-	MaterialParametersCollection _parametersCollection;
+	// Only materials which are not instances have a collection, instances keep parameters set on them in overrides
+	UniquePtr<MaterialParametersCollection> _parametersCollection;
+	MaterialParameterOverrides _overrides;
+	// Only cooked materials have baked parameters, parameters set at runtime take precedence over them
+	SharedPtr<const BakedParameters> _bakedParameters;
+	DynamicArray<ConstantBufferStorage> _constantBuffers;
+	// Version of the shader constant buffers were created for
+	unsigned int _shaderVersion;
 
 public:
 	Material();
 	Material(const Material& other);
 	virtual ~Material();
 
+private:
+	explicit Material(const SharedPtr<Material>& parent);
+
+	bool CreateConstantBuffers();
+	void ReleaseConstantBuffers();
+	// Lays baked parameters out for current shader, remapping them by names if its layout differs from the cooked one
+	// Buffers are built once per layout and shared by all copies of the material
+	const DynamicArray<SharedPtr<const BakedConstantBuffer>>& GetBakedConstantBuffers(const BakedParameters& baked) const;
+
+	// Material the instance has been created from (through any number of instances), the material itself if it is not an instance
+	const Material& GetRoot() const;
+
+	// Reads .dtmat source without requesting its shader and textures, so it can be used offline
+	bool ReadJSON(const String& path, String& shaderPath, DynamicArray<Pair<String, String>>& texturePaths);
+	bool LoadFromJSON(const String& path);
+	// Cooked materials are loaded with a single read, their parameters are already laid out for shader constant buffers
+	bool LoadCooked(const String& path);
+
+public:
 	virtual bool Load(const String& path) override;
 	virtual bool Save(const String& path) override;
 
+	virtual bool IsReadyToInitialize() const override;
 	virtual bool Initialize() override;
 	virtual void Shutdown() override;
+	virtual size_t GetMemorySize() const override;
+
+	virtual void GetDependencies(DynamicArray<const Asset*>& dependencies) const override;
+	virtual bool TakeReloaded(Asset& reloaded) override;
+	virtual void OnDependencyReloaded(const Asset& dependency) override;
+
+	// Uploads material's constant buffers (only if any parameter has changed since last upload) and binds them together with textures
+	void UpdatePerMaterialBuffers(Graphics& graphics);
 
-	void UpdatePerFrameBuffers(Graphics& graphics);
-	void UpdatePerDrawCallBuffers(Graphics& graphics);
+	// Instances are not registered in resources, they live as long as something references them
+	// They hold only parameters set on them and render with buffers of this material, so creating them is cheap
+	SharedPtr<Material> CreateInstance();
 
-	SharedPtr<Material> CreateInstance() const;
+	// Reads .dtmat source and writes it as .dtcmat with render state, shader and textures IDs and parameters laid out for shader constant buffers
+	// Shader is compiled to obtain the layout, so it is meant to run offline
+	static bool Cook(const String& sourcePath, const String& cookedPath);
 
 	inline RenderQueue GetRenderQueue() const
 	{
@@ -72,51 +165,100 @@ public:
 
 	inline const SharedPtr<Shader> GetShader() const
 	{
-		return _shader;
-	}
-	inline void SetShader(SharedPtr<Shader> shader)
-	{
-		_shader = shader;
+		return _shader || !_parent ? _shader : _parent->GetShader();
 	}
+	void SetShader(SharedPtr<Shader> shader);
 
-	inline const UniquePtr<RenderState>& GetRenderState() const
+	inline const SharedPtr<RenderState>& GetRenderState() const
 	{
-		return _renderState;
+		return _renderState || !_parent ? _renderState : _parent->GetRenderState();
 	}
 
-	inline void SetRenderStateParams(const RenderStateParams& params)
-	{
-		_renderStateParams = params;
-	}
+	// Switching to another shared state is cheap, so params can be changed on initialized materials as well
+	void SetRenderStateParams(const RenderStateParams& params);
 
 	inline void SetFloat(const String& name, float value)
 	{
-		_parametersCollection.SetFloat(name, value);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetFloat(name, value);
+		}
+		else
+		{
+			_overrides.Set(name, &value, sizeof(value));
+		}
 	}
 
 	inline void SetInt(const String& name, int value)
 	{
-		_parametersCollection.SetInt(name, value);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetInt(name, value);
+		}
+		else
+		{
+			_overrides.Set(name, &value, sizeof(value));
+		}
 	}
 
 	inline void SetVector(const String& name, const Vector2& vector)
 	{
-		_parametersCollection.SetVector(name, vector);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetVector(name, vector);
+		}
+		else
+		{
+			_overrides.Set(name, &vector, sizeof(vector));
+		}
 	}
 
 	inline void SetVector(const String& name, const Vector3& vector)
 	{
-		_parametersCollection.SetVector(name, vector);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetVector(name, vector);
+		}
+		else
+		{
+			_overrides.Set(name, &vector, sizeof(vector));
+		}
 	}
 
 	inline void SetColor(const String& name, const Vector4& color)
 	{
-		_parametersCollection.SetColor(name, color);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetColor(name, color);
+		}
+		else
+		{
+			_overrides.Set(name, &color, sizeof(color));
+		}
 	}
 
 	inline void SetMatrix(const String& name, const Matrix& matrix)
 	{
-		_parametersCollection.SetMatrix(name, matrix);
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetMatrix(name, matrix);
+		}
+		else
+		{
+			_overrides.Set(name, &matrix, sizeof(matrix));
+		}
+	}
+
+	inline void SetTexture(const String& name, const SharedPtr<Texture>& texture)
+	{
+		if (_parametersCollection)
+		{
+			_parametersCollection->SetTexture(name, texture);
+		}
+		else
+		{
+			_overrides.SetTexture(name, texture);
+		}
 	}
 
 public:
@@ -1,9 +1,40 @@
 #include "MaterialParametersCollection.h"
 
+#include <atomic>
+
 #include "Debug/Debug.h"
+#include "ResourceManagement/AssetID.h"
+
+// Materials are loaded on loading threads, so collections may be created on any of them
+static std::atomic<unsigned long long> gNextParametersID(1);
 
 MaterialParametersCollection MaterialParametersCollection::GLOBAL;
 
+MaterialParametersCollection::MaterialParametersCollection(const MaterialParametersCollection& other) : _matrixParameters(other._matrixParameters), _vector4Parameters(other._vector4Parameters),
+	_vector3Parameters(other._vector3Parameters), _vector2Parameters(other._vector2Parameters), _floatParameters(other._floatParameters), _intParameters(other._intParameters),
+	_textureParameters(other._textureParameters), _id(GenerateID()), _version(0)
+{}
+
+MaterialParametersCollection& MaterialParametersCollection::operator=(const MaterialParametersCollection& other)
+{
+	_matrixParameters = other._matrixParameters;
+	_vector4Parameters = other._vector4Parameters;
+	_vector3Parameters = other._vector3Parameters;
+	_vector2Parameters = other._vector2Parameters;
+	_floatParameters = other._floatParameters;
+	_intParameters = other._intParameters;
+	_textureParameters = other._textureParameters;
+	_id = GenerateID();
+	_version = 0;
+
+	return *this;
+}
+
+unsigned long long MaterialParametersCollection::GenerateID()
+{
+	return gNextParametersID.fetch_add(1);
+}
+
 void const* MaterialParametersCollection::GetMatrix(const String& name) const
 {
 	auto& found = _matrixParameters.find(name);
@@ -68,6 +99,16 @@ void const* MaterialParametersCollection::GetInt(const String& name) const
 	return &(found->second);
 }
 
+Texture* MaterialParametersCollection::GetTexture(const String& name) const
+{
+	auto& found = _textureParameters.find(name);
+	if (found == _textureParameters.end())
+	{
+		return nullptr;
+	}
+	return found->second.get();
+}
+
 void const* MaterialParametersCollection::Get(const String& name) const
 {
 	void const* ptr = GetMatrix(name);
@@ -109,7 +150,7 @@ void const* MaterialParametersCollection::Get(const String& name) const
 	return nullptr;
 }
 
-bool MaterialParametersCollection::LoadFromJSON(const JSON& jsonData)
+bool MaterialParametersCollection::LoadFromJSON(const JSON& jsonData, DynamicArray<Pair<String, String>>& texturePaths)
 {
 	if (!jsonData.is_array())
 	{
@@ -147,8 +188,7 @@ bool MaterialParametersCollection::LoadFromJSON(const JSON& jsonData)
 				else if (value.is_string())
 				{
 					std::string v = value;
-					String texturePath(v.begin(), v.end());
-					// TODO: SetTexture!
+					texturePaths.push_back(Pair<String, String>(name, String(v.begin(), v.end())));
 				}
 				else if (value.is_object())
 				{
@@ -175,3 +215,118 @@ bool MaterialParametersCollection::LoadFromJSON(const JSON& jsonData)
 
 	return true;
 }
+
+MaterialParameterOverrides::MaterialParameterOverrides(const MaterialParameterOverrides& other) : _overrides(other._overrides), _data(other._data), _textures(other._textures),
+	_id(MaterialParametersCollection::GenerateID()), _version(0), _parent(other._parent)
+{}
+
+MaterialParameterOverrides& MaterialParameterOverrides::operator=(const MaterialParameterOverrides& other)
+{
+	_overrides = other._overrides;
+	_data = other._data;
+	_textures = other._textures;
+	_id = MaterialParametersCollection::GenerateID();
+	_version = 0;
+	_parent = other._parent;
+
+	return *this;
+}
+
+void MaterialParameterOverrides::Set(const String& name, const void* value, unsigned int size)
+{
+	const unsigned long long nameHash = HashString(name);
+	++_version;
+
+	for (Override& parameter : _overrides)
+	{
+		if (parameter.NameHash == nameHash)
+		{
+			// Value of another type is appended, the old one is removed, so switching types back and forth doesn't grow the data
+			if (parameter.Size != size)
+			{
+				_data.erase(_data.begin() + parameter.Offset, _data.begin() + parameter.Offset + parameter.Size);
+				for (Override& other : _overrides)
+				{
+					if (other.Offset > parameter.Offset)
+					{
+						other.Offset -= parameter.Size;
+					}
+				}
+
+				parameter.Offset = (unsigned int)_data.size();
+				parameter.Size = size;
+				_data.resize(_data.size() + size);
+			}
+
+			memcpy(_data.data() + parameter.Offset, value, size);
+			return;
+		}
+	}
+
+	const Override parameter = {nameHash, (unsigned int)_data.size(), size};
+	_overrides.push_back(parameter);
+	_data.resize(_data.size() + size);
+	memcpy(_data.data() + parameter.Offset, value, size);
+}
+
+void const* MaterialParameterOverrides::Get(unsigned long long nameHash, unsigned int size) const
+{
+	for (const Override& parameter : _overrides)
+	{
+		if (parameter.NameHash == nameHash)
+		{
+			return parameter.Size == size ? _data.data() + parameter.Offset : nullptr;
+		}
+	}
+
+	return _parent ? _parent->Get(nameHash, size) : nullptr;
+}
+
+void MaterialParameterOverrides::SetTexture(const String& name, const SharedPtr<Texture>& texture)
+{
+	// Textures are not part of constant buffers, so changing them doesn't change the version
+	const unsigned long long nameHash = HashString(name);
+	for (auto& parameter : _textures)
+	{
+		if (parameter.first == nameHash)
+		{
+			parameter.second = texture;
+			return;
+		}
+	}
+
+	_textures.push_back(Pair<unsigned long long, SharedPtr<Texture>>(nameHash, texture));
+}
+
+Texture* MaterialParameterOverrides::GetTexture(const String& name) const
+{
+	// Most instances override no textures, so names are hashed only if there is anything to look up
+	const MaterialParameterOverrides* overrides = this;
+	while (overrides && overrides->_textures.empty())
+	{
+		overrides = overrides->_parent;
+	}
+	if (!overrides)
+	{
+		return nullptr;
+	}
+
+	const unsigned long long nameHash = HashString(name);
+	for (; overrides; overrides = overrides->_parent)
+	{
+		for (const auto& parameter : overrides->_textures)
+		{
+			if (parameter.first == nameHash)
+			{
+				return parameter.second.get();
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+size_t MaterialParameterOverrides::GetMemorySize() const
+{
+	return _overrides.capacity() * sizeof(Override) + _data.capacity() + _textures.capacity() * sizeof(Pair<unsigned long long, SharedPtr<Texture>>);
+}
@@ -4,6 +4,8 @@
 #include "Utility/Math.h"
 #include "Utility/JSON.h"
 
+class Texture;
+
 class MaterialParametersCollection final
 {
 	friend class Material;
@@ -19,6 +21,13 @@ private:
 	Map<String, Vector2> _vector2Parameters;
 	Map<String, float> _floatParameters;
 	Map<String, int> _intParameters;
+	// Textures are not part of constant buffers, so changing them doesn't change the version
+	Map<String, SharedPtr<Texture>> _textureParameters;
+
+	// Constant buffers remember ID and version of the collection they were filled from, IDs are never reused unlike addresses
+	unsigned long long _id;
+	// Incremented on every change so constant buffers can tell whether they have to be re-uploaded
+	unsigned int _version;
 
 private:
 	void const* GetMatrix(const String& name) const;
@@ -31,35 +40,132 @@ private:
 	void const* Get(const String& name) const;
 
 public:
-	bool LoadFromJSON(const JSON& jsonData);
+	inline MaterialParametersCollection() : _id(GenerateID()), _version(0)
+	{}
+
+	// Copies get IDs of their own, so buffers filled from the original are not mistaken for being filled from them
+	MaterialParametersCollection(const MaterialParametersCollection& other);
+	MaterialParametersCollection& operator=(const MaterialParametersCollection& other);
+
+	// Unique for the whole run (shared with instance overrides), 0 is never returned
+	static unsigned long long GenerateID();
+
+	// String parameters are paths of textures, those are returned (name and path) for the caller to load
+	bool LoadFromJSON(const JSON& jsonData, DynamicArray<Pair<String, String>>& texturePaths);
+
+	inline unsigned long long GetID() const
+	{
+		return _id;
+	}
+
+	inline unsigned int GetVersion() const
+	{
+		return _version;
+	}
 
 	inline void SetFloat(const String& name, float value)
 	{
 		_floatParameters[name] = value;
+		++_version;
 	}
 
 	inline void SetInt(const String& name, int value)
 	{
 		_intParameters[name] = value;
+		++_version;
 	}
 
 	inline void SetVector(const String& name, const Vector2& vector)
 	{
 		_vector2Parameters[name] = vector;
+		++_version;
 	}
 
 	inline void SetVector(const String& name, const Vector3& vector)
 	{
 		_vector3Parameters[name] = vector;
+		++_version;
+	}
+
+	inline void SetVector(const String& name, const Vector4& vector)
+	{
+		_vector4Parameters[name] = vector;
+		++_version;
 	}
 
 	inline void SetColor(const String& name, const Vector4& color)
 	{
 		_vector4Parameters[name] = color;
+		++_version;
 	}
 
 	inline void SetMatrix(const String& name, const Matrix& matrix)
 	{
 		_matrixParameters[name] = matrix;
+		++_version;
+	}
+
+	inline void SetTexture(const String& name, const SharedPtr<Texture>& texture)
+	{
+		_textureParameters[name] = texture;
 	}
-};
\ No newline at end of file
+
+	Texture* GetTexture(const String& name) const;
+};
+
+// Parameters set on a material instance, instances usually override just a few of them
+// so values are packed into a single array and looked up by hashes of their names
+class MaterialParameterOverrides final
+{
+private:
+	struct Override
+	{
+		unsigned long long NameHash;
+		// Offset within _data
+		unsigned int Offset;
+		unsigned int Size;
+	};
+
+	DynamicArray<Override> _overrides;
+	DynamicArray<unsigned char> _data;
+	DynamicArray<Pair<unsigned long long, SharedPtr<Texture>>> _textures;
+
+	unsigned long long _id;
+	unsigned int _version;
+	// Overrides of the instance this one was created from, values missing here are looked up in it
+	const MaterialParameterOverrides* _parent;
+
+public:
+	inline MaterialParameterOverrides() : _id(MaterialParametersCollection::GenerateID()), _version(0), _parent(nullptr)
+	{}
+
+	MaterialParameterOverrides(const MaterialParameterOverrides& other);
+	MaterialParameterOverrides& operator=(const MaterialParameterOverrides& other);
+
+	// Parent has to outlive these overrides
+	inline void SetParent(const MaterialParameterOverrides* parent)
+	{
+		_parent = parent;
+		++_version;
+	}
+
+	void Set(const String& name, const void* value, unsigned int size);
+	// Value is returned only if it has been set with the same size
+	void const* Get(unsigned long long nameHash, unsigned int size) const;
+
+	void SetTexture(const String& name, const SharedPtr<Texture>& texture);
+	Texture* GetTexture(const String& name) const;
+
+	inline unsigned long long GetID() const
+	{
+		return _id;
+	}
+
+	// Includes versions of parents, so changes of parent overrides are seen as changes of these as well
+	inline unsigned int GetVersion() const
+	{
+		return _parent ? _version + _parent->GetVersion() : _version;
+	}
+
+	size_t GetMemorySize() const;
+};
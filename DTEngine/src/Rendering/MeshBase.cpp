@@ -1,76 +1,367 @@
 #include "MeshBase.h"
 
 #include "Rendering/Graphics.h"
+#include "Rendering/MeshOptimizer.h"
 #include "Debug/Debug.h"
 
-MeshBase::MeshBase() : _vertexBuffer(nullptr), _indexBuffer(nullptr), _verticesCount(0), _indicesCount(0)
+#include <cstring>
+
+static_assert(sizeof(MeshBase::VertexType) == 32, "Full vertex format has to match MeshBase::VertexType");
+
+MeshBase::MeshBase() : _vertexBuffer(nullptr), _indexBuffer(nullptr), _verticesCount(0), _indicesCount(0), _vertexFormat(DEFAULT_VERTEX_FORMAT), _indexFormat(IndexFormat::UInt32),
+	_requiredData(MeshDataRetention::None), _retainedData(MeshDataRetention::Full), _vertexData(nullptr), _indexData(nullptr), _cpuDataSize(0), _gpuDataSize(0), _positionDequantizeScale(1.0f, 1.0f, 1.0f, 0.0f), _positionDequantizeOffset(0.0f, 0.0f, 0.0f, 0.0f)
 {}
 
-MeshBase::MeshBase(const MeshBase& other) : _vertexBuffer(nullptr), _indexBuffer(nullptr), _verticesCount(0), _indicesCount(0)
+MeshBase::MeshBase(const MeshBase& other) : _vertexBuffer(nullptr), _indexBuffer(nullptr), _verticesCount(0), _indicesCount(0), _vertexFormat(other._vertexFormat), _indexFormat(IndexFormat::UInt32),
+	_requiredData(other._requiredData), _retainedData(MeshDataRetention::Full), _vertexData(nullptr), _indexData(nullptr), _cpuDataSize(0), _gpuDataSize(0), _positionDequantizeScale(1.0f, 1.0f, 1.0f, 0.0f), _positionDequantizeOffset(0.0f, 0.0f, 0.0f, 0.0f)
 {}
 
 MeshBase::~MeshBase()
-{}
+{
+	_totalCPUDataSize -= _cpuDataSize;
+}
 
-bool MeshBase::CreateBuffers(VertexType* vertices, unsigned int* indices)
+const float MeshBase::LOD_HYSTERESIS = 0.1f;
+std::atomic<size_t> MeshBase::_totalCPUDataSize(0);
+
+void MeshBase::UpdateCPUDataSize()
+{
+	// Retained geometry is counted whether it is owned by the mesh or used in place
+	const size_t size = (_vertexData != nullptr ? (size_t)_verticesCount * sizeof(VertexType) : 0) + _positions.capacity() * sizeof(Vector3) +
+		(_indexData != nullptr ? (size_t)_indicesCount * sizeof(unsigned int) : 0);
+	// Added before subtracting, so the total never drops below sizes of other meshes
+	_totalCPUDataSize += size;
+	_totalCPUDataSize -= _cpuDataSize;
+	_cpuDataSize = size;
+}
+
+static inline size_t GetBuffersSize(unsigned int verticesCount, unsigned int vertexStride, unsigned int indicesCount, IndexFormat indexFormat)
+{
+	return (size_t)verticesCount * vertexStride + (size_t)indicesCount * (indexFormat == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int));
+}
+
+void MeshBase::EncodeVertices(const VertexType* vertices, unsigned int verticesCount, DynamicArray<unsigned char>& encodedVertices) const
+{
+	encodedVertices.resize(verticesCount * GetVertexStride());
+
+	switch (_vertexFormat)
+	{
+		case VertexFormat::Compact:
+			{
+				CompactVertex* encoded = (CompactVertex*)encodedVertices.data();
+				for (unsigned int i = 0; i < verticesCount; ++i)
+				{
+					encoded[i].Position = vertices[i].Position;
+					EncodeOctahedralNormal(vertices[i].Normal, encoded[i].Normal[0], encoded[i].Normal[1]);
+					encoded[i].UV[0] = FloatToHalf(vertices[i].UV.X);
+					encoded[i].UV[1] = FloatToHalf(vertices[i].UV.Y);
+				}
+			}
+			break;
+		case VertexFormat::Quantized:
+			{
+				QuantizedVertex* encoded = (QuantizedVertex*)encodedVertices.data();
+				for (unsigned int i = 0; i < verticesCount; ++i)
+				{
+					// Simplified LODs may move vertices slightly outside of the bounds, those are clamped
+					const Vector3& position = vertices[i].Position;
+					encoded[i].Position[0] = FloatToSnorm16((position.X - _positionDequantizeOffset.X) / _positionDequantizeScale.X);
+					encoded[i].Position[1] = FloatToSnorm16((position.Y - _positionDequantizeOffset.Y) / _positionDequantizeScale.Y);
+					encoded[i].Position[2] = FloatToSnorm16((position.Z - _positionDequantizeOffset.Z) / _positionDequantizeScale.Z);
+					encoded[i].Position[3] = 0;
+					EncodeOctahedralNormal(vertices[i].Normal, encoded[i].Normal[0], encoded[i].Normal[1]);
+					encoded[i].UV[0] = FloatToHalf(vertices[i].UV.X);
+					encoded[i].UV[1] = FloatToHalf(vertices[i].UV.Y);
+				}
+			}
+			break;
+		default:
+			memcpy(encodedVertices.data(), vertices, verticesCount * sizeof(VertexType));
+			break;
+	}
+}
+
+bool MeshBase::CreateBuffers(const VertexType* vertices, unsigned int verticesCount, const unsigned int* indices, unsigned int indicesCount,
+							 ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer, IndexFormat& indexFormat) const
 {
 	Graphics& graphics = gGraphics;
 
 	D3D11_BUFFER_DESC bufferDesc = {0};
 	D3D11_SUBRESOURCE_DATA bufferData = {0};
 
+	DynamicArray<unsigned char> encodedVertices;
+	EncodeVertices(vertices, verticesCount, encodedVertices);
+
 	// Vertex buffer creation
 	// Filling desc
 	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(VertexType) * _verticesCount;
+	bufferDesc.ByteWidth = (unsigned int)encodedVertices.size();
 	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
 	// Filling data
-	bufferData.pSysMem = vertices;
+	bufferData.pSysMem = encodedVertices.data();
 
-	bool result = graphics.CreateBuffer(bufferDesc, bufferData, &_vertexBuffer);
+	bool result = graphics.CreateBuffer(bufferDesc, bufferData, vertexBuffer);
 	if (!result)
 	{
 		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex buffer"));
 		return false;
 	}
 
+	// Half of the index memory and bandwidth whenever all vertices are addressable with 16 bits
+	DynamicArray<unsigned short> shortIndices;
+	indexFormat = verticesCount <= MAX_UINT16_INDEXED_VERTICES ? IndexFormat::UInt16 : IndexFormat::UInt32;
+	if (indexFormat == IndexFormat::UInt16)
+	{
+		shortIndices.resize(indicesCount);
+		for (unsigned int i = 0; i < indicesCount; ++i)
+		{
+			shortIndices[i] = (unsigned short)indices[i];
+		}
+	}
+
 	// Index buffer creation
 	// Filling desc
 	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(unsigned int) * _indicesCount;
+	bufferDesc.ByteWidth = indexFormat == IndexFormat::UInt16 ? sizeof(unsigned short) * indicesCount : sizeof(unsigned int) * indicesCount;
 	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
 	// Filling data
-	bufferData.pSysMem = indices;
+	bufferData.pSysMem = indexFormat == IndexFormat::UInt16 ? (const void*)shortIndices.data() : (const void*)indices;
 
-	result = graphics.CreateBuffer(bufferDesc, bufferData, &_indexBuffer);
+	result = graphics.CreateBuffer(bufferDesc, bufferData, indexBuffer);
 	if (!result)
 	{
 		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create index buffer"));
 	}
 
-	// Calculate bounding box
+	return result;
+}
+
+void MeshBase::SetBoundingBox(const BoundingBox& boundingBox)
+{
+	_boundingBox = boundingBox;
+
+	const Vector3 center = _boundingBox.GetCenter();
+	const Vector3 extents = _boundingBox.GetMax() - center;
+	_positionDequantizeScale = Vector4(Math::Max(extents.X, Math::EPSILON), Math::Max(extents.Y, Math::EPSILON), Math::Max(extents.Z, Math::EPSILON), 0.0f);
+	_positionDequantizeOffset = Vector4(center, 0.0f);
+}
+
+bool MeshBase::CreateBuffers(VertexType* vertices, unsigned int* indices)
+{
+	// Reordering is done in place, so CPU side data matches GPU buffers
+	float acmrBefore = 0.0f;
+	float acmrAfter = 0.0f;
+	MeshOptimizer::Optimize(vertices, _verticesCount, indices, _indicesCount, acmrBefore, acmrAfter);
+#if DT_DEBUG
+	// Reported only in debug builds, every loaded mesh would flood the log otherwise
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Optimized mesh (%s), ACMR %.3f -> %.3f"), _path.c_str(), acmrBefore, acmrAfter);
+#endif
+
+	// Calculate bounding box, quantized positions are relative to it
 	static const auto positionGetter = [](const VertexType& vertex) -> const Vector3&{return vertex.Position;};
-	_boundingBox.CalculateMinMax<VertexType>(vertices, _verticesCount, positionGetter);
+	BoundingBox boundingBox;
+	boundingBox.CalculateMinMax<VertexType>(vertices, _verticesCount, positionGetter);
 
-	_vertices.reserve(_verticesCount);
-	for (unsigned int i = 0; i < _verticesCount; ++i)
+	// Meshes generated into temporary arrays (i.e. primitives) keep a copy, data loaded straight into CPU arrays is kept as it is
+	if (vertices != _vertices.data())
 	{
-		_vertices.push_back(vertices[i]);
+		_vertices.assign(vertices, vertices + _verticesCount);
 	}
+	if (indices != _indices.data())
+	{
+		_indices.assign(indices, indices + _indicesCount);
+	}
+
+	return CreateOptimizedBuffers(_vertices.data(), _indices.data(), boundingBox);
+}
+
+bool MeshBase::CreateOptimizedBuffers(const VertexType* vertices, const unsigned int* indices, const BoundingBox& boundingBox)
+{
+	SetBoundingBox(boundingBox);
 
-	_indices.reserve(_indicesCount);
-	for (unsigned int i = 0; i < _indicesCount; ++i)
+	const bool result = CreateBuffers(vertices, _verticesCount, indices, _indicesCount, &_vertexBuffer, &_indexBuffer, _indexFormat);
+	if (_vertexBuffer == nullptr)
 	{
-		_indices.push_back(indices[i]);
+		return false;
 	}
+	_gpuDataSize += GetBuffersSize(_verticesCount, GetVertexStride(), _indicesCount, _indexFormat);
+
+	_vertexData = vertices;
+	_indexData = indices;
+	_positions.clear();
+	_retainedData = MeshDataRetention::Full;
+	UpdateCPUDataSize();
 
 	return result;
 }
 
+void MeshBase::SetVertexFormat(VertexFormat vertexFormat)
+{
+	DT_ASSERT(_vertexBuffer == nullptr, DT_TEXT("Vertex format cannot be changed after the mesh has been initialized"));
+	_vertexFormat = vertexFormat;
+}
+
+bool MeshBase::RequireCPUData(MeshDataRetention retention)
+{
+	_requiredData = Math::Max(_requiredData, retention);
+	if (retention > _retainedData)
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("CPU data of mesh (%s) required after it has been released"), _path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void MeshBase::ReleaseCPUData()
+{
+	if (_requiredData >= _retainedData)
+	{
+		return;
+	}
+
+	if (_requiredData == MeshDataRetention::Positions && _vertexData != nullptr)
+	{
+		_positions.resize(_verticesCount);
+		for (unsigned int i = 0; i < _verticesCount; ++i)
+		{
+			_positions[i] = _vertexData[i].Position;
+		}
+
+		// Indices used in place are owned by the derived mesh, which may free them now
+		if (_indexData != _indices.data())
+		{
+			_indices.assign(_indexData, _indexData + _indicesCount);
+			_indexData = _indices.data();
+		}
+	}
+	else if (_requiredData == MeshDataRetention::None)
+	{
+		DynamicArray<Vector3>().swap(_positions);
+		DynamicArray<unsigned int>().swap(_indices);
+		_indexData = nullptr;
+	}
+
+	// Swapping with empty arrays, clear alone doesn't free the memory
+	DynamicArray<VertexType>().swap(_vertices);
+	_vertexData = nullptr;
+	_retainedData = _requiredData;
+	UpdateCPUDataSize();
+}
+
+bool MeshBase::AddLOD(const VertexType* vertices, unsigned int verticesCount, const unsigned int* indices, unsigned int indicesCount, float screenSize, bool isOptimized)
+{
+	DT_ASSERT(_lods.size() + 1 < MAX_LODS, DT_TEXT("Too many LODs"));
+	DT_ASSERT(_lods.empty() || _lods.back().ScreenSize > screenSize, DT_TEXT("LODs have to be added in order of decreasing screen size"));
+
+	LOD lod;
+	lod.VertexBuffer = nullptr;
+	lod.IndexBuffer = nullptr;
+	lod.IndicesCount = indicesCount;
+	lod.IndicesFormat = IndexFormat::UInt32;
+	lod.ScreenSize = screenSize;
+
+	// LODs are not kept on CPU, so they are optimized in temporary copies
+	DynamicArray<VertexType> optimizedVertices;
+	DynamicArray<unsigned int> optimizedIndices;
+	if (!isOptimized)
+	{
+		optimizedVertices.assign(vertices, vertices + verticesCount);
+		optimizedIndices.assign(indices, indices + indicesCount);
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+		MeshOptimizer::Optimize(optimizedVertices.data(), verticesCount, optimizedIndices.data(), indicesCount, acmrBefore, acmrAfter);
+
+		vertices = optimizedVertices.data();
+		indices = optimizedIndices.data();
+	}
+
+	if (!CreateBuffers(vertices, verticesCount, indices, indicesCount, &lod.VertexBuffer, &lod.IndexBuffer, lod.IndicesFormat))
+	{
+		RELEASE_COM(lod.IndexBuffer);
+		RELEASE_COM(lod.VertexBuffer);
+		return false;
+	}
+
+	_lods.push_back(lod);
+	_gpuDataSize += GetBuffersSize(verticesCount, GetVertexStride(), indicesCount, lod.IndicesFormat);
+	return true;
+}
+
+unsigned int MeshBase::SelectLOD(float screenSize, unsigned int currentLOD) const
+{
+	unsigned int lod = 0;
+	for (unsigned int i = 0; i < _lods.size(); ++i)
+	{
+		// Switching to less detailed LOD requires going clearly below the threshold, switching back requires going clearly above it
+		const float threshold = _lods[i].ScreenSize * (i + 1 <= currentLOD ? 1.0f + LOD_HYSTERESIS : 1.0f - LOD_HYSTERESIS);
+		if (screenSize >= threshold)
+		{
+			break;
+		}
+
+		lod = i + 1;
+	}
+
+	return lod;
+}
+
 void MeshBase::Shutdown()
 {
+	for (LOD& lod : _lods)
+	{
+		RELEASE_COM(lod.IndexBuffer);
+		RELEASE_COM(lod.VertexBuffer);
+	}
+	_lods.clear();
+
 	RELEASE_COM(_indexBuffer);
 	RELEASE_COM(_vertexBuffer);
+	_gpuDataSize = 0;
+}
+
+size_t MeshBase::GetMemorySize() const
+{
+	return _cpuDataSize + _gpuDataSize;
+}
+
+bool MeshBase::TakeReloaded(Asset& reloaded)
+{
+	// Resources reload assets as instances of the same type, vertex format is chosen by the user of the mesh
+	MeshBase& mesh = static_cast<MeshBase&>(reloaded);
+	mesh._vertexFormat = _vertexFormat;
+	if (!mesh.Initialize())
+	{
+		return false;
+	}
+
+	// Consumers have declared what they need already, so new data is trimmed right away if the previous one was
+	const bool isReleased = _retainedData != MeshDataRetention::Full;
+
+	std::swap(_vertexBuffer, mesh._vertexBuffer);
+	std::swap(_indexBuffer, mesh._indexBuffer);
+	std::swap(_verticesCount, mesh._verticesCount);
+	std::swap(_indicesCount, mesh._indicesCount);
+	std::swap(_indexFormat, mesh._indexFormat);
+	std::swap(_vertices, mesh._vertices);
+	std::swap(_positions, mesh._positions);
+	std::swap(_indices, mesh._indices);
+	std::swap(_vertexData, mesh._vertexData);
+	std::swap(_indexData, mesh._indexData);
+	std::swap(_retainedData, mesh._retainedData);
+	std::swap(_cpuDataSize, mesh._cpuDataSize);
+	std::swap(_gpuDataSize, mesh._gpuDataSize);
+	std::swap(_boundingBox, mesh._boundingBox);
+	std::swap(_positionDequantizeScale, mesh._positionDequantizeScale);
+	std::swap(_positionDequantizeOffset, mesh._positionDequantizeOffset);
+	std::swap(_lods, mesh._lods);
+
+	if (isReleased)
+	{
+		ReleaseCPUData();
+	}
+
+	return true;
 }
\ No newline at end of file
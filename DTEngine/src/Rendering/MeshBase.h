@@ -1,11 +1,25 @@
 #pragma once
 
+#include <atomic>
+
 #include "ResourceManagement/Asset.h"
 #include "Utility/Math.h"
 #include "Utility/BoundingBox.h"
+#include "Rendering/VertexFormat.h"
 
 struct ID3D11Buffer;
 
+// How much of mesh's geometry stays in CPU memory after it has been uploaded to GPU
+enum class MeshDataRetention : unsigned char
+{
+	// Only GPU buffers are kept
+	None,
+	// Positions and indices, enough for physics cooking, occlusion culling or picking
+	Positions,
+	// Whole vertices and indices, needed for static batching or copying the mesh
+	Full
+};
+
 class MeshBase : public Asset
 {
 public:
@@ -17,16 +31,54 @@ public:
 		Vector2 UV;
 	};
 
+	// Less detailed version of the mesh, used when mesh covers less than ScreenSize of screen height
+	struct LOD
+	{
+		ID3D11Buffer* VertexBuffer;
+		ID3D11Buffer* IndexBuffer;
+		unsigned int IndicesCount;
+		IndexFormat IndicesFormat;
+		float ScreenSize;
+	};
+
+	static const unsigned int MAX_LODS = 4;
+	// Relative margin around LOD thresholds, so meshes close to a threshold don't switch LODs every frame
+	static const float LOD_HYSTERESIS;
+
+	// Vertex format of meshes which do not set their own before initialization
+	static const VertexFormat DEFAULT_VERTEX_FORMAT = VertexFormat::Compact;
+
 protected:
 	ID3D11Buffer* _vertexBuffer;
 	ID3D11Buffer* _indexBuffer;
 	unsigned int _verticesCount;
 	unsigned int _indicesCount;
+	VertexFormat _vertexFormat;
+	IndexFormat _indexFormat;
 
+	// CPU copy of the geometry, trimmed by ReleaseCPUData to what consumers of the mesh require
 	DynamicArray<VertexType> _vertices;
+	DynamicArray<Vector3> _positions;
 	DynamicArray<unsigned int> _indices;
+	// Retained geometry, either the arrays above or data owned by the derived mesh (i.e. mapped cooked mesh)
+	const VertexType* _vertexData;
+	const unsigned int* _indexData;
+	MeshDataRetention _requiredData;
+	MeshDataRetention _retainedData;
+	size_t _cpuDataSize;
+	// Bytes of vertex and index buffers of all LODs
+	size_t _gpuDataSize;
+
+	// Sum of CPU data sizes of all meshes, meshes are loaded on loading threads and trimmed on main thread
+	static std::atomic<size_t> _totalCPUDataSize;
 
 	BoundingBox _boundingBox;
+	// Quantized positions are decoded as position * scale + offset, so bounds map to [-1, 1]
+	Vector4 _positionDequantizeScale;
+	Vector4 _positionDequantizeOffset;
+
+	// LOD 0 is the mesh itself, only less detailed levels are stored here, sorted by decreasing ScreenSize
+	DynamicArray<LOD> _lods;
 
 public:
 	MeshBase();
@@ -34,10 +86,39 @@ public:
 	virtual ~MeshBase();
 
 protected:
+	// Optimizes order of vertices and triangles in place before upload
 	bool CreateBuffers(VertexType* vertices, unsigned int* indices);
+	// Uploads geometry which is optimized already (i.e. cooked meshes) together with its precomputed bounding box
+	// Geometry is retained in place, not copied, so it has to stay alive until ReleaseCPUData frees it
+	bool CreateOptimizedBuffers(const VertexType* vertices, const unsigned int* indices, const BoundingBox& boundingBox);
+	// Encodes vertices to mesh's vertex format and indices to 16 bits if possible
+	bool CreateBuffers(const VertexType* vertices, unsigned int verticesCount, const unsigned int* indices, unsigned int indicesCount,
+					   ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer, IndexFormat& indexFormat) const;
+	void UpdateCPUDataSize();
+	// Quantized positions are relative to the bounding box, so it has to be set before buffers are created
+	void SetBoundingBox(const BoundingBox& boundingBox);
+	void EncodeVertices(const VertexType* vertices, unsigned int verticesCount, DynamicArray<unsigned char>& encodedVertices) const;
+	// LODs have to be added in order of decreasing detail, they are optimized before upload unless they are optimized already
+	bool AddLOD(const VertexType* vertices, unsigned int verticesCount, const unsigned int* indices, unsigned int indicesCount, float screenSize, bool isOptimized = false);
+
+	inline bool AddLOD(const DynamicArray<VertexType>& vertices, const DynamicArray<unsigned int>& indices, float screenSize)
+	{
+		return AddLOD(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size(), screenSize);
+	}
 
 public:
 	virtual void Shutdown() override;
+	virtual size_t GetMemorySize() const override;
+	virtual bool TakeReloaded(Asset& reloaded) override;
+
+	// Has to be called before the mesh is initialized
+	void SetVertexFormat(VertexFormat vertexFormat);
+
+	// Declares that caller needs CPU side data of the mesh, has to be done before ReleaseCPUData
+	// Returns false if required data has already been released
+	bool RequireCPUData(MeshDataRetention retention);
+	// Frees CPU side data no consumer has required, meshes keep everything until then
+	virtual void ReleaseCPUData();
 
 	inline ID3D11Buffer* GetVertexBuffer() const
 	{
@@ -54,23 +135,106 @@ public:
 		return _indicesCount;
 	}
 
-	inline unsigned int GetVertexTypeSize() const
+	inline unsigned int GetLODsCount() const
+	{
+		return 1 + (unsigned int)_lods.size();
+	}
+
+	inline ID3D11Buffer* GetVertexBuffer(unsigned int lod) const
+	{
+		return lod == 0 ? _vertexBuffer : _lods[lod - 1].VertexBuffer;
+	}
+
+	inline ID3D11Buffer* GetIndexBuffer(unsigned int lod) const
 	{
-		return sizeof(VertexType);
+		return lod == 0 ? _indexBuffer : _lods[lod - 1].IndexBuffer;
 	}
 
-	inline const DynamicArray<VertexType>& GetVertices() const
+	inline unsigned int GetIndicesCount(unsigned int lod) const
 	{
-		return _vertices;
+		return lod == 0 ? _indicesCount : _lods[lod - 1].IndicesCount;
 	}
 
-	inline const DynamicArray<unsigned int>& GetIndices() const
+	inline IndexFormat GetIndexFormat(unsigned int lod = 0) const
 	{
-		return _indices;
+		return lod == 0 ? _indexFormat : _lods[lod - 1].IndicesFormat;
+	}
+
+	inline VertexFormat GetVertexFormat() const
+	{
+		return _vertexFormat;
+	}
+
+	// Size of a vertex in vertex buffers
+	inline unsigned int GetVertexStride() const
+	{
+		return GetVertexFormatStride(_vertexFormat);
+	}
+
+	inline const Vector4& GetPositionDequantizeScale() const
+	{
+		return _positionDequantizeScale;
+	}
+
+	inline const Vector4& GetPositionDequantizeOffset() const
+	{
+		return _positionDequantizeOffset;
+	}
+
+	// Screen size is mesh's projected size relative to screen height, current LOD is needed for hysteresis
+	unsigned int SelectLOD(float screenSize, unsigned int currentLOD) const;
+
+	inline MeshDataRetention GetRetainedCPUData() const
+	{
+		return _retainedData;
+	}
+
+	// Null unless full data is retained
+	inline const VertexType* GetVertices() const
+	{
+		return _vertexData;
+	}
+
+	inline unsigned int GetVerticesCount() const
+	{
+		return _verticesCount;
+	}
+
+	// Positions are either part of full vertices or stored on their own, so they have to be read with the stride
+	inline const Vector3* GetPositions() const
+	{
+		return _vertexData != nullptr ? &_vertexData[0].Position : (_positions.empty() ? nullptr : _positions.data());
+	}
+
+	inline unsigned int GetPositionsStride() const
+	{
+		return _vertexData != nullptr ? sizeof(VertexType) : sizeof(Vector3);
+	}
+
+	inline unsigned int GetPositionsCount() const
+	{
+		return _vertexData != nullptr ? _verticesCount : (unsigned int)_positions.size();
+	}
+
+	// Null unless positions or full data are retained, there are GetIndicesCount of them
+	inline const unsigned int* GetIndices() const
+	{
+		return _indexData;
 	}
 
 	inline const BoundingBox& GetBoundingBox() const
 	{
 		return _boundingBox;
 	}
+
+	// Bytes of geometry kept in CPU memory by this mesh
+	inline size_t GetCPUDataSize() const
+	{
+		return _cpuDataSize;
+	}
+
+	static inline size_t GetTotalCPUDataSize()
+	{
+		return _totalCPUDataSize.load();
+	}
 };
\ No newline at end of file
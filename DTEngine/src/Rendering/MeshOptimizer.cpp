@@ -0,0 +1,321 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+const float MeshOptimizer::OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float CalculateVertexScore(int cachePosition, unsigned int remainingValence)
+{
+	// Vertex without remaining triangles doesn't matter anymore
+	if (remainingValence == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// Vertices of the last triangle get fixed score, so the next triangle doesn't favour any of its edges
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			const float scale = 1.0f / (MeshOptimizer::OPTIMIZED_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+		}
+	}
+
+	// Vertices with few triangles left are preferred, so they are finished and do not cause cache misses later
+	return score + VALENCE_BOOST_SCALE * powf((float)remainingValence, -VALENCE_BOOST_POWER);
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, unsigned int indicesCount, unsigned int verticesCount)
+{
+	const unsigned int trianglesCount = indicesCount / 3;
+	if (trianglesCount == 0)
+	{
+		return;
+	}
+
+	// Triangles adjacent to a vertex are stored contiguously per vertex
+	DynamicArray<unsigned int> valences(verticesCount, 0);
+	for (unsigned int i = 0; i < trianglesCount * 3; ++i)
+	{
+		++valences[indices[i]];
+	}
+
+	DynamicArray<unsigned int> adjacencyOffsets(verticesCount + 1, 0);
+	for (unsigned int i = 0; i < verticesCount; ++i)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + valences[i];
+	}
+
+	DynamicArray<unsigned int> adjacency(trianglesCount * 3);
+	DynamicArray<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (unsigned int i = 0; i < trianglesCount * 3; ++i)
+	{
+		adjacency[adjacencyFill[indices[i]]++] = i / 3;
+	}
+
+	DynamicArray<int> cachePositions(verticesCount, -1);
+	DynamicArray<float> vertexScores(verticesCount);
+	for (unsigned int i = 0; i < verticesCount; ++i)
+	{
+		vertexScores[i] = CalculateVertexScore(-1, valences[i]);
+	}
+
+	DynamicArray<bool> isEmitted(trianglesCount, false);
+	DynamicArray<unsigned int> optimizedIndices(trianglesCount * 3);
+
+	// Emitted triangle's vertices are placed at front, so the cache can temporarily grow by 3
+	unsigned int cache[OPTIMIZED_CACHE_SIZE + 3];
+	unsigned int newCache[OPTIMIZED_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	unsigned int scanPosition = 0;
+	int bestTriangle = -1;
+	for (unsigned int emittedCount = 0; emittedCount < trianglesCount; ++emittedCount)
+	{
+		// Dead end, no triangle uses cached vertices, so the next one in original order is taken
+		if (bestTriangle < 0)
+		{
+			while (isEmitted[scanPosition])
+			{
+				++scanPosition;
+			}
+			bestTriangle = (int)scanPosition;
+		}
+
+		const unsigned int* triangle = indices + bestTriangle * 3;
+		isEmitted[bestTriangle] = true;
+
+		unsigned int newCacheCount = 0;
+		for (unsigned char i = 0; i < 3; ++i)
+		{
+			optimizedIndices[emittedCount * 3 + i] = triangle[i];
+			newCache[newCacheCount++] = triangle[i];
+			--valences[triangle[i]];
+		}
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			const unsigned int vertex = cache[i];
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		// Scores of evicted vertices have to be updated as well, they may still be used by remaining triangles
+		for (unsigned int i = 0; i < newCacheCount; ++i)
+		{
+			const unsigned int vertex = newCache[i];
+			cachePositions[vertex] = i < OPTIMIZED_CACHE_SIZE ? (int)i : -1;
+			vertexScores[vertex] = CalculateVertexScore(cachePositions[vertex], valences[vertex]);
+		}
+
+		cacheCount = Math::Min(newCacheCount, OPTIMIZED_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// Only triangles using cached vertices have changed their scores, so the best one is searched among them
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			const unsigned int vertex = cache[i];
+			for (unsigned int j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; ++j)
+			{
+				const unsigned int candidate = adjacency[j];
+				if (isEmitted[candidate])
+				{
+					continue;
+				}
+
+				const unsigned int* candidateTriangle = indices + candidate * 3;
+				const float score = vertexScores[candidateTriangle[0]] + vertexScores[candidateTriangle[1]] + vertexScores[candidateTriangle[2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)candidate;
+				}
+			}
+		}
+	}
+
+	std::copy(optimizedIndices.begin(), optimizedIndices.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, unsigned int indicesCount, const MeshBase::VertexType* vertices, unsigned int verticesCount)
+{
+	const unsigned int trianglesCount = indicesCount / 3;
+	if (trianglesCount == 0)
+	{
+		return;
+	}
+
+	const float acmrBefore = CalculateACMR(indices, indicesCount, verticesCount);
+
+	// Clusters start at triangles missing the cache with all vertices, reordering them keeps cache efficiency almost intact
+	DynamicArray<unsigned int> clustersStarts;
+	DynamicArray<unsigned int> timestamps(verticesCount, 0);
+	unsigned int time = MEASURED_CACHE_SIZE + 1;
+	for (unsigned int i = 0; i < trianglesCount; ++i)
+	{
+		unsigned char misses = 0;
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			const unsigned int vertex = indices[i * 3 + j];
+			if (time - timestamps[vertex] > MEASURED_CACHE_SIZE)
+			{
+				timestamps[vertex] = time++;
+				++misses;
+			}
+		}
+
+		if (i == 0 || misses == 3)
+		{
+			clustersStarts.push_back(i);
+		}
+	}
+	clustersStarts.push_back(trianglesCount);
+
+	const unsigned int clustersCount = (unsigned int)clustersStarts.size() - 1;
+	if (clustersCount < 2)
+	{
+		return;
+	}
+
+	// Area weighted centroids and normals of clusters
+	DynamicArray<Vector3> clustersCentroids(clustersCount, Vector3::ZERO);
+	DynamicArray<Vector3> clustersNormals(clustersCount, Vector3::ZERO);
+	Vector3 meshCentroid = Vector3::ZERO;
+	float meshArea = 0.0f;
+	for (unsigned int cluster = 0; cluster < clustersCount; ++cluster)
+	{
+		float clusterArea = 0.0f;
+		for (unsigned int i = clustersStarts[cluster]; i < clustersStarts[cluster + 1]; ++i)
+		{
+			const Vector3& p0 = vertices[indices[i * 3]].Position;
+			const Vector3& p1 = vertices[indices[i * 3 + 1]].Position;
+			const Vector3& p2 = vertices[indices[i * 3 + 2]].Position;
+
+			const Vector3 normal = Vector3::CrossProduct(p1 - p0, p2 - p0);
+			const float area = normal.Length();
+
+			clustersCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			clustersNormals[cluster] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clustersCentroids[cluster];
+		meshArea += clusterArea;
+		if (clusterArea > Math::EPSILON)
+		{
+			clustersCentroids[cluster] = clustersCentroids[cluster] * (1.0f / clusterArea);
+		}
+	}
+	if (meshArea > Math::EPSILON)
+	{
+		meshCentroid = meshCentroid * (1.0f / meshArea);
+	}
+
+	// Clusters facing away from the center are likely on the outside of the mesh, so they are drawn first and occlude the rest
+	DynamicArray<float> clustersKeys(clustersCount);
+	DynamicArray<unsigned int> clustersOrder(clustersCount);
+	for (unsigned int cluster = 0; cluster < clustersCount; ++cluster)
+	{
+		clustersKeys[cluster] = Vector3::DotProduct(clustersCentroids[cluster] - meshCentroid, clustersNormals[cluster].GetNormalizedSafe());
+		clustersOrder[cluster] = cluster;
+	}
+	std::stable_sort(clustersOrder.begin(), clustersOrder.end(), [&clustersKeys](unsigned int a, unsigned int b){return clustersKeys[a] > clustersKeys[b];});
+
+	DynamicArray<unsigned int> reorderedIndices;
+	reorderedIndices.reserve(trianglesCount * 3);
+	for (unsigned int cluster : clustersOrder)
+	{
+		reorderedIndices.insert(reorderedIndices.end(), indices + clustersStarts[cluster] * 3, indices + clustersStarts[cluster + 1] * 3);
+	}
+
+	// Triangles left over after the last full triangle stay at the end
+	reorderedIndices.insert(reorderedIndices.end(), indices + trianglesCount * 3, indices + indicesCount);
+
+	if (CalculateACMR(reorderedIndices.data(), indicesCount, verticesCount) <= acmrBefore * OVERDRAW_ACMR_THRESHOLD)
+	{
+		std::copy(reorderedIndices.begin(), reorderedIndices.end(), indices);
+	}
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshBase::VertexType* vertices, unsigned int verticesCount, unsigned int* indices, unsigned int indicesCount)
+{
+	DynamicArray<unsigned int> remap(verticesCount, UINT_MAX);
+	unsigned int nextVertex = 0;
+	for (unsigned int i = 0; i < indicesCount; ++i)
+	{
+		unsigned int& newVertex = remap[indices[i]];
+		if (newVertex == UINT_MAX)
+		{
+			newVertex = nextVertex++;
+		}
+		indices[i] = newVertex;
+	}
+
+	for (unsigned int i = 0; i < verticesCount; ++i)
+	{
+		if (remap[i] == UINT_MAX)
+		{
+			remap[i] = nextVertex++;
+		}
+	}
+
+	DynamicArray<MeshBase::VertexType> reorderedVertices(verticesCount);
+	for (unsigned int i = 0; i < verticesCount; ++i)
+	{
+		reorderedVertices[remap[i]] = vertices[i];
+	}
+	std::copy(reorderedVertices.begin(), reorderedVertices.end(), vertices);
+}
+
+float MeshOptimizer::CalculateACMR(const unsigned int* indices, unsigned int indicesCount, unsigned int verticesCount, unsigned int cacheSize)
+{
+	const unsigned int trianglesCount = indicesCount / 3;
+	if (trianglesCount == 0)
+	{
+		return 0.0f;
+	}
+
+	// Vertex is in FIFO cache if fewer than cacheSize other vertices have been transformed since it was
+	DynamicArray<unsigned int> timestamps(verticesCount, 0);
+	unsigned int time = cacheSize + 1;
+	unsigned int misses = 0;
+	for (unsigned int i = 0; i < trianglesCount * 3; ++i)
+	{
+		const unsigned int vertex = indices[i];
+		if (time - timestamps[vertex] > cacheSize)
+		{
+			timestamps[vertex] = time++;
+			++misses;
+		}
+	}
+
+	return (float)misses / trianglesCount;
+}
+
+void MeshOptimizer::Optimize(MeshBase::VertexType* vertices, unsigned int verticesCount, unsigned int* indices, unsigned int indicesCount, float& acmrBefore, float& acmrAfter)
+{
+	acmrBefore = CalculateACMR(indices, indicesCount, verticesCount);
+
+	OptimizeVertexCache(indices, indicesCount, verticesCount);
+	OptimizeOverdraw(indices, indicesCount, vertices, verticesCount);
+	OptimizeVertexFetch(vertices, verticesCount, indices, indicesCount);
+
+	acmrAfter = CalculateACMR(indices, indicesCount, verticesCount);
+}
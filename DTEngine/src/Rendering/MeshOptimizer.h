@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Rendering/MeshBase.h"
+
+// Reorders triangles and vertices of a mesh for GPU caches, rendered result stays the same
+// Triangles are ordered for post-transform cache reuse (Forsyth), then clusters of them front to back against overdraw (Sander et al.)
+// and finally vertices are ordered by first use, so vertex fetch reads memory linearly
+class MeshOptimizer final
+{
+public:
+	// Cache size the triangle order is optimized for, bigger than real caches do no harm with this algorithm
+	static const unsigned int OPTIMIZED_CACHE_SIZE = 32;
+	// FIFO cache used to measure ACMR, roughly matches post-transform caches of current GPUs
+	static const unsigned int MEASURED_CACHE_SIZE = 16;
+	// How much overdraw ordering may worsen ACMR before it is rejected
+	static const float OVERDRAW_ACMR_THRESHOLD;
+
+	static void OptimizeVertexCache(unsigned int* indices, unsigned int indicesCount, unsigned int verticesCount);
+	static void OptimizeOverdraw(unsigned int* indices, unsigned int indicesCount, const MeshBase::VertexType* vertices, unsigned int verticesCount);
+	// Vertices not referenced by any triangle are moved to the end
+	static void OptimizeVertexFetch(MeshBase::VertexType* vertices, unsigned int verticesCount, unsigned int* indices, unsigned int indicesCount);
+
+	// Average cache miss ratio, transformed vertices per triangle with FIFO cache of given size (0.5 is ideal, 3 is the worst)
+	static float CalculateACMR(const unsigned int* indices, unsigned int indicesCount, unsigned int verticesCount, unsigned int cacheSize = MEASURED_CACHE_SIZE);
+
+	// Runs all optimizations in place, ACMR of mesh before and after them is returned for reporting
+	static void Optimize(MeshBase::VertexType* vertices, unsigned int verticesCount, unsigned int* indices, unsigned int indicesCount, float& acmrBefore, float& acmrAfter);
+};
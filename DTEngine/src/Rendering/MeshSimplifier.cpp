@@ -0,0 +1,499 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Symmetric 4x4 matrix of plane quadric, only 10 unique values are stored
+struct Quadric
+{
+	double M[10];
+
+	inline Quadric()
+	{
+		for (unsigned char i = 0; i < 10; ++i)
+		{
+			M[i] = 0.0;
+		}
+	}
+
+	// Quadric of plane ax + by + cz + d = 0
+	inline Quadric(double a, double b, double c, double d)
+	{
+		M[0] = a * a; M[1] = a * b; M[2] = a * c; M[3] = a * d;
+		M[4] = b * b; M[5] = b * c; M[6] = b * d;
+		M[7] = c * c; M[8] = c * d;
+		M[9] = d * d;
+	}
+
+	inline double Determinant(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33) const
+	{
+		return M[a11] * M[a22] * M[a33] + M[a13] * M[a21] * M[a32] + M[a12] * M[a23] * M[a31]
+			- M[a13] * M[a22] * M[a31] - M[a11] * M[a23] * M[a32] - M[a12] * M[a21] * M[a33];
+	}
+
+	inline double Error(const Vector3& p) const
+	{
+		const double x = p.X;
+		const double y = p.Y;
+		const double z = p.Z;
+		return M[0] * x * x + 2 * M[1] * x * y + 2 * M[2] * x * z + 2 * M[3] * x + M[4] * y * y
+			+ 2 * M[5] * y * z + 2 * M[6] * y + M[7] * z * z + 2 * M[8] * z + M[9];
+	}
+
+	inline Quadric operator+(const Quadric& other) const
+	{
+		Quadric result;
+		for (unsigned char i = 0; i < 10; ++i)
+		{
+			result.M[i] = M[i] + other.M[i];
+		}
+		return result;
+	}
+};
+
+struct SimplifierTriangle
+{
+	unsigned int V[3];
+	// Collapse errors of edges (0-1, 1-2, 2-0) and the smallest of them
+	double Errors[4];
+	Vector3 Normal;
+	bool IsDeleted;
+	bool IsDirty;
+};
+
+struct SimplifierVertex
+{
+	Vector3 Position;
+	Quadric Q;
+	unsigned int FirstReference;
+	unsigned int ReferencesCount;
+	bool IsBorder;
+};
+
+// Triangle using a vertex, vertex references are stored contiguously per vertex
+struct SimplifierReference
+{
+	unsigned int Triangle;
+	unsigned int Corner;
+};
+
+class QuadricSimplifier final
+{
+private:
+	static const unsigned int MAX_ITERATIONS = 100;
+	static const int AGGRESSIVENESS = 7;
+
+	DynamicArray<SimplifierTriangle> _triangles;
+	DynamicArray<SimplifierVertex> _vertices;
+	DynamicArray<SimplifierReference> _references;
+	DynamicArray<MeshBase::VertexType> _attributes;
+
+	DynamicArray<bool> _deleted0;
+	DynamicArray<bool> _deleted1;
+
+public:
+	QuadricSimplifier(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices);
+
+private:
+	double CalculateError(unsigned int vertex0, unsigned int vertex1, Vector3& result) const;
+	bool IsFlipped(const Vector3& position, unsigned int vertex1, const SimplifierVertex& v0, DynamicArray<bool>& deleted) const;
+	void UpdateTriangles(unsigned int vertex0, const SimplifierVertex& v, const DynamicArray<bool>& deleted, unsigned int& deletedTriangles);
+	void UpdateMesh(unsigned int iteration);
+	void FindBorders();
+
+public:
+	void Simplify(unsigned int targetTrianglesCount);
+	void GetResult(DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices) const;
+};
+
+QuadricSimplifier::QuadricSimplifier(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices) : _attributes(vertices)
+{
+	_vertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		_vertices[i].Position = vertices[i].Position;
+		_vertices[i].FirstReference = 0;
+		_vertices[i].ReferencesCount = 0;
+		_vertices[i].IsBorder = false;
+	}
+
+	_triangles.resize(indices.size() / 3);
+	for (size_t i = 0; i < _triangles.size(); ++i)
+	{
+		SimplifierTriangle& triangle = _triangles[i];
+		triangle.V[0] = indices[i * 3];
+		triangle.V[1] = indices[i * 3 + 1];
+		triangle.V[2] = indices[i * 3 + 2];
+		triangle.IsDeleted = false;
+		triangle.IsDirty = false;
+	}
+}
+
+double QuadricSimplifier::CalculateError(unsigned int vertex0, unsigned int vertex1, Vector3& result) const
+{
+	const SimplifierVertex& v0 = _vertices[vertex0];
+	const SimplifierVertex& v1 = _vertices[vertex1];
+	const Quadric q = v0.Q + v1.Q;
+
+	// Try to find optimal position (minimizing quadric error) first
+	const double determinant = q.Determinant(0, 1, 2, 1, 4, 5, 2, 5, 7);
+	if (std::abs(determinant) > 1e-12)
+	{
+		result.X = (float)(-1.0 / determinant * q.Determinant(1, 2, 3, 4, 5, 6, 5, 7, 8));
+		result.Y = (float)(1.0 / determinant * q.Determinant(0, 2, 3, 1, 5, 6, 2, 7, 8));
+		result.Z = (float)(-1.0 / determinant * q.Determinant(0, 1, 3, 1, 4, 6, 2, 5, 8));
+		return q.Error(result);
+	}
+
+	// Otherwise pick best of edge ends and its midpoint
+	const Vector3 midpoint = (v0.Position + v1.Position) * 0.5f;
+	const double error0 = q.Error(v0.Position);
+	const double error1 = q.Error(v1.Position);
+	const double errorMid = q.Error(midpoint);
+	const double error = Math::Min(error0, Math::Min(error1, errorMid));
+
+	if (error == error0)
+	{
+		result = v0.Position;
+	}
+	else if (error == error1)
+	{
+		result = v1.Position;
+	}
+	else
+	{
+		result = midpoint;
+	}
+
+	return error;
+}
+
+bool QuadricSimplifier::IsFlipped(const Vector3& position, unsigned int vertex1, const SimplifierVertex& v0, DynamicArray<bool>& deleted) const
+{
+	for (unsigned int k = 0; k < v0.ReferencesCount; ++k)
+	{
+		const SimplifierReference& reference = _references[v0.FirstReference + k];
+		const SimplifierTriangle& triangle = _triangles[reference.Triangle];
+		if (triangle.IsDeleted)
+		{
+			continue;
+		}
+
+		const unsigned int id1 = triangle.V[(reference.Corner + 1) % 3];
+		const unsigned int id2 = triangle.V[(reference.Corner + 2) % 3];
+
+		// Triangle shares collapsed edge, it will be removed
+		if (id1 == vertex1 || id2 == vertex1)
+		{
+			deleted[k] = true;
+			continue;
+		}
+
+		const Vector3 d1 = (_vertices[id1].Position - position).GetNormalizedSafe();
+		const Vector3 d2 = (_vertices[id2].Position - position).GetNormalizedSafe();
+		if (Math::Abs(Vector3::DotProduct(d1, d2)) > 0.999f)
+		{
+			return true;
+		}
+
+		const Vector3 normal = Vector3::CrossProduct(d1, d2).GetNormalizedSafe();
+		deleted[k] = false;
+		if (Vector3::DotProduct(normal, triangle.Normal) < 0.2f)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void QuadricSimplifier::UpdateTriangles(unsigned int vertex0, const SimplifierVertex& v, const DynamicArray<bool>& deleted, unsigned int& deletedTriangles)
+{
+	Vector3 position;
+	for (unsigned int k = 0; k < v.ReferencesCount; ++k)
+	{
+		// Copy, references array grows in this loop
+		const SimplifierReference reference = _references[v.FirstReference + k];
+		SimplifierTriangle& triangle = _triangles[reference.Triangle];
+		if (triangle.IsDeleted)
+		{
+			continue;
+		}
+
+		if (deleted[k])
+		{
+			triangle.IsDeleted = true;
+			++deletedTriangles;
+			continue;
+		}
+
+		triangle.V[reference.Corner] = vertex0;
+		triangle.IsDirty = true;
+		triangle.Errors[0] = CalculateError(triangle.V[0], triangle.V[1], position);
+		triangle.Errors[1] = CalculateError(triangle.V[1], triangle.V[2], position);
+		triangle.Errors[2] = CalculateError(triangle.V[2], triangle.V[0], position);
+		triangle.Errors[3] = Math::Min(triangle.Errors[0], Math::Min(triangle.Errors[1], triangle.Errors[2]));
+		_references.push_back(reference);
+	}
+}
+
+void QuadricSimplifier::UpdateMesh(unsigned int iteration)
+{
+	if (iteration > 0)
+	{
+		unsigned int dst = 0;
+		for (size_t i = 0; i < _triangles.size(); ++i)
+		{
+			if (!_triangles[i].IsDeleted)
+			{
+				_triangles[dst++] = _triangles[i];
+			}
+		}
+		_triangles.resize(dst);
+	}
+
+	// Rebuild vertex to triangles references
+	for (auto& vertex : _vertices)
+	{
+		vertex.FirstReference = 0;
+		vertex.ReferencesCount = 0;
+	}
+	for (const auto& triangle : _triangles)
+	{
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			++_vertices[triangle.V[j]].ReferencesCount;
+		}
+	}
+
+	unsigned int firstReference = 0;
+	for (auto& vertex : _vertices)
+	{
+		vertex.FirstReference = firstReference;
+		firstReference += vertex.ReferencesCount;
+		vertex.ReferencesCount = 0;
+	}
+
+	_references.resize(_triangles.size() * 3);
+	for (unsigned int i = 0; i < (unsigned int)_triangles.size(); ++i)
+	{
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			SimplifierVertex& vertex = _vertices[_triangles[i].V[j]];
+			SimplifierReference& reference = _references[vertex.FirstReference + vertex.ReferencesCount];
+			reference.Triangle = i;
+			reference.Corner = j;
+			++vertex.ReferencesCount;
+		}
+	}
+
+	if (iteration > 0)
+	{
+		return;
+	}
+
+	// First iteration: calculate quadrics from triangle planes and initial errors
+	FindBorders();
+
+	for (auto& triangle : _triangles)
+	{
+		const Vector3& p0 = _vertices[triangle.V[0]].Position;
+		const Vector3& p1 = _vertices[triangle.V[1]].Position;
+		const Vector3& p2 = _vertices[triangle.V[2]].Position;
+		triangle.Normal = Vector3::CrossProduct(p1 - p0, p2 - p0).GetNormalizedSafe();
+
+		const Quadric plane(triangle.Normal.X, triangle.Normal.Y, triangle.Normal.Z, -Vector3::DotProduct(triangle.Normal, p0));
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			_vertices[triangle.V[j]].Q = _vertices[triangle.V[j]].Q + plane;
+		}
+	}
+
+	Vector3 position;
+	for (auto& triangle : _triangles)
+	{
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			triangle.Errors[j] = CalculateError(triangle.V[j], triangle.V[(j + 1) % 3], position);
+		}
+		triangle.Errors[3] = Math::Min(triangle.Errors[0], Math::Min(triangle.Errors[1], triangle.Errors[2]));
+	}
+}
+
+void QuadricSimplifier::FindBorders()
+{
+	// Edge used by a single triangle is a border, both its vertices are locked
+	DynamicArray<unsigned int> neighbours;
+	DynamicArray<unsigned int> neighboursCounts;
+
+	for (auto& vertex : _vertices)
+	{
+		neighbours.clear();
+		neighboursCounts.clear();
+
+		for (unsigned int k = 0; k < vertex.ReferencesCount; ++k)
+		{
+			const SimplifierTriangle& triangle = _triangles[_references[vertex.FirstReference + k].Triangle];
+			for (unsigned char j = 0; j < 3; ++j)
+			{
+				const unsigned int id = triangle.V[j];
+				auto found = std::find(neighbours.begin(), neighbours.end(), id);
+				if (found == neighbours.end())
+				{
+					neighbours.push_back(id);
+					neighboursCounts.push_back(1);
+				}
+				else
+				{
+					++neighboursCounts[found - neighbours.begin()];
+				}
+			}
+		}
+
+		for (size_t j = 0; j < neighbours.size(); ++j)
+		{
+			if (neighboursCounts[j] == 1)
+			{
+				_vertices[neighbours[j]].IsBorder = true;
+			}
+		}
+	}
+}
+
+void QuadricSimplifier::Simplify(unsigned int targetTrianglesCount)
+{
+	const unsigned int trianglesCount = (unsigned int)_triangles.size();
+	unsigned int deletedTriangles = 0;
+
+	for (unsigned int iteration = 0; iteration < MAX_ITERATIONS; ++iteration)
+	{
+		if (trianglesCount - deletedTriangles <= targetTrianglesCount)
+		{
+			break;
+		}
+
+		// Compacting and rebuilding references is expensive, so it's done every few iterations
+		if (iteration % 5 == 0)
+		{
+			UpdateMesh(iteration);
+		}
+
+		for (auto& triangle : _triangles)
+		{
+			triangle.IsDirty = false;
+		}
+
+		// Threshold grows with iterations, so the cheapest collapses are done first
+		const double threshold = 0.000000001 * pow(double(iteration + 3), AGGRESSIVENESS);
+
+		for (auto& triangle : _triangles)
+		{
+			if (triangle.Errors[3] > threshold || triangle.IsDeleted || triangle.IsDirty)
+			{
+				continue;
+			}
+
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				if (triangle.Errors[j] > threshold)
+				{
+					continue;
+				}
+
+				const unsigned int i0 = triangle.V[j];
+				const unsigned int i1 = triangle.V[(j + 1) % 3];
+				SimplifierVertex& v0 = _vertices[i0];
+				SimplifierVertex& v1 = _vertices[i1];
+
+				if (v0.IsBorder || v1.IsBorder)
+				{
+					continue;
+				}
+
+				Vector3 position;
+				CalculateError(i0, i1, position);
+
+				_deleted0.assign(v0.ReferencesCount, false);
+				_deleted1.assign(v1.ReferencesCount, false);
+				if (IsFlipped(position, i1, v0, _deleted0) || IsFlipped(position, i0, v1, _deleted1))
+				{
+					continue;
+				}
+
+				// Collapse i1 into i0
+				v0.Position = position;
+				v0.Q = v1.Q + v0.Q;
+
+				const unsigned int firstReference = (unsigned int)_references.size();
+				UpdateTriangles(i0, v0, _deleted0, deletedTriangles);
+				UpdateTriangles(i0, v1, _deleted1, deletedTriangles);
+
+				const unsigned int referencesCount = (unsigned int)_references.size() - firstReference;
+				if (referencesCount <= v0.ReferencesCount)
+				{
+					// Reuse old references range to save memory
+					if (referencesCount > 0)
+					{
+						std::copy(_references.begin() + firstReference, _references.end(), _references.begin() + v0.FirstReference);
+					}
+					_references.resize(firstReference);
+				}
+				else
+				{
+					v0.FirstReference = firstReference;
+				}
+				v0.ReferencesCount = referencesCount;
+				break;
+			}
+
+			if (trianglesCount - deletedTriangles <= targetTrianglesCount)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void QuadricSimplifier::GetResult(DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices) const
+{
+	vertices.clear();
+	indices.clear();
+
+	// Drop vertices which are not used anymore and remap indices
+	DynamicArray<unsigned int> remap(_vertices.size(), (unsigned int)-1);
+	for (const auto& triangle : _triangles)
+	{
+		if (triangle.IsDeleted)
+		{
+			continue;
+		}
+
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			const unsigned int vertex = triangle.V[j];
+			if (remap[vertex] == (unsigned int)-1)
+			{
+				remap[vertex] = (unsigned int)vertices.size();
+
+				MeshBase::VertexType simplifiedVertex = _attributes[vertex];
+				simplifiedVertex.Position = _vertices[vertex].Position;
+				vertices.push_back(simplifiedVertex);
+			}
+			indices.push_back(remap[vertex]);
+		}
+	}
+}
+
+bool MeshSimplifier::Simplify(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices, float targetRatio,
+							  DynamicArray<MeshBase::VertexType>& simplifiedVertices, DynamicArray<unsigned int>& simplifiedIndices)
+{
+	DT_ASSERT(indices.size() % 3 == 0, DT_TEXT("Only triangle lists can be simplified"));
+
+	const unsigned int targetTrianglesCount = (unsigned int)(indices.size() / 3 * Math::Clamp(targetRatio, 0.0f, 1.0f));
+
+	QuadricSimplifier simplifier(vertices, indices);
+	simplifier.Simplify(targetTrianglesCount);
+	simplifier.GetResult(simplifiedVertices, simplifiedIndices);
+
+	return simplifiedIndices.size() > 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Rendering/MeshBase.h"
+
+// Mesh simplification by quadric error metric edge collapses (Garland & Heckbert)
+// Edges on borders (including UV and normal seams, where vertices are split) are never collapsed,
+// so silhouettes of open meshes and texture seams stay intact
+class MeshSimplifier final
+{
+public:
+	// Collapses edges until mesh has at most targetRatio of original triangles (or no more edges can be collapsed)
+	// Returns false if simplified mesh would be empty
+	static bool Simplify(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices, float targetRatio,
+						 DynamicArray<MeshBase::VertexType>& simplifiedVertices, DynamicArray<unsigned int>& simplifiedIndices);
+};
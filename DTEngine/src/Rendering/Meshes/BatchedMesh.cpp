@@ -0,0 +1,37 @@
+#include "BatchedMesh.h"
+
+BatchedMesh::BatchedMesh(DynamicArray<VertexType>&& vertices, DynamicArray<unsigned int>&& indices) : MeshBase()
+{
+	_vertices = std::move(vertices);
+	_indices = std::move(indices);
+}
+
+BatchedMesh::BatchedMesh(const BatchedMesh& other) : MeshBase(other)
+{
+	_vertices = other._vertices;
+	_indices = other._indices;
+}
+
+BatchedMesh::~BatchedMesh()
+{
+	// Batched meshes are not registered in resources, so nobody else releases their buffers
+	Shutdown();
+}
+
+bool BatchedMesh::Initialize()
+{
+	_verticesCount = (unsigned int)_vertices.size();
+	_indicesCount = (unsigned int)_indices.size();
+
+	if (_verticesCount == 0 || _indicesCount == 0)
+	{
+		return false;
+	}
+
+	const bool result = CreateBuffers(_vertices.data(), _indices.data());
+
+	// Batches are not registered in resources, so they are not trimmed with other meshes and release their own data
+	ReleaseCPUData();
+
+	return result;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Rendering/MeshBase.h"
+
+// Mesh merged from several meshes by static batching
+// Vertices are already in world space, so it should be rendered with identity transform
+class BatchedMesh final : public MeshBase
+{
+public:
+	BatchedMesh(DynamicArray<VertexType>&& vertices, DynamicArray<unsigned int>&& indices);
+	BatchedMesh(const BatchedMesh& other);
+	virtual ~BatchedMesh();
+
+	virtual bool Initialize() override;
+};
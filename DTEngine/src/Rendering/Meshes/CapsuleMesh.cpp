@@ -11,18 +11,38 @@ CapsuleMesh::~CapsuleMesh()
 
 bool CapsuleMesh::Initialize()
 {
-	const unsigned int numRings = 8;
-	const unsigned int numSegments = 24;
+	DynamicArray<VertexType> vertices;
+	DynamicArray<unsigned int> indices;
+
+	Generate(8, 24, vertices, indices);
+	_verticesCount = (unsigned int)vertices.size();
+	_indicesCount = (unsigned int)indices.size();
+
+	if (!CreateBuffers(vertices.data(), indices.data()))
+	{
+		return false;
+	}
+
+	// Less detailed versions for distant capsules
+	Generate(4, 12, vertices, indices);
+	if (!AddLOD(vertices, indices, 0.3f))
+	{
+		return false;
+	}
+
+	Generate(2, 8, vertices, indices);
+	return AddLOD(vertices, indices, 0.1f);
+}
+
+void CapsuleMesh::Generate(unsigned int numRings, unsigned int numSegments, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices)
+{
 	const unsigned int numSegmentsHeight = 1;
 
 	const float radius = 0.25f;
 	const float height = 0.5f;
 
-	_verticesCount = (2 * numRings + 2) * (numSegments + 1) + (numSegmentsHeight - 1) * (numSegments + 1);
-	_indicesCount = (2 * numRings + 1) * (numSegments + 1) * 6 + (numSegmentsHeight - 1) * (numSegments + 1) * 6;
-
-	VertexType* vertices = new VertexType[_verticesCount];
-	unsigned int* indices = new unsigned int[_indicesCount];
+	vertices.resize((2 * numRings + 2) * (numSegments + 1) + (numSegmentsHeight - 1) * (numSegments + 1));
+	indices.resize((2 * numRings + 1) * (numSegments + 1) * 6 + (numSegmentsHeight - 1) * (numSegments + 1) * 6);
 
 	const float deltaRingAngle = Math::PI_DIV_2 / numRings;
 	const float deltaSegAngle = Math::TWO_PI / numSegments;
@@ -117,11 +137,4 @@ bool CapsuleMesh::Initialize()
 			++index;
 		}
 	}
-
-	bool result = CreateBuffers(vertices, indices);
-
-	delete[] vertices;
-	delete[] indices;
-
-	return result;
 }
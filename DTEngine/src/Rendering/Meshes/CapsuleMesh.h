@@ -10,4 +10,7 @@ public:
 	virtual ~CapsuleMesh();
 
 	virtual bool Initialize() override;
+
+private:
+	static void Generate(unsigned int numRings, unsigned int numSegments, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices);
 };
\ No newline at end of file
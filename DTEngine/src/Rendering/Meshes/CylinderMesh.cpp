@@ -11,13 +11,34 @@ CylinderMesh::~CylinderMesh()
 
 bool CylinderMesh::Initialize()
 {
-	const unsigned int baseTriangles = 30;
-	_verticesCount = (baseTriangles + 1) * 2;
-	// 3 for each triangle in bottom base, 3 for each triangle in top base, 6 for each side quad
-	_indicesCount = baseTriangles * 12;
+	DynamicArray<VertexType> vertices;
+	DynamicArray<unsigned int> indices;
+
+	Generate(30, vertices, indices);
+	_verticesCount = (unsigned int)vertices.size();
+	_indicesCount = (unsigned int)indices.size();
+
+	if (!CreateBuffers(vertices.data(), indices.data()))
+	{
+		return false;
+	}
 
-	VertexType* vertices = new VertexType[_verticesCount];
-	unsigned int* indices = new unsigned int[_indicesCount];
+	// Less detailed versions for distant cylinders
+	Generate(16, vertices, indices);
+	if (!AddLOD(vertices, indices, 0.3f))
+	{
+		return false;
+	}
+
+	Generate(8, vertices, indices);
+	return AddLOD(vertices, indices, 0.1f);
+}
+
+void CylinderMesh::Generate(unsigned int baseTriangles, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices)
+{
+	vertices.assign((baseTriangles + 1) * 2, VertexType());
+	// 3 for each triangle in bottom base, 3 for each triangle in top base, 6 for each side quad
+	indices.resize(baseTriangles * 12);
 
 	// Bottom center
 	vertices[baseTriangles].Position = Vector3(0.0f, 0.0f, 0.0f);
@@ -59,11 +80,4 @@ bool CylinderMesh::Initialize()
 		indices[(baseTriangles + i) * 6 + 4] = baseTriangles + 1 + i;
 		indices[(baseTriangles + i) * 6 + 5] = baseTriangles + 1 + ((i + 1) % baseTriangles);
 	}
-
-	const bool result = CreateBuffers(vertices, indices);
-
-	delete[] vertices;
-	delete[] indices;
-
-	return result;
 }
@@ -10,4 +10,7 @@ public:
 	virtual ~CylinderMesh();
 
 	virtual bool Initialize() override;
+
+private:
+	static void Generate(unsigned int baseTriangles, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices);
 };
\ No newline at end of file
@@ -10,19 +10,39 @@ SphereMesh::~SphereMesh()
 {}
 
 bool SphereMesh::Initialize()
+{
+	DynamicArray<VertexType> vertices;
+	DynamicArray<unsigned int> indices;
+
+	Generate(12, 12, vertices, indices);
+	_verticesCount = (unsigned int)vertices.size();
+	_indicesCount = (unsigned int)indices.size();
+
+	if (!CreateBuffers(vertices.data(), indices.data()))
+	{
+		return false;
+	}
+
+	// Less detailed versions for distant spheres
+	Generate(8, 8, vertices, indices);
+	if (!AddLOD(vertices, indices, 0.3f))
+	{
+		return false;
+	}
+
+	Generate(5, 5, vertices, indices);
+	return AddLOD(vertices, indices, 0.1f);
+}
+
+void SphereMesh::Generate(unsigned int rings, unsigned int sectors, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices)
 {
 	const float radius = 0.5f;
-	const unsigned int rings = 12;
-	const unsigned int sectors = 12;
 
 	const float R = 1.0f / (float)(rings - 1);
 	const float S = 1.0f / (float)(sectors - 1);
 
-	_verticesCount = rings * sectors;
-	_indicesCount = rings * sectors * 6;
-
-	VertexType* vertices = new VertexType[_verticesCount];
-	unsigned int* indices = new unsigned int[_indicesCount];
+	vertices.resize(rings * sectors);
+	indices.resize((rings - 1) * (sectors - 1) * 6);
 
 	unsigned int i = 0;
 	unsigned int j = 0;
@@ -31,7 +51,7 @@ bool SphereMesh::Initialize()
 		const float sinR = sin(Math::PI * r * R);
 		const float sinRMinusPiDiv2 = sin(-Math::PI_DIV_2 + Math::PI * r * R);
 
-		for (unsigned int s = 0; s < sectors; ++s, ++i, j += 6)
+		for (unsigned int s = 0; s < sectors; ++s, ++i)
 		{
 			const float y = sinRMinusPiDiv2 * radius;
 			const float x = cos(Math::TWO_PI * s * S) * sinR * radius;
@@ -49,14 +69,8 @@ bool SphereMesh::Initialize()
 				indices[j + 3] = r * sectors + (s + 1);
 				indices[j + 4] = (r + 1) * sectors + s;
 				indices[j + 5] = (r + 1) * sectors + (s + 1);
+				j += 6;
 			}
 		}
 	}
-
-	const bool result = CreateBuffers(vertices, indices);
-
-	delete[] vertices;
-	delete[] indices;
-
-	return result;
-}
+}
\ No newline at end of file
@@ -10,4 +10,7 @@ public:
 	virtual ~SphereMesh();
 
 	virtual bool Initialize() override;
+
+private:
+	static void Generate(unsigned int rings, unsigned int sectors, DynamicArray<VertexType>& vertices, DynamicArray<unsigned int>& indices);
 };
\ No newline at end of file
@@ -1,176 +1,436 @@
 #include "StaticMesh.h"
 
 #include "Debug/Debug.h"
+#include "Rendering/MeshOptimizer.h"
+#include "Rendering/MeshSimplifier.h"
+#include "Rendering/OBJImporter.h"
+#include "ResourceManagement/AssetID.h"
+#include "ResourceManagement/CacheEntry.h"
+#include "ResourceManagement/FileSystem.h"
 #include "Utility/String.h"
 
+#include <cstring>
 #include <fstream>
-#include <sstream>
-#include <vector>
-#include <unordered_map>
+
+// Simplified LODs as ratio of original triangles count and screen size from which they are used
+static const float LODS_TRIANGLES_RATIOS[] = {0.5f, 0.25f};
+static const float LODS_SCREEN_SIZES[] = {0.3f, 0.1f};
+static const unsigned int LODS_COUNT = sizeof(LODS_TRIANGLES_RATIOS) / sizeof(float);
+
+static const String LODS_CACHE_EXTENSION = DT_TEXT(".lods");
+static const unsigned int LODS_CACHE_MAGIC = 0x444F4C44; // "DLOD"
+// Has to be bumped whenever simplification, optimization or the settings above change, so stale caches are regenerated
+static const unsigned int LODS_CACHE_VERSION = 2;
+
+static const String COOKED_MESH_EXTENSION = DT_TEXT("dtmesh");
+static const unsigned int COOKED_MESH_MAGIC = 0x534D5444; // "DTMS"
+// Has to be bumped whenever cooked mesh layout or MeshBase::VertexType change
+static const unsigned int COOKED_MESH_VERSION = 1;
+// Sections of cooked meshes are aligned, so they can be used in place when the file is mapped
+static const unsigned int COOKED_MESH_ALIGNMENT = 16;
+
+// Layout of .dtmesh files:
+// header, submeshes, LOD headers and then aligned vertices and indices of the mesh followed by the ones of each LOD
+struct CookedMeshHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned int VerticesCount;
+	unsigned int IndicesCount;
+	unsigned int SubMeshesCount;
+	unsigned int LODsCount;
+	Vector3 BoundsMin;
+	Vector3 BoundsMax;
+};
+
+struct CookedLODHeader
+{
+	float ScreenSize;
+	unsigned int VerticesCount;
+	unsigned int IndicesCount;
+	unsigned int Reserved;
+};
+
+// Geometry of one level of cooked mesh, pointing into its data
+struct CookedMeshLevel
+{
+	const MeshBase::VertexType* Vertices;
+	const unsigned int* Indices;
+};
+
+// Pointers into mapped cooked mesh, level 0 is the mesh itself
+struct CookedMeshView
+{
+	const CookedMeshHeader* Header;
+	const StaticMesh::SubMesh* SubMeshes;
+	const CookedLODHeader* LODs;
+	DynamicArray<CookedMeshLevel> Levels;
+};
+
+static inline size_t AlignCookedOffset(size_t offset)
+{
+	return (offset + COOKED_MESH_ALIGNMENT - 1) & ~(size_t)(COOKED_MESH_ALIGNMENT - 1);
+}
 
 StaticMesh::StaticMesh() : MeshBase()
 {}
 
-StaticMesh::StaticMesh(const StaticMesh& other) : MeshBase(other)
+StaticMesh::StaticMesh(const StaticMesh& other) : MeshBase(other), _subMeshes(other._subMeshes)
 {}
 
 StaticMesh::~StaticMesh()
 {}
 
-struct Face
+bool StaticMesh::LoadFromOBJ(const String& path)
 {
-	unsigned int positionIndex;
-	unsigned int uvIndex;
-	unsigned int normalIndex;
+	FileView file;
+	if (!gFileSystem.MapFile(path, file))
+	{
+		return false;
+	}
 
-	inline bool operator==(const Face& other) const
+	if (!OBJImporter::Import((const char*)file.GetData(), file.GetSize(), _vertices, _indices, _subMeshes))
 	{
-		return positionIndex == other.positionIndex && uvIndex == other.uvIndex && normalIndex == other.normalIndex;
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Mesh (%s) references vertices it doesn't define"), path.c_str());
+		return false;
 	}
-};
 
-struct FaceHasher
+	_verticesCount = (unsigned int)_vertices.size();
+	_indicesCount = (unsigned int)_indices.size();
+
+	return true;
+}
+
+// Cache is valid only for the mesh it was generated from
+static unsigned long long HashMeshData(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices)
+{
+	const unsigned long long hash = HashBytes(vertices.data(), vertices.size() * sizeof(MeshBase::VertexType));
+	return HashBytes(indices.data(), indices.size() * sizeof(unsigned int), hash);
+}
+
+// Fails if the cache is truncated
+static bool ReadLODsCacheData(const FileView& file, size_t& offset, void* destination, size_t size)
 {
-	inline std::size_t operator()(const Face& key) const
+	if (file.GetSize() - offset < size)
 	{
-		return (((key.positionIndex * 0x1f1f1f1f) ^ key.normalIndex) * 0x1f1f1f1f) ^ key.uvIndex;
+		return false;
 	}
-};
 
-void ProcessFace(Face& face, const String& faceDefinition)
+	memcpy(destination, file.GetData() + offset, size);
+	offset += size;
+	return true;
+}
+
+// Read through the file system, so caches packed together with their meshes are used as well
+static bool LoadLODsCache(const String& path, unsigned long long sourceHash, DynamicArray<StaticMesh::LODData>& lods)
 {
-	String positionIndex;
-	String uvIndex;
-	String normalIndex;
+	FileView file;
+	if (!gFileSystem.MapFile(path, file))
+	{
+		return false;
+	}
 
-	unsigned int i = 0;
-	while (faceDefinition[i] != '/')
+	size_t offset = 0;
+	CacheEntryHeader header;
+	unsigned int lodsCount = 0;
+	if (!ReadLODsCacheData(file, offset, &header, sizeof(header)) || !ReadLODsCacheData(file, offset, &lodsCount, sizeof(lodsCount)))
 	{
-		positionIndex += faceDefinition[i];
-		++i;
+		return false;
 	}
-	++i;
-	while (faceDefinition[i] != '/')
+
+	// Hash is stored as well, so cache of another version of the mesh is never used
+	if (header.Magic != LODS_CACHE_MAGIC || header.Version != LODS_CACHE_VERSION || header.Key != sourceHash || lodsCount > LODS_COUNT)
 	{
-		uvIndex += faceDefinition[i];
-		++i;
+		return false;
 	}
-	++i;
-	const unsigned int length = (unsigned int)faceDefinition.size();
-	while (faceDefinition[i] != '/' && i < length)
+
+	lods.resize(lodsCount);
+	for (StaticMesh::LODData& lod : lods)
 	{
-		normalIndex += faceDefinition[i];
-		++i;
+		unsigned int verticesCount = 0;
+		unsigned int indicesCount = 0;
+		if (!ReadLODsCacheData(file, offset, &lod.ScreenSize, sizeof(lod.ScreenSize)) || !ReadLODsCacheData(file, offset, &verticesCount, sizeof(verticesCount)) ||
+			!ReadLODsCacheData(file, offset, &indicesCount, sizeof(indicesCount)))
+		{
+			return false;
+		}
+
+		if (file.GetSize() - offset < (size_t)verticesCount * sizeof(MeshBase::VertexType) + (size_t)indicesCount * sizeof(unsigned int))
+		{
+			return false;
+		}
+
+		lod.Vertices.resize(verticesCount);
+		lod.Indices.resize(indicesCount);
+		ReadLODsCacheData(file, offset, lod.Vertices.data(), verticesCount * sizeof(MeshBase::VertexType));
+		ReadLODsCacheData(file, offset, lod.Indices.data(), indicesCount * sizeof(unsigned int));
 	}
-	++i;
 
-	face.positionIndex = std::stoul(positionIndex) - 1;
-	face.uvIndex = std::stoul(uvIndex) - 1;
-	face.normalIndex = std::stoul(normalIndex) - 1;
+	return true;
 }
 
-bool StaticMesh::LoadFromOBJ(const String& path)
+static bool SaveLODsCache(const String& path, unsigned long long sourceHash, const DynamicArray<StaticMesh::LODData>& lods)
 {
-	std::wifstream file;
-	file.open(path, std::ios::in);
+	return SaveCacheEntry(path, {LODS_CACHE_MAGIC, LODS_CACHE_VERSION, sourceHash}, [&lods](std::ofstream& file)
+	{
+		const unsigned int lodsCount = (unsigned int)lods.size();
+		file.write((const char*)&lodsCount, sizeof(lodsCount));
 
-	if (!file.is_open())
+		for (const StaticMesh::LODData& lod : lods)
+		{
+			const unsigned int verticesCount = (unsigned int)lod.Vertices.size();
+			const unsigned int indicesCount = (unsigned int)lod.Indices.size();
+			file.write((const char*)&lod.ScreenSize, sizeof(lod.ScreenSize));
+			file.write((const char*)&verticesCount, sizeof(verticesCount));
+			file.write((const char*)&indicesCount, sizeof(indicesCount));
+			file.write((const char*)lod.Vertices.data(), verticesCount * sizeof(MeshBase::VertexType));
+			file.write((const char*)lod.Indices.data(), indicesCount * sizeof(unsigned int));
+		}
+	});
+}
+
+// Stops at the first LOD which cannot be simplified enough, LODs are optimized for upload as well
+static void SimplifyLODs(const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices, DynamicArray<StaticMesh::LODData>& lods)
+{
+	lods.clear();
+
+	size_t previousIndicesCount = indices.size();
+	for (unsigned int i = 0; i < LODS_COUNT; ++i)
 	{
-		return false;
+		StaticMesh::LODData lod;
+		lod.ScreenSize = LODS_SCREEN_SIZES[i];
+		if (!MeshSimplifier::Simplify(vertices, indices, LODS_TRIANGLES_RATIOS[i], lod.Vertices, lod.Indices))
+		{
+			break;
+		}
+
+		// Mesh consisting mostly of borders and seams can't be simplified much, such LOD is not worth a draw call switch
+		if (lod.Indices.size() * 4 > previousIndicesCount * 3)
+		{
+			break;
+		}
+
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+		MeshOptimizer::Optimize(lod.Vertices.data(), (unsigned int)lod.Vertices.size(), lod.Indices.data(), (unsigned int)lod.Indices.size(), acmrBefore, acmrAfter);
+
+		previousIndicesCount = lod.Indices.size();
+		lods.push_back(std::move(lod));
 	}
+}
 
-	std::vector<Vector3> positions;
-	std::vector<Vector3> normals;
-	std::vector<Vector2> uvs;
-	std::vector<Face> faces;
+void StaticMesh::CreateLODs()
+{
+	const String cachePath = _path + LODS_CACHE_EXTENSION;
+	const unsigned long long sourceHash = HashMeshData(_vertices, _indices);
 
-	String line;
-	while (std::getline(file, line))
+	if (!LoadLODsCache(cachePath, sourceHash, _sourceLODs))
 	{
-		if (line.length() == 0)
+		SimplifyLODs(_vertices, _indices, _sourceLODs);
+
+		// Games running from packs don't write next to their data, caches are meant to be packed with the meshes
+		if (!gFileSystem.HasMountedPacks() && !SaveLODsCache(cachePath, sourceHash, _sourceLODs))
 		{
-			continue;
+			gDebug.Printf(LogVerbosity::Warning, CHANNEL_ENGINE, DT_TEXT("Failed to save LODs cache (%s)"), cachePath.c_str());
 		}
+	}
+}
+
+// Triangles are reordered only within their submeshes, vertices are shared by all of them
+static void OptimizeSubMeshes(DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices, const DynamicArray<StaticMesh::SubMesh>& subMeshes, BoundingBox& boundingBox)
+{
+	for (const StaticMesh::SubMesh& subMesh : subMeshes)
+	{
+		MeshOptimizer::OptimizeVertexCache(indices.data() + subMesh.IndexStart, subMesh.IndicesCount, (unsigned int)vertices.size());
+		MeshOptimizer::OptimizeOverdraw(indices.data() + subMesh.IndexStart, subMesh.IndicesCount, vertices.data(), (unsigned int)vertices.size());
+	}
+	MeshOptimizer::OptimizeVertexFetch(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size());
+
+	static const auto positionGetter = [](const MeshBase::VertexType& vertex) -> const Vector3&{return vertex.Position;};
+	boundingBox.CalculateMinMax<MeshBase::VertexType>(vertices.data(), (unsigned int)vertices.size(), positionGetter);
+}
+
+void StaticMesh::PrepareSource()
+{
+	// Initialize reports empty meshes
+	if (_vertices.empty() || _indices.empty())
+	{
+		return;
+	}
+
+	// Submeshes imported from usemtl are kept, triangles are reordered only within them
+	OptimizeSubMeshes(_vertices, _indices, _subMeshes, _sourceBoundingBox);
+	CreateLODs();
+}
+
+// Validates layout of cooked mesh and points the view into its data
+static bool ReadCookedMesh(const unsigned char* data, size_t size, CookedMeshView& view)
+{
+	if (size < sizeof(CookedMeshHeader))
+	{
+		return false;
+	}
+
+	view.Header = (const CookedMeshHeader*)data;
+	const CookedMeshHeader& header = *view.Header;
+	if (header.Magic != COOKED_MESH_MAGIC || header.Version != COOKED_MESH_VERSION || header.LODsCount >= MeshBase::MAX_LODS)
+	{
+		return false;
+	}
+
+	size_t offset = sizeof(CookedMeshHeader);
+	view.SubMeshes = (const StaticMesh::SubMesh*)(data + offset);
+	offset += (size_t)header.SubMeshesCount * sizeof(StaticMesh::SubMesh);
+	view.LODs = (const CookedLODHeader*)(data + offset);
+	offset += (size_t)header.LODsCount * sizeof(CookedLODHeader);
+	if (offset > size)
+	{
+		return false;
+	}
+
+	view.Levels.resize(1 + header.LODsCount);
+	for (unsigned int i = 0; i <= header.LODsCount; ++i)
+	{
+		const size_t verticesCount = i == 0 ? header.VerticesCount : view.LODs[i - 1].VerticesCount;
+		const size_t indicesCount = i == 0 ? header.IndicesCount : view.LODs[i - 1].IndicesCount;
 
-		if (line[0] == 'v')
+		offset = AlignCookedOffset(offset);
+		view.Levels[i].Vertices = (const MeshBase::VertexType*)(data + offset);
+		offset += verticesCount * sizeof(MeshBase::VertexType);
+
+		offset = AlignCookedOffset(offset);
+		view.Levels[i].Indices = (const unsigned int*)(data + offset);
+		offset += indicesCount * sizeof(unsigned int);
+
+		if (offset > size)
 		{
-			std::wistringstream s(line.substr(2));
-			if (line[1] == ' ')
-			{
-				Vector3 position;
-				s >> position.X;
-				s >> position.Y;
-				s >> position.Z;
-				positions.push_back(position);
-			}
-			else if (line[1] == 'n')
-			{
-				Vector3 normal;
-				s >> normal.X;
-				s >> normal.Y;
-				s >> normal.Z;
-				normals.push_back(normal);
-			}
-			else if (line[1] == 't')
-			{
-				Vector2 uv;
-				s >> uv.X;
-				s >> uv.Y;
-				uvs.push_back(uv);
-			}
+			return false;
 		}
-		else if (line[0] == 'f')
+	}
+
+	for (unsigned int i = 0; i < header.SubMeshesCount; ++i)
+	{
+		const StaticMesh::SubMesh& subMesh = view.SubMeshes[i];
+		if (subMesh.IndexStart > header.IndicesCount || subMesh.IndicesCount > header.IndicesCount - subMesh.IndexStart)
 		{
-			std::wistringstream s(line.substr(2));
-			String faceDef1, faceDef2, faceDef3;
-			s >> faceDef1;
-			s >> faceDef2;
-			s >> faceDef3;
-			Face f1, f2, f3;
-			ProcessFace(f1, faceDef1);
-			ProcessFace(f2, faceDef2);
-			ProcessFace(f3, faceDef3);
-			faces.push_back(f1);
-			faces.push_back(f2);
-			faces.push_back(f3);
+			return false;
 		}
 	}
 
-	std::list<VertexType> verticesList;
-	_vertices.clear();
-	_indices.clear();
+	return true;
+}
 
-	std::unordered_map<Face, std::list<VertexType>::iterator, FaceHasher> face2Vertex;
+static void WriteCookedPadding(std::ofstream& file)
+{
+	static const char ZEROS[COOKED_MESH_ALIGNMENT] = {0};
+	const size_t offset = (size_t)file.tellp();
+	file.write(ZEROS, AlignCookedOffset(offset) - offset);
+}
 
-	const unsigned int facesCount = (unsigned int)faces.size();
-	unsigned int k = 0;
-	for (unsigned int i = 0; i < facesCount; ++i)
+static bool SaveCookedMesh(const String& path, const DynamicArray<MeshBase::VertexType>& vertices, const DynamicArray<unsigned int>& indices,
+						   const DynamicArray<StaticMesh::SubMesh>& subMeshes, const BoundingBox& boundingBox, const DynamicArray<StaticMesh::LODData>& lods)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
 	{
-		auto found = face2Vertex.find(faces[i]);
-		if (found == face2Vertex.end())
-		{
-			_indices.push_back(k);
+		return false;
+	}
+
+	const CookedMeshHeader header = {COOKED_MESH_MAGIC, COOKED_MESH_VERSION, (unsigned int)vertices.size(), (unsigned int)indices.size(),
+									 (unsigned int)subMeshes.size(), (unsigned int)lods.size(), boundingBox.GetMin(), boundingBox.GetMax()};
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)subMeshes.data(), subMeshes.size() * sizeof(StaticMesh::SubMesh));
+	for (const StaticMesh::LODData& lod : lods)
+	{
+		const CookedLODHeader lodHeader = {lod.ScreenSize, (unsigned int)lod.Vertices.size(), (unsigned int)lod.Indices.size(), 0};
+		file.write((const char*)&lodHeader, sizeof(lodHeader));
+	}
 
-			VertexType v;
-			v.Position = positions[faces[i].positionIndex];
-			v.Normal = normals[faces[i].normalIndex];
-			v.UV = uvs[faces[i].uvIndex];
-			_vertices.push_back(v);
-			verticesList.push_back(v);
-			face2Vertex.insert({faces[i], --verticesList.end()});
+	WriteCookedPadding(file);
+	file.write((const char*)vertices.data(), vertices.size() * sizeof(MeshBase::VertexType));
+	WriteCookedPadding(file);
+	file.write((const char*)indices.data(), indices.size() * sizeof(unsigned int));
+	for (const StaticMesh::LODData& lod : lods)
+	{
+		WriteCookedPadding(file);
+		file.write((const char*)lod.Vertices.data(), lod.Vertices.size() * sizeof(MeshBase::VertexType));
+		WriteCookedPadding(file);
+		file.write((const char*)lod.Indices.data(), lod.Indices.size() * sizeof(unsigned int));
+	}
 
-			++k;
-		}
-		else
+	return !file.fail();
+}
+
+bool StaticMesh::LoadCooked(const String& path)
+{
+	if (!gFileSystem.MapFile(path, _cookedData))
+	{
+		return false;
+	}
+
+	CookedMeshView view;
+	if (!ReadCookedMesh(_cookedData.GetData(), _cookedData.GetSize(), view))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cooked mesh (%s) is corrupted or has been cooked by another version"), path.c_str());
+		_cookedData.Release();
+		return false;
+	}
+
+	_verticesCount = view.Header->VerticesCount;
+	_indicesCount = view.Header->IndicesCount;
+	_subMeshes.assign(view.SubMeshes, view.SubMeshes + view.Header->SubMeshesCount);
+
+	return true;
+}
+
+bool StaticMesh::InitializeCooked()
+{
+	// Layout has been validated in Load already
+	CookedMeshView view;
+	ReadCookedMesh(_cookedData.GetData(), _cookedData.GetSize(), view);
+
+	if (_verticesCount == 0 || _indicesCount == 0)
+	{
+		return false;
+	}
+
+	const BoundingBox boundingBox(view.Header->BoundsMin, view.Header->BoundsMax);
+	if (!CreateOptimizedBuffers(view.Levels[0].Vertices, view.Levels[0].Indices, boundingBox))
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < view.Header->LODsCount; ++i)
+	{
+		const CookedLODHeader& lod = view.LODs[i];
+		if (!AddLOD(view.Levels[i + 1].Vertices, lod.VerticesCount, view.Levels[i + 1].Indices, lod.IndicesCount, lod.ScreenSize, true))
 		{
-			auto index = std::distance(verticesList.begin(), found->second);
-			_indices.push_back((unsigned int)index);
+			// Mesh can still be rendered without LODs
+			gDebug.Printf(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Failed to create LODs of mesh (%s)"), _path.c_str());
+			break;
 		}
 	}
 
-	_verticesCount = (unsigned int)_vertices.size();
-	_indicesCount = (unsigned int)_indices.size();
+	return true;
+}
+
+bool StaticMesh::Cook(const String& sourcePath, const String& cookedPath)
+{
+	StaticMesh mesh;
+	if (!mesh.Load(sourcePath) || mesh._vertices.empty() || mesh._indices.empty())
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot cook mesh (%s), it cannot be imported"), sourcePath.c_str());
+		return false;
+	}
+
+	// Loading has optimized the mesh and prepared its LODs already
+	if (!SaveCookedMesh(cookedPath, mesh._vertices, mesh._indices, mesh._subMeshes, mesh._sourceBoundingBox, mesh._sourceLODs))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot write cooked mesh (%s)"), cookedPath.c_str());
+		return false;
+	}
 
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Cooked mesh (%s) with %u vertices and %u LODs to %s"), sourcePath.c_str(), mesh._verticesCount, (unsigned int)mesh._sourceLODs.size(), cookedPath.c_str());
 	return true;
 }
 
@@ -185,9 +445,19 @@ bool StaticMesh::Load(const String& path)
 	MeshBase::Load(path);
 
 	String extension = GetExtension(path);
-	if (extension == DT_TEXT("obj"))
+	if (extension == COOKED_MESH_EXTENSION)
+	{
+		return LoadCooked(path);
+	}
+	else if (extension == DT_TEXT("obj"))
 	{
-		return LoadFromOBJ(path);
+		if (!LoadFromOBJ(path))
+		{
+			return false;
+		}
+
+		PrepareSource();
+		return true;
 	}
 	else if (extension == DT_TEXT("fbx"))
 	{
@@ -200,6 +470,17 @@ bool StaticMesh::Load(const String& path)
 
 bool StaticMesh::Initialize()
 {
+	if (_cookedData.IsValid())
+	{
+		if (!InitializeCooked())
+		{
+			_cookedData.Release();
+			return false;
+		}
+
+		return true;
+	}
+
 	if (_vertices.size() == 0 || _indices.size() == 0)
 	{
 		_vertices.clear();
@@ -207,9 +488,50 @@ bool StaticMesh::Initialize()
 		return false;
 	}
 
-	bool result = CreateBuffers(_vertices.data(), _indices.data());
-	_vertices.clear();
-	_indices.clear();
+	bool result = CreateOptimizedBuffers(_vertices.data(), _indices.data(), _sourceBoundingBox);
+	for (unsigned int i = 0; result && i < _sourceLODs.size(); ++i)
+	{
+		const LODData& lod = _sourceLODs[i];
+		if (!AddLOD(lod.Vertices.data(), (unsigned int)lod.Vertices.size(), lod.Indices.data(), (unsigned int)lod.Indices.size(), lod.ScreenSize, true))
+		{
+			// Mesh can still be rendered without LODs
+			gDebug.Printf(LogVerbosity::Warning, CHANNEL_GRAPHICS, DT_TEXT("Failed to create LODs of mesh (%s)"), _path.c_str());
+			break;
+		}
+	}
+
+	// LODs are not kept on CPU
+	DynamicArray<LODData>().swap(_sourceLODs);
 
 	return result;
 }
+
+bool StaticMesh::TakeReloaded(Asset& reloaded)
+{
+	if (!MeshBase::TakeReloaded(reloaded))
+	{
+		return false;
+	}
+
+	std::swap(_subMeshes, static_cast<StaticMesh&>(reloaded)._subMeshes);
+	_cookedData.Swap(static_cast<StaticMesh&>(reloaded)._cookedData);
+
+	// Data of reloaded mesh has been trimmed already, its cooked geometry is needed only when full vertices are kept
+	if (GetVertices() == nullptr)
+	{
+		_cookedData.Release();
+	}
+
+	return true;
+}
+
+void StaticMesh::ReleaseCPUData()
+{
+	MeshBase::ReleaseCPUData();
+
+	// Trimmed data has been copied out of the cooked mesh, so it doesn't have to stay mapped anymore
+	if (GetVertices() == nullptr)
+	{
+		_cookedData.Release();
+	}
+}
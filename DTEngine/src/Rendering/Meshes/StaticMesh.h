@@ -1,12 +1,33 @@
 #pragma once
 
 #include "Rendering/MeshBase.h"
+#include "ResourceManagement/FileSystem.h"
 
 class StaticMesh final : public MeshBase
 {
-private:
-	std::vector<VertexType> _vertices;
-	std::vector<unsigned int> _indices;
+public:
+	// Range of indices drawn with one material
+	struct SubMesh
+	{
+		unsigned int IndexStart;
+		unsigned int IndicesCount;
+	};
+
+	// Simplified and optimized geometry of one LOD
+	struct LODData
+	{
+		float ScreenSize;
+		DynamicArray<VertexType> Vertices;
+		DynamicArray<unsigned int> Indices;
+	};
+
+protected:
+	DynamicArray<SubMesh> _subMeshes;
+	// Cooked mesh stays mapped from Load, its geometry is used in place as CPU data until ReleaseCPUData
+	FileView _cookedData;
+	// Source meshes are optimized and simplified in Load on loading threads, Initialize only uploads them
+	BoundingBox _sourceBoundingBox;
+	DynamicArray<LODData> _sourceLODs;
 
 public:
 	StaticMesh();
@@ -16,9 +37,28 @@ public:
 protected:
 	bool LoadFromOBJ(const String& path);
 	bool LoadFromFBX(const String& path);
+	// Cooked meshes are optimized and have their LODs already, so loading them only validates the layout
+	bool LoadCooked(const String& path);
+	bool InitializeCooked();
+
+	// Optimizes imported geometry and prepares its LODs, so nothing but uploads is left for Initialize
+	void PrepareSource();
+	// Simplified LODs are generated once and cached in a file next to the source mesh
+	void CreateLODs();
 
 public:
 	virtual bool Load(const String& path) override;
 
 	virtual bool Initialize() override;
+	virtual bool TakeReloaded(Asset& reloaded) override;
+	virtual void ReleaseCPUData() override;
+
+	inline const DynamicArray<SubMesh>& GetSubMeshes() const
+	{
+		return _subMeshes;
+	}
+
+	// Imports source mesh (i.e. OBJ) and writes it as .dtmesh, which is loaded without any parsing
+	// Source mesh is optimized and its LODs are generated during cooking, so it is meant to run offline
+	static bool Cook(const String& sourcePath, const String& cookedPath);
 };
\ No newline at end of file
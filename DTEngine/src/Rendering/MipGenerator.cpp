@@ -0,0 +1,207 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "Utility/Math.h"
+
+const float MipGenerator::KAISER_RADIUS = 2.0f;
+const float MipGenerator::KAISER_ALPHA = 4.0f;
+
+// Source pixel contributing to a destination pixel, pixels outside of the image are replaced by edge pixels
+struct FilterTap
+{
+	unsigned int Index;
+	float Weight;
+};
+
+// Taps of all destination pixels along one axis, precomputed once per mip because they are the same for every row (or column)
+struct FilterKernel
+{
+	DynamicArray<FilterTap> Taps;
+	// Destination pixel i uses taps from Offsets[i] up to Offsets[i + 1]
+	DynamicArray<unsigned int> Offsets;
+};
+
+// Modified Bessel function of the first kind, power series converges quickly for arguments used by the window
+static float BesselI0(float x)
+{
+	const float quarterSquared = x * x * 0.25f;
+	float term = 1.0f;
+	float sum = 1.0f;
+	for (int k = 1; k < 20; ++k)
+	{
+		term *= quarterSquared / (float)(k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float Sinc(float x)
+{
+	if (Math::Abs(x) < 1e-5f)
+	{
+		return 1.0f;
+	}
+
+	const float angle = Math::PI * x;
+	return Math::Sin(angle) / angle;
+}
+
+static void BuildKernel(unsigned int sourceSize, unsigned int destinationSize, MipFilter filter, FilterKernel& kernel)
+{
+	const float scale = (float)sourceSize / (float)destinationSize;
+	const float windowScale = 1.0f / BesselI0(MipGenerator::KAISER_ALPHA);
+	const int lastIndex = (int)sourceSize - 1;
+
+	kernel.Taps.clear();
+	kernel.Offsets.resize(destinationSize + 1);
+	for (unsigned int i = 0; i < destinationSize; ++i)
+	{
+		const unsigned int firstTap = (unsigned int)kernel.Taps.size();
+		kernel.Offsets[i] = firstTap;
+
+		float weightsSum = 0.0f;
+		if (filter == MipFilter::Box)
+		{
+			// Non integer scales cover edge pixels only partially
+			const float begin = i * scale;
+			const float end = begin + scale;
+			for (int s = (int)begin; (float)s < end; ++s)
+			{
+				const float coverage = Math::Min(end, s + 1.0f) - Math::Max(begin, (float)s);
+				if (coverage > 0.0f)
+				{
+					kernel.Taps.push_back({(unsigned int)Math::Min(s, lastIndex), coverage});
+					weightsSum += coverage;
+				}
+			}
+		}
+		else
+		{
+			// Distances are measured in destination pixels, so the filter is stretched over more source pixels when downscaling
+			const float center = (i + 0.5f) * scale;
+			const float radius = MipGenerator::KAISER_RADIUS * scale;
+			for (int s = (int)floorf(center - radius); (float)s <= center + radius; ++s)
+			{
+				const float distance = (s + 0.5f - center) / scale;
+				const float windowPosition = distance / MipGenerator::KAISER_RADIUS;
+				const float windowSquared = 1.0f - windowPosition * windowPosition;
+				if (windowSquared <= 0.0f)
+				{
+					continue;
+				}
+
+				const float weight = Sinc(distance) * BesselI0(MipGenerator::KAISER_ALPHA * Math::Sqrt(windowSquared)) * windowScale;
+				if (weight != 0.0f)
+				{
+					kernel.Taps.push_back({(unsigned int)Math::Clamp(s, 0, lastIndex), weight});
+					weightsSum += weight;
+				}
+			}
+		}
+
+		// Normalized, so flat areas keep their value no matter how the taps fall on source pixels
+		for (unsigned int t = firstTap; t < (unsigned int)kernel.Taps.size(); ++t)
+		{
+			kernel.Taps[t].Weight /= weightsSum;
+		}
+	}
+	kernel.Offsets[destinationSize] = (unsigned int)kernel.Taps.size();
+}
+
+// Filters rows of source into temporary first and then columns of temporary into destination, pixels are 4 floats
+static void Resample(const float* source, unsigned int sourceWidth, unsigned int sourceHeight, const FilterKernel& horizontal, const FilterKernel& vertical,
+					 unsigned int destinationWidth, unsigned int destinationHeight, DynamicArray<float>& temporary, float* destination)
+{
+	temporary.resize((size_t)destinationWidth * sourceHeight * 4);
+	for (unsigned int y = 0; y < sourceHeight; ++y)
+	{
+		const float* sourceRow = source + (size_t)y * sourceWidth * 4;
+		float* temporaryRow = temporary.data() + (size_t)y * destinationWidth * 4;
+		for (unsigned int x = 0; x < destinationWidth; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (unsigned int t = horizontal.Offsets[x]; t < horizontal.Offsets[x + 1]; ++t)
+			{
+				const FilterTap& tap = horizontal.Taps[t];
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sourceRow + (size_t)tap.Index * 4), _mm_set1_ps(tap.Weight)));
+			}
+			_mm_storeu_ps(temporaryRow + (size_t)x * 4, sum);
+		}
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const size_t temporaryRowSize = (size_t)destinationWidth * 4;
+	for (unsigned int y = 0; y < destinationHeight; ++y)
+	{
+		float* destinationRow = destination + (size_t)y * temporaryRowSize;
+		for (unsigned int x = 0; x < destinationWidth; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (unsigned int t = vertical.Offsets[y]; t < vertical.Offsets[y + 1]; ++t)
+			{
+				const FilterTap& tap = vertical.Taps[t];
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(temporary.data() + tap.Index * temporaryRowSize + (size_t)x * 4), _mm_set1_ps(tap.Weight)));
+			}
+			// Negative lobes of sinc overshoot around sharp edges
+			_mm_storeu_ps(destinationRow + (size_t)x * 4, _mm_min_ps(_mm_max_ps(sum, zero), one));
+		}
+	}
+}
+
+static void ConvertToBytes(const float* pixels, size_t pixelsCount, unsigned char* bytes)
+{
+	const __m128 scale = _mm_set1_ps(255.0f);
+	for (size_t i = 0; i < pixelsCount; ++i)
+	{
+		// Conversion rounds to nearest, values are already in [0, 1] so saturating packs only narrow them
+		const __m128i values = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(pixels + i * 4), scale));
+		const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(values, values), values);
+		const int pixel = _mm_cvtsi128_si32(packed);
+		memcpy(bytes + i * 4, &pixel, sizeof(pixel));
+	}
+}
+
+void MipGenerator::Generate(const Image& image, MipFilter filter, unsigned int mipsCount, DynamicArray<Image>& mips)
+{
+	mips.resize(mipsCount);
+	if (mipsCount == 0)
+	{
+		return;
+	}
+
+	// Filtering from the previous float mip keeps rounding errors of 8 bit channels from accumulating down the chain
+	unsigned int width = image.Width;
+	unsigned int height = image.Height;
+	DynamicArray<float> current((size_t)width * height * 4);
+	for (size_t i = 0; i < current.size(); ++i)
+	{
+		current[i] = image.Pixels[i] * (1.0f / 255.0f);
+	}
+
+	DynamicArray<float> next;
+	DynamicArray<float> temporary;
+	FilterKernel horizontal;
+	FilterKernel vertical;
+	for (Image& mip : mips)
+	{
+		const unsigned int mipWidth = Math::Max(width / 2, 1u);
+		const unsigned int mipHeight = Math::Max(height / 2, 1u);
+		BuildKernel(width, mipWidth, filter, horizontal);
+		BuildKernel(height, mipHeight, filter, vertical);
+
+		next.resize((size_t)mipWidth * mipHeight * 4);
+		Resample(current.data(), width, height, horizontal, vertical, mipWidth, mipHeight, temporary, next.data());
+
+		mip.Width = mipWidth;
+		mip.Height = mipHeight;
+		mip.Pixels.resize((size_t)mipWidth * mipHeight * 4);
+		ConvertToBytes(next.data(), (size_t)mipWidth * mipHeight, mip.Pixels.data());
+
+		current.swap(next);
+		width = mipWidth;
+		height = mipHeight;
+	}
+}
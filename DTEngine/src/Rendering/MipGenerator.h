@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "ImageDecoder.h"
+
+enum class MipFilter : unsigned char
+{
+	// Average of covered source pixels, cheap but blurry
+	Box,
+	// Kaiser windowed sinc, keeps small mips sharper
+	Kaiser
+};
+
+// Builds mip chains of RGBA8 images, sizes don't have to be powers of two (odd sizes are rounded down like in D3D)
+// Every mip is filtered from the previous one in floating point, all four channels of a pixel are processed at once with SSE
+class MipGenerator final
+{
+public:
+	// Support of Kaiser filter on each side of a pixel, in pixels of the smaller mip
+	static const float KAISER_RADIUS;
+	// Shape of Kaiser window, higher values mean less ringing and more blur
+	static const float KAISER_ALPHA;
+
+	// Generates given number of mips below the image, each of them half the size of the previous one (but at least 1x1)
+	static void Generate(const Image& image, MipFilter filter, unsigned int mipsCount, DynamicArray<Image>& mips);
+};
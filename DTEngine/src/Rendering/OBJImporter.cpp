@@ -0,0 +1,521 @@
+#include "OBJImporter.h"
+
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+static const int MISSING_INDEX = -1;
+
+// Channels of face corners
+static const unsigned int POSITION_CHANNEL = 0;
+static const unsigned int UV_CHANNEL = 1;
+static const unsigned int NORMAL_CHANNEL = 2;
+static const unsigned int CHANNELS_COUNT = 3;
+
+// Corner of a triangle, relative indices (negative ones in the file) are stored relative to the chunk until chunks are merged
+struct OBJCorner
+{
+	int Indices[CHANNELS_COUNT];
+	unsigned char RelativeMask;
+};
+
+// Elements parsed from a part of the file, whole lines only
+struct OBJChunk
+{
+	const char* Begin;
+	const char* End;
+
+	DynamicArray<Vector3> Positions;
+	DynamicArray<Vector2> UVs;
+	DynamicArray<Vector3> Normals;
+	// Three corners per triangle
+	DynamicArray<OBJCorner> Corners;
+	// Corners count at each usemtl
+	DynamicArray<size_t> SubMeshStarts;
+};
+
+static inline bool IsDigit(char character)
+{
+	return character >= '0' && character <= '9';
+}
+
+static inline bool IsSpace(char character)
+{
+	return character == ' ' || character == '\t' || character == '\r';
+}
+
+static inline const char* SkipSpaces(const char* position, const char* end)
+{
+	while (position < end && IsSpace(*position))
+	{
+		++position;
+	}
+	return position;
+}
+
+static inline const char* SkipLine(const char* position, const char* end)
+{
+	while (position < end && *position != '\n')
+	{
+		++position;
+	}
+	return position < end ? position + 1 : end;
+}
+
+static inline double GetPowerOfTen(int exponent)
+{
+	// Powers of ten up to 22 are exact in doubles
+	static const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	return exponent <= 22 ? POWERS_OF_TEN[exponent] : std::pow(10.0, exponent);
+}
+
+// Parses decimal float with optional exponent, significant digits beyond 19 are ignored
+static const char* ParseFloat(const char* position, const char* end, float& value)
+{
+	position = SkipSpaces(position, end);
+
+	bool isNegative = false;
+	if (position < end && (*position == '-' || *position == '+'))
+	{
+		isNegative = *position == '-';
+		++position;
+	}
+
+	unsigned long long digits = 0;
+	unsigned int digitsCount = 0;
+	int exponent = 0;
+	for (; position < end && IsDigit(*position); ++position)
+	{
+		if (digitsCount < 19)
+		{
+			digits = digits * 10 + (*position - '0');
+			digitsCount += digits != 0;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+
+	if (position < end && *position == '.')
+	{
+		for (++position; position < end && IsDigit(*position); ++position)
+		{
+			if (digitsCount < 19)
+			{
+				digits = digits * 10 + (*position - '0');
+				digitsCount += digits != 0;
+				--exponent;
+			}
+		}
+	}
+
+	if (position < end && (*position == 'e' || *position == 'E'))
+	{
+		++position;
+		bool isExponentNegative = false;
+		if (position < end && (*position == '-' || *position == '+'))
+		{
+			isExponentNegative = *position == '-';
+			++position;
+		}
+
+		int writtenExponent = 0;
+		for (; position < end && IsDigit(*position); ++position)
+		{
+			if (writtenExponent < 10000)
+			{
+				writtenExponent = writtenExponent * 10 + (*position - '0');
+			}
+		}
+		exponent += isExponentNegative ? -writtenExponent : writtenExponent;
+	}
+
+	double result = (double)digits;
+	if (digits != 0)
+	{
+		result = exponent < 0 ? result / GetPowerOfTen(-exponent) : result * GetPowerOfTen(exponent);
+	}
+	value = (float)(isNegative ? -result : result);
+
+	return position;
+}
+
+// Returns false if there is no index (i.e. UV in "1//2")
+// Indices which don't fit in int are saturated, so they are reported as out of range instead of wrapping around
+static inline bool ParseIndex(const char*& position, const char* end, int& index)
+{
+	const bool isNegative = position < end && *position == '-';
+	const char* digitsStart = isNegative ? position + 1 : position;
+	const char* digitsEnd = digitsStart;
+
+	int value = 0;
+	for (; digitsEnd < end && IsDigit(*digitsEnd); ++digitsEnd)
+	{
+		const int digit = *digitsEnd - '0';
+		value = value > (INT_MAX - digit) / 10 ? INT_MAX : value * 10 + digit;
+	}
+
+	if (digitsEnd == digitsStart)
+	{
+		return false;
+	}
+
+	position = digitsEnd;
+	index = isNegative ? -value : value;
+	return true;
+}
+
+// Parses one "position/uv/normal" corner, only position is mandatory
+static const char* ParseCorner(const char* position, const char* end, const OBJChunk& chunk, OBJCorner& corner, bool& isValid)
+{
+	const size_t elementsCounts[CHANNELS_COUNT] = {chunk.Positions.size(), chunk.UVs.size(), chunk.Normals.size()};
+
+	corner.RelativeMask = 0;
+	for (unsigned int channel = 0; channel < CHANNELS_COUNT; ++channel)
+	{
+		corner.Indices[channel] = MISSING_INDEX;
+
+		if (channel > 0)
+		{
+			if (position >= end || *position != '/')
+			{
+				continue;
+			}
+			++position;
+		}
+
+		int index = 0;
+		if (!ParseIndex(position, end, index) || index == 0)
+		{
+			continue;
+		}
+
+		if (index > 0)
+		{
+			corner.Indices[channel] = index - 1;
+		}
+		else
+		{
+			corner.Indices[channel] = (int)elementsCounts[channel] + index;
+			corner.RelativeMask |= 1 << channel;
+		}
+	}
+
+	// Skips anything unexpected till the end of the corner
+	while (position < end && !IsSpace(*position) && *position != '\n')
+	{
+		++position;
+	}
+
+	// Relative index is resolved only when chunks are merged, until then it may be negative and equal to MISSING_INDEX
+	isValid = corner.Indices[POSITION_CHANNEL] != MISSING_INDEX || (corner.RelativeMask & (1 << POSITION_CHANNEL)) != 0;
+	return position;
+}
+
+static void ParseChunk(OBJChunk& chunk)
+{
+	DynamicArray<OBJCorner> polygon;
+
+	const char* const end = chunk.End;
+	const char* position = chunk.Begin;
+	while (position < end)
+	{
+		position = SkipSpaces(position, end);
+		if (position >= end)
+		{
+			break;
+		}
+
+		const char* const lineStart = position;
+		if (lineStart[0] == 'v' && end - lineStart > 1)
+		{
+			if (IsSpace(lineStart[1]))
+			{
+				Vector3 element;
+				position = ParseFloat(lineStart + 1, end, element.X);
+				position = ParseFloat(position, end, element.Y);
+				position = ParseFloat(position, end, element.Z);
+				chunk.Positions.push_back(element);
+			}
+			else if (lineStart[1] == 't')
+			{
+				Vector2 element;
+				position = ParseFloat(lineStart + 2, end, element.X);
+				position = ParseFloat(position, end, element.Y);
+				chunk.UVs.push_back(element);
+			}
+			else if (lineStart[1] == 'n')
+			{
+				Vector3 element;
+				position = ParseFloat(lineStart + 2, end, element.X);
+				position = ParseFloat(position, end, element.Y);
+				position = ParseFloat(position, end, element.Z);
+				chunk.Normals.push_back(element);
+			}
+		}
+		else if (lineStart[0] == 'f' && end - lineStart > 1 && IsSpace(lineStart[1]))
+		{
+			polygon.clear();
+			position = lineStart + 1;
+			bool isValid = true;
+			while (true)
+			{
+				position = SkipSpaces(position, end);
+				if (position >= end || *position == '\n' || *position == '#')
+				{
+					break;
+				}
+
+				OBJCorner corner;
+				bool isCornerValid = false;
+				position = ParseCorner(position, end, chunk, corner, isCornerValid);
+				isValid &= isCornerValid;
+				polygon.push_back(corner);
+			}
+
+			// Polygons are triangulated as fans, which is right for convex ones
+			if (isValid)
+			{
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					chunk.Corners.push_back(polygon[0]);
+					chunk.Corners.push_back(polygon[i - 1]);
+					chunk.Corners.push_back(polygon[i]);
+				}
+			}
+		}
+		else if (end - lineStart > 6 && memcmp(lineStart, "usemtl", 6) == 0)
+		{
+			chunk.SubMeshStarts.push_back(chunk.Corners.size());
+		}
+
+		position = SkipLine(position, end);
+	}
+}
+
+static inline unsigned int HashCorner(const OBJCorner& corner)
+{
+	unsigned int hash = (unsigned int)corner.Indices[POSITION_CHANNEL] * 0x9E3779B1u;
+	hash = (hash ^ (unsigned int)corner.Indices[UV_CHANNEL]) * 0x85EBCA77u;
+	hash = (hash ^ (unsigned int)corner.Indices[NORMAL_CHANNEL]) * 0xC2B2AE3Du;
+	return hash ^ (hash >> 15);
+}
+
+static inline bool AreCornersEqual(const OBJCorner& first, const OBJCorner& second)
+{
+	return first.Indices[POSITION_CHANNEL] == second.Indices[POSITION_CHANNEL] && first.Indices[UV_CHANNEL] == second.Indices[UV_CHANNEL] &&
+		first.Indices[NORMAL_CHANNEL] == second.Indices[NORMAL_CHANNEL];
+}
+
+// Open addressing map from resolved corner to vertex index, corners of vertices are kept separately
+class OBJVertexMap final
+{
+private:
+	// Vertex index + 1, zero marks empty slots
+	DynamicArray<unsigned int> _slots;
+	DynamicArray<OBJCorner> _corners;
+
+	void Grow()
+	{
+		DynamicArray<unsigned int> slots(_slots.size() * 2, 0);
+		_slots.swap(slots);
+
+		const unsigned int mask = (unsigned int)_slots.size() - 1;
+		for (unsigned int vertex = 0; vertex < _corners.size(); ++vertex)
+		{
+			unsigned int index = HashCorner(_corners[vertex]) & mask;
+			while (_slots[index] != 0)
+			{
+				index = (index + 1) & mask;
+			}
+			_slots[index] = vertex + 1;
+		}
+	}
+
+public:
+	OBJVertexMap(size_t expectedCount)
+	{
+		size_t capacity = 64;
+		while (capacity < expectedCount * 2)
+		{
+			capacity *= 2;
+		}
+		_slots.resize(capacity, 0);
+		_corners.reserve(expectedCount);
+	}
+
+	// Returns index of vertex with given corner, adds new vertex if there is none yet
+	unsigned int FindOrAdd(const OBJCorner& corner, bool& isAdded)
+	{
+		const unsigned int mask = (unsigned int)_slots.size() - 1;
+		unsigned int index = HashCorner(corner) & mask;
+		while (_slots[index] != 0)
+		{
+			const unsigned int vertex = _slots[index] - 1;
+			if (AreCornersEqual(_corners[vertex], corner))
+			{
+				isAdded = false;
+				return vertex;
+			}
+			index = (index + 1) & mask;
+		}
+
+		const unsigned int vertex = (unsigned int)_corners.size();
+		_corners.push_back(corner);
+		_slots[index] = vertex + 1;
+		isAdded = true;
+
+		// Keeps at most half of slots used
+		if (_corners.size() * 2 > _slots.size())
+		{
+			Grow();
+		}
+
+		return vertex;
+	}
+};
+
+bool OBJImporter::Import(const char* data, size_t size, DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices,
+						 DynamicArray<StaticMesh::SubMesh>& subMeshes)
+{
+	// Chunks are split at line ends, so every line is parsed by exactly one thread
+	const unsigned int hardwareThreadsCount = Math::Max(std::thread::hardware_concurrency(), 1u);
+	const unsigned int chunksCount = (unsigned int)Math::Clamp<size_t>(size / MIN_CHUNK_SIZE, 1, Math::Min(hardwareThreadsCount, MAX_THREADS_COUNT));
+	DynamicArray<OBJChunk> chunks(chunksCount);
+	const char* const end = data + size;
+	const char* chunkBegin = data;
+	for (unsigned int i = 0; i < chunksCount; ++i)
+	{
+		const char* chunkEnd = i + 1 == chunksCount ? end : SkipLine(Math::Max(data + size / chunksCount * (i + 1), chunkBegin), end);
+		chunks[i].Begin = chunkBegin;
+		chunks[i].End = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	DynamicArray<std::thread> threads;
+	for (unsigned int i = 1; i < chunksCount; ++i)
+	{
+		threads.push_back(std::thread(&ParseChunk, std::ref(chunks[i])));
+	}
+	ParseChunk(chunks[0]);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	// Elements of all chunks are merged first, so faces may reference elements defined anywhere in the file
+	DynamicArray<Vector3> positions;
+	DynamicArray<Vector2> uvs;
+	DynamicArray<Vector3> normals;
+	// Counts of elements of each channel preceding each chunk
+	DynamicArray<int> bases;
+	size_t cornersCount = 0;
+	for (const OBJChunk& chunk : chunks)
+	{
+		bases.push_back((int)positions.size());
+		bases.push_back((int)uvs.size());
+		bases.push_back((int)normals.size());
+		positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+		uvs.insert(uvs.end(), chunk.UVs.begin(), chunk.UVs.end());
+		normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+		cornersCount += chunk.Corners.size();
+	}
+	const size_t elementsCounts[CHANNELS_COUNT] = {positions.size(), uvs.size(), normals.size()};
+
+	vertices.clear();
+	indices.clear();
+	subMeshes.clear();
+	vertices.reserve(positions.size());
+	indices.reserve(cornersCount);
+
+	// Vertices without normals get them smoothed from faces they are part of
+	DynamicArray<bool> isNormalMissing;
+	bool isAnyNormalMissing = false;
+
+	OBJVertexMap vertexMap(positions.size());
+	size_t subMeshStart = 0;
+	for (unsigned int i = 0; i < chunksCount; ++i)
+	{
+		const OBJChunk& chunk = chunks[i];
+		for (size_t chunkSubMeshStart : chunk.SubMeshStarts)
+		{
+			const size_t start = indices.size() + chunkSubMeshStart;
+			if (start > subMeshStart)
+			{
+				subMeshes.push_back({(unsigned int)subMeshStart, (unsigned int)(start - subMeshStart)});
+			}
+			subMeshStart = start;
+		}
+
+		for (OBJCorner corner : chunk.Corners)
+		{
+			for (unsigned int channel = 0; channel < CHANNELS_COUNT; ++channel)
+			{
+				int& index = corner.Indices[channel];
+				const bool isRelative = (corner.RelativeMask & (1 << channel)) != 0;
+				if (!isRelative && index == MISSING_INDEX)
+				{
+					continue;
+				}
+
+				index += isRelative ? bases[i * CHANNELS_COUNT + channel] : 0;
+				if (index < 0 || (size_t)index >= elementsCounts[channel])
+				{
+					return false;
+				}
+			}
+			corner.RelativeMask = 0;
+
+			bool isAdded = false;
+			const unsigned int vertexIndex = vertexMap.FindOrAdd(corner, isAdded);
+			indices.push_back(vertexIndex);
+			if (!isAdded)
+			{
+				continue;
+			}
+
+			MeshBase::VertexType vertex;
+			vertex.Position = positions[corner.Indices[POSITION_CHANNEL]];
+			vertex.UV = corner.Indices[UV_CHANNEL] != MISSING_INDEX ? uvs[corner.Indices[UV_CHANNEL]] : Vector2(0.0f, 0.0f);
+			vertex.Normal = corner.Indices[NORMAL_CHANNEL] != MISSING_INDEX ? normals[corner.Indices[NORMAL_CHANNEL]] : Vector3::ZERO;
+			vertices.push_back(vertex);
+
+			isNormalMissing.push_back(corner.Indices[NORMAL_CHANNEL] == MISSING_INDEX);
+			isAnyNormalMissing |= isNormalMissing.back();
+		}
+	}
+
+	if (indices.size() > subMeshStart)
+	{
+		subMeshes.push_back({(unsigned int)subMeshStart, (unsigned int)(indices.size() - subMeshStart)});
+	}
+
+	if (isAnyNormalMissing)
+	{
+		// Area weighted, cross product of edges is twice the area of the triangle
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const Vector3 faceNormal = Vector3::CrossProduct(vertices[indices[i + 1]].Position - vertices[indices[i]].Position, vertices[indices[i + 2]].Position - vertices[indices[i]].Position);
+			for (size_t j = i; j < i + 3; ++j)
+			{
+				if (isNormalMissing[indices[j]])
+				{
+					vertices[indices[j]].Normal += faceNormal;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			if (isNormalMissing[i])
+			{
+				vertices[i].Normal.NormalizeSafe();
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Rendering/Meshes/StaticMesh.h"
+
+// Parses Wavefront OBJ meshes from memory, polygons are triangulated as fans
+// Missing UVs are zeroed and missing normals are smoothed from faces sharing the vertex
+// Big files are parsed in chunks on more threads, vertices with the same position, UV and normal are then merged in one pass
+// Every usemtl starts a new submesh, materials themselves are not imported
+class OBJImporter final
+{
+public:
+	// Smallest part of a file parsed by one thread, smaller files are parsed on calling thread only
+	static const size_t MIN_CHUNK_SIZE = 1 << 20;
+	static const unsigned int MAX_THREADS_COUNT = 8;
+
+	// Returns false if faces reference elements which the file doesn't define
+	static bool Import(const char* data, size_t size, DynamicArray<MeshBase::VertexType>& vertices, DynamicArray<unsigned int>& indices,
+					   DynamicArray<StaticMesh::SubMesh>& subMeshes);
+};
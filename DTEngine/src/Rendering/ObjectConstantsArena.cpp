@@ -0,0 +1,93 @@
+#include "ObjectConstantsArena.h"
+
+#include "Debug/Debug.h"
+#include "Graphics.h"
+
+static_assert(sizeof(ObjectConstants) % 256 == 0, "ObjectConstants size must be a multiple of 256 bytes");
+
+ObjectConstantsArena::ObjectConstantsArena() : _buffer(nullptr), _capacity(0), _slotsCount(0), _isMapped(false)
+{}
+
+bool ObjectConstantsArena::CreateBuffer(Graphics& graphics, unsigned int capacity)
+{
+	RELEASE_COM(_buffer);
+
+	D3D11_BUFFER_DESC bufferDesc = {0};
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(ObjectConstants) * capacity;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	if (!graphics.CreateBuffer(bufferDesc, &_buffer))
+	{
+		_capacity = 0;
+		return false;
+	}
+
+	_capacity = capacity;
+	return true;
+}
+
+bool ObjectConstantsArena::Initialize(Graphics& graphics, unsigned int initialCapacity)
+{
+	_slotsCount = 0;
+	_isMapped = false;
+	return CreateBuffer(graphics, initialCapacity);
+}
+
+void ObjectConstantsArena::Shutdown()
+{
+	RELEASE_COM(_buffer);
+	_capacity = 0;
+	_slotsCount = 0;
+	_isMapped = false;
+}
+
+ObjectConstants* ObjectConstantsArena::Begin(Graphics& graphics, unsigned int slotsCount)
+{
+	DT_ASSERT(!_isMapped, DT_TEXT("Object constants arena is already mapped"));
+
+	_slotsCount = 0;
+	if (!_buffer || slotsCount == 0)
+	{
+		return nullptr;
+	}
+
+	if (slotsCount > _capacity)
+	{
+		unsigned int newCapacity = _capacity;
+		while (newCapacity < slotsCount)
+		{
+			newCapacity *= 2;
+		}
+
+		gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Growing object constants arena to %u slots"), newCapacity);
+
+		if (!CreateBuffer(graphics, newCapacity))
+		{
+			gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to grow object constants arena"));
+			return nullptr;
+		}
+	}
+
+	// Discarding gives fresh memory, so draws submitted in previous passes still see their own data
+	void* data = graphics.Map(_buffer, D3D11_MAP_WRITE_DISCARD);
+	if (!data)
+	{
+		return nullptr;
+	}
+
+	_isMapped = true;
+	_slotsCount = slotsCount;
+
+	return static_cast<ObjectConstants*>(data);
+}
+
+void ObjectConstantsArena::End(Graphics& graphics)
+{
+	if (_isMapped)
+	{
+		graphics.Unmap(_buffer);
+		_isMapped = false;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Utility/Math.h"
+
+struct ID3D11Buffer;
+
+class Graphics;
+
+// Constants of a single rendered object
+// Layout must match PerObjectBuffer declared in shaders
+// Padded to 256 bytes, because constant buffer offsets must be multiples of 16 constants
+struct ObjectConstants final
+{
+public:
+	Matrix Model2WorldMatrix;
+	// Decoding of quantized vertex positions, see VertexFormat::Quantized
+	Vector4 PositionDequantizeScale;
+	Vector4 PositionDequantizeOffset;
+
+private:
+	unsigned char _padding[256 - sizeof(Matrix) - 2 * sizeof(Vector4)];
+};
+
+// Upload arena for per object constants
+// All visible objects write their constants into one big dynamic buffer, which is mapped once per camera pass
+// Draws then bind only their own slot of the buffer (requires constant buffer offsets from D3D11.1)
+class ObjectConstantsArena final
+{
+public:
+	static const unsigned int INVALID_SLOT = (unsigned int)-1;
+	static const unsigned int SLOT_CONSTANTS_COUNT = sizeof(ObjectConstants) / 16;
+
+private:
+	ID3D11Buffer* _buffer;
+	unsigned int _capacity;
+	unsigned int _slotsCount;
+	bool _isMapped;
+
+public:
+	ObjectConstantsArena();
+
+private:
+	bool CreateBuffer(Graphics& graphics, unsigned int capacity);
+
+public:
+	bool Initialize(Graphics& graphics, unsigned int initialCapacity);
+	void Shutdown();
+
+	// Maps the arena for given number of objects (growing it if necessary)
+	// Returns pointer to slotsCount writable ObjectConstants or nullptr on failure
+	ObjectConstants* Begin(Graphics& graphics, unsigned int slotsCount);
+	void End(Graphics& graphics);
+
+	inline bool IsValidSlot(unsigned int slot) const
+	{
+		return _buffer != nullptr && slot < _slotsCount;
+	}
+
+	inline ID3D11Buffer* GetBuffer() const
+	{
+		return _buffer;
+	}
+};
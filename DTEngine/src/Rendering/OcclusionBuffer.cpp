@@ -0,0 +1,273 @@
+#include "OcclusionBuffer.h"
+
+#include <cfloat>
+#include <utility>
+#include <xmmintrin.h>
+
+OcclusionBuffer::OcclusionBuffer()
+{
+	Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+	_depth.assign(WIDTH * HEIGHT, 1.0f);
+	_triangles.clear();
+
+	for (Tile& tile : _tiles)
+	{
+		tile.Triangles.clear();
+		tile.MaxDepth = 1.0f;
+	}
+}
+
+void OcclusionBuffer::AddOccluder(const Vector3* positions, unsigned int positionsStride, unsigned int positionsCount, const unsigned int* indices, unsigned int indicesCount, const Matrix& modelViewProjection)
+{
+	_clipPositions.resize(positionsCount);
+	for (unsigned int i = 0; i < positionsCount; ++i)
+	{
+		const Vector3& position = *(const Vector3*)((const unsigned char*)positions + i * positionsStride);
+		_clipPositions[i] = Vector4(position, 1.0f) * modelViewProjection;
+	}
+
+	for (unsigned int i = 0; i + 2 < indicesCount; i += 3)
+	{
+		AddTriangle(_clipPositions[indices[i]], _clipPositions[indices[i + 1]], _clipPositions[indices[i + 2]]);
+	}
+}
+
+void OcclusionBuffer::AddTriangle(const Vector4& clip0, const Vector4& clip1, const Vector4& clip2)
+{
+	if (clip0.W < Math::EPSILON || clip1.W < Math::EPSILON || clip2.W < Math::EPSILON)
+	{
+		return;
+	}
+
+	// Screen space with Y pointing down, pixel centers at half coordinates
+	float x[3];
+	float y[3];
+	float z[3];
+	const Vector4* clip[3] = {&clip0, &clip1, &clip2};
+	for (unsigned char i = 0; i < 3; ++i)
+	{
+		const float invW = 1.0f / clip[i]->W;
+		x[i] = (clip[i]->X * invW * 0.5f + 0.5f) * WIDTH;
+		y[i] = (0.5f - clip[i]->Y * invW * 0.5f) * HEIGHT;
+		z[i] = clip[i]->Z * invW;
+	}
+
+	// Occluders are rasterized two sided, so winding of occluder meshes doesn't matter
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (Math::Abs(area) < Math::EPSILON)
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+
+	const float minX = Math::Max(0.0f, floorf(Math::Min(x[0], Math::Min(x[1], x[2]))));
+	const float minY = Math::Max(0.0f, floorf(Math::Min(y[0], Math::Min(y[1], y[2]))));
+	const float maxX = Math::Min((float)(WIDTH - 1), floorf(Math::Max(x[0], Math::Max(x[1], x[2]))));
+	const float maxY = Math::Min((float)(HEIGHT - 1), floorf(Math::Max(y[0], Math::Max(y[1], y[2]))));
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// Edge i goes from vertex i to vertex i + 1, its function divided by area is barycentric weight of the opposite vertex
+	ScreenTriangle triangle;
+	triangle.DepthX = 0.0f;
+	triangle.DepthY = 0.0f;
+	triangle.DepthC = 0.0f;
+	const float invArea = 1.0f / area;
+	for (unsigned char i = 0; i < 3; ++i)
+	{
+		const unsigned char next = (i + 1) % 3;
+		const unsigned char opposite = (i + 2) % 3;
+
+		triangle.EdgeA[i] = y[i] - y[next];
+		triangle.EdgeB[i] = x[next] - x[i];
+		triangle.EdgeC[i] = -triangle.EdgeA[i] * x[i] - triangle.EdgeB[i] * y[i];
+
+		triangle.DepthX += triangle.EdgeA[i] * invArea * z[opposite];
+		triangle.DepthY += triangle.EdgeB[i] * invArea * z[opposite];
+		triangle.DepthC += triangle.EdgeC[i] * invArea * z[opposite];
+	}
+
+	triangle.MinX = (unsigned int)minX;
+	triangle.MinY = (unsigned int)minY;
+	triangle.MaxX = (unsigned int)maxX;
+	triangle.MaxY = (unsigned int)maxY;
+
+	const unsigned int triangleIndex = (unsigned int)_triangles.size();
+	_triangles.push_back(triangle);
+
+	for (unsigned int tileY = triangle.MinY / TILE_HEIGHT; tileY <= triangle.MaxY / TILE_HEIGHT; ++tileY)
+	{
+		for (unsigned int tileX = triangle.MinX / TILE_WIDTH; tileX <= triangle.MaxX / TILE_WIDTH; ++tileX)
+		{
+			_tiles[tileY * TILES_X + tileX].Triangles.push_back(triangleIndex);
+		}
+	}
+}
+
+void OcclusionBuffer::Rasterize()
+{
+	for (unsigned int i = 0; i < TILES_COUNT; ++i)
+	{
+		RasterizeTile(i);
+	}
+}
+
+void OcclusionBuffer::RasterizeTile(unsigned int tileIndex)
+{
+	Tile& tile = _tiles[tileIndex];
+	if (tile.Triangles.empty())
+	{
+		return;
+	}
+
+	const unsigned int minX = (tileIndex % TILES_X) * TILE_WIDTH;
+	const unsigned int minY = (tileIndex / TILES_X) * TILE_HEIGHT;
+	const unsigned int maxX = minX + TILE_WIDTH - 1;
+	const unsigned int maxY = minY + TILE_HEIGHT - 1;
+
+	for (unsigned int triangle : tile.Triangles)
+	{
+		RasterizeTriangle(_triangles[triangle], minX, minY, maxX, maxY);
+	}
+
+	__m128 maxDepth = _mm_setzero_ps();
+	for (unsigned int y = minY; y <= maxY; ++y)
+	{
+		const float* row = &_depth[y * WIDTH];
+		for (unsigned int x = minX; x <= maxX; x += 4)
+		{
+			maxDepth = _mm_max_ps(maxDepth, _mm_loadu_ps(row + x));
+		}
+	}
+
+	float maxDepths[4];
+	_mm_storeu_ps(maxDepths, maxDepth);
+	tile.MaxDepth = Math::Max(Math::Max(maxDepths[0], maxDepths[1]), Math::Max(maxDepths[2], maxDepths[3]));
+}
+
+void OcclusionBuffer::RasterizeTriangle(const ScreenTriangle& triangle, unsigned int tileMinX, unsigned int tileMinY, unsigned int tileMaxX, unsigned int tileMaxY)
+{
+	// Tiles are multiples of 4 pixels wide, so aligned groups of 4 pixels never leave the tile
+	// Pixels outside of triangle's bounds fail edge tests anyway
+	const unsigned int minX = Math::Max(triangle.MinX, tileMinX) & ~3u;
+	const unsigned int maxX = Math::Min(triangle.MaxX, tileMaxX);
+	const unsigned int minY = Math::Max(triangle.MinY, tileMinY);
+	const unsigned int maxY = Math::Min(triangle.MaxY, tileMaxY);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 edgeA0 = _mm_set1_ps(triangle.EdgeA[0]);
+	const __m128 edgeA1 = _mm_set1_ps(triangle.EdgeA[1]);
+	const __m128 edgeA2 = _mm_set1_ps(triangle.EdgeA[2]);
+	const __m128 depthX = _mm_set1_ps(triangle.DepthX);
+
+	for (unsigned int y = minY; y <= maxY; ++y)
+	{
+		const float pixelY = y + 0.5f;
+		const __m128 rowEdge0 = _mm_set1_ps(triangle.EdgeB[0] * pixelY + triangle.EdgeC[0]);
+		const __m128 rowEdge1 = _mm_set1_ps(triangle.EdgeB[1] * pixelY + triangle.EdgeC[1]);
+		const __m128 rowEdge2 = _mm_set1_ps(triangle.EdgeB[2] * pixelY + triangle.EdgeC[2]);
+		const __m128 rowDepth = _mm_set1_ps(triangle.DepthY * pixelY + triangle.DepthC);
+
+		float* row = &_depth[y * WIDTH];
+		for (unsigned int x = minX; x <= maxX; x += 4)
+		{
+			const __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), pixelOffsets);
+
+			const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0);
+			const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1);
+			const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2);
+			const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			const __m128 depth = _mm_loadu_ps(row + x);
+			const __m128 nearest = _mm_min_ps(depth, _mm_add_ps(_mm_mul_ps(depthX, pixelX), rowDepth));
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+		}
+	}
+}
+
+bool OcclusionBuffer::IsVisible(const Vector3& min, const Vector3& max, const Matrix& viewProjection) const
+{
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	float minDepth = 1.0f;
+
+	for (unsigned char i = 0; i < 8; ++i)
+	{
+		const Vector3 corner((i & 1) ? max.X : min.X, (i & 2) ? max.Y : min.Y, (i & 4) ? max.Z : min.Z);
+		const Vector4 clip = Vector4(corner, 1.0f) * viewProjection;
+
+		// Bounds crossing near plane are too close to be occluded reliably
+		if (clip.W < Math::EPSILON)
+		{
+			return true;
+		}
+
+		const float invW = 1.0f / clip.W;
+		const float x = (clip.X * invW * 0.5f + 0.5f) * WIDTH;
+		const float y = (0.5f - clip.Y * invW * 0.5f) * HEIGHT;
+		minX = Math::Min(minX, x);
+		minY = Math::Min(minY, y);
+		maxX = Math::Max(maxX, x);
+		maxY = Math::Max(maxY, y);
+		minDepth = Math::Min(minDepth, clip.Z * invW);
+	}
+
+	// Outside of the buffer, frustum culling decides about those
+	if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT)
+	{
+		return true;
+	}
+
+	const unsigned int pixelMinX = (unsigned int)Math::Max(0.0f, floorf(minX));
+	const unsigned int pixelMinY = (unsigned int)Math::Max(0.0f, floorf(minY));
+	const unsigned int pixelMaxX = (unsigned int)Math::Min((float)(WIDTH - 1), floorf(maxX));
+	const unsigned int pixelMaxY = (unsigned int)Math::Min((float)(HEIGHT - 1), floorf(maxY));
+
+	for (unsigned int tileY = pixelMinY / TILE_HEIGHT; tileY <= pixelMaxY / TILE_HEIGHT; ++tileY)
+	{
+		for (unsigned int tileX = pixelMinX / TILE_WIDTH; tileX <= pixelMaxX / TILE_WIDTH; ++tileX)
+		{
+			// Whole tile is nearer than bounds
+			if (minDepth > _tiles[tileY * TILES_X + tileX].MaxDepth)
+			{
+				continue;
+			}
+
+			const unsigned int startX = Math::Max(pixelMinX, tileX * TILE_WIDTH);
+			const unsigned int startY = Math::Max(pixelMinY, tileY * TILE_HEIGHT);
+			const unsigned int endX = Math::Min(pixelMaxX, tileX * TILE_WIDTH + TILE_WIDTH - 1);
+			const unsigned int endY = Math::Min(pixelMaxY, tileY * TILE_HEIGHT + TILE_HEIGHT - 1);
+			for (unsigned int y = startY; y <= endY; ++y)
+			{
+				for (unsigned int x = startX; x <= endX; ++x)
+				{
+					if (minDepth <= _depth[y * WIDTH + x])
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
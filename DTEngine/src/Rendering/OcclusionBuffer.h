@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Rendering/MeshBase.h"
+#include "Utility/Math.h"
+
+// Low resolution CPU depth buffer used to cull objects hidden behind occluders, doesn't need GPU at all
+// Occluder triangles are binned into screen tiles first, then each tile is rasterized independently with SIMD
+// Every tile keeps its farthest depth, so most occludees are rejected or accepted without touching pixels
+class OcclusionBuffer final
+{
+public:
+	static const unsigned int WIDTH = 256;
+	static const unsigned int HEIGHT = 128;
+	static const unsigned int TILE_WIDTH = 32;
+	static const unsigned int TILE_HEIGHT = 16;
+	static const unsigned int TILES_X = WIDTH / TILE_WIDTH;
+	static const unsigned int TILES_Y = HEIGHT / TILE_HEIGHT;
+	static const unsigned int TILES_COUNT = TILES_X * TILES_Y;
+
+private:
+	// Triangle in screen space as edge functions and depth plane, inside pixels have all edge functions non-negative
+	struct ScreenTriangle
+	{
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		float DepthX;
+		float DepthY;
+		float DepthC;
+		// Screen space bounds in pixels, inclusive
+		unsigned int MinX;
+		unsigned int MinY;
+		unsigned int MaxX;
+		unsigned int MaxY;
+	};
+
+	struct Tile
+	{
+		DynamicArray<unsigned int> Triangles;
+		// Farthest depth in the tile, anything nearer than that may be visible
+		float MaxDepth;
+	};
+
+	// Depth in [0, 1] range like in D3D, rows of WIDTH pixels
+	DynamicArray<float> _depth;
+	DynamicArray<ScreenTriangle> _triangles;
+	Tile _tiles[TILES_COUNT];
+
+	// Reused between occluders, so adding them doesn't allocate once those have grown enough
+	DynamicArray<Vector4> _clipPositions;
+
+public:
+	OcclusionBuffer();
+
+private:
+	void AddTriangle(const Vector4& clip0, const Vector4& clip1, const Vector4& clip2);
+	void RasterizeTriangle(const ScreenTriangle& triangle, unsigned int tileMinX, unsigned int tileMinY, unsigned int tileMaxX, unsigned int tileMaxY);
+
+public:
+	// Resets depth to far plane and removes all binned occluders
+	void Clear();
+
+	// Transforms occluder to screen space and bins its triangles into tiles, nothing is rasterized until Rasterize is called
+	// Triangles crossing near plane are skipped, missing occluder only makes culling less effective
+	// Positions are read with given stride in bytes, so they can be part of bigger vertices
+	void AddOccluder(const Vector3* positions, unsigned int positionsStride, unsigned int positionsCount, const unsigned int* indices, unsigned int indicesCount, const Matrix& modelViewProjection);
+
+	// Rasterizes all binned triangles, tiles write only to their own pixels so they can be processed in parallel
+	void Rasterize();
+	void RasterizeTile(unsigned int tileIndex);
+
+	// Returns false only if world space bounds are hidden behind rasterized occluders
+	bool IsVisible(const Vector3& min, const Vector3& max, const Matrix& viewProjection) const;
+};
@@ -1,7 +1,16 @@
 #include "RenderState.h"
 
+#include <atomic>
+
 #include "Graphics.h"
 
+unsigned int RenderState::GenerateID()
+{
+	// Materials may create states on loading threads
+	static std::atomic<unsigned int> nextID(1);
+	return nextID++;
+}
+
 bool RenderState::Initialize(ID3D11Device* device)
 {
 	if (!device)
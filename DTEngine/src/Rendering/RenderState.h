@@ -194,29 +194,57 @@ public:
 	}
 };
 
+// Packs all params into a single value, each of them fits into 8 bits
+struct RenderStateParamsHasher final
+{
+	inline size_t operator()(const RenderStateParams& params) const
+	{
+		const unsigned long long packed = (unsigned long long)params.GetCullMode() | ((unsigned long long)params.GetFillMode() << 8) |
+			((unsigned long long)params.GetZWrite() << 16) | ((unsigned long long)params.GetSrcBlendMode() << 24) |
+			((unsigned long long)params.GetDestBlendMode() << 32) | ((unsigned long long)params.GetZTestFunction() << 40);
+		return Hash<unsigned long long>()(packed);
+	}
+};
+
+// Immutable once created, identical states are shared through Graphics::GetRenderState
 struct RenderState final
 {
 	friend class Graphics;
 
 private:
 	RenderStateParams _params;
+	// Unique for the whole run, unlike address of the state which may be reused after it's freed
+	unsigned int _id;
 
 	ID3D11DepthStencilState* _depthStencilState;
 	ID3D11RasterizerState* _rasterizerState;
 
 private:
-	inline RenderState(const RenderStateParams& renderStateParams) : _params(renderStateParams), _depthStencilState(nullptr), _rasterizerState(nullptr)
+	inline RenderState(const RenderStateParams& renderStateParams) : _params(renderStateParams), _id(GenerateID()), _depthStencilState(nullptr), _rasterizerState(nullptr)
 	{}
-	inline RenderState() : _depthStencilState(nullptr), _rasterizerState(nullptr)
+	inline RenderState() : _id(GenerateID()), _depthStencilState(nullptr), _rasterizerState(nullptr)
 	{}
 	inline RenderState(const RenderState& other) = delete;
 	inline RenderState(RenderState&& other) = delete;
 
+	// Never returns 0, so it can mark no state
+	static unsigned int GenerateID();
+
 	bool Initialize(ID3D11Device* device);
 
 public:
+	inline ~RenderState()
+	{
+		Shutdown();
+	}
+
 	void Shutdown();
 
+	inline const RenderStateParams& GetParams() const
+	{
+		return _params;
+	}
+
 	inline bool operator==(const RenderState& other) const
 	{
 		return _params == other._params;
@@ -9,53 +9,78 @@
 #include "GameFramework/Entity.h"
 #include "GameFramework/Components/Camera.h"
 #include "Rendering/MaterialParametersCollection.h"
+#include "Rendering/ObjectConstantsArena.h"
+#include "Rendering/Texture.h"
+#include "ResourceManagement/AssetID.h"
+#include "ResourceManagement/FileSystem.h"
+#include "ResourceManagement/Resources.h"
 #include "Utility/String.h"
 
-void ShaderVariable::SetGetterFunctionFromTypeDescription(const _D3D11_SHADER_TYPE_DESC& typeDescription)
+static const String SHADER_CACHE_DIRECTORY = DT_TEXT("Resources/Shaders/Cache/");
+
+void ShaderVariable::SetGetterFunction(ShaderVariableType type)
+{
+	switch (type)
+	{
+		case ShaderVariableType::Float:
+			VariableGetterFunction = &MaterialParametersCollection::GetFloat;
+			break;
+		case ShaderVariableType::Int:
+			VariableGetterFunction = &MaterialParametersCollection::GetInt;
+			break;
+		case ShaderVariableType::Vector2:
+			VariableGetterFunction = &MaterialParametersCollection::GetVector2;
+			break;
+		case ShaderVariableType::Vector3:
+			VariableGetterFunction = &MaterialParametersCollection::GetVector3;
+			break;
+		case ShaderVariableType::Vector4:
+			VariableGetterFunction = &MaterialParametersCollection::GetVector4;
+			break;
+		case ShaderVariableType::Matrix:
+			VariableGetterFunction = &MaterialParametersCollection::GetMatrix;
+			break;
+		default:
+			VariableGetterFunction = &MaterialParametersCollection::Get;
+			break;
+	}
+}
+
+static ShaderVariableType GetVariableType(const D3D11_SHADER_TYPE_DESC& typeDescription)
 {
-	VariableGetterFunction = &MaterialParametersCollection::Get;
 	if (typeDescription.Class == D3D_SVC_MATRIX_COLUMNS)
 	{
-		VariableGetterFunction = &MaterialParametersCollection::GetMatrix;
+		return ShaderVariableType::Matrix;
 	}
 	else if (typeDescription.Class == D3D_SVC_VECTOR)
 	{
 		unsigned int numberOfElements = typeDescription.Columns == 1 ? typeDescription.Rows : typeDescription.Columns;
 		switch (numberOfElements)
 		{
-			case 1:
-				break;
 			case 2:
-				VariableGetterFunction = &MaterialParametersCollection::GetVector2;
-				break;
+				return ShaderVariableType::Vector2;
 			case 3:
-				VariableGetterFunction = &MaterialParametersCollection::GetVector3;
-				break;
+				return ShaderVariableType::Vector3;
 			case 4:
-				VariableGetterFunction = &MaterialParametersCollection::GetVector4;
-				break;
+				return ShaderVariableType::Vector4;
 		}
 	}
 	else if (typeDescription.Class == D3D_SVC_SCALAR)
 	{
 		switch (typeDescription.Type)
 		{
-			case D3D_SVT_BOOL:
-				break;
-			case D3D_SVT_DOUBLE:
-				break;
 			case D3D_SVT_FLOAT:
-				VariableGetterFunction = &MaterialParametersCollection::GetFloat;
-				break;
+				return ShaderVariableType::Float;
 			case D3D_SVT_INT:
-				VariableGetterFunction = &MaterialParametersCollection::GetInt;
-				break;
+				return ShaderVariableType::Int;
 		}
 	}
 	else if (typeDescription.Class == D3D_SVC_OBJECT)
 	{
 		DT_ASSERT(false, DT_TEXT("Unsupported shader variable type!"));
 	}
+
+	return ShaderVariableType::Raw;
 }
 
 void const* ShaderVariable::Get(const MaterialParametersCollection& materialParametersCollection)
@@ -69,75 +94,245 @@ void const* ShaderVariable::Get(const MaterialParametersCollection& materialPara
 	return (rawPtr->*VariableGetterFunction)(Name);
 }
 
-bool ShaderConstantBuffer::Initialize(Graphics& graphics)
-{
-	unsigned int bufferSize = 0;
-	for (auto& variable : Variables)
-	{
-		bufferSize += variable->Size;
-	}
-
-	const D3D11_SUBRESOURCE_DATA bufferData = {0};
+ConstantBufferStorage::ConstantBufferStorage() : _buffer(nullptr), _lastSourceID(0), _lastSourceVersion(0), _lastOverridesID(0), _lastOverridesVersion(0), _lastGlobalVersion(0), _usesGlobals(false), _isUploaded(false)
+{}
 
+bool ConstantBufferStorage::Initialize(Graphics& graphics, unsigned int size)
+{
 	D3D11_BUFFER_DESC bufferDesc = {0};
 	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	bufferDesc.ByteWidth = bufferSize;
+	bufferDesc.ByteWidth = size;
 	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-	return graphics.CreateBuffer(bufferDesc, &_constantBuffer);
+	_uploadedData.assign(size, 0);
+	_stagingData.assign(size, 0);
+	_lastSourceID = 0;
+	_isUploaded = false;
+
+	return graphics.CreateBuffer(bufferDesc, &_buffer);
+}
+
+void ConstantBufferStorage::Shutdown()
+{
+	RELEASE_COM(_buffer);
+	_baked = nullptr;
+	_uploadedData.clear();
+	_stagingData.clear();
+	_lastSourceID = 0;
+	_isUploaded = false;
+}
+
+void ConstantBufferStorage::SetBaked(const SharedPtr<const BakedConstantBuffer>& baked)
+{
+	_baked = baked;
+	_isUploaded = false;
+}
+
+size_t ConstantBufferStorage::GetMemorySize() const
+{
+	return (_buffer != nullptr ? _uploadedData.size() : 0) + _uploadedData.capacity() + _stagingData.capacity();
+}
+
+bool ShaderConstantBuffer::Initialize(Graphics& graphics)
+{
+	if (Frequency == ConstantBufferFrequency::PerMaterial)
+	{
+		// Per material buffers are created by materials using this shader
+		return true;
+	}
+
+	return _sharedStorage.Initialize(graphics, Size);
 }
 
 void ShaderConstantBuffer::Shutdown()
 {
-	RELEASE_COM(_constantBuffer);
+	_sharedStorage.Shutdown();
 }
 
-void ShaderConstantBuffer::Update(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection)
+void ShaderConstantBuffer::Update(Graphics& graphics, ConstantBufferStorage& storage, const MaterialParametersCollection& materialParametersCollection, const MaterialParameterOverrides* overrides) const
 {
-	void* data = graphics.Map(_constantBuffer);
-	if (!data)
+	if (!storage._buffer)
 	{
-		graphics.Unmap(_constantBuffer);
 		return;
 	}
 
-	for (auto& variable : Variables)
+	const MaterialParametersCollection& globalParametersCollection = MaterialParametersCollection::GLOBAL;
+	const unsigned long long sourceID = materialParametersCollection.GetID();
+	const unsigned int sourceVersion = materialParametersCollection.GetVersion();
+	const unsigned long long overridesID = overrides ? overrides->GetID() : 0;
+	const unsigned int overridesVersion = overrides ? overrides->GetVersion() : 0;
+	const unsigned int globalVersion = globalParametersCollection.GetVersion();
+
+	const bool isUpToDate = storage._isUploaded && storage._lastSourceID == sourceID && storage._lastSourceVersion == sourceVersion &&
+		storage._lastOverridesID == overridesID && storage._lastOverridesVersion == overridesVersion && (!storage._usesGlobals || storage._lastGlobalVersion == globalVersion);
+
+	if (!isUpToDate)
 	{
-		void const* variableData = variable->Get(materialParametersCollection);
-		if (variableData == nullptr)
+		const BakedConstantBuffer* baked = storage._baked && storage._baked->Data.size() == Size && storage._baked->Variables.size() == Variables.size() ? storage._baked.get() : nullptr;
+		if (baked)
+		{
+			memcpy(storage._stagingData.data(), baked->Data.data(), Size);
+		}
+		else
 		{
-			variableData = variable->Get(MaterialParametersCollection::GLOBAL);
+			std::fill(storage._stagingData.begin(), storage._stagingData.end(), (unsigned char)0);
 		}
+		storage._usesGlobals = false;
 
-		if (variableData == nullptr)
+		const size_t variablesCount = Variables.size();
+		for (size_t i = 0; i < variablesCount; ++i)
 		{
-			continue;
+			const auto& variable = Variables[i];
+			void const* variableData = overrides ? overrides->Get(variable->NameHash, variable->Size) : nullptr;
+			if (variableData == nullptr)
+			{
+				variableData = variable->Get(materialParametersCollection);
+			}
+			if (variableData == nullptr && baked && baked->Variables[i])
+			{
+				// Staging data holds the baked value already
+				continue;
+			}
+
+			if (variableData == nullptr && &materialParametersCollection != &globalParametersCollection)
+			{
+				// Remember that this buffer depends on globals even if the global is not set yet
+				storage._usesGlobals = true;
+				variableData = variable->Get(globalParametersCollection);
+			}
+
+			if (variableData == nullptr)
+			{
+				continue;
+			}
+
+			memcpy(storage._stagingData.data() + variable->Offset, variableData, variable->Size);
 		}
 
-		void* destPtr = (char*)data + variable->Offset;
-		memcpy(destPtr, variableData, variable->Size);
+		storage._lastSourceID = sourceID;
+		storage._lastSourceVersion = sourceVersion;
+		storage._lastOverridesID = overridesID;
+		storage._lastOverridesVersion = overridesVersion;
+		storage._lastGlobalVersion = globalVersion;
+
+		// Parameters might have been set to the same values, upload only if data really differs
+		if (!storage._isUploaded || memcmp(storage._stagingData.data(), storage._uploadedData.data(), Size) != 0)
+		{
+			// Map unmaps the buffer itself when it fails
+			void* data = graphics.Map(storage._buffer);
+			if (!data)
+			{
+				return;
+			}
+
+			memcpy(data, storage._stagingData.data(), Size);
+			graphics.Unmap(storage._buffer);
+
+			storage._uploadedData.swap(storage._stagingData);
+			storage._isUploaded = true;
+		}
 	}
 
-	graphics.Unmap(_constantBuffer);
-	graphics.SetVSConstantBuffers(Index, 1, &_constantBuffer);
+	graphics.SetVSConstantBuffers(Index, 1, &storage._buffer);
 }
 
-Shader::Shader() : _vertexShader(nullptr), _pixelShader(nullptr), _inputLayout(nullptr)
-{}
+void ShaderConstantBuffer::Update(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection)
+{
+	Update(graphics, _sharedStorage, materialParametersCollection, nullptr);
+}
+
+// Reads includes through file system so shaders can be compiled from packs
+// Includes are resolved relative to the file including them, like D3D_COMPILE_STANDARD_FILE_INCLUDE does
+class ShaderInclude final : public ID3DInclude
+{
+private:
+	String _sourceDirectory;
+	// Directories of opened includes by their data, nested includes are resolved relative to them
+	Map<LPCVOID, String> _includeDirectories;
+
+public:
+	ShaderInclude(const String& sourcePath) : _sourceDirectory(GetDirectory(sourcePath))
+	{}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+	{
+		const auto parentDirectory = _includeDirectories.find(parentData);
+		const String& directory = parentDirectory != _includeDirectories.end() ? parentDirectory->second : _sourceDirectory;
+		const std::string name(fileName);
+		const String path = directory + String(name.begin(), name.end());
+
+		DynamicArray<unsigned char> source;
+		if (!gFileSystem.ReadFile(path, source))
+		{
+			return E_FAIL;
+		}
+
+		unsigned char* includeData = new unsigned char[source.size() + 1];
+		memcpy(includeData, source.data(), source.size());
+		_includeDirectories[includeData] = GetDirectory(path);
+
+		*data = includeData;
+		*bytes = (UINT)source.size();
+		return S_OK;
+	}
+
+	HRESULT __stdcall Close(LPCVOID data) override
+	{
+		_includeDirectories.erase(data);
+		delete[] (const unsigned char*)data;
+		return S_OK;
+	}
+};
+
+Shader::Shader() : _pixelShader(nullptr), _objectConstantsBufferIndex(-1), _perMaterialLayoutHash(0), _bytecodeSize(0), _version(0)
+{
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		_vertexShaders[i] = nullptr;
+		_inputLayouts[i] = nullptr;
+	}
+}
 
 Shader::~Shader()
 {}
 
-bool Shader::GatherConstantBuffersInfo(ID3D10Blob* compiledShader)
+bool Shader::Compile(const ShaderCompileRequest& request, CompiledShader& compiledShader)
 {
-	if (!compiledShader)
+	DynamicArray<unsigned char> source;
+	if (!gFileSystem.ReadFile(request.SourcePath, source))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot read shader source: %s"), request.SourcePath.c_str());
+		return false;
+	}
+
+	const std::string sourceName(request.SourcePath.begin(), request.SourcePath.end());
+	const D3D_SHADER_MACRO defines[] = {{request.Define.c_str(), "1"}, {nullptr, nullptr}};
+	ShaderInclude include(request.SourcePath);
+	ID3D10Blob* bytecode = nullptr;
+	ID3D10Blob* errors = nullptr;
+	HRESULT result = D3DCompile(source.data(), source.size(), sourceName.c_str(), request.Define.empty() ? nullptr : defines, &include,
+								request.EntryPoint.c_str(), request.Target.c_str(), request.Flags, 0, &bytecode, &errors);
+	if (FAILED(result))
 	{
+		if (errors)
+		{
+			const std::string message((const char*)errors->GetBufferPointer(), errors->GetBufferSize());
+			gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot compile shader (%s): %s"), request.SourcePath.c_str(), String(message.begin(), message.end()).c_str());
+		}
+
+		RELEASE_COM(errors);
+		RELEASE_COM(bytecode);
 		return false;
 	}
+	RELEASE_COM(errors);
+
+	const unsigned char* bytecodePointer = (const unsigned char*)bytecode->GetBufferPointer();
+	compiledShader.Bytecode.assign(bytecodePointer, bytecodePointer + bytecode->GetBufferSize());
+	RELEASE_COM(bytecode);
 
 	ID3D11ShaderReflection* reflectedShader = nullptr;
-	HRESULT result = D3DReflect(compiledShader->GetBufferPointer(), compiledShader->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)&reflectedShader);
+	result = D3DReflect(compiledShader.Bytecode.data(), compiledShader.Bytecode.size(), IID_ID3D11ShaderReflection, (void**)&reflectedShader);
 	HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot reflect shader!")));
 
 	// Get shader description
@@ -149,122 +344,284 @@ bool Shader::GatherConstantBuffersInfo(ID3D10Blob* compiledShader)
 	{
 		D3D11_SHADER_INPUT_BIND_DESC reflectedBoundResourceDesc;
 		result = reflectedShader->GetResourceBindingDesc(i, &reflectedBoundResourceDesc);
+		if (FAILED(result))
+		{
+			continue;
+		}
 
-		switch (reflectedBoundResourceDesc.Type)
+		if (reflectedBoundResourceDesc.Type == D3D_SIT_TEXTURE || reflectedBoundResourceDesc.Type == D3D_SIT_SAMPLER)
 		{
-			case D3D_SIT_CBUFFER:
-				{
-					ID3D11ShaderReflectionConstantBuffer* reflectedConstantBuffer = reflectedShader->GetConstantBufferByName(reflectedBoundResourceDesc.Name);
-					CreateConstantBufferAndVariables(reflectedBoundResourceDesc, reflectedConstantBuffer);
-				}
-				break;
-			case D3D_SIT_TEXTURE:
-				break;
-			case D3D_SIT_SAMPLER:
-				break;
+			ShaderResourceReflection resource;
+			const std::string name = reflectedBoundResourceDesc.Name;
+			resource.Name = String(name.begin(), name.end());
+			resource.Index = reflectedBoundResourceDesc.BindPoint;
+			if (reflectedBoundResourceDesc.Type == D3D_SIT_TEXTURE)
+			{
+				compiledShader.Textures.push_back(std::move(resource));
+			}
+			else
+			{
+				compiledShader.Samplers.push_back(std::move(resource));
+			}
+			continue;
 		}
+
+		if (reflectedBoundResourceDesc.Type != D3D_SIT_CBUFFER)
+		{
+			continue;
+		}
+
+		ID3D11ShaderReflectionConstantBuffer* reflectedConstantBuffer = reflectedShader->GetConstantBufferByName(reflectedBoundResourceDesc.Name);
+		D3D11_SHADER_BUFFER_DESC reflectedConstantBufferDesc;
+		result = reflectedConstantBuffer->GetDesc(&reflectedConstantBufferDesc);
+		HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain constant buffer description!")); RELEASE_COM(reflectedShader));
+
+		ShaderConstantBufferReflection constantBuffer;
+		const std::string name = reflectedConstantBufferDesc.Name;
+		constantBuffer.Name = String(name.begin(), name.end());
+		constantBuffer.Index = reflectedBoundResourceDesc.BindPoint;
+		constantBuffer.Size = reflectedConstantBufferDesc.Size;
+
+		for (unsigned int j = 0; j < reflectedConstantBufferDesc.Variables; ++j)
+		{
+			// Get variable description
+			ID3D11ShaderReflectionVariable* reflectedVariable = reflectedConstantBuffer->GetVariableByIndex(j);
+			D3D11_SHADER_VARIABLE_DESC reflectedVariableDesc;
+			result = reflectedVariable->GetDesc(&reflectedVariableDesc);
+			HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain variable description!")); RELEASE_COM(reflectedShader));
+
+			ID3D11ShaderReflectionType* reflectedVariableType = reflectedVariable->GetType();
+			D3D11_SHADER_TYPE_DESC reflectedVariableTypeDesc;
+			result = reflectedVariableType->GetDesc(&reflectedVariableTypeDesc);
+			HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain variable type description!")); RELEASE_COM(reflectedShader));
+
+			ShaderVariableReflection variable;
+			const std::string variableName = reflectedVariableDesc.Name;
+			variable.Name = String(variableName.begin(), variableName.end());
+			variable.Offset = reflectedVariableDesc.StartOffset;
+			variable.Size = reflectedVariableDesc.Size;
+			variable.Type = GetVariableType(reflectedVariableTypeDesc);
+			constantBuffer.Variables.push_back(std::move(variable));
+		}
+
+		compiledShader.ConstantBuffers.push_back(std::move(constantBuffer));
 	}
 
+	RELEASE_COM(reflectedShader);
 	return true;
 }
 
-bool Shader::CreateConstantBufferAndVariables(const _D3D11_SHADER_INPUT_BIND_DESC& reflectedResourceDesc, ID3D11ShaderReflectionConstantBuffer* reflectedConstantBuffer)
+bool Shader::GatherConstantBuffersInfo(const CompiledShader& compiledShader)
 {
-	D3D11_SHADER_BUFFER_DESC reflectedConstantBufferDesc;
-	HRESULT result = reflectedConstantBuffer->GetDesc(&reflectedConstantBufferDesc);
-	HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain constant buffer description!")));
+	for (const ShaderConstantBufferReflection& reflectedConstantBuffer : compiledShader.ConstantBuffers)
+	{
+		if (!CreateConstantBufferAndVariables(reflectedConstantBuffer))
+		{
+			return false;
+		}
+	}
 
+	return true;
+}
+
+bool Shader::CreateConstantBufferAndVariables(const ShaderConstantBufferReflection& reflectedConstantBuffer)
+{
 	// Create constant buffer
 	UniquePtr<ShaderConstantBuffer> constantBuffer = std::make_unique<ShaderConstantBuffer>();
-	const std::string name = reflectedConstantBufferDesc.Name;
-	constantBuffer->Name = String(name.begin(), name.end());
-	constantBuffer->Index = reflectedResourceDesc.BindPoint;
+	constantBuffer->Name = reflectedConstantBuffer.Name;
+	constantBuffer->Index = (unsigned char)reflectedConstantBuffer.Index;
+	constantBuffer->Size = reflectedConstantBuffer.Size;
 
 	// Create variables that given constant buffer contains
-	for (unsigned int j = 0; j < reflectedConstantBufferDesc.Variables; ++j)
+	for (const ShaderVariableReflection& reflectedVariable : reflectedConstantBuffer.Variables)
 	{
-		// Get variable description
-		ID3D11ShaderReflectionVariable* reflectedVariable = reflectedConstantBuffer->GetVariableByIndex(j);
-		D3D11_SHADER_VARIABLE_DESC reflectedVariableDesc;
-		result = reflectedVariable->GetDesc(&reflectedVariableDesc);
-		HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain variable description!")));
-
-		ID3D11ShaderReflectionType* reflectedVariableType = reflectedVariable->GetType();
-		D3D11_SHADER_TYPE_DESC reflectedVariableTypeDesc;
-		result = reflectedVariableType->GetDesc(&reflectedVariableTypeDesc);
-		HR_REACTION(result, gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot obtain variable type description!")));
-
-
-		// Create variable
 		UniquePtr<ShaderVariable> variable = std::make_unique<ShaderVariable>();
-		variable->Offset = reflectedVariableDesc.StartOffset;
-		const std::string name = reflectedVariableDesc.Name;
-		variable->Name = String(name.begin(), name.end());
-		variable->Size = reflectedVariableDesc.Size;
-		variable->SetGetterFunctionFromTypeDescription(reflectedVariableTypeDesc);
+		variable->Offset = reflectedVariable.Offset;
+		variable->Name = reflectedVariable.Name;
+		variable->NameHash = HashString(variable->Name);
+		variable->Size = reflectedVariable.Size;
+		variable->SetGetterFunction(reflectedVariable.Type);
 
 		// Push variable to array
 		constantBuffer->Variables.push_back(std::move(variable));
 	}
 
+	// Buffer update frequency is determined by its name, buffers that are neither per frame nor per object are per material ones
 	if (Contains(constantBuffer->Name, DT_TEXT("PerFrame"), false))
 	{
+		constantBuffer->Frequency = ConstantBufferFrequency::PerFrame;
 		_perFrameBuffers.push_back(std::move(constantBuffer));
 	}
+	else if (Contains(constantBuffer->Name, DT_TEXT("PerObject"), false))
+	{
+		constantBuffer->Frequency = ConstantBufferFrequency::PerObject;
+		_perObjectBuffers.push_back(std::move(constantBuffer));
+	}
 	else
 	{
-		_perDrawCallBuffers.push_back(std::move(constantBuffer));
+		constantBuffer->Frequency = ConstantBufferFrequency::PerMaterial;
+		_perMaterialBuffers.push_back(std::move(constantBuffer));
 	}
 
 	return true;
 }
 
-bool Shader::Load(const String& path)
+void Shader::FindObjectConstantsBuffer()
 {
-	Asset::Load(path);
+	_objectConstantsBufferIndex = -1;
 
-	const String vsFileName = path + DT_TEXT("VS.hlsl");
-	const String psFileName = path + DT_TEXT("PS.hlsl");
-	Graphics& graphics = gGraphics;
+	// Arena slots can be bound only if the whole per object data is a single buffer laid out like ObjectConstants
+	if (_perObjectBuffers.size() != 1)
+	{
+		return;
+	}
 
-	HRESULT result = D3DCompileFromFile(vsFileName.c_str(), nullptr, nullptr, "main", "vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &_vertexShaderBuffer, nullptr);
-	HR(result);
+	const ShaderConstantBuffer& buffer = *_perObjectBuffers[0];
+	if (buffer.Size > sizeof(ObjectConstants))
+	{
+		return;
+	}
 
-	result = D3DCompileFromFile(psFileName.c_str(), nullptr, nullptr, "main", "ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &_pixelShaderBuffer, nullptr);
-	HR(result);
+	struct ObjectConstant
+	{
+		const Char* Name;
+		unsigned int Offset;
+		unsigned int Size;
+	};
+	static const ObjectConstant OBJECT_CONSTANTS[] =
+	{
+		{DT_TEXT("Model2WorldMatrix"), offsetof(ObjectConstants, Model2WorldMatrix), sizeof(Matrix)},
+		{DT_TEXT("PositionDequantizeScale"), offsetof(ObjectConstants, PositionDequantizeScale), sizeof(Vector4)},
+		{DT_TEXT("PositionDequantizeOffset"), offsetof(ObjectConstants, PositionDequantizeOffset), sizeof(Vector4)},
+	};
 
-	return true;
+	// Every variable has to be one of ObjectConstants members at the same offset
+	for (const auto& variable : buffer.Variables)
+	{
+		bool matches = false;
+		for (const ObjectConstant& constant : OBJECT_CONSTANTS)
+		{
+			if (variable->Name == constant.Name && variable->Offset == constant.Offset && variable->Size == constant.Size)
+			{
+				matches = true;
+				break;
+			}
+		}
+
+		if (!matches)
+		{
+			return;
+		}
+	}
+
+	_objectConstantsBufferIndex = buffer.Index;
 }
 
-bool Shader::Initialize()
+void Shader::CalculatePerMaterialLayoutHash()
 {
-	if (!_vertexShaderBuffer || !_pixelShaderBuffer)
+	unsigned long long hash = HASH_SEED;
+	for (const auto& constantBuffer : _perMaterialBuffers)
 	{
-		return false;
+		hash = HashBytes(&constantBuffer->Size, sizeof(constantBuffer->Size), hash);
+		for (const auto& variable : constantBuffer->Variables)
+		{
+			hash = HashBytes(variable->Name.data(), variable->Name.size() * sizeof(Char), hash);
+			hash = HashBytes(&variable->Offset, sizeof(variable->Offset), hash);
+			hash = HashBytes(&variable->Size, sizeof(variable->Size), hash);
+		}
 	}
 
-	Graphics& graphics = gGraphics;
+	_perMaterialLayoutHash = hash;
+}
 
-	if (!graphics.CreateVertexShader(_vertexShaderBuffer, &_vertexShader))
+// Shared by all shaders, so hits and misses are counted for the whole run
+static ShaderCache& GetShaderCache()
+{
+	static ShaderCache shaderCache(SHADER_CACHE_DIRECTORY);
+	return shaderCache;
+}
+
+bool Shader::CompileCached(const ShaderCompileRequest& request, CompiledShader& compiledShader)
+{
+	static const ShaderCache::CompilerFunction compiler = &Shader::Compile;
+	return GetShaderCache().Get(request, compiler, compiledShader);
+}
+
+bool Shader::Load(const String& path)
+{
+	Asset::Load(path);
+
+	ShaderCompileRequest request;
+	request.EntryPoint = "main";
+	request.Flags = D3D10_SHADER_ENABLE_STRICTNESS;
+
+	request.SourcePath = path + DT_TEXT("VS.hlsl");
+	request.Target = "vs_5_0";
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
 	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex shader"));
-		return false;
+		request.Define = GetVertexFormatShaderDefine((VertexFormat)i);
+		if (!CompileCached(request, _compiledVertexShaders[i]))
+		{
+			return false;
+		}
 	}
-	if (!graphics.CreatePixelShader(_pixelShaderBuffer, &_pixelShader))
+
+	request.SourcePath = path + DT_TEXT("PS.hlsl");
+	request.Target = "ps_5_0";
+	request.Define.clear();
+	if (!CompileCached(request, _compiledPixelShader))
 	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create pixel shader"));
 		return false;
 	}
 
-	if (!GatherConstantBuffersInfo(_vertexShaderBuffer))
+	// Variants differ only in vertex input, so constant buffers are taken from the first one
+	if (!GatherConstantBuffersInfo(_compiledVertexShaders[0]) || !GatherConstantBuffersInfo(_compiledPixelShader))
 	{
 		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to obtain shader reflection info"));
 		return false;
 	}
+	CalculatePerMaterialLayoutHash();
 
-	if (!GatherConstantBuffersInfo(_pixelShaderBuffer))
+#if DT_DEBUG
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Shader cache: %u hits, %u misses so far"), GetShaderCache().GetHitsCount(), GetShaderCache().GetMissesCount());
+#endif
+
+	return true;
+}
+
+bool Shader::Initialize()
+{
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		if (_compiledVertexShaders[i].Bytecode.empty())
+		{
+			return false;
+		}
+	}
+	if (_compiledPixelShader.Bytecode.empty())
 	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to obtain shader reflection info"));
+		return false;
+	}
+
+	Graphics& graphics = gGraphics;
+
+	_bytecodeSize = _compiledPixelShader.Bytecode.size();
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		_bytecodeSize += _compiledVertexShaders[i].Bytecode.size();
+	}
+
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		if (!graphics.CreateVertexShader(_compiledVertexShaders[i].Bytecode.data(), _compiledVertexShaders[i].Bytecode.size(), &_vertexShaders[i]))
+		{
+			gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create vertex shader"));
+			return false;
+		}
+	}
+	if (!graphics.CreatePixelShader(_compiledPixelShader.Bytecode.data(), _compiledPixelShader.Bytecode.size(), &_pixelShader))
+	{
+		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create pixel shader"));
 		return false;
 	}
 
@@ -277,41 +634,61 @@ bool Shader::Initialize()
 		}
 	}
 
-	for (const auto& perDrawCallBuffer : _perDrawCallBuffers)
+	for (const auto& perObjectBuffer : _perObjectBuffers)
 	{
-		if (!perDrawCallBuffer->Initialize(graphics))
+		if (!perObjectBuffer->Initialize(graphics))
 		{
-			gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot initialize buffer named %s!"), perDrawCallBuffer->Name.c_str());
+			gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot initialize buffer named %s!"), perObjectBuffer->Name.c_str());
 			return false;
 		}
 	}
 
-	RELEASE_COM(_pixelShaderBuffer);
+	FindObjectConstantsBuffer();
 
-	D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[3];
-	inputLayoutDesc[0] = {0};
-	inputLayoutDesc[1] = {0};
-	inputLayoutDesc[2] = {0};
+	_textures = _compiledPixelShader.Textures;
+	for (const ShaderResourceReflection& sampler : _compiledPixelShader.Samplers)
+	{
+		_samplerSlots.push_back(sampler.Index);
+	}
+	if (!_textures.empty())
+	{
+		_defaultTexture = gResources.Get<Texture>();
+	}
 
-	inputLayoutDesc[0].SemanticName = "POSITION";
-	inputLayoutDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	inputLayoutDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	_compiledPixelShader = CompiledShader();
 
-	inputLayoutDesc[1].SemanticName = "NORMAL";
-	inputLayoutDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	inputLayoutDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		const VertexFormat vertexFormat = (VertexFormat)i;
 
-	inputLayoutDesc[2].SemanticName = "TEXCOORD";
-	inputLayoutDesc[2].Format = DXGI_FORMAT_R32G32_FLOAT;
-	inputLayoutDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[3];
+		inputLayoutDesc[0] = {0};
+		inputLayoutDesc[1] = {0};
+		inputLayoutDesc[2] = {0};
 
-	if (!graphics.CreateInputLayout(inputLayoutDesc, sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC), _vertexShaderBuffer->GetBufferPointer(), (size_t)_vertexShaderBuffer->GetBufferSize(), &_inputLayout))
-	{
-		gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create input layout"));
-		return false;
-	}
+		inputLayoutDesc[0].SemanticName = "POSITION";
+		inputLayoutDesc[0].Format = vertexFormat == VertexFormat::Quantized ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+		inputLayoutDesc[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		inputLayoutDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		inputLayoutDesc[1].SemanticName = "NORMAL";
+		inputLayoutDesc[1].Format = vertexFormat == VertexFormat::Full ? DXGI_FORMAT_R32G32B32_FLOAT : DXGI_FORMAT_R16G16_SNORM;
+		inputLayoutDesc[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		inputLayoutDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		inputLayoutDesc[2].SemanticName = "TEXCOORD";
+		inputLayoutDesc[2].Format = vertexFormat == VertexFormat::Full ? DXGI_FORMAT_R32G32_FLOAT : DXGI_FORMAT_R16G16_FLOAT;
+		inputLayoutDesc[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		inputLayoutDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		if (!graphics.CreateInputLayout(inputLayoutDesc, sizeof(inputLayoutDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC), _compiledVertexShaders[i].Bytecode.data(), _compiledVertexShaders[i].Bytecode.size(), &_inputLayouts[i]))
+		{
+			gDebug.Print(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create input layout"));
+			return false;
+		}
 
-	RELEASE_COM(_vertexShaderBuffer);
+		_compiledVertexShaders[i] = CompiledShader();
+	}
 
 	return true;
 }
@@ -323,33 +700,137 @@ void Shader::Shutdown()
 		perFrameBuffer->Shutdown();
 	}
 
-	for (const auto& perDrawCallBuffer : _perDrawCallBuffers)
+	for (const auto& perObjectBuffer : _perObjectBuffers)
 	{
-		perDrawCallBuffer->Shutdown();
+		perObjectBuffer->Shutdown();
 	}
 
-	_perDrawCallBuffers.clear();
+	_perObjectBuffers.clear();
+	_perMaterialBuffers.clear();
 	_perFrameBuffers.clear();
+	_objectConstantsBufferIndex = -1;
+	_perMaterialLayoutHash = 0;
+	_textures.clear();
+	_samplerSlots.clear();
+	_defaultTexture = nullptr;
 
-	RELEASE_COM(_inputLayout);
+	for (unsigned int i = 0; i < VERTEX_FORMATS_COUNT; ++i)
+	{
+		RELEASE_COM(_inputLayouts[i]);
+		RELEASE_COM(_vertexShaders[i]);
+		_compiledVertexShaders[i] = CompiledShader();
+	}
 	RELEASE_COM(_pixelShader);
-	RELEASE_COM(_vertexShader);
-	RELEASE_COM(_vertexShaderBuffer);
-	RELEASE_COM(_pixelShaderBuffer);
+	_compiledPixelShader = CompiledShader();
+	_bytecodeSize = 0;
 }
 
-void Shader::UpdatePerFrameBuffers(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection)
+size_t Shader::GetMemorySize() const
+{
+	size_t size = _bytecodeSize;
+	for (const auto& perFrameBuffer : _perFrameBuffers)
+	{
+		size += perFrameBuffer->GetMemorySize();
+	}
+	for (const auto& perObjectBuffer : _perObjectBuffers)
+	{
+		size += perObjectBuffer->GetMemorySize();
+	}
+
+	return size;
+}
+
+void Shader::GetSourceFiles(DynamicArray<String>& sourceFiles) const
+{
+	ShaderCache::GetSourceFiles(_path + DT_TEXT("VS.hlsl"), sourceFiles);
+	ShaderCache::GetSourceFiles(_path + DT_TEXT("PS.hlsl"), sourceFiles);
+}
+
+bool Shader::TakeReloaded(Asset& reloaded)
+{
+	// Resources reload assets as instances of the same type
+	Shader& shader = static_cast<Shader&>(reloaded);
+	if (!shader.Initialize())
+	{
+		return false;
+	}
+
+	std::swap(_vertexShaders, shader._vertexShaders);
+	std::swap(_pixelShader, shader._pixelShader);
+	std::swap(_inputLayouts, shader._inputLayouts);
+	std::swap(_perFrameBuffers, shader._perFrameBuffers);
+	std::swap(_perMaterialBuffers, shader._perMaterialBuffers);
+	std::swap(_perObjectBuffers, shader._perObjectBuffers);
+	std::swap(_objectConstantsBufferIndex, shader._objectConstantsBufferIndex);
+	std::swap(_perMaterialLayoutHash, shader._perMaterialLayoutHash);
+	std::swap(_textures, shader._textures);
+	std::swap(_samplerSlots, shader._samplerSlots);
+	std::swap(_defaultTexture, shader._defaultTexture);
+	std::swap(_bytecodeSize, shader._bytecodeSize);
+	++_version;
+
+	return true;
+}
+
+bool Shader::CreatePerMaterialStorages(Graphics& graphics, DynamicArray<ConstantBufferStorage>& storages) const
+{
+	storages.resize(_perMaterialBuffers.size());
+
+	const size_t buffersCount = _perMaterialBuffers.size();
+	for (size_t i = 0; i < buffersCount; ++i)
+	{
+		if (!storages[i].Initialize(graphics, _perMaterialBuffers[i]->Size))
+		{
+			gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Cannot initialize buffer named %s!"), _perMaterialBuffers[i]->Name.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Shader::UpdatePerFrameBuffers(Graphics& graphics)
 {
 	for (const auto& constantBuffer : _perFrameBuffers)
 	{
-		constantBuffer->Update(graphics, materialParametersCollection);
+		constantBuffer->Update(graphics, MaterialParametersCollection::GLOBAL);
+	}
+}
+
+void Shader::UpdatePerMaterialBuffers(Graphics& graphics, DynamicArray<ConstantBufferStorage>& storages, const MaterialParametersCollection& materialParametersCollection,
+									  const MaterialParameterOverrides* overrides) const
+{
+	DT_ASSERT(storages.size() == _perMaterialBuffers.size(), DT_TEXT("Material storages do not match shader constant buffers"));
+
+	const size_t buffersCount = _perMaterialBuffers.size();
+	for (size_t i = 0; i < buffersCount; ++i)
+	{
+		_perMaterialBuffers[i]->Update(graphics, storages[i], materialParametersCollection, overrides);
 	}
 }
 
-void Shader::UpdatePerDrawCallBuffers(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection)
+void Shader::UpdatePerObjectBuffers(Graphics& graphics, const MaterialParametersCollection& objectParametersCollection)
 {
-	for (auto& constantBuffer : _perDrawCallBuffers)
+	for (auto& constantBuffer : _perObjectBuffers)
 	{
-		constantBuffer->Update(graphics, materialParametersCollection);
+		constantBuffer->Update(graphics, objectParametersCollection);
+	}
+}
+
+void Shader::BindTextures(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection, const MaterialParameterOverrides* overrides) const
+{
+	for (const ShaderResourceReflection& texture : _textures)
+	{
+		const Texture* materialTexture = overrides ? overrides->GetTexture(texture.Name) : nullptr;
+		if (!materialTexture)
+		{
+			materialTexture = materialParametersCollection.GetTexture(texture.Name);
+		}
+		if (!materialTexture)
+		{
+			materialTexture = _defaultTexture.get();
+		}
+
+		graphics.SetPSShaderResource(texture.Index, materialTexture ? materialTexture->GetView() : nullptr);
 	}
 }
\ No newline at end of file
@@ -2,20 +2,20 @@
 
 #include "ResourceManagement/Asset.h"
 #include "Utility/Math.h"
+#include "Rendering/VertexFormat.h"
+#include "Rendering/ShaderCache.h"
 
 struct ID3D11VertexShader;
 struct ID3D11PixelShader;
 struct ID3D11InputLayout;
 struct ID3D11Buffer;
 struct ID3D11DeviceContext;
-struct ID3D10Blob;
-struct ID3D11ShaderReflectionConstantBuffer;
-struct _D3D11_SHADER_INPUT_BIND_DESC;
-struct _D3D11_SHADER_TYPE_DESC;
 
 class Entity;
 class Graphics;
 class MaterialParametersCollection;
+class MaterialParameterOverrides;
+class Texture;
 
 struct ShaderVariable
 {
@@ -23,68 +23,203 @@ struct ShaderVariable
 
 public:
 	String Name;
+	// Overrides of material instances and baked parameters are matched by it
+	unsigned long long NameHash;
 	unsigned int Offset;
 	unsigned int Size;
 	VariableGetterFunctionPointer VariableGetterFunction;
 
-	void SetGetterFunctionFromTypeDescription(const _D3D11_SHADER_TYPE_DESC& typeDescription);
+	void SetGetterFunction(ShaderVariableType type);
 	void const* Get(const MaterialParametersCollection& materialParametersCollection);
 };
 
+enum class ConstantBufferFrequency
+{
+	// Filled only from global parameters (camera matrices etc.), uploaded once per camera pass
+	PerFrame,
+	// Filled from material parameters, each material owns its own GPU buffer
+	PerMaterial,
+	// Filled from currently rendered object parameters (model matrix)
+	PerObject
+};
+
+// Values resolved offline when materials are cooked, laid out exactly like the constant buffer they are baked for
+struct BakedConstantBuffer
+{
+	DynamicArray<unsigned char> Data;
+	// For each variable of the constant buffer, whether Data holds its value
+	DynamicArray<bool> Variables;
+};
+
+// GPU buffer backing a single instance of a reflected constant buffer
+// Keeps a copy of last uploaded data, so buffer is mapped only when its content really changes
+struct ConstantBufferStorage
+{
+	friend struct ShaderConstantBuffer;
+
+private:
+	ID3D11Buffer* _buffer;
+	// Baked values are used for variables missing in material parameters, before falling back to globals
+	SharedPtr<const BakedConstantBuffer> _baked;
+
+	DynamicArray<unsigned char> _uploadedData;
+	DynamicArray<unsigned char> _stagingData;
+
+	unsigned long long _lastSourceID;
+	unsigned int _lastSourceVersion;
+	// 0 if last upload had no instance overrides
+	unsigned long long _lastOverridesID;
+	unsigned int _lastOverridesVersion;
+	unsigned int _lastGlobalVersion;
+	bool _usesGlobals;
+	bool _isUploaded;
+
+public:
+	ConstantBufferStorage();
+
+	bool Initialize(Graphics& graphics, unsigned int size);
+	void Shutdown();
+
+	void SetBaked(const SharedPtr<const BakedConstantBuffer>& baked);
+
+	// GPU buffer together with its CPU copies
+	size_t GetMemorySize() const;
+};
+
 struct ShaderConstantBuffer
 {
 private:
-	ID3D11Buffer* _constantBuffer;
+	// Storage used by per frame and per object buffers (per material buffers are stored in materials)
+	ConstantBufferStorage _sharedStorage;
 
 public:
 	String Name;
 	unsigned char Index;
+	unsigned int Size;
+	ConstantBufferFrequency Frequency;
 
 	DynamicArray<UniquePtr<ShaderVariable>> Variables;
 
 	bool Initialize(Graphics& graphics);
 	void Shutdown();
 
+	// Per material buffers take memory only in storages of materials
+	inline size_t GetMemorySize() const
+	{
+		return _sharedStorage.GetMemorySize();
+	}
+
+	// Uploads data to storage only if source parameters have changed since last upload, then binds the storage
+	// Overrides (of material instances, may be null) take precedence over the collection
+	void Update(Graphics& graphics, ConstantBufferStorage& storage, const MaterialParametersCollection& materialParametersCollection, const MaterialParameterOverrides* overrides) const;
 	void Update(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection);
 };
 
 class Shader final : public Asset
 {
 private:
-	ID3D11VertexShader* _vertexShader;
+	// Vertex shader is compiled once per vertex format, all variants share constant buffers layout
+	ID3D11VertexShader* _vertexShaders[VERTEX_FORMATS_COUNT];
 	ID3D11PixelShader* _pixelShader;
-	ID3D11InputLayout* _inputLayout;
+	ID3D11InputLayout* _inputLayouts[VERTEX_FORMATS_COUNT];
 
-	ID3D10Blob* _vertexShaderBuffer;
-	ID3D10Blob* _pixelShaderBuffer;
+	// Bytecode and reflection are kept only between Load and Initialize
+	CompiledShader _compiledVertexShaders[VERTEX_FORMATS_COUNT];
+	CompiledShader _compiledPixelShader;
 
 	DynamicArray<UniquePtr<ShaderConstantBuffer>> _perFrameBuffers;
-	DynamicArray<UniquePtr<ShaderConstantBuffer>> _perDrawCallBuffers;
+	DynamicArray<UniquePtr<ShaderConstantBuffer>> _perMaterialBuffers;
+	DynamicArray<UniquePtr<ShaderConstantBuffer>> _perObjectBuffers;
+
+	// Textures and samplers of the pixel shader, vertex shaders don't sample textures
+	DynamicArray<ShaderResourceReflection> _textures;
+	DynamicArray<unsigned int> _samplerSlots;
+	// Bound in place of textures which materials don't set
+	SharedPtr<Texture> _defaultTexture;
+
+	// Index of the per object buffer that matches ObjectConstants layout, -1 if shader cannot use object constants arena
+	int _objectConstantsBufferIndex;
+	// Hash of names, offsets and sizes of per material variables, baked material parameters are valid only for the same layout
+	unsigned long long _perMaterialLayoutHash;
+
+	// Drivers keep shader objects of about the size of bytecode they are created from
+	size_t _bytecodeSize;
+
+	// Bumped whenever reload swaps in new content, per material storages created before may not match constant buffers anymore
+	unsigned int _version;
 
 public:
 	Shader();
 	virtual ~Shader();
 
 private:
-	bool GatherConstantBuffersInfo(ID3D10Blob* compiledShader);
-	bool CreateConstantBufferAndVariables(const _D3D11_SHADER_INPUT_BIND_DESC& reflectedResourceDesc, ID3D11ShaderReflectionConstantBuffer* reflectedConstantBuffer);
+	// Compiler used by shader cache on misses, reflects constant buffers right away so cached entries don't need reflection
+	static bool Compile(const ShaderCompileRequest& request, CompiledShader& compiledShader);
+
+	bool GatherConstantBuffersInfo(const CompiledShader& compiledShader);
+	bool CreateConstantBufferAndVariables(const ShaderConstantBufferReflection& reflectedConstantBuffer);
+	void FindObjectConstantsBuffer();
+	void CalculatePerMaterialLayoutHash();
 
 public:
+	// Compiles through the shader cache shared by all shaders, also usable for shaders which are not assets
+	static bool CompileCached(const ShaderCompileRequest& request, CompiledShader& compiledShader);
+
 	virtual bool Load(const String& path) override;
 
 	virtual bool Initialize() override;
 	virtual void Shutdown() override;
+	virtual size_t GetMemorySize() const override;
+
+	virtual void GetSourceFiles(DynamicArray<String>& sourceFiles) const override;
+	virtual bool TakeReloaded(Asset& reloaded) override;
+
+	inline unsigned int GetVersion() const
+	{
+		return _version;
+	}
+
+	// Reflected in Load already, so materials can be cooked against shaders which are never initialized
+	inline const DynamicArray<UniquePtr<ShaderConstantBuffer>>& GetPerMaterialBuffers() const
+	{
+		return _perMaterialBuffers;
+	}
+	inline unsigned long long GetPerMaterialLayoutHash() const
+	{
+		return _perMaterialLayoutHash;
+	}
+
+	// Creates GPU storages for all per material constant buffers of this shader (in order of _perMaterialBuffers)
+	bool CreatePerMaterialStorages(Graphics& graphics, DynamicArray<ConstantBufferStorage>& storages) const;
 
-	void UpdatePerFrameBuffers(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection);
-	void UpdatePerDrawCallBuffers(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection);
+	void UpdatePerFrameBuffers(Graphics& graphics);
+	void UpdatePerMaterialBuffers(Graphics& graphics, DynamicArray<ConstantBufferStorage>& storages, const MaterialParametersCollection& materialParametersCollection,
+								  const MaterialParameterOverrides* overrides) const;
+	void UpdatePerObjectBuffers(Graphics& graphics, const MaterialParametersCollection& objectParametersCollection);
+	// Binds textures of material parameters to pixel shader slots with the same names
+	void BindTextures(Graphics& graphics, const MaterialParametersCollection& materialParametersCollection, const MaterialParameterOverrides* overrides) const;
+
+	inline const DynamicArray<unsigned int>& GetSamplerSlots() const
+	{
+		return _samplerSlots;
+	}
+
+	inline bool UsesObjectConstantsLayout() const
+	{
+		return _objectConstantsBufferIndex >= 0;
+	}
+	inline unsigned int GetObjectConstantsBufferIndex() const
+	{
+		return (unsigned int)_objectConstantsBufferIndex;
+	}
 
-	inline ID3D11InputLayout* GetInputLayout() const
+	inline ID3D11InputLayout* GetInputLayout(VertexFormat vertexFormat) const
 	{
-		return _inputLayout;
+		return _inputLayouts[(unsigned int)vertexFormat];
 	}
-	inline ID3D11VertexShader* GetVertexShader() const
+	inline ID3D11VertexShader* GetVertexShader(VertexFormat vertexFormat) const
 	{
-		return _vertexShader;
+		return _vertexShaders[(unsigned int)vertexFormat];
 	}
 	inline ID3D11PixelShader* GetPixelShader() const
 	{
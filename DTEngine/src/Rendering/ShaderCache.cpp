@@ -0,0 +1,310 @@
+#include "ShaderCache.h"
+
+#include <set>
+
+#include "ResourceManagement/AssetID.h"
+#include "ResourceManagement/CacheEntry.h"
+#include "ResourceManagement/FileSystem.h"
+#include "Utility/String.h"
+
+static const unsigned int CACHE_MAGIC = 0x48535444; // "DTSH"
+static const String CACHE_EXTENSION = DT_TEXT(".dtshader");
+
+// Incremental hash of compilation inputs
+struct ShaderHash
+{
+	unsigned long long Value = HASH_SEED;
+
+	inline void Add(const void* data, size_t size)
+	{
+		Value = HashBytes(data, size, Value);
+	}
+
+	inline void Add(const std::string& string)
+	{
+		const unsigned int size = (unsigned int)string.size();
+		Add(&size, sizeof(size));
+		Add(string.data(), size);
+	}
+};
+
+static bool ReadSource(const String& path, std::string& source)
+{
+	DynamicArray<unsigned char> data;
+	if (!gFileSystem.ReadFile(path, data))
+	{
+		return false;
+	}
+
+	source.assign(data.begin(), data.end());
+	return true;
+}
+
+// Hashes the source and all files it includes with quotes, system includes cannot change between runs
+static void HashSource(const String& path, const std::string& source, ShaderHash& hash, std::set<String>& visitedPaths)
+{
+	hash.Add(source);
+
+	const String directory = GetDirectory(path);
+	size_t position = 0;
+	while ((position = source.find("#include", position)) != std::string::npos)
+	{
+		position += 8;
+
+		const size_t lineEnd = source.find('\n', position);
+		const size_t nameStart = source.find('"', position);
+		if (nameStart == std::string::npos || nameStart > lineEnd)
+		{
+			continue;
+		}
+		const size_t nameEnd = source.find('"', nameStart + 1);
+		if (nameEnd == std::string::npos || nameEnd > lineEnd)
+		{
+			continue;
+		}
+
+		const std::string name = source.substr(nameStart + 1, nameEnd - nameStart - 1);
+		hash.Add(name);
+
+		const String includePath = directory + String(name.begin(), name.end());
+		if (!visitedPaths.insert(includePath).second)
+		{
+			continue;
+		}
+
+		// Missing include is hashed only by name, compilation reports it anyway
+		std::string includeSource;
+		if (ReadSource(includePath, includeSource))
+		{
+			HashSource(includePath, includeSource, hash, visitedPaths);
+		}
+	}
+}
+
+static void WriteString(std::ofstream& file, const String& string)
+{
+	const unsigned int length = (unsigned int)string.size();
+	file.write((const char*)&length, sizeof(length));
+	file.write((const char*)string.data(), length * sizeof(Char));
+}
+
+static bool ReadString(std::ifstream& file, String& string)
+{
+	unsigned int length = 0;
+	file.read((char*)&length, sizeof(length));
+	if (!file)
+	{
+		return false;
+	}
+
+	string.resize(length);
+	file.read((char*)&string[0], length * sizeof(Char));
+	return !file.fail();
+}
+
+static void WriteResources(std::ofstream& file, const DynamicArray<ShaderResourceReflection>& resources)
+{
+	const unsigned int resourcesCount = (unsigned int)resources.size();
+	file.write((const char*)&resourcesCount, sizeof(resourcesCount));
+	for (const ShaderResourceReflection& resource : resources)
+	{
+		WriteString(file, resource.Name);
+		file.write((const char*)&resource.Index, sizeof(resource.Index));
+	}
+}
+
+static bool ReadResources(std::ifstream& file, DynamicArray<ShaderResourceReflection>& resources)
+{
+	unsigned int resourcesCount = 0;
+	file.read((char*)&resourcesCount, sizeof(resourcesCount));
+	if (!file)
+	{
+		return false;
+	}
+
+	resources.resize(resourcesCount);
+	for (ShaderResourceReflection& resource : resources)
+	{
+		if (!ReadString(file, resource.Name))
+		{
+			return false;
+		}
+		file.read((char*)&resource.Index, sizeof(resource.Index));
+	}
+
+	return !file.fail();
+}
+
+ShaderCache::ShaderCache(const String& directory) : _directory(directory), _hitsCount(0), _missesCount(0)
+{}
+
+String ShaderCache::GetCachePath(const ShaderCompileRequest& request) const
+{
+	ShaderHash hash;
+	hash.Add(request.SourcePath.data(), request.SourcePath.size() * sizeof(Char));
+	hash.Add(request.Define);
+	hash.Add(request.EntryPoint);
+	hash.Add(request.Target);
+	hash.Add(&request.Flags, sizeof(request.Flags));
+
+	return GetCacheEntryPath(_directory, hash.Value, CACHE_EXTENSION);
+}
+
+bool ShaderCache::CalculateKey(const ShaderCompileRequest& request, unsigned long long& key) const
+{
+	std::string source;
+	if (!ReadSource(request.SourcePath, source))
+	{
+		return false;
+	}
+
+	const unsigned int version = VERSION;
+	ShaderHash hash;
+	hash.Add(&version, sizeof(version));
+	hash.Add(request.Define);
+	hash.Add(request.EntryPoint);
+	hash.Add(request.Target);
+	hash.Add(&request.Flags, sizeof(request.Flags));
+
+	std::set<String> visitedPaths;
+	visitedPaths.insert(request.SourcePath);
+	HashSource(request.SourcePath, source, hash, visitedPaths);
+
+	key = hash.Value;
+	return true;
+}
+
+bool ShaderCache::GetSourceFiles(const String& sourcePath, DynamicArray<String>& sourceFiles)
+{
+	std::string source;
+	if (!ReadSource(sourcePath, source))
+	{
+		return false;
+	}
+
+	// Includes are found the same way as for the key, hash itself is not needed
+	ShaderHash hash;
+	std::set<String> visitedPaths;
+	visitedPaths.insert(sourcePath);
+	HashSource(sourcePath, source, hash, visitedPaths);
+
+	sourceFiles.insert(sourceFiles.end(), visitedPaths.begin(), visitedPaths.end());
+	return true;
+}
+
+bool ShaderCache::LoadEntry(const String& path, unsigned long long key, CompiledShader& compiledShader) const
+{
+	std::ifstream file;
+	if (!OpenCacheEntry(path, {CACHE_MAGIC, VERSION, key}, file))
+	{
+		return false;
+	}
+
+	unsigned int bytecodeSize = 0;
+	file.read((char*)&bytecodeSize, sizeof(bytecodeSize));
+	if (!file || bytecodeSize == 0)
+	{
+		return false;
+	}
+
+	compiledShader.Bytecode.resize(bytecodeSize);
+	file.read((char*)compiledShader.Bytecode.data(), bytecodeSize);
+
+	unsigned int buffersCount = 0;
+	file.read((char*)&buffersCount, sizeof(buffersCount));
+	if (!file)
+	{
+		return false;
+	}
+
+	compiledShader.ConstantBuffers.resize(buffersCount);
+	for (ShaderConstantBufferReflection& buffer : compiledShader.ConstantBuffers)
+	{
+		unsigned int variablesCount = 0;
+		if (!ReadString(file, buffer.Name))
+		{
+			return false;
+		}
+		file.read((char*)&buffer.Index, sizeof(buffer.Index));
+		file.read((char*)&buffer.Size, sizeof(buffer.Size));
+		file.read((char*)&variablesCount, sizeof(variablesCount));
+		if (!file)
+		{
+			return false;
+		}
+
+		buffer.Variables.resize(variablesCount);
+		for (ShaderVariableReflection& variable : buffer.Variables)
+		{
+			if (!ReadString(file, variable.Name))
+			{
+				return false;
+			}
+			file.read((char*)&variable.Offset, sizeof(variable.Offset));
+			file.read((char*)&variable.Size, sizeof(variable.Size));
+			file.read((char*)&variable.Type, sizeof(variable.Type));
+		}
+	}
+
+	return ReadResources(file, compiledShader.Textures) && ReadResources(file, compiledShader.Samplers);
+}
+
+bool ShaderCache::SaveEntry(const String& path, unsigned long long key, const CompiledShader& compiledShader) const
+{
+	return SaveCacheEntry(path, {CACHE_MAGIC, VERSION, key}, [&compiledShader](std::ofstream& file)
+	{
+		const unsigned int bytecodeSize = (unsigned int)compiledShader.Bytecode.size();
+		const unsigned int buffersCount = (unsigned int)compiledShader.ConstantBuffers.size();
+		file.write((const char*)&bytecodeSize, sizeof(bytecodeSize));
+		file.write((const char*)compiledShader.Bytecode.data(), bytecodeSize);
+		file.write((const char*)&buffersCount, sizeof(buffersCount));
+
+		for (const ShaderConstantBufferReflection& buffer : compiledShader.ConstantBuffers)
+		{
+			const unsigned int variablesCount = (unsigned int)buffer.Variables.size();
+			WriteString(file, buffer.Name);
+			file.write((const char*)&buffer.Index, sizeof(buffer.Index));
+			file.write((const char*)&buffer.Size, sizeof(buffer.Size));
+			file.write((const char*)&variablesCount, sizeof(variablesCount));
+
+			for (const ShaderVariableReflection& variable : buffer.Variables)
+			{
+				WriteString(file, variable.Name);
+				file.write((const char*)&variable.Offset, sizeof(variable.Offset));
+				file.write((const char*)&variable.Size, sizeof(variable.Size));
+				file.write((const char*)&variable.Type, sizeof(variable.Type));
+			}
+		}
+
+		WriteResources(file, compiledShader.Textures);
+		WriteResources(file, compiledShader.Samplers);
+	});
+}
+
+bool ShaderCache::Get(const ShaderCompileRequest& request, const CompilerFunction& compiler, CompiledShader& compiledShader)
+{
+	unsigned long long key = 0;
+	if (!CalculateKey(request, key))
+	{
+		return false;
+	}
+
+	// Entry stored for older sources (or version) of the same request fails the key check and gets replaced below
+	const String cachePath = GetCachePath(request);
+	if (LoadEntry(cachePath, key, compiledShader))
+	{
+		++_hitsCount;
+		return true;
+	}
+
+	++_missesCount;
+	compiledShader = CompiledShader();
+	if (!compiler(request, compiledShader))
+	{
+		return false;
+	}
+
+	// Failing to store the entry only means the shader is compiled again next time
+	SaveEntry(cachePath, key, compiledShader);
+	return true;
+}
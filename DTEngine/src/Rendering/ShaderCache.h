@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+
+#include "Core/Platform.h"
+#include "Core/Event.h"
+
+// Type of reflected shader variable, decides which material parameter getter fills it
+enum class ShaderVariableType : unsigned char
+{
+	Raw,
+	Float,
+	Int,
+	Vector2,
+	Vector3,
+	Vector4,
+	Matrix
+};
+
+struct ShaderVariableReflection
+{
+	String Name;
+	unsigned int Offset;
+	unsigned int Size;
+	ShaderVariableType Type;
+};
+
+// Everything needed to create ShaderConstantBuffer without reflecting bytecode again
+struct ShaderConstantBufferReflection
+{
+	String Name;
+	unsigned int Index;
+	unsigned int Size;
+	DynamicArray<ShaderVariableReflection> Variables;
+};
+
+// Texture or sampler bound by the shader, textures are matched with material parameters by name
+struct ShaderResourceReflection
+{
+	String Name;
+	unsigned int Index;
+};
+
+struct CompiledShader
+{
+	DynamicArray<unsigned char> Bytecode;
+	DynamicArray<ShaderConstantBufferReflection> ConstantBuffers;
+	DynamicArray<ShaderResourceReflection> Textures;
+	DynamicArray<ShaderResourceReflection> Samplers;
+};
+
+// Single compilation of a shader source, all of it is part of the cache key
+struct ShaderCompileRequest
+{
+	String SourcePath;
+	// Preprocessor define set to 1, may be empty
+	std::string Define;
+	std::string EntryPoint;
+	std::string Target;
+	unsigned int Flags;
+};
+
+// Cache of compiled shaders, stores bytecode together with reflection of constant buffers, textures and samplers
+// Key is a hash of the source, all files it includes (recursively) and compile settings, so any change in them is a cache miss
+// Every compile request has a single entry named after its settings, so a superseded entry is overwritten instead of piling up
+// Compiler is passed in, so caching doesn't depend on D3D
+class ShaderCache final
+{
+public:
+	typedef Function<bool(const ShaderCompileRequest&, CompiledShader&)> CompilerFunction;
+
+	// Has to be bumped whenever cache file layout or reflection data change
+	static const unsigned int VERSION = 3;
+
+private:
+	String _directory;
+	// Shaders may be loaded on more threads at once
+	std::atomic<unsigned int> _hitsCount;
+	std::atomic<unsigned int> _missesCount;
+
+public:
+	ShaderCache(const String& directory);
+
+private:
+	// Path depends only on request settings, not on the sources
+	String GetCachePath(const ShaderCompileRequest& request) const;
+	bool LoadEntry(const String& path, unsigned long long key, CompiledShader& compiledShader) const;
+	bool SaveEntry(const String& path, unsigned long long key, const CompiledShader& compiledShader) const;
+
+public:
+	// Returns false if source file cannot be read
+	bool CalculateKey(const ShaderCompileRequest& request, unsigned long long& key) const;
+
+	// Appends the source and all files it includes (recursively), changing any of them changes the key
+	static bool GetSourceFiles(const String& sourcePath, DynamicArray<String>& sourceFiles);
+
+	// Returns cached shader if there is one for current sources, otherwise compiles it and stores the result
+	bool Get(const ShaderCompileRequest& request, const CompilerFunction& compiler, CompiledShader& compiledShader);
+
+	inline unsigned int GetHitsCount() const
+	{
+		return _hitsCount;
+	}
+
+	inline unsigned int GetMissesCount() const
+	{
+		return _missesCount;
+	}
+};
@@ -0,0 +1,240 @@
+#include "Texture.h"
+
+#include "Debug/Debug.h"
+#include "Graphics.h"
+#include "Rendering/BlockCompressor.h"
+#include "Rendering/ImageDecoder.h"
+#include "Rendering/MipGenerator.h"
+#include "ResourceManagement/FileSystem.h"
+
+static const String TEXTURE_CACHE_DIRECTORY = DT_TEXT("Resources/Textures/Cache/");
+
+static DXGI_FORMAT GetDXGIFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case TextureFormat::BC3:
+		return DXGI_FORMAT_BC3_UNORM;
+	case TextureFormat::BC5:
+		return DXGI_FORMAT_BC5_UNORM;
+	default:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+// Shared by all textures, so hits and misses are counted for the whole run
+static TextureCache& GetTextureCache()
+{
+	static TextureCache textureCache(TEXTURE_CACHE_DIRECTORY);
+	return textureCache;
+}
+
+Texture::Texture() : _texture(nullptr), _view(nullptr), _format(TextureFormat::RGBA8), _width(0), _height(0), _mipsCount(0), _gpuDataSize(0)
+{}
+
+Texture::~Texture()
+{}
+
+TextureImportSettings Texture::GetImportSettings(const String& path)
+{
+	static const String NORMAL_MAP_SUFFIX = DT_TEXT("_normal");
+
+	// Name of the file without directory and extension
+	const size_t nameStart = path.find_last_of(DT_TEXT("/\\")) + 1;
+	const size_t extensionStart = path.find_last_of(DT_TEXT('.'));
+	const String name = path.substr(nameStart, extensionStart == String::npos || extensionStart < nameStart ? String::npos : extensionStart - nameStart);
+
+	TextureImportSettings settings;
+	if (name.size() >= NORMAL_MAP_SUFFIX.size() && name.compare(name.size() - NORMAL_MAP_SUFFIX.size(), NORMAL_MAP_SUFFIX.size(), NORMAL_MAP_SUFFIX) == 0)
+	{
+		settings.Compression = TextureCompression::Normal;
+	}
+
+	return settings;
+}
+
+bool Texture::Import(const unsigned char* data, size_t size, const TextureImportSettings& settings, TextureData& texture)
+{
+	Image image;
+	if (!ImageDecoder::Decode(data, size, image))
+	{
+		return false;
+	}
+
+	DynamicArray<Image> mips;
+	if (settings.GenerateMips)
+	{
+		MipGenerator::Generate(image, settings.Filter, GetFullMipsCount(image.Width, image.Height) - 1, mips);
+	}
+
+	TextureFormat format = TextureFormat::RGBA8;
+	if (settings.Compression == TextureCompression::Normal)
+	{
+		format = TextureFormat::BC5;
+	}
+	else if (settings.Compression == TextureCompression::Color)
+	{
+		format = TextureFormat::BC1;
+		for (size_t i = 3; i < image.Pixels.size(); i += 4)
+		{
+			if (image.Pixels[i] < 255)
+			{
+				format = TextureFormat::BC3;
+				break;
+			}
+		}
+	}
+
+	// D3D requires the top mip of block compressed textures to consist of whole blocks, smaller mips are padded automatically
+	if (IsBlockCompressed(format) && (image.Width % 4 != 0 || image.Height % 4 != 0))
+	{
+		format = TextureFormat::RGBA8;
+	}
+
+	texture.Format = format;
+	texture.Width = image.Width;
+	texture.Height = image.Height;
+	texture.MipsCount = 1 + (unsigned int)mips.size();
+
+	size_t dataSize = GetTextureMipSize(format, image.Width, image.Height);
+	for (const Image& mip : mips)
+	{
+		dataSize += GetTextureMipSize(format, mip.Width, mip.Height);
+	}
+	texture.Data.resize(dataSize);
+
+	unsigned char* mipData = texture.Data.data();
+	for (unsigned int i = 0; i < texture.MipsCount; ++i)
+	{
+		const Image& mip = i == 0 ? image : mips[i - 1];
+		if (IsBlockCompressed(format))
+		{
+			BlockCompressor::Compress(mip.Pixels.data(), mip.Width, mip.Height, format, mipData);
+		}
+		else
+		{
+			memcpy(mipData, mip.Pixels.data(), mip.Pixels.size());
+		}
+		mipData += GetTextureMipSize(format, mip.Width, mip.Height);
+	}
+
+	return true;
+}
+
+bool Texture::Load(const String& path)
+{
+	Asset::Load(path);
+
+	FileView file;
+	if (!gFileSystem.MapFile(path, file))
+	{
+		return false;
+	}
+
+	static const TextureCache::ImporterFunction importer = &Texture::Import;
+	if (!GetTextureCache().Get(file.GetData(), file.GetSize(), GetImportSettings(path), importer, _data))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Texture (%s) is not a supported TGA or PNG image"), path.c_str());
+		return false;
+	}
+
+#if DT_DEBUG
+	// Reported only in debug builds, every loaded texture would flood the log otherwise
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_GRAPHICS, DT_TEXT("Texture cache: %u hits, %u misses so far"), GetTextureCache().GetHitsCount(), GetTextureCache().GetMissesCount());
+#endif
+
+	return true;
+}
+
+bool Texture::Initialize()
+{
+	if (_data.Data.empty())
+	{
+		// Only textures without a path are allowed to have no data, those become the white fallback
+		if (!_path.empty())
+		{
+			return false;
+		}
+
+		_data.Format = TextureFormat::RGBA8;
+		_data.Width = 1;
+		_data.Height = 1;
+		_data.MipsCount = 1;
+		_data.Data.assign(4, 255);
+	}
+
+	DynamicArray<D3D11_SUBRESOURCE_DATA> mipsData(_data.MipsCount);
+	size_t offset = 0;
+	for (unsigned int i = 0; i < _data.MipsCount; ++i)
+	{
+		const unsigned int mipWidth = Math::Max(_data.Width >> i, 1u);
+		const unsigned int mipHeight = Math::Max(_data.Height >> i, 1u);
+		mipsData[i].pSysMem = _data.Data.data() + offset;
+		mipsData[i].SysMemPitch = (unsigned int)GetTextureRowPitch(_data.Format, mipWidth);
+		mipsData[i].SysMemSlicePitch = 0;
+		offset += GetTextureMipSize(_data.Format, mipWidth, mipHeight);
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {0};
+	textureDesc.Width = _data.Width;
+	textureDesc.Height = _data.Height;
+	textureDesc.MipLevels = _data.MipsCount;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = GetDXGIFormat(_data.Format);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	Graphics& graphics = gGraphics;
+	if (!graphics.CreateTexture2D(textureDesc, mipsData.data(), &_texture) || !graphics.CreateShaderResourceView(_texture, &_view))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_GRAPHICS, DT_TEXT("Failed to create texture (%s)"), _path.c_str());
+		return false;
+	}
+
+	_format = _data.Format;
+	_width = _data.Width;
+	_height = _data.Height;
+	_mipsCount = _data.MipsCount;
+	_gpuDataSize = _data.Data.size();
+
+	// GPU has its own copy now
+	_data = TextureData();
+
+	return true;
+}
+
+void Texture::Shutdown()
+{
+	RELEASE_COM(_view);
+	RELEASE_COM(_texture);
+	_data = TextureData();
+	_gpuDataSize = 0;
+}
+
+size_t Texture::GetMemorySize() const
+{
+	return _gpuDataSize;
+}
+
+bool Texture::TakeReloaded(Asset& reloaded)
+{
+	// Resources reload assets as instances of the same type
+	Texture& texture = static_cast<Texture&>(reloaded);
+	if (!texture.Initialize())
+	{
+		return false;
+	}
+
+	std::swap(_texture, texture._texture);
+	std::swap(_view, texture._view);
+	std::swap(_format, texture._format);
+	std::swap(_width, texture._width);
+	std::swap(_height, texture._height);
+	std::swap(_mipsCount, texture._mipsCount);
+	std::swap(_gpuDataSize, texture._gpuDataSize);
+
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ResourceManagement/Asset.h"
+#include "Rendering/TextureCache.h"
+
+struct ID3D11Texture2D;
+struct ID3D11ShaderResourceView;
+
+// 2D texture loaded from TGA or PNG, imported through the texture cache so decoding, mip generation and compression run only once per image
+// Textures created without a path are 1x1 white, they stand in for textures which cannot be loaded
+class Texture final : public Asset
+{
+private:
+	ID3D11Texture2D* _texture;
+	ID3D11ShaderResourceView* _view;
+
+	// Imported data is kept only between Load and Initialize
+	TextureData _data;
+
+	TextureFormat _format;
+	unsigned int _width;
+	unsigned int _height;
+	unsigned int _mipsCount;
+	size_t _gpuDataSize;
+
+public:
+	Texture();
+	virtual ~Texture();
+
+	// Import settings are derived from the file name, images ending with "_normal" are normal maps
+	static TextureImportSettings GetImportSettings(const String& path);
+	// Importer used by texture cache on misses, block compressed formats are used only if the image size is divisible by 4
+	static bool Import(const unsigned char* data, size_t size, const TextureImportSettings& settings, TextureData& texture);
+
+	virtual bool Load(const String& path) override;
+
+	virtual bool Initialize() override;
+	virtual void Shutdown() override;
+
+	virtual size_t GetMemorySize() const override;
+	virtual bool TakeReloaded(Asset& reloaded) override;
+
+	inline ID3D11ShaderResourceView* GetView() const
+	{
+		return _view;
+	}
+
+	inline TextureFormat GetFormat() const
+	{
+		return _format;
+	}
+	inline unsigned int GetWidth() const
+	{
+		return _width;
+	}
+	inline unsigned int GetHeight() const
+	{
+		return _height;
+	}
+	inline unsigned int GetMipsCount() const
+	{
+		return _mipsCount;
+	}
+};
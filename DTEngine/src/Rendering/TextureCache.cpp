@@ -0,0 +1,112 @@
+#include "TextureCache.h"
+
+#include "ResourceManagement/AssetID.h"
+#include "ResourceManagement/CacheEntry.h"
+#include "Utility/Math.h"
+
+static const unsigned int CACHE_MAGIC = 0x58545444; // "DTTX"
+static const String CACHE_EXTENSION = DT_TEXT(".dttexture");
+
+// Stored right after the common entry header, data of all mips follow
+struct TextureCacheHeader
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int MipsCount;
+	TextureFormat Format;
+	unsigned long long DataSize;
+};
+
+TextureCache::TextureCache(const String& directory) : _directory(directory), _hitsCount(0), _missesCount(0)
+{}
+
+String TextureCache::GetCachePath(unsigned long long key) const
+{
+	return GetCacheEntryPath(_directory, key, CACHE_EXTENSION);
+}
+
+unsigned long long TextureCache::CalculateKey(const unsigned char* sourceData, size_t sourceSize, const TextureImportSettings& settings)
+{
+	const unsigned int version = VERSION;
+	unsigned long long hash = HashBytes(&version, sizeof(version));
+	hash = HashBytes(&settings.Compression, sizeof(settings.Compression), hash);
+	hash = HashBytes(&settings.Filter, sizeof(settings.Filter), hash);
+	hash = HashBytes(&settings.GenerateMips, sizeof(settings.GenerateMips), hash);
+
+	return HashBytes(sourceData, sourceSize, hash);
+}
+
+bool TextureCache::LoadEntry(const String& path, unsigned long long key, TextureData& texture) const
+{
+	std::ifstream file;
+	if (!OpenCacheEntry(path, {CACHE_MAGIC, VERSION, key}, file))
+	{
+		return false;
+	}
+
+	TextureCacheHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.Format > TextureFormat::BC5 || header.Width == 0 || header.Height == 0 ||
+		header.MipsCount == 0 || header.MipsCount > GetFullMipsCount(header.Width, header.Height))
+	{
+		return false;
+	}
+
+	// Truncated or otherwise damaged entries would upload garbage, so the size is checked against the layout
+	size_t expectedSize = 0;
+	for (unsigned int i = 0; i < header.MipsCount; ++i)
+	{
+		expectedSize += GetTextureMipSize(header.Format, Math::Max(header.Width >> i, 1u), Math::Max(header.Height >> i, 1u));
+	}
+	if (header.DataSize != expectedSize)
+	{
+		return false;
+	}
+
+	texture.Format = header.Format;
+	texture.Width = header.Width;
+	texture.Height = header.Height;
+	texture.MipsCount = header.MipsCount;
+	texture.Data.resize(expectedSize);
+	file.read((char*)texture.Data.data(), expectedSize);
+
+	return !file.fail();
+}
+
+bool TextureCache::SaveEntry(const String& path, unsigned long long key, const TextureData& texture) const
+{
+	TextureCacheHeader header = {};
+	header.Width = texture.Width;
+	header.Height = texture.Height;
+	header.MipsCount = texture.MipsCount;
+	header.Format = texture.Format;
+	header.DataSize = texture.Data.size();
+
+	return SaveCacheEntry(path, {CACHE_MAGIC, VERSION, key}, [&header, &texture](std::ofstream& file)
+	{
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)texture.Data.data(), texture.Data.size());
+	});
+}
+
+bool TextureCache::Get(const unsigned char* sourceData, size_t sourceSize, const TextureImportSettings& settings, const ImporterFunction& importer, TextureData& texture)
+{
+	const unsigned long long key = CalculateKey(sourceData, sourceSize, settings);
+	const String cachePath = GetCachePath(key);
+	if (LoadEntry(cachePath, key, texture))
+	{
+		++_hitsCount;
+		return true;
+	}
+
+	++_missesCount;
+	texture = TextureData();
+	if (!importer(sourceData, sourceSize, settings, texture))
+	{
+		return false;
+	}
+
+	// Failing to store the entry only means the texture is imported again next time
+	SaveEntry(cachePath, key, texture);
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+
+#include "Core/Platform.h"
+#include "Core/Event.h"
+#include "Rendering/MipGenerator.h"
+#include "Rendering/TextureFormat.h"
+
+// Everything deciding how a source image is imported, all of it is part of the cache key
+struct TextureImportSettings
+{
+	TextureCompression Compression;
+	MipFilter Filter;
+	bool GenerateMips;
+
+	inline TextureImportSettings() : Compression(TextureCompression::Color), Filter(MipFilter::Kaiser), GenerateMips(true)
+	{}
+};
+
+// Content addressed cache of imported textures, stores decoded, mipmapped and block compressed data ready for upload
+// Key is a hash of the source file data and import settings, so editing the image or changing settings is a cache miss
+// Importer is passed in, so caching doesn't depend on decoders and D3D
+class TextureCache final
+{
+public:
+	typedef Function<bool(const unsigned char*, size_t, const TextureImportSettings&, TextureData&)> ImporterFunction;
+
+	// Has to be bumped whenever cache file layout or import itself (decoding, filtering, compression) change
+	static const unsigned int VERSION = 1;
+
+private:
+	String _directory;
+	// Textures may be loaded on more threads at once
+	std::atomic<unsigned int> _hitsCount;
+	std::atomic<unsigned int> _missesCount;
+
+public:
+	TextureCache(const String& directory);
+
+private:
+	String GetCachePath(unsigned long long key) const;
+	bool LoadEntry(const String& path, unsigned long long key, TextureData& texture) const;
+	bool SaveEntry(const String& path, unsigned long long key, const TextureData& texture) const;
+
+public:
+	static unsigned long long CalculateKey(const unsigned char* sourceData, size_t sourceSize, const TextureImportSettings& settings);
+
+	// Returns cached texture if there is one for given source data, otherwise imports it and stores the result
+	bool Get(const unsigned char* sourceData, size_t sourceSize, const TextureImportSettings& settings, const ImporterFunction& importer, TextureData& texture);
+
+	inline unsigned int GetHitsCount() const
+	{
+		return _hitsCount;
+	}
+
+	inline unsigned int GetMissesCount() const
+	{
+		return _missesCount;
+	}
+};
@@ -0,0 +1,44 @@
+#include "TextureFormat.h"
+
+#include "Utility/Math.h"
+
+bool IsBlockCompressed(TextureFormat format)
+{
+	return format != TextureFormat::RGBA8;
+}
+
+unsigned int GetTextureFormatBlockSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC5:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+size_t GetTextureRowPitch(TextureFormat format, unsigned int width)
+{
+	const size_t blocksCount = IsBlockCompressed(format) ? (width + 3) / 4 : width;
+	return blocksCount * GetTextureFormatBlockSize(format);
+}
+
+size_t GetTextureMipSize(TextureFormat format, unsigned int width, unsigned int height)
+{
+	const size_t rowsCount = IsBlockCompressed(format) ? (height + 3) / 4 : height;
+	return rowsCount * GetTextureRowPitch(format, width);
+}
+
+unsigned int GetFullMipsCount(unsigned int width, unsigned int height)
+{
+	unsigned int mipsCount = 1;
+	for (unsigned int size = Math::Max(width, height); size > 1; size /= 2)
+	{
+		++mipsCount;
+	}
+	return mipsCount;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core/Platform.h"
+
+// Formats of textures in GPU memory, all of them are sampled as normalized floats
+enum class TextureFormat : unsigned char
+{
+	// 4 bytes per pixel, used for images too small for block compression
+	RGBA8,
+	// 8 bytes per 4x4 block, RGB with 5:6:5 endpoints
+	BC1,
+	// 16 bytes per 4x4 block, BC1 colors with separately interpolated alpha
+	BC3,
+	// 16 bytes per 4x4 block, two independent channels (XY of tangent space normals)
+	BC5
+};
+
+// How source image is converted when imported
+enum class TextureCompression : unsigned char
+{
+	// BC1, or BC3 if the image has any transparent pixel
+	Color,
+	// BC5, shaders reconstruct Z from XY
+	Normal,
+	// RGBA8
+	None
+};
+
+// Imported texture with all its mips stored one after another, largest first
+struct TextureData
+{
+	TextureFormat Format;
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int MipsCount;
+	DynamicArray<unsigned char> Data;
+
+	inline TextureData() : Format(TextureFormat::RGBA8), Width(0), Height(0), MipsCount(0)
+	{}
+};
+
+bool IsBlockCompressed(TextureFormat format);
+// Bytes per pixel for RGBA8, bytes per 4x4 block for compressed formats
+unsigned int GetTextureFormatBlockSize(TextureFormat format);
+// Distance between rows of pixels (or rows of blocks) in bytes
+size_t GetTextureRowPitch(TextureFormat format, unsigned int width);
+size_t GetTextureMipSize(TextureFormat format, unsigned int width, unsigned int height);
+// Number of mips down to 1x1
+unsigned int GetFullMipsCount(unsigned int width, unsigned int height);
@@ -0,0 +1,86 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+
+unsigned int GetVertexFormatStride(VertexFormat format)
+{
+	switch (format)
+	{
+		case VertexFormat::Compact:
+			return sizeof(CompactVertex);
+		case VertexFormat::Quantized:
+			return sizeof(QuantizedVertex);
+		default:
+			// float3 position, float3 normal, float2 UV
+			return 32;
+	}
+}
+
+const char* GetVertexFormatShaderDefine(VertexFormat format)
+{
+	switch (format)
+	{
+		case VertexFormat::Compact:
+			return "VERTEX_FORMAT_COMPACT";
+		case VertexFormat::Quantized:
+			return "VERTEX_FORMAT_QUANTIZED";
+		default:
+			return "VERTEX_FORMAT_FULL";
+	}
+}
+
+short FloatToSnorm16(float value)
+{
+	return (short)Math::Round(Math::Clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+unsigned short FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const unsigned int sign = (bits >> 16) & 0x8000;
+	const int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	unsigned int mantissa = bits & 0x007FFFFF;
+
+	if (exponent <= 0)
+	{
+		return (unsigned short)sign;
+	}
+
+	if (exponent >= 31)
+	{
+		// Infinity, NaN stays NaN
+		return (unsigned short)(sign | 0x7C00 | (((bits & 0x7F800000) == 0x7F800000 && mantissa != 0) ? 0x200 : 0));
+	}
+
+	// Round to nearest, carry may overflow into exponent which is still correct
+	mantissa += 0x00001000;
+	return (unsigned short)(sign + ((unsigned int)exponent << 10) + (mantissa >> 13));
+}
+
+void EncodeOctahedralNormal(const Vector3& normal, short& x, short& y)
+{
+	const float length = Math::Abs(normal.X) + Math::Abs(normal.Y) + Math::Abs(normal.Z);
+	if (length < Math::EPSILON)
+	{
+		x = 0;
+		y = 0;
+		return;
+	}
+
+	float octX = normal.X / length;
+	float octY = normal.Y / length;
+
+	// Lower hemisphere is folded over the diagonals
+	if (normal.Z < 0.0f)
+	{
+		const float foldedX = (1.0f - Math::Abs(octY)) * (octX >= 0.0f ? 1.0f : -1.0f);
+		const float foldedY = (1.0f - Math::Abs(octX)) * (octY >= 0.0f ? 1.0f : -1.0f);
+		octX = foldedX;
+		octY = foldedY;
+	}
+
+	x = FloatToSnorm16(octX);
+	y = FloatToSnorm16(octY);
+}
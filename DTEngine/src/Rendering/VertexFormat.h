@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "Utility/Math.h"
+
+// Layouts of vertices in GPU vertex buffers, CPU side meshes always use MeshBase::VertexType
+// Every shader is compiled once per format, see VertexFormats.hlsli for decoding in shaders
+enum class VertexFormat : unsigned char
+{
+	// float3 position, float3 normal, float2 UV (32 bytes)
+	Full,
+	// float3 position, octahedral normal as 2 x snorm16, UV as 2 x half (20 bytes)
+	Compact,
+	// Position as 4 x snorm16 relative to mesh bounds, octahedral normal as 2 x snorm16, UV as 2 x half (16 bytes)
+	// Dequantized in shaders with per object PositionDequantizeScale and PositionDequantizeOffset
+	Quantized,
+
+	Count
+};
+
+static const unsigned int VERTEX_FORMATS_COUNT = (unsigned int)VertexFormat::Count;
+
+enum class IndexFormat : unsigned char
+{
+	UInt16,
+	UInt32
+};
+
+// Meshes with up to this many vertices get 16 bit indices
+static const unsigned int MAX_UINT16_INDEXED_VERTICES = 65536;
+
+struct CompactVertex
+{
+	Vector3 Position;
+	short Normal[2];
+	unsigned short UV[2];
+};
+
+struct QuantizedVertex
+{
+	short Position[4];
+	short Normal[2];
+	unsigned short UV[2];
+};
+
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex has to be tightly packed");
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex has to be tightly packed");
+
+unsigned int GetVertexFormatStride(VertexFormat format);
+// Name of the macro defined when compiling shaders for given format
+const char* GetVertexFormatShaderDefine(VertexFormat format);
+
+// Maps [-1, 1] to [-32767, 32767]
+short FloatToSnorm16(float value);
+// IEEE 754 half precision, denormals are flushed to zero
+unsigned short FloatToHalf(float value);
+// Projects unit vector on octahedron unfolded to [-1, 1] square
+void EncodeOctahedralNormal(const Vector3& normal, short& x, short& y);
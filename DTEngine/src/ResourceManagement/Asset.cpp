@@ -18,6 +18,11 @@ bool Asset::Save(const String& path)
 	return false;
 }
 
+bool Asset::IsReadyToInitialize() const
+{
+	return true;
+}
+
 bool Asset::Initialize()
 {
 	return true;
@@ -25,3 +30,24 @@ bool Asset::Initialize()
 
 void Asset::Shutdown()
 {}
+
+size_t Asset::GetMemorySize() const
+{
+	return 0;
+}
+
+void Asset::GetSourceFiles(DynamicArray<String>& sourceFiles) const
+{
+	sourceFiles.push_back(_path);
+}
+
+void Asset::GetDependencies(DynamicArray<const Asset*>& dependencies) const
+{}
+
+bool Asset::TakeReloaded(Asset& reloaded)
+{
+	return false;
+}
+
+void Asset::OnDependencyReloaded(const Asset& dependency)
+{}
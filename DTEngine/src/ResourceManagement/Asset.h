@@ -14,9 +14,24 @@ public:
 	virtual bool Load(const String& path);
 	virtual bool Save(const String& path);
 
+	// Asynchronously loaded assets are initialized only once this returns true (i.e. their dependencies are loaded)
+	virtual bool IsReadyToInitialize() const;
 	virtual bool Initialize();
 	virtual void Shutdown();
 
+	// Bytes of CPU and GPU memory held by the asset, counted against memory budget of resources
+	// Assets reporting zero are never evicted to fit the budget
+	virtual size_t GetMemorySize() const;
+
+	// Files the asset is built from, asset gets reloaded when any of them changes
+	virtual void GetSourceFiles(DynamicArray<String>& sourceFiles) const;
+	// Other assets used by this one, they notify it through OnDependencyReloaded when they get reloaded
+	virtual void GetDependencies(DynamicArray<const Asset*>& dependencies) const;
+	// Initializes freshly loaded copy of this asset and swaps content with it, so references to this asset stay valid
+	// Copy ends up with previous content and is shut down by the caller, returns false if the asset cannot be reloaded
+	virtual bool TakeReloaded(Asset& reloaded);
+	virtual void OnDependencyReloaded(const Asset& dependency);
+
 	inline const String& GetPath() const
 	{
 		return _path;
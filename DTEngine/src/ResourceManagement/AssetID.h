@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Core/Platform.h"
+
+// 64 bit FNV-1a hash of asset path, assets are looked up by it instead of by their paths
+typedef unsigned long long AssetID;
+
+// Marks empty slots of asset table, no path hashes to it
+static const AssetID INVALID_ASSET_ID = 0;
+
+// FNV-1a, shared by all hashes of the engine so they stay consistent with asset IDs
+static const unsigned long long HASH_SEED = 14695981039346656037ull;
+static const unsigned long long HASH_PRIME = 1099511628211ull;
+
+// Hashes characters (not bytes) of the string, hash of previous data can be passed in to continue it
+constexpr unsigned long long HashString(const Char* string, size_t length, unsigned long long hash = HASH_SEED)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= (unsigned long long)string[i];
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
+
+inline unsigned long long HashString(const String& string, unsigned long long hash = HASH_SEED)
+{
+	return HashString(string.c_str(), string.size(), hash);
+}
+
+inline unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash = HASH_SEED)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
+
+constexpr AssetID GetAssetID(const Char* path, size_t length)
+{
+	const AssetID hash = HashString(path, length);
+	return hash == INVALID_ASSET_ID ? 1 : hash;
+}
+
+// Computed at compile time for literals, i.e. constexpr AssetID id = GetAssetID(DT_TEXT("Resources/Materials/Default.mat"));
+template<size_t N>
+constexpr AssetID GetAssetID(const Char (&path)[N])
+{
+	return GetAssetID(path, N - 1);
+}
+
+inline AssetID GetAssetID(const String& path)
+{
+	return GetAssetID(path.c_str(), path.size());
+}
@@ -0,0 +1,105 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+
+#include "Utility/Math.h"
+
+AssetLoader::AssetLoader() : _isRunning(false)
+{}
+
+void AssetLoader::Load(AssetLoadRequest& request)
+{
+	const bool result = request.LoadedAsset->Load(request.Path);
+	request.State = result ? AssetLoadState::Loaded : AssetLoadState::LoadFailed;
+}
+
+void AssetLoader::ThreadLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_pendingCondition.wait(lock, [this]() { return !_isRunning || !_pendingRequests.empty(); });
+		if (!_isRunning)
+		{
+			return;
+		}
+
+		SharedPtr<AssetLoadRequest> request = _pendingRequests.front();
+		_pendingRequests.pop_front();
+
+		lock.unlock();
+		Load(*request);
+		lock.lock();
+
+		_loadedRequests.push_back(request);
+		_loadedCondition.notify_all();
+	}
+}
+
+bool AssetLoader::Initialize()
+{
+	// Main thread keeps rendering meanwhile, so it doesn't count
+	const unsigned int hardwareThreadsCount = std::thread::hardware_concurrency();
+	const unsigned int threadsCount = Math::Clamp(hardwareThreadsCount > 1 ? hardwareThreadsCount - 1 : 1u, 1u, MAX_THREADS_COUNT);
+
+	_isRunning = true;
+	for (unsigned int i = 0; i < threadsCount; ++i)
+	{
+		_threads.push_back(std::thread(&AssetLoader::ThreadLoop, this));
+	}
+
+	return true;
+}
+
+void AssetLoader::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+		_pendingRequests.clear();
+	}
+	_pendingCondition.notify_all();
+
+	for (std::thread& thread : _threads)
+	{
+		thread.join();
+	}
+	_threads.clear();
+}
+
+void AssetLoader::Enqueue(const SharedPtr<AssetLoadRequest>& request)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pendingRequests.push_back(request);
+	}
+	_pendingCondition.notify_one();
+}
+
+void AssetLoader::TakeLoaded(DynamicArray<SharedPtr<AssetLoadRequest>>& loadedRequests)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	loadedRequests.insert(loadedRequests.end(), _loadedRequests.begin(), _loadedRequests.end());
+	_loadedRequests.clear();
+}
+
+void AssetLoader::WaitForLoad(const SharedPtr<AssetLoadRequest>& request)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (request->State.load() != AssetLoadState::Loading)
+	{
+		return;
+	}
+
+	auto pendingIt = std::find(_pendingRequests.begin(), _pendingRequests.end(), request);
+	if (pendingIt != _pendingRequests.end())
+	{
+		// Waiting for a loading thread would only add latency
+		_pendingRequests.erase(pendingIt);
+		lock.unlock();
+		Load(*request);
+		return;
+	}
+
+	_loadedCondition.wait(lock, [&request]() { return request->State.load() != AssetLoadState::Loading; });
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Core/Platform.h"
+#include "ResourceManagement/Asset.h"
+#include "ResourceManagement/AssetID.h"
+
+enum class AssetLoadState : unsigned char
+{
+	// Waiting for a loading thread or being loaded by it
+	Loading,
+	// Loaded on CPU, waiting for initialization on main thread
+	Loaded,
+	// Loading failed, waiting for main thread to report it
+	LoadFailed,
+	Ready,
+	Failed
+};
+
+// Creates empty asset of a concrete type, so assets can be loaded again without knowing their type
+typedef SharedPtr<Asset>(*AssetFactory)();
+
+// Single load of an asset, shared by all handles requesting the same path while it is in flight
+struct AssetLoadRequest final
+{
+	AssetID ID;
+	String Path;
+	String TypeName;
+	AssetFactory Factory;
+	SharedPtr<Asset> LoadedAsset;
+	std::atomic<AssetLoadState> State;
+	// Reloaded asset is swapped into the already loaded one instead of being registered
+	bool IsReload;
+
+	AssetLoadRequest(AssetID id, const String& path, const String& typeName, AssetFactory factory, const SharedPtr<Asset>& asset, AssetLoadState state) :
+		ID(id), Path(path), TypeName(typeName), Factory(factory), LoadedAsset(asset), State(state), IsReload(false)
+	{}
+};
+
+// Returned by Resources::LoadAsync, asset can be taken once it is ready (or waited for with Resources::Wait)
+template<typename T>
+class AssetLoadHandle final
+{
+	friend class Resources;
+
+private:
+	SharedPtr<AssetLoadRequest> _request;
+
+public:
+	inline AssetLoadHandle()
+	{}
+	inline explicit AssetLoadHandle(const SharedPtr<AssetLoadRequest>& request) : _request(request)
+	{}
+
+	inline bool IsValid() const
+	{
+		return _request != nullptr;
+	}
+
+	// CPU part of loading has finished (successfully or not), asset may still wait for initialization
+	inline bool IsLoaded() const
+	{
+		return _request && _request->State.load() != AssetLoadState::Loading;
+	}
+
+	inline bool IsReady() const
+	{
+		return _request && _request->State.load() == AssetLoadState::Ready;
+	}
+
+	inline bool IsFailed() const
+	{
+		const AssetLoadState state = _request ? _request->State.load() : AssetLoadState::Failed;
+		return state == AssetLoadState::LoadFailed || state == AssetLoadState::Failed;
+	}
+
+	// Returns nullptr until the asset is ready
+	inline SharedPtr<T> Get() const
+	{
+		return IsReady() ? StaticPointerCast<T>(_request->LoadedAsset) : SharedPtr<T>(nullptr);
+	}
+};
+
+// Runs CPU part of asset loading (file I/O, parsing) on worker threads
+// Initialization creates GPU resources, so loaded assets are handed back to main thread for it
+class AssetLoader final
+{
+public:
+	// Loading is mostly bound by file I/O, more threads would only fight over the disk
+	static const unsigned int MAX_THREADS_COUNT = 4;
+
+private:
+	DynamicArray<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _pendingCondition;
+	std::condition_variable _loadedCondition;
+	LinkedList<SharedPtr<AssetLoadRequest>> _pendingRequests;
+	DynamicArray<SharedPtr<AssetLoadRequest>> _loadedRequests;
+	bool _isRunning;
+
+public:
+	AssetLoader();
+
+private:
+	static void Load(AssetLoadRequest& request);
+
+	void ThreadLoop();
+
+public:
+	bool Initialize();
+	// Requests which have not been picked by loading threads yet are dropped, loaded ones can still be taken
+	void Shutdown();
+
+	void Enqueue(const SharedPtr<AssetLoadRequest>& request);
+	// Moves requests loaded by loading threads since last call to the end of given array
+	void TakeLoaded(DynamicArray<SharedPtr<AssetLoadRequest>>& loadedRequests);
+	// Loads the request on calling thread if no loading thread has picked it yet, otherwise waits for the loading thread
+	// Request loaded this way is not returned by TakeLoaded
+	void WaitForLoad(const SharedPtr<AssetLoadRequest>& request);
+};
@@ -0,0 +1,90 @@
+#include "AssetTable.h"
+
+AssetTable::AssetTable() : _slots(INITIAL_CAPACITY, {INVALID_ASSET_ID, nullptr}), _count(0)
+{}
+
+unsigned int AssetTable::FindIndex(AssetID id) const
+{
+	const unsigned int mask = (unsigned int)_slots.size() - 1;
+	unsigned int index = GetHomeIndex(id);
+	while (_slots[index].ID != INVALID_ASSET_ID && _slots[index].ID != id)
+	{
+		index = (index + 1) & mask;
+	}
+	return index;
+}
+
+void AssetTable::Grow()
+{
+	DynamicArray<Slot> oldSlots(_slots.size() * 2, {INVALID_ASSET_ID, nullptr});
+	oldSlots.swap(_slots);
+
+	for (Slot& slot : oldSlots)
+	{
+		if (slot.ID != INVALID_ASSET_ID)
+		{
+			_slots[FindIndex(slot.ID)] = std::move(slot);
+		}
+	}
+}
+
+SharedPtr<Asset> AssetTable::Find(AssetID id) const
+{
+	const Slot& slot = _slots[FindIndex(id)];
+	return slot.ID == id ? slot.Value : SharedPtr<Asset>(nullptr);
+}
+
+bool AssetTable::Insert(AssetID id, const SharedPtr<Asset>& asset)
+{
+	DT_ASSERT(id != INVALID_ASSET_ID, DT_TEXT("Invalid asset ID"));
+
+	// Keeps at most 3/4 of slots used, so probe sequences stay short
+	if ((_count + 1) * 4 > _slots.size() * 3)
+	{
+		Grow();
+	}
+
+	Slot& slot = _slots[FindIndex(id)];
+	if (slot.ID == id)
+	{
+		return false;
+	}
+
+	slot.ID = id;
+	slot.Value = asset;
+	++_count;
+	return true;
+}
+
+bool AssetTable::Remove(AssetID id)
+{
+	const unsigned int mask = (unsigned int)_slots.size() - 1;
+	unsigned int emptyIndex = FindIndex(id);
+	if (_slots[emptyIndex].ID != id)
+	{
+		return false;
+	}
+
+	// Moves back every following entry of the probe sequence which would not be found past the hole
+	for (unsigned int index = (emptyIndex + 1) & mask; _slots[index].ID != INVALID_ASSET_ID; index = (index + 1) & mask)
+	{
+		const unsigned int homeIndex = GetHomeIndex(_slots[index].ID);
+		const bool isHomeBetween = emptyIndex <= index ? (emptyIndex < homeIndex && homeIndex <= index) : (emptyIndex < homeIndex || homeIndex <= index);
+		if (!isHomeBetween)
+		{
+			_slots[emptyIndex] = std::move(_slots[index]);
+			emptyIndex = index;
+		}
+	}
+
+	_slots[emptyIndex].ID = INVALID_ASSET_ID;
+	_slots[emptyIndex].Value = nullptr;
+	--_count;
+	return true;
+}
+
+void AssetTable::Clear()
+{
+	_slots.assign(INITIAL_CAPACITY, {INVALID_ASSET_ID, nullptr});
+	_count = 0;
+}
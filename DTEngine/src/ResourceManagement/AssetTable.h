@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "ResourceManagement/Asset.h"
+#include "ResourceManagement/AssetID.h"
+
+// Open addressing hash table of assets keyed by their IDs
+// Linear probing keeps a lookup within a few adjacent slots, removal shifts following entries back so no tombstones are needed
+class AssetTable final
+{
+public:
+	// Has to be a power of two
+	static const unsigned int INITIAL_CAPACITY = 64;
+
+private:
+	struct Slot
+	{
+		AssetID ID;
+		SharedPtr<Asset> Value;
+	};
+
+	DynamicArray<Slot> _slots;
+	unsigned int _count;
+
+public:
+	AssetTable();
+
+private:
+	inline unsigned int GetHomeIndex(AssetID id) const
+	{
+		return (unsigned int)(id ^ (id >> 32)) & ((unsigned int)_slots.size() - 1);
+	}
+
+	// Returns index of the slot with given ID or of the empty slot where it would be inserted
+	unsigned int FindIndex(AssetID id) const;
+	void Grow();
+
+public:
+	// Returns nullptr if there is no asset with given ID
+	SharedPtr<Asset> Find(AssetID id) const;
+	// Returns false (and keeps the stored asset) if an asset with given ID is already stored
+	bool Insert(AssetID id, const SharedPtr<Asset>& asset);
+	bool Remove(AssetID id);
+	void Clear();
+
+	template<typename FunctionT>
+	void ForEach(FunctionT function) const;
+
+	inline unsigned int GetCount() const
+	{
+		return _count;
+	}
+};
+
+template<typename FunctionT>
+inline void AssetTable::ForEach(FunctionT function) const
+{
+	for (const Slot& slot : _slots)
+	{
+		if (slot.ID != INVALID_ASSET_ID)
+		{
+			function(slot.ID, slot.Value);
+		}
+	}
+}
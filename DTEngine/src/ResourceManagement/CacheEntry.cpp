@@ -0,0 +1,74 @@
+#include "CacheEntry.h"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "Utility/String.h"
+
+// Makes names of entries being written unique within the process
+static std::atomic<unsigned int> gTemporaryEntriesCount(0);
+
+String GetCacheEntryPath(const String& directory, unsigned long long nameHash, const String& extension)
+{
+	static const Char HEX_DIGITS[] = DT_TEXT("0123456789abcdef");
+
+	String name(16, DT_TEXT('0'));
+	for (unsigned char i = 0; i < 16; ++i)
+	{
+		name[15 - i] = HEX_DIGITS[(nameHash >> (i * 4)) & 0xF];
+	}
+
+	return directory + name + extension;
+}
+
+bool OpenCacheEntry(const String& path, const CacheEntryHeader& header, std::ifstream& file)
+{
+	file.open(path, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	CacheEntryHeader storedHeader;
+	file.read((char*)&storedHeader, sizeof(storedHeader));
+
+	// Key is stored as well, so hash collision of file names cannot return wrong data silently
+	return file && storedHeader.Magic == header.Magic && storedHeader.Version == header.Version && storedHeader.Key == header.Key;
+}
+
+bool SaveCacheEntry(const String& path, const CacheEntryHeader& header, const Function<void(std::ofstream&)>& writeData)
+{
+	// Fails harmlessly if the directory already exists
+	std::error_code error;
+	std::filesystem::create_directories(GetDirectory(path), error);
+
+	// Several loading threads may produce the same entry at once, each writes its own file and renames it into place
+	// so readers never see a partially written entry
+	const std::string suffix = "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(++gTemporaryEntriesCount) + ".tmp";
+	const String temporaryPath = path + String(suffix.begin(), suffix.end());
+	std::ofstream file(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	writeData(file);
+	file.close();
+
+	if (file.fail())
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <fstream>
+
+#include "Core/Platform.h"
+#include "Core/Event.h"
+
+// Every entry of on-disk caches starts with this header, the rest of the file is up to the cache
+struct CacheEntryHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned long long Key;
+};
+
+// Entry is named by hex digits of the hash, placed in the cache directory
+String GetCacheEntryPath(const String& directory, unsigned long long nameHash, const String& extension);
+
+// Opens the entry if its header matches, file is left right after the header
+bool OpenCacheEntry(const String& path, const CacheEntryHeader& header, std::ifstream& file);
+
+// Creates the directory if needed and writes the header followed by whatever writeData writes
+bool SaveCacheEntry(const String& path, const CacheEntryHeader& header, const Function<void(std::ofstream&)>& writeData);
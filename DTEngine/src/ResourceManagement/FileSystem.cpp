@@ -0,0 +1,160 @@
+#include "FileSystem.h"
+
+#include <fstream>
+
+#include "Debug/Debug.h"
+#include "Utility/String.h"
+
+FileSystem gFileSystem;
+
+const String FileSystem::DEFAULT_PACK_PATH = DT_TEXT("Resources.dtpak");
+
+FileView::FileView() : _data(nullptr), _size(0)
+{}
+
+void FileView::Release()
+{
+	_data = nullptr;
+	_size = 0;
+	DynamicArray<unsigned char>().swap(_buffer);
+}
+
+void FileView::Swap(FileView& other)
+{
+	std::swap(_data, other._data);
+	std::swap(_size, other._size);
+	_buffer.swap(other._buffer);
+}
+
+bool FileSystem::Initialize()
+{
+	if (!std::ifstream(DEFAULT_PACK_PATH).is_open())
+	{
+		gDebug.Print(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("No resources pack found, loading loose files"));
+		return true;
+	}
+
+	return Mount(DEFAULT_PACK_PATH);
+}
+
+void FileSystem::Shutdown()
+{
+	UnmountAll();
+}
+
+bool FileSystem::Mount(const String& packPath)
+{
+	UniquePtr<PackFile> pack = std::make_unique<PackFile>();
+	if (!pack->Open(packPath))
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot mount pack: %s"), packPath.c_str());
+		return false;
+	}
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Mounted pack %s with %u files"), packPath.c_str(), pack->GetEntriesCount());
+	_packs.push_back(std::move(pack));
+	return true;
+}
+
+void FileSystem::UnmountAll()
+{
+	_packs.clear();
+}
+
+const PackFile* FileSystem::FindPack(const String& path, const PackEntry*& entry) const
+{
+	if (_packs.empty())
+	{
+		return nullptr;
+	}
+
+	const AssetID id = GetAssetID(NormalizePath(path));
+	for (auto it = _packs.rbegin(); it != _packs.rend(); ++it)
+	{
+		entry = (*it)->Find(id);
+		if (entry)
+		{
+			return it->get();
+		}
+	}
+	return nullptr;
+}
+
+bool FileSystem::ReadFile(const String& path, DynamicArray<unsigned char>& data) const
+{
+	const PackEntry* entry = nullptr;
+	const PackFile* pack = FindPack(path, entry);
+	if (pack)
+	{
+		return pack->Read(*entry, data);
+	}
+
+	// Opened at the end, so the whole file is read with a single call once its size is known
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	const std::streamoff size = file.tellg();
+	if (size < 0)
+	{
+		return false;
+	}
+
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size == 0 || file.read((char*)data.data(), size).good();
+}
+
+bool FileSystem::MapFile(const String& path, FileView& view) const
+{
+	view.Release();
+
+	const PackEntry* entry = nullptr;
+	const PackFile* pack = FindPack(path, entry);
+	if (pack && !entry->IsCompressed())
+	{
+		view._data = pack->GetStoredData(*entry);
+		view._size = entry->Size;
+		return view._data != nullptr;
+	}
+
+	if (!ReadFile(path, view._buffer))
+	{
+		return false;
+	}
+
+	// Empty files are still valid views
+	static const unsigned char EMPTY_DATA = 0;
+	view._data = view._buffer.empty() ? &EMPTY_DATA : view._buffer.data();
+	view._size = view._buffer.size();
+	return true;
+}
+
+bool FileSystem::ReadTextFile(const String& path, std::string& text) const
+{
+	DynamicArray<unsigned char> data;
+	if (!ReadFile(path, data))
+	{
+		return false;
+	}
+
+	// Files are read in binary mode, so Windows line endings are trimmed here
+	text.clear();
+	text.reserve(data.size());
+	for (unsigned char character : data)
+	{
+		if (character != '\r')
+		{
+			text.push_back((char)character);
+		}
+	}
+	return true;
+}
+
+bool FileSystem::Exists(const String& path) const
+{
+	const PackEntry* entry = nullptr;
+	return FindPack(path, entry) || std::ifstream(path).is_open();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "ResourceManagement/PackFile.h"
+
+// Read only data of a file, points straight into the mapped pack when the file is stored there uncompressed
+// Mapped data stays valid until packs are unmounted
+class FileView final
+{
+	friend class FileSystem;
+
+private:
+	const unsigned char* _data;
+	size_t _size;
+	// Holds the data when it cannot be mapped (loose or compressed files)
+	DynamicArray<unsigned char> _buffer;
+
+public:
+	FileView();
+	// Copy would point into buffer of the original
+	FileView(const FileView& other) = delete;
+	FileView& operator=(const FileView& other) = delete;
+
+	void Release();
+	// Exchanges data with another view, data of both stays where it is
+	void Swap(FileView& other);
+
+	inline const unsigned char* GetData() const
+	{
+		return _data;
+	}
+
+	inline size_t GetSize() const
+	{
+		return _size;
+	}
+
+	inline bool IsValid() const
+	{
+		return _data != nullptr;
+	}
+};
+
+// Reads engine files either from mounted packs or from loose files on disk
+// Paths are the ones engine uses (i.e. "Resources/Materials/Red.dtmat"), mounted packs are searched first
+// Reading is safe from any thread, packs are mounted and unmounted on main thread only while nothing is being loaded
+class FileSystem final
+{
+public:
+	static const String DEFAULT_PACK_PATH;
+
+private:
+	// Packs mounted later take precedence, so patches can be mounted over the base pack
+	DynamicArray<UniquePtr<PackFile>> _packs;
+
+public:
+	// Mounts default pack if there is one, game runs from loose files otherwise
+	bool Initialize();
+	void Shutdown();
+
+	bool Mount(const String& packPath);
+	void UnmountAll();
+
+	bool ReadFile(const String& path, DynamicArray<unsigned char>& data) const;
+	// Avoids copying when possible, data of uncompressed files in packs is used in place
+	bool MapFile(const String& path, FileView& view) const;
+	bool ReadTextFile(const String& path, std::string& text) const;
+	bool Exists(const String& path) const;
+
+	// Files in mounted packs shadow loose files, so changes of loose files have no effect then
+	inline bool HasMountedPacks() const
+	{
+		return !_packs.empty();
+	}
+
+private:
+	const PackFile* FindPack(const String& path, const PackEntry*& entry) const;
+};
+
+extern FileSystem gFileSystem;
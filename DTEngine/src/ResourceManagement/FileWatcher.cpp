@@ -0,0 +1,272 @@
+#include "FileWatcher.h"
+
+#if !DT_WINDOWS
+#include <filesystem>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Utility/String.h"
+
+const float FileWatcher::DEBOUNCE_TIME = 0.2f;
+
+// Enough for a few hundred notifications, changes of a whole directory (i.e. version control update) are read in more passes
+static const size_t NOTIFICATIONS_BUFFER_SIZE = 64 * 1024;
+
+#if DT_WINDOWS
+FileWatcher::FileWatcher() : _isRunning(false), _directoryHandle(nullptr), _stopEvent(nullptr)
+{}
+#else
+FileWatcher::FileWatcher() : _isRunning(false), _inotifyHandle(-1), _stopPipe{-1, -1}
+{}
+#endif
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+bool FileWatcher::Start(const String& directory)
+{
+	Stop();
+
+	_directory = NormalizePath(directory);
+	while (!_directory.empty() && _directory.back() == DT_TEXT('/'))
+	{
+		_directory.pop_back();
+	}
+
+#if DT_WINDOWS
+	HANDLE directoryHandle = CreateFile(_directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+										FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directoryHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	_directoryHandle = directoryHandle;
+
+	_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (!_stopEvent)
+	{
+		Stop();
+		return false;
+	}
+#else
+	_inotifyHandle = inotify_init1(IN_CLOEXEC);
+	if (_inotifyHandle < 0 || pipe(_stopPipe) != 0)
+	{
+		Stop();
+		return false;
+	}
+
+	// Inotify doesn't watch subdirectories, so each of them gets its own watch
+	AddWatches(_directory);
+	if (_watchedDirectories.empty())
+	{
+		Stop();
+		return false;
+	}
+#endif
+
+	_isRunning = true;
+	_thread = std::thread(&FileWatcher::ThreadLoop, this);
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	if (_isRunning)
+	{
+		_isRunning = false;
+#if DT_WINDOWS
+		SetEvent(_stopEvent);
+#else
+		const char stopSignal = 0;
+		write(_stopPipe[1], &stopSignal, sizeof(stopSignal));
+#endif
+		_thread.join();
+	}
+
+#if DT_WINDOWS
+	if (_stopEvent)
+	{
+		CloseHandle(_stopEvent);
+	}
+	if (_directoryHandle)
+	{
+		CloseHandle(_directoryHandle);
+	}
+	_stopEvent = nullptr;
+	_directoryHandle = nullptr;
+#else
+	for (int handle : {_inotifyHandle, _stopPipe[0], _stopPipe[1]})
+	{
+		if (handle >= 0)
+		{
+			close(handle);
+		}
+	}
+	_inotifyHandle = -1;
+	_stopPipe[0] = -1;
+	_stopPipe[1] = -1;
+	_watchedDirectories.clear();
+#endif
+
+	std::lock_guard<std::mutex> lock(_changesMutex);
+	_changes.clear();
+}
+
+void FileWatcher::AddChange(const String& path)
+{
+	std::lock_guard<std::mutex> lock(_changesMutex);
+	_changes[path] = Clock::now();
+}
+
+void FileWatcher::TakeChangedFiles(DynamicArray<String>& changedFiles)
+{
+	const Clock::time_point settledTime = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(DEBOUNCE_TIME));
+
+	std::lock_guard<std::mutex> lock(_changesMutex);
+	for (auto it = _changes.begin(); it != _changes.end();)
+	{
+		if (it->second > settledTime)
+		{
+			++it;
+			continue;
+		}
+
+		changedFiles.push_back(it->first);
+		it = _changes.erase(it);
+	}
+}
+
+#if DT_WINDOWS
+void FileWatcher::ThreadLoop()
+{
+	// Notifications are DWORD aligned
+	DynamicArray<DWORD> buffer(NOTIFICATIONS_BUFFER_SIZE / sizeof(DWORD));
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	const HANDLE events[] = {overlapped.hEvent, _stopEvent};
+
+	while (_isRunning)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (!ReadDirectoryChangesW(_directoryHandle, buffer.data(), (DWORD)(buffer.size() * sizeof(DWORD)), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+								   nullptr, &overlapped, nullptr))
+		{
+			break;
+		}
+
+		DWORD bytesCount = 0;
+		if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0)
+		{
+			// Pending read writes to the buffer, so it has to finish before the buffer is freed
+			CancelIo(_directoryHandle);
+			GetOverlappedResult(_directoryHandle, &overlapped, &bytesCount, TRUE);
+			break;
+		}
+
+		// Zero bytes means that the buffer has overflown and changes were lost
+		if (!GetOverlappedResult(_directoryHandle, &overlapped, &bytesCount, FALSE) || bytesCount == 0)
+		{
+			continue;
+		}
+
+		const unsigned char* entry = (const unsigned char*)buffer.data();
+		while (true)
+		{
+			const FILE_NOTIFY_INFORMATION* notification = (const FILE_NOTIFY_INFORMATION*)entry;
+			if (notification->Action != FILE_ACTION_REMOVED && notification->Action != FILE_ACTION_RENAMED_OLD_NAME)
+			{
+				const WCHAR* name = notification->FileName;
+				const String relativePath(name, name + notification->FileNameLength / sizeof(WCHAR));
+				AddChange(_directory + DT_TEXT('/') + NormalizePath(relativePath));
+			}
+
+			if (notification->NextEntryOffset == 0)
+			{
+				break;
+			}
+			entry += notification->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+#else
+void FileWatcher::AddWatches(const String& directory)
+{
+	// Files are reported once they are closed after writing or moved in, editors saving through a temporary file do the latter
+	const int watch = inotify_add_watch(_inotifyHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watch < 0)
+	{
+		return;
+	}
+	_watchedDirectories[watch] = directory;
+
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		if (it->is_directory(error))
+		{
+			AddWatches(directory + DT_TEXT('/') + it->path().filename().generic_string<Char>());
+		}
+	}
+}
+
+void FileWatcher::ThreadLoop()
+{
+	DynamicArray<unsigned char> buffer(NOTIFICATIONS_BUFFER_SIZE);
+
+	while (_isRunning)
+	{
+		pollfd handles[] = {{_inotifyHandle, POLLIN, 0}, {_stopPipe[0], POLLIN, 0}};
+		if (poll(handles, 2, -1) < 0 || handles[1].revents != 0)
+		{
+			break;
+		}
+
+		const ssize_t bytesCount = read(_inotifyHandle, buffer.data(), buffer.size());
+		if (bytesCount <= 0)
+		{
+			continue;
+		}
+
+		for (const unsigned char* entry = buffer.data(); entry < buffer.data() + bytesCount;)
+		{
+			const inotify_event* notification = (const inotify_event*)entry;
+			entry += sizeof(inotify_event) + notification->len;
+
+			if (notification->mask & IN_IGNORED)
+			{
+				// Watched directory was removed
+				_watchedDirectories.erase(notification->wd);
+				continue;
+			}
+
+			auto directory = _watchedDirectories.find(notification->wd);
+			if (notification->len == 0 || directory == _watchedDirectories.end())
+			{
+				continue;
+			}
+
+			const String path = directory->second + DT_TEXT('/') + notification->name;
+			if (notification->mask & IN_ISDIR)
+			{
+				// Files may be written to the new directory before its watch is added, those are caught on their next change
+				if (notification->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					AddWatches(path);
+				}
+			}
+			else if (notification->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				AddChange(path);
+			}
+		}
+	}
+}
+#endif
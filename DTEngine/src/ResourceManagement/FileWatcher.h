@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "Core/Platform.h"
+
+// Watches a directory tree for changed files on a background thread
+// Editors often save a file in more writes, so a file is reported only once it has stayed unchanged for DEBOUNCE_TIME
+class FileWatcher final
+{
+public:
+	static const float DEBOUNCE_TIME;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	String _directory;
+	std::thread _thread;
+	std::atomic<bool> _isRunning;
+
+	// Changed files (paths as engine uses them) with time of their last change
+	std::mutex _changesMutex;
+	Dictionary<String, Clock::time_point> _changes;
+
+#if DT_WINDOWS
+	void* _directoryHandle;
+	void* _stopEvent;
+#else
+	int _inotifyHandle;
+	// Written to when stopping, so the thread doesn't wait for another change
+	int _stopPipe[2];
+	Dictionary<int, String> _watchedDirectories;
+
+	void AddWatches(const String& directory);
+#endif
+
+public:
+	FileWatcher();
+	~FileWatcher();
+
+private:
+	void ThreadLoop();
+	void AddChange(const String& path);
+
+public:
+	// Paths of reported files start with the watched directory, i.e. "Resources/Materials/Red.dtmat"
+	bool Start(const String& directory);
+	void Stop();
+
+	inline bool IsRunning() const
+	{
+		return _isRunning;
+	}
+
+	// Moves files which have settled since last call to the end of given array
+	void TakeChangedFiles(DynamicArray<String>& changedFiles);
+};
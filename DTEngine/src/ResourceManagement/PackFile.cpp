@@ -0,0 +1,280 @@
+#include "PackFile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#if !DT_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Utility/LZ4.h"
+#include "Utility/String.h"
+
+const float PackFile::MIN_COMPRESSION_SAVING = 0.1f;
+
+static const String PACK_EXTENSION = DT_TEXT("dtpak");
+
+PackFile::PackFile() : _fileHandle(nullptr), _mappingHandle(nullptr), _data(nullptr), _size(0), _entries(nullptr), _entriesCount(0)
+{}
+
+PackFile::~PackFile()
+{
+	Close();
+}
+
+bool PackFile::Open(const String& path)
+{
+	Close();
+
+#if DT_WINDOWS
+	HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	_fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(PackHeader))
+	{
+		Close();
+		return false;
+	}
+	_size = (size_t)fileSize.QuadPart;
+
+	_mappingHandle = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const unsigned char*)MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(PackHeader))
+	{
+		close(file);
+		return false;
+	}
+	_size = (size_t)fileStat.st_size;
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	_data = data == MAP_FAILED ? nullptr : (const unsigned char*)data;
+#endif
+
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+
+	const PackHeader* header = (const PackHeader*)_data;
+	const unsigned long long entriesSize = (unsigned long long)header->EntriesCount * sizeof(PackEntry);
+	if (header->Magic != MAGIC || header->Version != VERSION || header->EntriesOffset % ALIGNMENT != 0 ||
+		header->EntriesOffset > _size || entriesSize > _size - header->EntriesOffset)
+	{
+		Close();
+		return false;
+	}
+
+	_entries = (const PackEntry*)(_data + header->EntriesOffset);
+	_entriesCount = header->EntriesCount;
+	return true;
+}
+
+void PackFile::Close()
+{
+#if DT_WINDOWS
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mappingHandle)
+	{
+		CloseHandle(_mappingHandle);
+	}
+	if (_fileHandle)
+	{
+		CloseHandle(_fileHandle);
+	}
+#else
+	if (_data)
+	{
+		munmap((void*)_data, _size);
+	}
+#endif
+
+	_fileHandle = nullptr;
+	_mappingHandle = nullptr;
+	_data = nullptr;
+	_size = 0;
+	_entries = nullptr;
+	_entriesCount = 0;
+}
+
+const PackEntry* PackFile::Find(AssetID id) const
+{
+	const PackEntry* entriesEnd = _entries + _entriesCount;
+	const PackEntry* entry = std::lower_bound(_entries, entriesEnd, id, [](const PackEntry& entry, AssetID id)
+	{
+		return entry.ID < id;
+	});
+
+	return entry != entriesEnd && entry->ID == id ? entry : nullptr;
+}
+
+const unsigned char* PackFile::GetStoredData(const PackEntry& entry) const
+{
+	if (entry.Offset > _size || entry.StoredSize > _size - entry.Offset)
+	{
+		return nullptr;
+	}
+
+	return _data + entry.Offset;
+}
+
+bool PackFile::Read(const PackEntry& entry, DynamicArray<unsigned char>& data) const
+{
+	const unsigned char* storedData = GetStoredData(entry);
+	if (!storedData)
+	{
+		return false;
+	}
+
+	data.resize(entry.Size);
+	if (entry.IsCompressed())
+	{
+		return LZ4::Decompress(storedData, entry.StoredSize, data.data(), entry.Size);
+	}
+
+	memcpy(data.data(), storedData, entry.Size);
+	return true;
+}
+
+static void WritePadding(std::ofstream& file, unsigned int alignment)
+{
+	static const char ZEROS[PackFile::ALIGNMENT] = {0};
+	const unsigned int misalignment = (unsigned int)((unsigned long long)file.tellp() % alignment);
+	if (misalignment != 0)
+	{
+		file.write(ZEROS, alignment - misalignment);
+	}
+}
+
+bool PackFile::Build(const String& sourceDirectory, const String& packPath, const DynamicArray<String>& excludedExtensions, bool compress)
+{
+	namespace fs = std::filesystem;
+
+	struct SourceFile
+	{
+		AssetID ID;
+		fs::path FilePath;
+	};
+
+	std::error_code error;
+	fs::path root = fs::path(sourceDirectory).lexically_normal();
+	if (!root.has_filename())
+	{
+		root = root.parent_path();
+	}
+	if (!fs::is_directory(root, error))
+	{
+		return false;
+	}
+
+	DynamicArray<SourceFile> sourceFiles;
+	for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+	{
+		if (!it->is_regular_file(error))
+		{
+			continue;
+		}
+
+		const String extension = GetExtension(it->path().filename().native());
+		if (extension == PACK_EXTENSION || std::find(excludedExtensions.begin(), excludedExtensions.end(), extension) != excludedExtensions.end())
+		{
+			continue;
+		}
+
+		// Same path as engine asks for, i.e. "Resources/Materials/Red.dtmat"
+		const String path = (root.filename() / it->path().lexically_relative(root)).generic_string<Char>();
+		sourceFiles.push_back({GetAssetID(path), it->path()});
+	}
+	if (error)
+	{
+		return false;
+	}
+
+	std::sort(sourceFiles.begin(), sourceFiles.end(), [](const SourceFile& first, const SourceFile& second)
+	{
+		return first.ID < second.ID;
+	});
+	for (size_t i = 1; i < sourceFiles.size(); ++i)
+	{
+		if (sourceFiles[i].ID == sourceFiles[i - 1].ID)
+		{
+			// Paths collide, engine could not tell those files apart
+			return false;
+		}
+	}
+
+	std::ofstream pack(packPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!pack.is_open())
+	{
+		return false;
+	}
+
+	PackHeader header = {MAGIC, VERSION, (unsigned int)sourceFiles.size(), 0, 0};
+	pack.write((const char*)&header, sizeof(header));
+
+	DynamicArray<PackEntry> entries;
+	DynamicArray<unsigned char> compressedData;
+	for (const SourceFile& sourceFile : sourceFiles)
+	{
+		std::ifstream file(sourceFile.FilePath, std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		const DynamicArray<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		const unsigned char* storedData = data.data();
+		size_t storedSize = data.size();
+		if (compress && !data.empty())
+		{
+			compressedData.resize(LZ4::GetCompressBound(data.size()));
+			const size_t compressedSize = LZ4::Compress(data.data(), data.size(), compressedData.data());
+			if (compressedSize <= data.size() * (1.0f - MIN_COMPRESSION_SAVING))
+			{
+				storedData = compressedData.data();
+				storedSize = compressedSize;
+			}
+		}
+
+		WritePadding(pack, ALIGNMENT);
+		entries.push_back({sourceFile.ID, (unsigned long long)pack.tellp(), (unsigned int)storedSize, (unsigned int)data.size()});
+		pack.write((const char*)storedData, storedSize);
+	}
+
+	WritePadding(pack, ALIGNMENT);
+	header.EntriesOffset = (unsigned long long)pack.tellp();
+	pack.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+
+	pack.seekp(0);
+	pack.write((const char*)&header, sizeof(header));
+
+	return !pack.fail();
+}
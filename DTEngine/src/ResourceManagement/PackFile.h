@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Core/Platform.h"
+#include "ResourceManagement/AssetID.h"
+
+// Layout of .dtpak files:
+// header, blobs of all files (each aligned to ALIGNMENT) and table of entries sorted by ID at the end
+// Files are identified by IDs of their paths as engine uses them (i.e. "Resources/Materials/Red.dtmat")
+struct PackHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned int EntriesCount;
+	unsigned int Reserved;
+	unsigned long long EntriesOffset;
+};
+
+struct PackEntry
+{
+	AssetID ID;
+	unsigned long long Offset;
+	// Entry is compressed with LZ4 if stored size differs from the original one
+	unsigned int StoredSize;
+	unsigned int Size;
+
+	inline bool IsCompressed() const
+	{
+		return StoredSize != Size;
+	}
+};
+
+// Read only view of a pack, whole file is memory mapped so reading an entry costs only page faults of its blob
+// Reading is safe from any thread once the pack is open
+class PackFile final
+{
+public:
+	static const unsigned int MAGIC = 0x4B505444; // "DTPK"
+	static const unsigned int VERSION = 1;
+	static const unsigned int ALIGNMENT = 16;
+	// Entries are stored compressed only if it saves at least this fraction of their size
+	static const float MIN_COMPRESSION_SAVING;
+
+private:
+	void* _fileHandle;
+	void* _mappingHandle;
+	const unsigned char* _data;
+	size_t _size;
+
+	const PackEntry* _entries;
+	unsigned int _entriesCount;
+
+public:
+	PackFile();
+	~PackFile();
+
+	bool Open(const String& path);
+	void Close();
+
+	// Returns nullptr if pack has no entry with given ID
+	const PackEntry* Find(AssetID id) const;
+	// Returns entry's data as it is stored in the pack, nullptr if the entry points out of the pack
+	const unsigned char* GetStoredData(const PackEntry& entry) const;
+	// Decompresses compressed entries, returns false if entry data is corrupted
+	bool Read(const PackEntry& entry, DynamicArray<unsigned char>& data) const;
+
+	inline unsigned int GetEntriesCount() const
+	{
+		return _entriesCount;
+	}
+
+	// Packs all files in source directory (recursively), paths in pack start with the name of the directory
+	// Files with extensions in excludedExtensions (i.e. runtime caches) are skipped
+	static bool Build(const String& sourceDirectory, const String& packPath, const DynamicArray<String>& excludedExtensions, bool compress);
+};
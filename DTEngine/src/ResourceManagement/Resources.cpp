@@ -1,37 +1,411 @@
 #include "Resources.h"
 
+#include <algorithm>
+
+#include "ResourceManagement/FileSystem.h"
+#include "Utility/String.h"
+
 Resources gResources;
 
+const String Resources::RESOURCES_DIRECTORY = DT_TEXT("Resources");
+
+Resources::Resources() : _memoryBudget(DEFAULT_MEMORY_BUDGET), _memoryUsage(0), _frameIndex(0)
+{}
+
+bool Resources::FinishLoad(const SharedPtr<AssetLoadRequest>& request)
+{
+	_loader.WaitForLoad(request);
+
+	const AssetLoadState state = request->State.load();
+	if (state == AssetLoadState::Ready || state == AssetLoadState::Failed)
+	{
+		return state == AssetLoadState::Ready;
+	}
+
+	const String& path = request->Path;
+	const String& typeName = request->TypeName;
+	const SharedPtr<Asset>& asset = request->LoadedAsset;
+
+	bool result = state == AssetLoadState::Loaded;
+	if (!result)
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot load %s at path: %s"), typeName.c_str(), path.c_str());
+	}
+	else
+	{
+		gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Loaded asset of type %s at path: %s"), typeName.c_str(), path.c_str());
+
+		result = asset->Initialize();
+		if (!result)
+		{
+			gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot initialize %s at path: %s"), typeName.c_str(), path.c_str());
+		}
+		else
+		{
+			gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Initialized asset of type %s at path: %s"), typeName.c_str(), path.c_str());
+		}
+	}
+
+	if (!result)
+	{
+		asset->Shutdown();
+	}
+
+	// Source files may be read to find them (i.e. shader includes), so it is done without the lock
+	DynamicArray<String> sourceFiles;
+	DynamicArray<AssetID> dependencies;
+	if (result && IsHotReloadEnabled())
+	{
+		GetReloadInfo(*asset, sourceFiles, dependencies);
+	}
+
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	if (result && _assets.Insert(request->ID, asset))
+	{
+		const size_t memorySize = asset->GetMemorySize();
+		_assetsUsage[request->ID] = {typeName, memorySize, _frameIndex, request->Factory, std::move(sourceFiles), std::move(dependencies), false};
+		_memoryUsage += memorySize;
+	}
+	_inFlightRequests.erase(request->ID);
+	request->State = result ? AssetLoadState::Ready : AssetLoadState::Failed;
+
+	return result;
+}
+
 bool Resources::Initialize()
 {
+	if (!_loader.Initialize())
+	{
+		return false;
+	}
+
 	_missingMaterial = std::make_unique<Material>();
 	_missingMaterial->SetColor(Vector4(1.0f, 0.0f, 1.0f, 1.0f));
 	if (!_missingMaterial->Initialize())
 	{
 		return false;
 	}
+
+#if DT_DEBUG
+	// Packed files shadow loose ones, so their changes would have no effect
+	if (!gFileSystem.HasMountedPacks() && !_fileWatcher.Start(RESOURCES_DIRECTORY))
+	{
+		gDebug.Print(LogVerbosity::Warning, CHANNEL_ENGINE, DT_TEXT("Cannot watch resources directory, hot reload is disabled"));
+	}
+#endif
+
 	return true;
 }
 
+void Resources::GetReloadInfo(const Asset& asset, DynamicArray<String>& sourceFiles, DynamicArray<AssetID>& dependencies)
+{
+	// Watcher reports normalized paths
+	asset.GetSourceFiles(sourceFiles);
+	for (String& sourceFile : sourceFiles)
+	{
+		sourceFile = NormalizePath(sourceFile);
+	}
+
+	DynamicArray<const Asset*> dependencyAssets;
+	asset.GetDependencies(dependencyAssets);
+	for (const Asset* dependency : dependencyAssets)
+	{
+		// Hidden assets are never reloaded
+		if (!dependency->GetPath().empty())
+		{
+			dependencies.push_back(GetAssetID(dependency->GetPath()));
+		}
+	}
+}
+
+void Resources::ReloadChangedAssets()
+{
+	DynamicArray<String> changedFiles;
+	_fileWatcher.TakeChangedFiles(changedFiles);
+	if (changedFiles.empty())
+	{
+		return;
+	}
+	std::sort(changedFiles.begin(), changedFiles.end());
+
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	for (auto& usage : _assetsUsage)
+	{
+		AssetUsage& assetUsage = usage.second;
+		const bool isChanged = std::any_of(assetUsage.SourceFiles.begin(), assetUsage.SourceFiles.end(), [&changedFiles](const String& sourceFile)
+		{
+			return std::binary_search(changedFiles.begin(), changedFiles.end(), sourceFile);
+		});
+		if (!isChanged || assetUsage.IsReloading || !assetUsage.Factory)
+		{
+			continue;
+		}
+
+		// New version is loaded in the background like any other asset, the loaded one is used until it is swapped
+		const SharedPtr<Asset> asset = _assets.Find(usage.first);
+		SharedPtr<AssetLoadRequest> request(new AssetLoadRequest(usage.first, asset->GetPath(), assetUsage.TypeName, assetUsage.Factory, assetUsage.Factory(), AssetLoadState::Loading));
+		request->IsReload = true;
+		assetUsage.IsReloading = true;
+		_loader.Enqueue(request);
+
+		gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Reloading asset of type %s at path: %s"), assetUsage.TypeName.c_str(), asset->GetPath().c_str());
+	}
+}
+
+void Resources::FinishReload(const SharedPtr<AssetLoadRequest>& request)
+{
+	const String& path = request->Path;
+	const String& typeName = request->TypeName;
+	const SharedPtr<Asset>& reloaded = request->LoadedAsset;
+
+	SharedPtr<Asset> asset;
+	{
+		std::lock_guard<std::mutex> lock(_assetsMutex);
+		asset = _assets.Find(request->ID);
+		auto usage = _assetsUsage.find(request->ID);
+		if (usage != _assetsUsage.end())
+		{
+			usage->second.IsReloading = false;
+		}
+	}
+
+	// Asset may have been evicted in the meantime, it is loaded from the changed files on its next request then
+	// Previous version stays in use if the new one cannot be loaded (i.e. the file is being edited and has a typo)
+	const bool result = asset && request->State.load() == AssetLoadState::Loaded && asset->TakeReloaded(*reloaded);
+	reloaded->Shutdown();
+	request->State = result ? AssetLoadState::Ready : AssetLoadState::Failed;
+	if (!asset)
+	{
+		return;
+	}
+	if (!result)
+	{
+		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot reload %s at path: %s, previous version is kept"), typeName.c_str(), path.c_str());
+		return;
+	}
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Reloaded asset of type %s at path: %s"), typeName.c_str(), path.c_str());
+
+	// Changed files may include other files or use other assets now
+	DynamicArray<String> sourceFiles;
+	DynamicArray<AssetID> dependencies;
+	GetReloadInfo(*asset, sourceFiles, dependencies);
+
+	DynamicArray<SharedPtr<Asset>> dependents;
+	{
+		std::lock_guard<std::mutex> lock(_assetsMutex);
+		auto usage = _assetsUsage.find(request->ID);
+		if (usage != _assetsUsage.end())
+		{
+			usage->second.SourceFiles = std::move(sourceFiles);
+			usage->second.Dependencies = std::move(dependencies);
+		}
+
+		for (const auto& dependentUsage : _assetsUsage)
+		{
+			const DynamicArray<AssetID>& dependentDependencies = dependentUsage.second.Dependencies;
+			if (std::find(dependentDependencies.begin(), dependentDependencies.end(), request->ID) != dependentDependencies.end())
+			{
+				dependents.push_back(_assets.Find(dependentUsage.first));
+			}
+		}
+	}
+
+	// Dependents are not reloaded, they only update what they derive from the dependency
+	for (const SharedPtr<Asset>& dependent : dependents)
+	{
+		dependent->OnDependencyReloaded(*asset);
+	}
+	OnAssetReloaded.Execute(*asset);
+}
+
 void Resources::Shutdown()
 {
+	_fileWatcher.Stop();
+
+	// Loading threads may still hold assets, so they are stopped first
+	_loader.Shutdown();
+	_loader.TakeLoaded(_loadedRequests);
+	for (const SharedPtr<AssetLoadRequest>& request : _loadedRequests)
+	{
+		if (request->State.load() == AssetLoadState::Loaded)
+		{
+			request->LoadedAsset->Shutdown();
+		}
+	}
+	_loadedRequests.clear();
+	_inFlightRequests.clear();
+
 	if (_missingMaterial)
 	{
 		_missingMaterial->Shutdown();
 	}
 	_missingMaterial = nullptr;
 
-	for (auto pair : _assetsMap)
+	_assets.ForEach([](AssetID id, const SharedPtr<Asset>& asset)
+	{
+		if (asset)
+		{
+			asset->Shutdown();
+		}
+	});
+	_assets.Clear();
+	_assetsUsage.clear();
+	_memoryUsage = 0;
+}
+
+void Resources::Update()
+{
+	_loader.TakeLoaded(_loadedRequests);
+
+	// Order of loading is kept, so assets wait for their dependencies only when those are still loading
+	size_t remainingCount = 0;
+	for (size_t i = 0; i < _loadedRequests.size(); ++i)
 	{
-		if (pair.second)
+		const SharedPtr<AssetLoadRequest>& request = _loadedRequests[i];
+		if (request->State.load() == AssetLoadState::Loaded && !request->LoadedAsset->IsReadyToInitialize())
 		{
-			pair.second->Shutdown();
+			_loadedRequests[remainingCount++] = request;
+			continue;
 		}
+
+		if (request->IsReload)
+		{
+			FinishReload(request);
+			continue;
+		}
+
+		// Requests which have been waited for are already finished
+		FinishLoad(request);
+	}
+	_loadedRequests.resize(remainingCount);
+
+	if (IsHotReloadEnabled())
+	{
+		ReloadChangedAssets();
+	}
+
+	EvictUnusedAssets();
+	++_frameIndex;
+}
+
+void Resources::MarkUsed(AssetID id)
+{
+	auto usage = _assetsUsage.find(id);
+	if (usage != _assetsUsage.end())
+	{
+		usage->second.LastUsedFrame = _frameIndex;
+	}
+}
+
+void Resources::EvictUnusedAssets()
+{
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+
+	// Sizes change over time (i.e. meshes releasing CPU data), so they are refreshed together with usage
+	DynamicArray<Pair<unsigned int, AssetID>> unusedAssets;
+	_memoryUsage = 0;
+	_assets.ForEach([this, &unusedAssets](AssetID id, const SharedPtr<Asset>& asset)
+	{
+		auto usage = _assetsUsage.find(id);
+		if (usage == _assetsUsage.end())
+		{
+			return;
+		}
+
+		usage->second.MemorySize = asset->GetMemorySize();
+		_memoryUsage += usage->second.MemorySize;
+
+		// Table holds the only reference of unused assets, nothing can take another one without locking the mutex
+		if (asset.use_count() > 1)
+		{
+			usage->second.LastUsedFrame = _frameIndex;
+		}
+		else if (usage->second.MemorySize > 0)
+		{
+			unusedAssets.push_back({usage->second.LastUsedFrame, id});
+		}
+	});
+
+	if (_memoryBudget == 0 || _memoryUsage <= _memoryBudget)
+	{
+		return;
+	}
+
+	std::sort(unusedAssets.begin(), unusedAssets.end());
+	for (const Pair<unsigned int, AssetID>& unusedAsset : unusedAssets)
+	{
+		if (_memoryUsage <= _memoryBudget)
+		{
+			break;
+		}
+
+		const AssetID id = unusedAsset.second;
+		const SharedPtr<Asset> asset = _assets.Find(id);
+		const AssetUsage& usage = _assetsUsage[id];
+		_memoryUsage -= usage.MemorySize;
+		gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Evicted asset of type %s (%u KB) at path: %s"), usage.TypeName.c_str(), (unsigned int)(usage.MemorySize / 1024), asset->GetPath().c_str());
+
+		// Asset is loaded again on its next request
+		_assets.Remove(id);
+		_assetsUsage.erase(id);
+		asset->Shutdown();
+	}
+}
+
+void Resources::SetMemoryBudget(size_t memoryBudget)
+{
+	_memoryBudget = memoryBudget;
+}
+
+size_t Resources::GetMemoryUsage()
+{
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	return _memoryUsage;
+}
+
+void Resources::GetMemoryUsagePerType(Map<String, size_t>& memoryUsagePerType)
+{
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+
+	memoryUsagePerType.clear();
+	for (const auto& usage : _assetsUsage)
+	{
+		memoryUsagePerType[usage.second.TypeName] += usage.second.MemorySize;
+	}
+}
+
+void Resources::LogMemoryUsage()
+{
+	Map<String, size_t> memoryUsagePerType;
+	GetMemoryUsagePerType(memoryUsagePerType);
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Assets take %u KB of %u KB budget"), (unsigned int)(GetMemoryUsage() / 1024), (unsigned int)(_memoryBudget / 1024));
+	for (const auto& usage : memoryUsagePerType)
+	{
+		gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("    %s: %u KB"), usage.first.c_str(), (unsigned int)(usage.second / 1024));
 	}
-	_assetsMap.clear();
 }
 
 Material* Resources::GetDefaultMaterial() const
 {
 	return _missingMaterial.get();
 }
+
+void Resources::ReleaseMeshesCPUData()
+{
+	const size_t previousSize = MeshBase::GetTotalCPUDataSize();
+
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	_assets.ForEach([](AssetID id, SharedPtr<Asset> asset)
+	{
+		SharedPtr<MeshBase> mesh = DynamicPointerCast<MeshBase>(asset);
+		if (mesh)
+		{
+			mesh->ReleaseCPUData();
+		}
+	});
+
+	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Released %u KB of CPU mesh data, %u KB is still retained"),
+				  (unsigned int)((previousSize - MeshBase::GetTotalCPUDataSize()) / 1024), (unsigned int)(MeshBase::GetTotalCPUDataSize() / 1024));
+}
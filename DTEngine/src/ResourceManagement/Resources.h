@@ -1,6 +1,12 @@
 #pragma once
 
+#include <mutex>
+
+#include "Core/Event.h"
 #include "Debug/Debug.h"
+#include "ResourceManagement/AssetLoader.h"
+#include "ResourceManagement/AssetTable.h"
+#include "ResourceManagement/FileWatcher.h"
 
 #include "Rendering/Material.h"
 #include "Rendering/Shader.h"
@@ -17,46 +23,173 @@
 #include "Rendering/Meshes/CapsuleMesh.h"
 #include "Rendering/Meshes/StaticMesh.h"
 
-#include <map>
-
 class Shader;
 class MeshBase;
 class Material;
 
 class Resources final
 {
+public:
+	// Unreferenced assets are evicted, least recently used first, while loaded assets take more memory than this
+	static const size_t DEFAULT_MEMORY_BUDGET = 512 * 1024 * 1024;
+	// Watched for changes in debug builds when running from loose files
+	static const String RESOURCES_DIRECTORY;
+
+private:
+	// Loaded assets with paths, only those can be evicted or reloaded as they can be loaded again
+	struct AssetUsage
+	{
+		String TypeName;
+		size_t MemorySize;
+		// Frame in which the asset was last requested or referenced outside of resources
+		unsigned int LastUsedFrame;
+
+		// Kept only while hot reload is enabled
+		AssetFactory Factory;
+		DynamicArray<String> SourceFiles;
+		DynamicArray<AssetID> Dependencies;
+		bool IsReloading;
+	};
+
 protected:
-	Map<String, SharedPtr<Asset>> _assetsMap;
+	// Guards assets table and in-flight requests, loading threads request dependencies of assets they load
+	std::mutex _assetsMutex;
+	AssetTable _assets;
+	// Requests being loaded, so concurrent requests for the same path share one load
+	Dictionary<AssetID, SharedPtr<AssetLoadRequest>> _inFlightRequests;
+	// Requests loaded by loading threads, initialized on main thread in Update (main thread only)
+	DynamicArray<SharedPtr<AssetLoadRequest>> _loadedRequests;
+	AssetLoader _loader;
 	UniquePtr<Material> _missingMaterial;
 
+	// Guarded by assets mutex as well
+	Dictionary<AssetID, AssetUsage> _assetsUsage;
+	size_t _memoryBudget;
+	size_t _memoryUsage;
+	unsigned int _frameIndex;
+
+	FileWatcher _fileWatcher;
+
+private:
+	template<typename T>
+	static String GetTypeName();
+	template<typename T>
+	static SharedPtr<Asset> CreateAsset();
+	// Hidden assets (created without a path) are identified by their type
+	template<typename T>
+	static AssetID GetHiddenAssetID();
+
+	// Initializes loaded asset on calling (main) thread, loading it first if it isn't loaded yet
+	bool FinishLoad(const SharedPtr<AssetLoadRequest>& request);
+	// Swaps reloaded asset into the loaded one and notifies assets depending on it (main thread only)
+	void FinishReload(const SharedPtr<AssetLoadRequest>& request);
+
+	static void GetReloadInfo(const Asset& asset, DynamicArray<String>& sourceFiles, DynamicArray<AssetID>& dependencies);
+	// Starts reloading assets whose source files have changed, other assets stay as they are
+	void ReloadChangedAssets();
+
+	// Has to be called with assets mutex locked
+	void MarkUsed(AssetID id);
+	// Refreshes usage of all assets and evicts unreferenced ones until memory usage fits the budget
+	void EvictUnusedAssets();
+
 public:
+	// Called after an asset has taken over its reloaded content, for users deriving data from assets (i.e. bounds from meshes)
+	Event<void(const Asset&)> OnAssetReloaded;
+
+public:
+	Resources();
+
 	bool Initialize();
 	void Shutdown();
 
+	// Initializes assets whose loading has finished, swaps in reloaded ones and evicts assets over memory budget
+	// Called once per frame on main thread, so assets change only between frames
+	void Update();
+
+	inline bool IsHotReloadEnabled() const
+	{
+		return _fileWatcher.IsRunning();
+	}
+
+	// Zero disables eviction
+	void SetMemoryBudget(size_t memoryBudget);
+
+	inline size_t GetMemoryBudget() const
+	{
+		return _memoryBudget;
+	}
+
+	// Memory of evictable (loaded from a path) assets as of the last update
+	size_t GetMemoryUsage();
+
+	void GetMemoryUsagePerType(Map<String, size_t>& memoryUsagePerType);
+	void LogMemoryUsage();
+
 	Material* GetDefaultMaterial() const;
 
+	// Trims CPU side data of all loaded meshes to what their consumers required, called once scene is loaded
+	void ReleaseMeshesCPUData();
+
 	template<typename T>
 	SharedPtr<T> Get();
+	// Loads and initializes the asset on calling thread (main thread only)
+	// ID of the path can be passed in if it is known already (i.e. computed at compile time with GetAssetID)
 	template<typename T>
 	SharedPtr<T> Get(const String& path);
 	template<typename T>
+	SharedPtr<T> Get(AssetID id, const String& path);
+	// Returns already initialized asset without loading it, nullptr if there is none
+	template<typename T>
+	SharedPtr<T> Find(AssetID id);
+	// Starts loading the asset on a loading thread, safe to call from any thread (also from Load of other assets)
+	// Asset gets initialized in Update once it is loaded and ready to initialize
+	template<typename T>
+	AssetLoadHandle<T> LoadAsync(const String& path);
+	template<typename T>
+	AssetLoadHandle<T> LoadAsync(AssetID id, const String& path);
+	// Blocks until the asset is loaded and initializes it right away if needed (main thread only)
+	template<typename T>
+	SharedPtr<T> Wait(const AssetLoadHandle<T>& handle);
+	// Copies are owned by the caller only and shut down once the last reference to them is released
+	template<typename T>
 	SharedPtr<T> GetCopy(const T& original);
 };
 
 extern Resources gResources;
 
+template<typename T>
+inline String Resources::GetTypeName()
+{
+	const std::string typeNameStr = typeid(T).name();
+	return String(typeNameStr.begin(), typeNameStr.end());
+}
+
+template<typename T>
+SharedPtr<Asset> Resources::CreateAsset()
+{
+	return SharedPtr<Asset>(new T());
+}
+
+template<typename T>
+inline AssetID Resources::GetHiddenAssetID()
+{
+	// Type name is built and hashed only once per type
+	static const AssetID id = GetAssetID(DT_TEXT("Hidden") + GetTypeName<T>());
+	return id;
+}
+
 template<typename T>
 SharedPtr<T> Resources::Get()
 {
-	String path = DT_TEXT("Hidden");
-	std::string typeNameStr = typeid(T).name();
-	String typeName(typeNameStr.begin(), typeNameStr.end());
-	path += typeName;
-	if (_assetsMap.find(path) != _assetsMap.end())
+	const AssetID id = GetHiddenAssetID<T>();
+	SharedPtr<T> asset = Find<T>(id);
+	if (asset)
 	{
-		return StaticPointerCast<T>(_assetsMap[path]);
+		return asset;
 	}
 
+	const String typeName = GetTypeName<T>();
 	SharedPtr<T> nAsset(new T());
 	bool result = nAsset->Initialize();
 	if (!result)
@@ -68,66 +201,103 @@ SharedPtr<T> Resources::Get()
 
 	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Initialized asset of type %s"), typeName.c_str());
 
-	_assetsMap.insert(Pair<String, SharedPtr<Asset>>(path, nAsset));
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	_assets.Insert(id, nAsset);
 
-	return StaticPointerCast<T>(_assetsMap[path]);
+	return nAsset;
 }
 
 template<typename T>
-SharedPtr<T> Resources::Get(const String& path)
+inline SharedPtr<T> Resources::Get(const String& path)
 {
-	if (_assetsMap.find(path) != _assetsMap.end())
+	return Get<T>(GetAssetID(path), path);
+}
+
+template<typename T>
+inline SharedPtr<T> Resources::Get(AssetID id, const String& path)
+{
+	// Loaded assets are returned without creating a load request
+	SharedPtr<T> asset = Find<T>(id);
+	if (asset)
 	{
-		return StaticPointerCast<T>(_assetsMap[path]);
+		return asset;
 	}
 
-	std::string typeNameStr = typeid(T).name();
-	String typeName(typeNameStr.begin(), typeNameStr.end());
-	SharedPtr<T> nAsset(new T());
-	bool result = nAsset->Load(path);
-	if (!result)
+	return Wait(LoadAsync<T>(id, path));
+}
+
+template<typename T>
+inline SharedPtr<T> Resources::Find(AssetID id)
+{
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+	SharedPtr<Asset> asset = _assets.Find(id);
+	if (asset)
 	{
-		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot load %s at path: %s"), typeName.c_str(), path.c_str());
-		nAsset->Shutdown();
-		return SharedPtr<T>(nullptr);
+		MarkUsed(id);
 	}
+	return StaticPointerCast<T>(asset);
+}
 
-	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Loaded asset of type %s at path: %s"), typeName.c_str(), path.c_str());
+template<typename T>
+inline AssetLoadHandle<T> Resources::LoadAsync(const String& path)
+{
+	return LoadAsync<T>(GetAssetID(path), path);
+}
 
-	result = nAsset->Initialize();
-	if (!result)
+template<typename T>
+AssetLoadHandle<T> Resources::LoadAsync(AssetID id, const String& path)
+{
+	DT_ASSERT(id == GetAssetID(path), DT_TEXT("Asset ID does not match its path"));
+
+	std::lock_guard<std::mutex> lock(_assetsMutex);
+
+	SharedPtr<Asset> asset = _assets.Find(id);
+	if (asset)
 	{
-		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot initialize %s at path: %s"), typeName.c_str(), path.c_str());
-		nAsset->Shutdown();
-		return SharedPtr<T>(nullptr);
+		DT_ASSERT(asset->GetPath() == path, DT_TEXT("Asset ID collision"));
+		MarkUsed(id);
+		return AssetLoadHandle<T>(SharedPtr<AssetLoadRequest>(new AssetLoadRequest(id, path, GetTypeName<T>(), &CreateAsset<T>, asset, AssetLoadState::Ready)));
+	}
+
+	SharedPtr<AssetLoadRequest>& request = _inFlightRequests[id];
+	if (!request)
+	{
+		request.reset(new AssetLoadRequest(id, path, GetTypeName<T>(), &CreateAsset<T>, CreateAsset<T>(), AssetLoadState::Loading));
+		_loader.Enqueue(request);
 	}
 
-	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Initialized asset of type %s at path: %s"), typeName.c_str(), path.c_str());
+	return AssetLoadHandle<T>(request);
+}
 
-	_assetsMap.insert(Pair<String, SharedPtr<Asset>>(path, nAsset));
+template<typename T>
+SharedPtr<T> Resources::Wait(const AssetLoadHandle<T>& handle)
+{
+	if (!handle.IsValid() || (!handle.IsReady() && !FinishLoad(handle._request)))
+	{
+		return SharedPtr<T>(nullptr);
+	}
 
-	return StaticPointerCast<T>(_assetsMap[path]);
+	return handle.Get();
 }
 
 template<typename T>
 inline SharedPtr<T> Resources::GetCopy(const T& original)
 {
-	SharedPtr<T> nAsset(new T(original));
-	std::string typeNameStr = typeid(T).name();
-	String typeName(typeNameStr.begin(), typeNameStr.end());
-	String path = original.GetPath() + DT_TEXT("_copy");
+	SharedPtr<T> nAsset(new T(original), [](T* asset)
+	{
+		asset->Shutdown();
+		delete asset;
+	});
+	const String typeName = GetTypeName<T>();
 
 	bool result = nAsset->Initialize();
 	if (!result)
 	{
 		gDebug.Printf(LogVerbosity::Error, CHANNEL_ENGINE, DT_TEXT("Cannot initialize copy of a %s"), typeName.c_str());
-		nAsset->Shutdown();
 		return SharedPtr<T>(nullptr);
 	}
 
 	gDebug.Printf(LogVerbosity::Log, CHANNEL_ENGINE, DT_TEXT("Initialized asset copy of type %s"), typeName.c_str());
 
-	_assetsMap.insert(Pair<String, SharedPtr<Asset>>(path, nAsset));
-
-	return StaticPointerCast<T>(_assetsMap[path]);
+	return nAsset;
 }
@@ -1,3 +1,5 @@
+#include "VertexFormats.hlsli"
+
 cbuffer PerFrameBuffer : register(b0)
 {
 	matrix World2ViewMatrix;
@@ -7,20 +9,15 @@ cbuffer PerFrameBuffer : register(b0)
 cbuffer PerObjectBuffer : register(b1)
 {
 	matrix Model2WorldMatrix;
+	float4 PositionDequantizeScale;
+	float4 PositionDequantizeOffset;
 };
 
-cbuffer ColorPerFrameBuffer : register(b2)
+cbuffer ColorPerMaterialBuffer : register(b2)
 {
 	float4 Color;
 }
 
-struct VertexInput
-{
-	float3 Position : POSITION;
-	float3 Normal : NORMAL;
-	float2 UVs : TEXCOORD0;
-};
-
 struct PixelInput
 {
 	float4 Position : SV_POSITION;
@@ -32,11 +29,11 @@ struct PixelInput
 PixelInput main(VertexInput input)
 {
 	PixelInput output;
-	output.Position = mul(float4(input.Position, 1.0f), Model2WorldMatrix);
+	output.Position = mul(float4(DecodePosition(input, PositionDequantizeScale, PositionDequantizeOffset), 1.0f), Model2WorldMatrix);
 	output.Position = mul(output.Position, World2ViewMatrix);
 	output.Position = mul(output.Position, View2ProjectionMatrix);
 
-	output.Normal = (mul(float4(input.Normal, 0.0f), Model2WorldMatrix)).xyz;
+	output.Normal = (mul(float4(DecodeNormal(input), 0.0f), Model2WorldMatrix)).xyz;
 
 	output.UVs = input.UVs;
 
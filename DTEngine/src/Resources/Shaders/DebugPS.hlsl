@@ -0,0 +1,10 @@
+struct PixelInput
+{
+	float4 Position : SV_POSITION;
+	float4 Color : COLOR;
+};
+
+float4 main(PixelInput input) : SV_TARGET
+{
+	return input.Color;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+cbuffer PerFrameBuffer : register(b0)
+{
+	matrix World2ViewMatrix;
+	matrix View2ProjectionMatrix;
+};
+
+struct VertexInput
+{
+	float3 Position : POSITION;
+	float4 Color : COLOR;
+};
+
+struct PixelInput
+{
+	float4 Position : SV_POSITION;
+	float4 Color : COLOR;
+};
+
+// Debug vertices are already in world space
+PixelInput main(VertexInput input)
+{
+	PixelInput output;
+	output.Position = mul(float4(input.Position, 1.0f), World2ViewMatrix);
+	output.Position = mul(output.Position, View2ProjectionMatrix);
+
+	output.Color = input.Color;
+
+	return output;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+Texture2D MainTexture : register(t0);
+SamplerState MainSampler : register(s0);
+
+struct PixelInput
+{
+	float4 Position : SV_POSITION;
+	float3 Normal : NORMAL;
+	float2 UVs : TEXCOORD0;
+	float4 Color : COLOR;
+};
+
+float4 main(PixelInput input) : SV_TARGET
+{
+	return MainTexture.Sample(MainSampler, input.UVs) * input.Color;
+}
\ No newline at end of file
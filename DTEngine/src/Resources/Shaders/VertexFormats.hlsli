@@ -0,0 +1,44 @@
+// Vertex input for all vertex formats (see VertexFormat.h), shaders are compiled once per format
+// Use DecodePosition and DecodeNormal instead of reading position and normal directly
+
+#if !defined(VERTEX_FORMAT_FULL) && !defined(VERTEX_FORMAT_COMPACT) && !defined(VERTEX_FORMAT_QUANTIZED)
+#define VERTEX_FORMAT_FULL 1
+#endif
+
+struct VertexInput
+{
+#if defined(VERTEX_FORMAT_QUANTIZED)
+	// snorm16 relative to mesh bounds
+	float4 Position : POSITION;
+#else
+	float3 Position : POSITION;
+#endif
+#if defined(VERTEX_FORMAT_FULL)
+	float3 Normal : NORMAL;
+#else
+	// Octahedral encoding as snorm16
+	float2 Normal : NORMAL;
+#endif
+	float2 UVs : TEXCOORD0;
+};
+
+float3 DecodePosition(VertexInput input, float4 dequantizeScale, float4 dequantizeOffset)
+{
+#if defined(VERTEX_FORMAT_QUANTIZED)
+	return input.Position.xyz * dequantizeScale.xyz + dequantizeOffset.xyz;
+#else
+	return input.Position;
+#endif
+}
+
+float3 DecodeNormal(VertexInput input)
+{
+#if defined(VERTEX_FORMAT_FULL)
+	return input.Normal;
+#else
+	float3 normal = float3(input.Normal, 1.0f - abs(input.Normal.x) - abs(input.Normal.y));
+	float t = saturate(-normal.z);
+	normal.xy += normal.xy >= 0.0f ? -t : t;
+	return normalize(normal);
+#endif
+}
@@ -10,19 +10,6 @@ BoundingBox::BoundingBox(const DynamicArray<Vector3>& positions)
 	CalculateMinMax(positions);
 }
 
-void BoundingBox::CalculateCorners()
-{
-	_corners.clear();
-	_corners.push_back(Vector3(_min.X, _min.Y, _min.Z));
-	_corners.push_back(Vector3(_min.X, _max.Y, _min.Z));
-	_corners.push_back(Vector3(_max.X, _min.Y, _min.Z));
-	_corners.push_back(Vector3(_max.X, _max.Y, _min.Z));
-	_corners.push_back(Vector3(_min.X, _min.Y, _max.Z));
-	_corners.push_back(Vector3(_min.X, _max.Y, _max.Z));
-	_corners.push_back(Vector3(_max.X, _min.Y, _max.Z));
-	_corners.push_back(Vector3(_max.X, _max.Y, _max.Z));
-}
-
 void BoundingBox::SetMinMax(Vector3 min, Vector3 max)
 {
 	// Ensure that distances in every axis is above 0
@@ -47,8 +34,6 @@ void BoundingBox::SetMinMax(Vector3 min, Vector3 max)
 
 	_min = min;
 	_max = max;
-
-	CalculateCorners();
 }
 
 void BoundingBox::CalculateMinMax(const DynamicArray<Vector3>& positions)
@@ -64,3 +49,20 @@ void BoundingBox::CalculateMinMax(const DynamicArray<Vector3>& positions)
 
 	SetMinMax(minPosition, maxPosition);
 }
+
+BoundingBox BoundingBox::GetTransformed(const Matrix& affineTransform) const
+{
+	const Vector3 center = GetCenter();
+	const Vector3 halfExtents = GetHalfExtents();
+	const Matrix& m = affineTransform;
+
+	const Vector3 worldCenter = Vector3(Vector4(center, 1.0f) * m);
+	const Vector3 worldHalfExtents(abs(m.M11) * halfExtents.X + abs(m.M21) * halfExtents.Y + abs(m.M31) * halfExtents.Z,
+								   abs(m.M12) * halfExtents.X + abs(m.M22) * halfExtents.Y + abs(m.M32) * halfExtents.Z,
+								   abs(m.M13) * halfExtents.X + abs(m.M23) * halfExtents.Y + abs(m.M33) * halfExtents.Z);
+
+	BoundingBox transformed;
+	transformed._min = worldCenter - worldHalfExtents;
+	transformed._max = worldCenter + worldHalfExtents;
+	return transformed;
+}
@@ -4,14 +4,16 @@
 #include "Core/Event.h"
 #include "Math.h"
 
+// Axis aligned box stored as plain min/max values (copying it never allocates)
 struct BoundingBox final
 {
+public:
+	static const unsigned char CORNERS_COUNT = 8;
+
 private:
 	Vector3 _min;
 	Vector3 _max;
 
-	DynamicArray<Vector3> _corners;
-
 public:
 	inline BoundingBox()
 	{}
@@ -19,8 +21,6 @@ public:
 	BoundingBox(const DynamicArray<Vector3>& positions);
 
 private:
-	void CalculateCorners();
-
 	void SetMinMax(Vector3 min, Vector3 max);
 
 public:
@@ -38,9 +38,10 @@ public:
 		return _max;
 	}
 
-	inline const DynamicArray<Vector3>& GetCorners() const
+	// Returns one of 8 corners, bits of index select max (1) or min (0) for X, Y and Z respectively
+	inline Vector3 GetCorner(unsigned char index) const
 	{
-		return _corners;
+		return Vector3((index & 1) ? _max.X : _min.X, (index & 2) ? _max.Y : _min.Y, (index & 4) ? _max.Z : _min.Z);
 	}
 
 	inline Vector3 GetCenter() const
@@ -53,14 +54,9 @@ public:
 		return _max - GetCenter();
 	}
 
-	inline BoundingBox& operator=(const BoundingBox& other)
-	{
-		_min = other._min;
-		_max = other._max;
-		CalculateCorners();
-
-		return *this;
-	}
+	// Returns box enclosing this box transformed by given affine matrix
+	// Transforms only the center and projects extents on world axes instead of transforming all corners
+	BoundingBox GetTransformed(const Matrix& affineTransform) const;
 };
 
 template<typename T>
@@ -2,6 +2,13 @@
 
 #include "Math.h"
 
+enum class ContainmentType
+{
+	Disjoint,
+	Intersects,
+	Contains
+};
+
 struct Plane final
 {
 private:
@@ -13,6 +20,11 @@ public:
 	inline Plane(float a, float b, float c, float d) : _planeVector(a, b, c, d)
 	{}
 
+	inline const Vector4& GetPlaneVector() const
+	{
+		return _planeVector;
+	}
+
 	inline float Dot(const Vector3& worldPoint) const
 	{
 		return _planeVector.X * worldPoint.X + _planeVector.Y * worldPoint.Y + _planeVector.Z * worldPoint.Z + _planeVector.W;
@@ -22,4 +34,44 @@ public:
 	{
 		return _planeVector.X * worldVector.X + _planeVector.Y * worldVector.Y + _planeVector.Z * worldVector.Z + _planeVector.W;
 	}
-};
\ No newline at end of file
+
+	// Returns dot product with the corner of axis aligned box that lies furthest along plane normal
+	// If it's negative, whole box lies behind the plane
+	inline float DotFurthestCorner(const Vector3& min, const Vector3& max) const
+	{
+		return _planeVector.X * (_planeVector.X >= 0.0f ? max.X : min.X)
+			+ _planeVector.Y * (_planeVector.Y >= 0.0f ? max.Y : min.Y)
+			+ _planeVector.Z * (_planeVector.Z >= 0.0f ? max.Z : min.Z)
+			+ _planeVector.W;
+	}
+
+	// Returns dot product with the corner of axis aligned box that lies furthest against plane normal
+	// If it's positive, whole box lies in front of the plane
+	inline float DotNearestCorner(const Vector3& min, const Vector3& max) const
+	{
+		return _planeVector.X * (_planeVector.X >= 0.0f ? min.X : max.X)
+			+ _planeVector.Y * (_planeVector.Y >= 0.0f ? min.Y : max.Y)
+			+ _planeVector.Z * (_planeVector.Z >= 0.0f ? min.Z : max.Z)
+			+ _planeVector.W;
+	}
+};
+
+// Tests axis aligned box against convex volume bounded by planes (with normals pointing inside, i.e. camera frustum)
+inline ContainmentType TestBoxAgainstPlanes(const Plane* planes, unsigned int planesCount, const Vector3& min, const Vector3& max)
+{
+	ContainmentType result = ContainmentType::Contains;
+	for (unsigned int i = 0; i < planesCount; ++i)
+	{
+		if (planes[i].DotFurthestCorner(min, max) < 0.0f)
+		{
+			return ContainmentType::Disjoint;
+		}
+
+		if (planes[i].DotNearestCorner(min, max) < 0.0f)
+		{
+			result = ContainmentType::Intersects;
+		}
+	}
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "Inflate.h"
+
+#include <cstring>
+
+namespace Inflate
+{
+	static const unsigned int MAX_BITS = 15;
+	static const unsigned int FAST_BITS = 9;
+	static const unsigned int LITERALS_COUNT = 288;
+	static const unsigned int DISTANCES_COUNT = 32;
+	static const unsigned int END_OF_BLOCK = 256;
+
+	static const unsigned short LENGTH_BASES[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	static const unsigned char LENGTH_EXTRA_BITS[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	static const unsigned short DISTANCE_BASES[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	static const unsigned char DISTANCE_EXTRA_BITS[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+	// Order in which lengths of code length codes are stored
+	static const unsigned char CODE_LENGTHS_ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	// Deflate stores bits starting with the least significant one, Huffman codes with their first bit first
+	struct BitReader
+	{
+		const unsigned char* Data;
+		const unsigned char* End;
+		unsigned long long Buffer;
+		unsigned int Count;
+		bool IsOverrun;
+
+		inline void Refill()
+		{
+			while (Count <= 56 && Data < End)
+			{
+				Buffer |= (unsigned long long)*Data++ << Count;
+				Count += 8;
+			}
+		}
+
+		inline unsigned int Read(unsigned int bitsCount)
+		{
+			Refill();
+			if (Count < bitsCount)
+			{
+				IsOverrun = true;
+				return 0;
+			}
+
+			const unsigned int value = (unsigned int)(Buffer & ((1ull << bitsCount) - 1));
+			Buffer >>= bitsCount;
+			Count -= bitsCount;
+			return value;
+		}
+	};
+
+	struct Huffman
+	{
+		// Length of the code in upper bits and symbol in lower 9 bits, zero for codes longer than FAST_BITS
+		unsigned short Fast[1 << FAST_BITS];
+		unsigned short Counts[MAX_BITS + 1];
+		// Symbols ordered by their codes
+		unsigned short Symbols[LITERALS_COUNT];
+	};
+
+	static inline unsigned int ReverseBits(unsigned int code, unsigned int length)
+	{
+		unsigned int reversed = 0;
+		for (unsigned int i = 0; i < length; ++i)
+		{
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+		return reversed;
+	}
+
+	// Incomplete codes are allowed, deflate uses them for single distance codes
+	static bool BuildHuffman(Huffman& huffman, const unsigned char* lengths, unsigned int symbolsCount)
+	{
+		memset(huffman.Counts, 0, sizeof(huffman.Counts));
+		memset(huffman.Fast, 0, sizeof(huffman.Fast));
+		for (unsigned int i = 0; i < symbolsCount; ++i)
+		{
+			++huffman.Counts[lengths[i]];
+		}
+		huffman.Counts[0] = 0;
+
+		int left = 1;
+		for (unsigned int length = 1; length <= MAX_BITS; ++length)
+		{
+			left = (left << 1) - huffman.Counts[length];
+			if (left < 0)
+			{
+				return false;
+			}
+		}
+
+		unsigned short offsets[MAX_BITS + 2];
+		unsigned int nextCodes[MAX_BITS + 1];
+		offsets[1] = 0;
+		unsigned int code = 0;
+		for (unsigned int length = 1; length <= MAX_BITS; ++length)
+		{
+			offsets[length + 1] = offsets[length] + huffman.Counts[length];
+			code = (code + (length > 1 ? huffman.Counts[length - 1] : 0)) << 1;
+			nextCodes[length] = code;
+		}
+
+		for (unsigned int symbol = 0; symbol < symbolsCount; ++symbol)
+		{
+			const unsigned int length = lengths[symbol];
+			if (length == 0)
+			{
+				continue;
+			}
+
+			huffman.Symbols[offsets[length]++] = (unsigned short)symbol;
+
+			const unsigned int symbolCode = nextCodes[length]++;
+			if (length <= FAST_BITS)
+			{
+				const unsigned short entry = (unsigned short)((length << 9) | symbol);
+				for (unsigned int i = ReverseBits(symbolCode, length); i < (1u << FAST_BITS); i += 1u << length)
+				{
+					huffman.Fast[i] = entry;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Returns -1 if the code is invalid or the stream ends
+	static inline int Decode(BitReader& reader, const Huffman& huffman)
+	{
+		reader.Refill();
+
+		const unsigned short entry = huffman.Fast[reader.Buffer & ((1 << FAST_BITS) - 1)];
+		const unsigned int entryLength = entry >> 9;
+		if (entry != 0 && entryLength <= reader.Count)
+		{
+			reader.Buffer >>= entryLength;
+			reader.Count -= entryLength;
+			return entry & 0x1FF;
+		}
+
+		// Canonical codes of each length are consecutive, so the code is found by counting codes of shorter lengths
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (unsigned int length = 1; length <= MAX_BITS && length <= reader.Count; ++length)
+		{
+			code |= (int)((reader.Buffer >> (length - 1)) & 1);
+			const int count = huffman.Counts[length];
+			if (code - first < count)
+			{
+				reader.Buffer >>= length;
+				reader.Count -= length;
+				return huffman.Symbols[index + code - first];
+			}
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+
+		return -1;
+	}
+
+	static bool ReadDynamicTables(BitReader& reader, Huffman& literals, Huffman& distances)
+	{
+		const unsigned int literalsCount = reader.Read(5) + 257;
+		const unsigned int distancesCount = reader.Read(5) + 1;
+		const unsigned int codeLengthsCount = reader.Read(4) + 4;
+		if (literalsCount > 286 || distancesCount > 30)
+		{
+			return false;
+		}
+
+		unsigned char lengths[LITERALS_COUNT + DISTANCES_COUNT] = {0};
+		for (unsigned int i = 0; i < codeLengthsCount; ++i)
+		{
+			lengths[CODE_LENGTHS_ORDER[i]] = (unsigned char)reader.Read(3);
+		}
+
+		Huffman codeLengths;
+		if (reader.IsOverrun || !BuildHuffman(codeLengths, lengths, 19))
+		{
+			return false;
+		}
+
+		// Literal and distance lengths are one sequence, repeats may cross from one to the other
+		memset(lengths, 0, sizeof(lengths));
+		unsigned int index = 0;
+		while (index < literalsCount + distancesCount)
+		{
+			const int symbol = Decode(reader, codeLengths);
+			if (symbol < 0)
+			{
+				return false;
+			}
+
+			if (symbol < 16)
+			{
+				lengths[index++] = (unsigned char)symbol;
+				continue;
+			}
+
+			unsigned char value = 0;
+			unsigned int repeatsCount = 0;
+			if (symbol == 16)
+			{
+				if (index == 0)
+				{
+					return false;
+				}
+				value = lengths[index - 1];
+				repeatsCount = 3 + reader.Read(2);
+			}
+			else if (symbol == 17)
+			{
+				repeatsCount = 3 + reader.Read(3);
+			}
+			else
+			{
+				repeatsCount = 11 + reader.Read(7);
+			}
+
+			if (index + repeatsCount > literalsCount + distancesCount)
+			{
+				return false;
+			}
+			memset(lengths + index, value, repeatsCount);
+			index += repeatsCount;
+		}
+
+		if (reader.IsOverrun || lengths[END_OF_BLOCK] == 0)
+		{
+			return false;
+		}
+
+		return BuildHuffman(literals, lengths, literalsCount) && BuildHuffman(distances, lengths + literalsCount, distancesCount);
+	}
+
+	static void BuildFixedTables(Huffman& literals, Huffman& distances)
+	{
+		unsigned char lengths[LITERALS_COUNT];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		BuildHuffman(literals, lengths, LITERALS_COUNT);
+
+		memset(lengths, 5, DISTANCES_COUNT);
+		BuildHuffman(distances, lengths, DISTANCES_COUNT);
+	}
+
+	static bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances, unsigned char* destination, unsigned char*& output, unsigned char* outputEnd)
+	{
+		while (true)
+		{
+			const int symbol = Decode(reader, literals);
+			if (symbol < 0)
+			{
+				return false;
+			}
+
+			if (symbol < (int)END_OF_BLOCK)
+			{
+				if (output == outputEnd)
+				{
+					return false;
+				}
+				*output++ = (unsigned char)symbol;
+				continue;
+			}
+
+			if (symbol == END_OF_BLOCK)
+			{
+				return true;
+			}
+
+			const unsigned int lengthIndex = symbol - 257;
+			if (lengthIndex >= sizeof(LENGTH_BASES) / sizeof(LENGTH_BASES[0]))
+			{
+				return false;
+			}
+			const size_t length = LENGTH_BASES[lengthIndex] + reader.Read(LENGTH_EXTRA_BITS[lengthIndex]);
+
+			const int distanceIndex = Decode(reader, distances);
+			if (distanceIndex < 0 || distanceIndex >= (int)(sizeof(DISTANCE_BASES) / sizeof(DISTANCE_BASES[0])))
+			{
+				return false;
+			}
+			const size_t distance = DISTANCE_BASES[distanceIndex] + reader.Read(DISTANCE_EXTRA_BITS[distanceIndex]);
+
+			if (reader.IsOverrun || distance > (size_t)(output - destination) || length > (size_t)(outputEnd - output))
+			{
+				return false;
+			}
+
+			// Match may overlap the output it is copied to, so it is copied byte by byte
+			const unsigned char* match = output - distance;
+			for (size_t i = 0; i < length; ++i)
+			{
+				output[i] = match[i];
+			}
+			output += length;
+		}
+	}
+
+	bool DecompressZlib(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t destinationSize)
+	{
+		// Deflate method, window up to 32 KB, header checksum, no preset dictionary
+		if (sourceSize < 2 || (source[0] & 0x0F) != 8 || (source[0] >> 4) > 7 || ((source[0] << 8) | source[1]) % 31 != 0 || (source[1] & 0x20) != 0)
+		{
+			return false;
+		}
+
+		BitReader reader = {source + 2, source + sourceSize, 0, 0, false};
+		unsigned char* output = destination;
+		unsigned char* const outputEnd = destination + destinationSize;
+
+		Huffman literals;
+		Huffman distances;
+		bool isFinal = false;
+		while (!isFinal)
+		{
+			isFinal = reader.Read(1) != 0;
+			const unsigned int type = reader.Read(2);
+
+			bool result = false;
+			if (type == 0)
+			{
+				// Stored block starts at byte boundary
+				reader.Read(reader.Count % 8);
+				const unsigned int length = reader.Read(16);
+				const unsigned int lengthComplement = reader.Read(16);
+				if (reader.IsOverrun || length != (~lengthComplement & 0xFFFF) || length > (size_t)(outputEnd - output))
+				{
+					return false;
+				}
+
+				// Part of the block may be in bit buffer already
+				unsigned int remaining = length;
+				while (remaining > 0 && reader.Count >= 8)
+				{
+					*output++ = (unsigned char)reader.Read(8);
+					--remaining;
+				}
+				if (remaining > (size_t)(reader.End - reader.Data))
+				{
+					return false;
+				}
+				memcpy(output, reader.Data, remaining);
+				reader.Data += remaining;
+				output += remaining;
+				result = true;
+			}
+			else if (type == 1)
+			{
+				BuildFixedTables(literals, distances);
+				result = InflateBlock(reader, literals, distances, destination, output, outputEnd);
+			}
+			else if (type == 2)
+			{
+				result = ReadDynamicTables(reader, literals, distances) && InflateBlock(reader, literals, distances, destination, output, outputEnd);
+			}
+
+			if (!result || reader.IsOverrun)
+			{
+				return false;
+			}
+		}
+
+		// Adler-32 checksum is not verified, PNG chunks have their own CRCs
+		return output == outputEnd;
+	}
+}
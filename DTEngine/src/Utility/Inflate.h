@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Decoder of zlib streams (deflate with zlib header), as used by PNG images
+// Huffman codes up to FAST_BITS long are decoded with a single table lookup, longer ones bit by bit
+namespace Inflate
+{
+	// Returns false if data is corrupted, uses a preset dictionary or doesn't decompress to exactly destinationSize bytes
+	bool DecompressZlib(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t destinationSize);
+}
@@ -0,0 +1,195 @@
+#include "LZ4.h"
+
+#include <cstring>
+
+namespace LZ4
+{
+	static const size_t MIN_MATCH = 4;
+	// Last match has to start at least this many bytes before the end of the block
+	static const size_t MATCH_FIND_LIMIT = 12;
+	// Last bytes of the block are always literals
+	static const size_t LAST_LITERALS = 5;
+	static const size_t MAX_OFFSET = 65535;
+	static const unsigned int HASH_BITS = 12;
+
+	static inline unsigned int Read32(const unsigned char* data)
+	{
+		unsigned int value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static inline unsigned int HashSequence(unsigned int sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Writes the part of length which doesn't fit into 4 bits of the token
+	static inline unsigned char* WriteLength(unsigned char* output, size_t length)
+	{
+		length -= 15;
+		while (length >= 255)
+		{
+			*output++ = 255;
+			length -= 255;
+		}
+		*output++ = (unsigned char)length;
+		return output;
+	}
+
+	static unsigned char* WriteSequence(unsigned char* output, const unsigned char* literals, size_t literalsLength, size_t offset, size_t matchLength)
+	{
+		unsigned char* token = output++;
+		*token = (unsigned char)((literalsLength < 15 ? literalsLength : 15) << 4);
+		if (literalsLength >= 15)
+		{
+			output = WriteLength(output, literalsLength);
+		}
+
+		memcpy(output, literals, literalsLength);
+		output += literalsLength;
+
+		// Last sequence has literals only
+		if (matchLength == 0)
+		{
+			return output;
+		}
+
+		*output++ = (unsigned char)(offset & 0xFF);
+		*output++ = (unsigned char)(offset >> 8);
+
+		const size_t storedMatchLength = matchLength - MIN_MATCH;
+		*token |= (unsigned char)(storedMatchLength < 15 ? storedMatchLength : 15);
+		if (storedMatchLength >= 15)
+		{
+			output = WriteLength(output, storedMatchLength);
+		}
+
+		return output;
+	}
+
+	size_t Compress(const unsigned char* source, size_t sourceSize, unsigned char* destination)
+	{
+		unsigned char* output = destination;
+		size_t anchor = 0;
+
+		if (sourceSize > MATCH_FIND_LIMIT)
+		{
+			// Positions are stored + 1, so zero means empty
+			size_t table[1 << HASH_BITS] = {0};
+
+			const size_t matchStartLimit = sourceSize - MATCH_FIND_LIMIT;
+			const size_t matchEndLimit = sourceSize - LAST_LITERALS;
+			size_t position = 0;
+			while (position <= matchStartLimit)
+			{
+				const unsigned int sequence = Read32(source + position);
+				size_t& entry = table[HashSequence(sequence)];
+				const size_t candidate = entry;
+				entry = position + 1;
+
+				if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(source + candidate - 1) != sequence)
+				{
+					++position;
+					continue;
+				}
+
+				const size_t matchPosition = candidate - 1;
+				size_t matchLength = MIN_MATCH;
+				while (position + matchLength < matchEndLimit && source[matchPosition + matchLength] == source[position + matchLength])
+				{
+					++matchLength;
+				}
+
+				output = WriteSequence(output, source + anchor, position - anchor, position - matchPosition, matchLength);
+				position += matchLength;
+				anchor = position;
+			}
+		}
+
+		output = WriteSequence(output, source + anchor, sourceSize - anchor, 0, 0);
+		return output - destination;
+	}
+
+	// Reads the part of length stored after the token, returns false if it runs past the input
+	static inline bool ReadLength(const unsigned char*& input, const unsigned char* inputEnd, size_t& length)
+	{
+		unsigned char value;
+		do
+		{
+			if (input >= inputEnd)
+			{
+				return false;
+			}
+			value = *input++;
+			length += value;
+		}
+		while (value == 255);
+
+		return true;
+	}
+
+	bool Decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t destinationSize)
+	{
+		const unsigned char* input = source;
+		const unsigned char* const inputEnd = source + sourceSize;
+		unsigned char* output = destination;
+		unsigned char* const outputEnd = destination + destinationSize;
+
+		while (input < inputEnd)
+		{
+			const unsigned char token = *input++;
+
+			size_t literalsLength = token >> 4;
+			if (literalsLength == 15 && !ReadLength(input, inputEnd, literalsLength))
+			{
+				return false;
+			}
+			if (literalsLength > (size_t)(inputEnd - input) || literalsLength > (size_t)(outputEnd - output))
+			{
+				return false;
+			}
+
+			memcpy(output, input, literalsLength);
+			input += literalsLength;
+			output += literalsLength;
+
+			if (input == inputEnd)
+			{
+				break;
+			}
+
+			if (inputEnd - input < 2)
+			{
+				return false;
+			}
+			const size_t offset = input[0] | (input[1] << 8);
+			input += 2;
+			if (offset == 0 || offset > (size_t)(output - destination))
+			{
+				return false;
+			}
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+			{
+				return false;
+			}
+			matchLength += MIN_MATCH;
+			if (matchLength > (size_t)(outputEnd - output))
+			{
+				return false;
+			}
+
+			// Match may overlap the output it is copied to, so it is copied byte by byte
+			const unsigned char* match = output - offset;
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				output[i] = match[i];
+			}
+			output += matchLength;
+		}
+
+		return output == outputEnd;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// LZ4 block format (no frame), compatible with the reference implementation
+// Compressor is a simple greedy one, it is meant for offline packing where decompression speed is what matters
+namespace LZ4
+{
+	// Size of destination buffer which is always enough for compressed data
+	inline size_t GetCompressBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	// Returns size of compressed data, destination has to have at least GetCompressBound(sourceSize) bytes
+	size_t Compress(const unsigned char* source, size_t sourceSize, unsigned char* destination);
+
+	// Returns false if data is corrupted or doesn't decompress to exactly destinationSize bytes
+	bool Decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t destinationSize);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cctype>
 
 #include "Core/Platform.h"
@@ -22,6 +23,25 @@ static String GetExtension(const String& path)
 	return extension;
 }
 
+// Returns directory of the path including trailing separator, empty string if there is none
+static String GetDirectory(const String& path)
+{
+	const size_t lastSeparatorIndex = path.find_last_of(DT_TEXT("/\\"));
+	return lastSeparatorIndex == String::npos ? String() : path.substr(0, lastSeparatorIndex + 1);
+}
+
+// Engine paths use forward slashes only and don't start with "./", so the same file always has the same path (and ID)
+static String NormalizePath(const String& path)
+{
+	String normalizedPath = path;
+	std::replace(normalizedPath.begin(), normalizedPath.end(), DT_TEXT('\\'), DT_TEXT('/'));
+	if (normalizedPath.compare(0, 2, DT_TEXT("./")) == 0)
+	{
+		normalizedPath.erase(0, 2);
+	}
+	return normalizedPath;
+}
+
 static bool Contains(const String& string, const String& testString, bool caseSensitive = true)
 {
 	const size_t testStringSize = testString.size();
@@ -1,5 +1,11 @@
 #include "Core/App.h"
 #include "GameFramework/Game.h"
+#include "Debug/Debug.h"
+#include "Debug/SelfTest.h"
+#include "Rendering/Material.h"
+#include "Rendering/Meshes/StaticMesh.h"
+#include "ResourceManagement/PackFile.h"
+#include "Utility/String.h"
 
 #if DT_DEBUG
 #include "vld.h"
@@ -7,8 +13,64 @@
 
 #if DT_WINDOWS
 
+#include <shellapi.h>
+
+// Offline tools run instead of the game:
+// "DTEngine.exe -pack <source directory> <pack path>" builds a pack, shader and texture caches are rebuilt by the engine, so they are left out
+// LODs caches are packed, so meshes loaded from the pack are not simplified again
+// "DTEngine.exe -cook <source mesh> <cooked mesh>" imports a mesh and writes it as .dtmesh
+// "DTEngine.exe -cook <source material> <cooked material>" reads a .dtmat and writes it as .dtcmat
+// "DTEngine.exe -selftest" runs CPU checks of engine systems, exit code is non zero if any of them fails
+static bool TryRunTool(int& exitCode)
+{
+	int argumentsCount = 0;
+	LPWSTR* arguments = CommandLineToArgvW(GetCommandLineW(), &argumentsCount);
+	if (!arguments)
+	{
+		return false;
+	}
+
+	const String tool = argumentsCount > 1 ? arguments[1] : DT_TEXT("");
+	const bool isTool = (argumentsCount == 4 && (tool == DT_TEXT("-pack") || tool == DT_TEXT("-cook"))) || (argumentsCount == 2 && tool == DT_TEXT("-selftest"));
+	if (isTool)
+	{
+		gDebug.Initialize();
+
+		bool result = false;
+		if (tool == DT_TEXT("-selftest"))
+		{
+			result = SelfTest::Run();
+		}
+		else if (tool == DT_TEXT("-pack"))
+		{
+			const DynamicArray<String> excludedExtensions = {DT_TEXT("dtshader"), DT_TEXT("dttexture")};
+			result = PackFile::Build(arguments[2], arguments[3], excludedExtensions, true);
+		}
+		else if (GetExtension(arguments[2]) == DT_TEXT("dtmat"))
+		{
+			result = Material::Cook(arguments[2], arguments[3]);
+		}
+		else
+		{
+			result = StaticMesh::Cook(arguments[2], arguments[3]);
+		}
+
+		gDebug.Shutdown();
+		exitCode = result ? 0 : -1;
+	}
+
+	LocalFree(arguments);
+	return isTool;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
 {
+	int toolExitCode = 0;
+	if (TryRunTool(toolExitCode))
+	{
+		return toolExitCode;
+	}
+
 	{
 		const UniquePtr<App>& app = App::GetInstance();
 		if (app)
@@ -9,7 +9,7 @@ cbuffer PerObjectBuffer : register(b1)
 	matrix Model2WorldMatrix;
 };
 
-cbuffer ColorPerFrameBuffer : register(b2)
+cbuffer ColorPerMaterialBuffer : register(b2)
 {
 	float4 Color;
 }